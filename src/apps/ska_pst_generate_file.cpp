@@ -33,11 +33,14 @@
 
 #include "ska/pst/common/utils/FileWriter.h"
 #include "ska/pst/common/utils/Logging.h"
+#include "ska/pst/common/utils/ThreadedSegmentProducer.h"
+#include "ska/pst/common/utils/Timer.h"
 #include "ska/pst/common/definitions.h"
 
 #include <unistd.h>
 #include <iostream>
 #include <cfloat>
+#include <memory>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -48,6 +51,12 @@ void usage();
 // default duration of output signal
 static const double default_duration = 10.0; // seconds
 
+// default number of heaps generated in each segment
+static const unsigned default_heaps_per_segment = 1;
+
+// default number of segments that the generator thread may produce ahead of the writers
+static const unsigned default_queue_depth = 4;
+
 auto main(int argc, char *argv[]) -> int
 {
   ska::pst::common::setup_spdlog();
@@ -60,13 +69,21 @@ auto main(int argc, char *argv[]) -> int
 
   bool use_o_direct = false;
 
+  bool preallocate = false;
+
+  bool compress_weights = false;
+
+  unsigned heaps_per_segment = default_heaps_per_segment;
+
+  unsigned queue_depth = default_queue_depth;
+
   char verbose = 0;
 
   opterr = 0;
 
   int c = 0;
 
-  while ((c = getopt(argc, argv, "d:hos:T:w:v")) != EOF)
+  while ((c = getopt(argc, argv, "d:hn:opq:s:T:w:vz")) != EOF)
   {
     switch(c)
     {
@@ -75,10 +92,22 @@ auto main(int argc, char *argv[]) -> int
         exit(EXIT_SUCCESS);
         break;
 
+      case 'n':
+        heaps_per_segment = static_cast<unsigned>(atoi(optarg));
+        break;
+
       case 'o':
         use_o_direct = true;
         break;
 
+      case 'p':
+        preallocate = true;
+        break;
+
+      case 'q':
+        queue_depth = static_cast<unsigned>(atoi(optarg));
+        break;
+
       case 'd':
         data_config_filename = optarg;
         break;
@@ -99,6 +128,10 @@ auto main(int argc, char *argv[]) -> int
         verbose++;
         break;
 
+      case 'z':
+        compress_weights = true;
+        break;
+
       default:
         std::cerr << "ERROR: unrecognised option: -" << static_cast<char>(optopt) << std::endl;
         usage();
@@ -137,6 +170,13 @@ auto main(int argc, char *argv[]) -> int
     return EXIT_FAILURE;
   }
 
+  if (heaps_per_segment == 0)
+  {
+    SPDLOG_ERROR("ERROR: number of heaps per segment must be greater than zero");
+    usage();
+    return EXIT_FAILURE;
+  }
+
   std::string output_data_dir = "data";
   std::string output_weights_dir = "weights";
 
@@ -154,12 +194,12 @@ auto main(int argc, char *argv[]) -> int
 
     data_header.set_val("DATA_GENERATOR", signal_generator);
 
-    ska::pst::common::SegmentGenerator generator;
-    generator.configure(data_header, weights_header);
+    auto generator = std::make_shared<ska::pst::common::SegmentGenerator>();
+    generator->configure(data_header, weights_header);
 
     // the SegmentGenerator will initialize some header parameters if necessary
-    data_header = generator.get_data_header();
-    weights_header = generator.get_weights_header();
+    data_header = generator->get_data_header();
+    weights_header = generator->get_weights_header();
 
     std::string utc_start = data_header.get_val("UTC_START");
     uint32_t file_number = data_header.get_uint32("FILE_NUMBER");
@@ -184,14 +224,6 @@ auto main(int argc, char *argv[]) -> int
     std::filesystem::path output_weights_filename = output_weights_path / weights_file_writer.get_filename(utc_start, obs_offset, file_number);
     SPDLOG_DEBUG("ska_pst_generate_file writing weights to file {}", output_weights_filename.generic_string());
 
-    // open output files and write headers
-
-    data_file_writer.open_file(output_data_filename);
-    data_file_writer.write_header(data_header);
-
-    weights_file_writer.open_file(output_weights_filename);
-    weights_file_writer.write_header(weights_header);
-
     // compute the number of heaps to write to file
 
     double bytes_per_second = data_header.compute_bytes_per_second();
@@ -202,31 +234,97 @@ auto main(int argc, char *argv[]) -> int
 
     SPDLOG_DEBUG("ska_pst_generate_file seconds_per_heap={} num_heaps={}", seconds_per_heap, num_heaps);
 
-    unsigned num_heaps_per_loop = 1;
-    generator.resize(num_heaps_per_loop);
+    // preallocate the exact size of each output file
+
+    if (preallocate)
+    {
+      uint64_t data_file_bytes = data_header.get_uint64("HDR_SIZE") + num_heaps * bytes_per_heap;
+      uint64_t weights_file_bytes = weights_header.get_uint64("HDR_SIZE") + num_heaps * weights_header.get_uint64("RESOLUTION");
+      SPDLOG_DEBUG("ska_pst_generate_file preallocating data_file_bytes={} weights_file_bytes={}", data_file_bytes, weights_file_bytes);
+      data_file_writer.set_preallocation_bytes(data_file_bytes);
+      if (!compress_weights)
+      {
+        weights_file_writer.set_preallocation_bytes(weights_file_bytes);
+      }
+    }
+
+    weights_file_writer.set_compression(compress_weights);
+
+    // when pipelined, the weights are written by the asynchronous queue of the weights writer, concurrently with the data
+    if (queue_depth > 0)
+    {
+      weights_file_writer.set_async_depth(1);
+    }
+
+    // open output files and write headers
+
+    data_file_writer.open_file(output_data_filename);
+    data_file_writer.write_header(data_header);
+
+    weights_file_writer.open_file(output_weights_filename);
+    weights_file_writer.write_header(weights_header);
+
+    generator->resize(heaps_per_segment);
+    const uint64_t num_segments = (num_heaps + heaps_per_segment - 1) / heaps_per_segment;
 
-    for (unsigned iheap=0; iheap < num_heaps; iheap++)
+    // when pipelined, the segments are generated on a separate thread, up to queue_depth segments ahead of the writers
+    std::shared_ptr<ska::pst::common::SegmentProducer> producer = generator;
+    if (queue_depth > 0)
+    {
+      producer = std::make_shared<ska::pst::common::ThreadedSegmentProducer>(generator, queue_depth, num_segments, heaps_per_segment);
+    }
+
+    ska::pst::common::Timer timer;
+    uint64_t bytes_written = 0;
+
+    for (uint64_t iheap=0; iheap < num_heaps; iheap += heaps_per_segment)
     {
       SPDLOG_DEBUG("ska_pst_generate_file generating {} of {} heaps", iheap, num_heaps);
-      ska::pst::common::SegmentProducer::Segment segment = generator.next_segment();
+      ska::pst::common::SegmentProducer::Segment segment = producer->next_segment();
 
-      ssize_t data_written = data_file_writer.write_data(segment.data.block, segment.data.size);
-      if (data_written != segment.data.size)
+      // the last segment may contain more heaps than remain to be written
+      const uint64_t segment_heaps = std::min(static_cast<uint64_t>(heaps_per_segment), num_heaps - iheap);
+      const uint64_t data_bytes = segment.data.size / heaps_per_segment * segment_heaps;
+      const uint64_t weights_bytes = segment.weights.size / heaps_per_segment * segment_heaps;
+
+      // when pipelined, the weights write must complete before the next call to next_segment releases the segment
+      ssize_t weights_written = 0;
+      if (queue_depth > 0)
+      {
+        weights_file_writer.write_data_async(segment.weights.block, weights_bytes);
+        weights_written = static_cast<ssize_t>(weights_bytes);
+      }
+      else
       {
-        SPDLOG_ERROR("ska_pst_generate_file wrote only {} of {} bytes of data", data_written, segment.data.size);
+        weights_written = weights_file_writer.write_data(segment.weights.block, weights_bytes);
+      }
+
+      ssize_t data_written = data_file_writer.write_data(segment.data.block, data_bytes);
+      if (queue_depth > 0)
+      {
+        weights_file_writer.wait_for_writes();
+      }
+
+      if (static_cast<uint64_t>(data_written) != data_bytes)
+      {
+        SPDLOG_ERROR("ska_pst_generate_file wrote only {} of {} bytes of data", data_written, data_bytes);
         break;
       }
 
-      ssize_t weights_written = weights_file_writer.write_data(segment.weights.block, segment.weights.size);
-      if (weights_written != segment.weights.size)
+      if (static_cast<uint64_t>(weights_written) != weights_bytes)
       {
-        SPDLOG_ERROR("ska_pst_generate_file wrote only {} of {} bytes of weight", weights_written, segment.weights.size);
+        SPDLOG_ERROR("ska_pst_generate_file wrote only {} of {} bytes of weight", weights_written, weights_bytes);
         break;
       }
+
+      bytes_written += data_bytes + weights_bytes;
     }
 
     data_file_writer.close_file();
     weights_file_writer.close_file();
+
+    SPDLOG_INFO("ska_pst_generate_file wrote {} heaps of data and weights", num_heaps);
+    timer.print_rates(bytes_written);
   }
   catch (std::exception& exc)
   {
@@ -247,6 +345,10 @@ void usage()
   std::cout << "  -s signal     name of signal generator (" << ska::pst::common::get_supported_data_generators_list() << ")" << std::endl;
   std::cout << "  -T seconds    duration of simulated signal (default: " << default_duration << ")" << std::endl;
   std::cout << "  -h            print this help text" << std::endl;
+  std::cout << "  -n heaps      number of heaps generated in each segment (default: " << default_heaps_per_segment << ")" << std::endl;
   std::cout << "  -o            use O_DIRECT for writing file output" << std::endl;
+  std::cout << "  -p            preallocate the expected size of the output files" << std::endl;
+  std::cout << "  -q depth      number of segments generated ahead of the writers, 0 to generate and write serially (default: " << default_queue_depth << ")" << std::endl;
   std::cout << "  -v            verbose output" << std::endl;
+  std::cout << "  -z            compress the weights file" << std::endl;
 }
@@ -98,6 +98,12 @@ namespace ska::pst::common
   //! number of micro seconds in a second
   static constexpr double microseconds_per_second = 1.0_mega;
 
+  //! number of nano seconds in a second
+  static constexpr uint64_t nanoseconds_per_second = 1_giga;
+
+  //! number of nano seconds in a micro second
+  static constexpr uint64_t nanoseconds_per_microsecond = 1_kilo;
+
   //! number of bits in a byte
   static constexpr unsigned bits_per_byte = 8;
 
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <inttypes.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef SKA_PST_COMMON_UTILS_AsyncWriteQueue_h
+#define SKA_PST_COMMON_UTILS_AsyncWriteQueue_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Keeps a bounded number of positioned writes in flight and completes them out of band.
+   *
+   * @details Writes are submitted with an explicit file offset and return as soon as the request is queued.
+   * When the library is built with liburing (HAVE_LIBURING), the requests are submitted to an io_uring and reaped by a
+   * completion thread. Otherwise, or if the io_uring cannot be created, a pool of worker threads performs each request
+   * with pwrite. In both cases, short writes are resubmitted until the request is complete, the optional callback is
+   * invoked from the thread that completed the request, and write blocks while depth requests are in flight (backpressure).
+   * Callbacks are serialised: no two callbacks run concurrently, even when several pwrite workers complete requests at once.
+   * The buffer of each request must remain valid and unmodified until the request completes.
+   *
+   * The first error reported by any request is stored and re-thrown by the next call to write or wait.
+   * If the io_uring completion thread can no longer reap completions, every outstanding request is failed and every
+   * subsequent call to write or wait throws.
+   */
+  class AsyncWriteQueue {
+
+    public:
+
+      /**
+       * @brief Callback invoked when a request has been written in full, never concurrently with another callback.
+       *
+       * @param buffer pointer to the buffer that was written
+       * @param nbytes number of bytes written
+       * @param offset offset in the file at which the buffer was written
+       */
+      using Callback = std::function<void(const char * buffer, uint64_t nbytes, uint64_t offset)>;
+
+      /**
+       * @brief Construct a new AsyncWriteQueue object
+       *
+       * @param depth maximum number of requests in flight, must be greater than zero
+       * @param use_io_uring use io_uring if the library was built with liburing support
+       */
+      AsyncWriteQueue(uint32_t depth, bool use_io_uring = true);
+
+      /**
+       * @brief Destroy the AsyncWriteQueue object, waiting for all requests in flight to complete.
+       *
+       */
+      ~AsyncWriteQueue();
+
+      AsyncWriteQueue(const AsyncWriteQueue&) = delete;
+      auto operator=(const AsyncWriteQueue&) -> AsyncWriteQueue& = delete;
+
+      /**
+       * @brief Submit a write of nbytes from buffer to the file descriptor at offset.
+       * Blocks while the maximum number of requests are in flight.
+       *
+       * @param fd file descriptor opened for writing
+       * @param buffer pointer to the data to write, which must remain valid until the request completes
+       * @param nbytes number of bytes to write
+       * @param offset offset in the file at which to write the data
+       * @param callback optional function invoked when the request completes
+       * @throw std::runtime_error if a previously submitted request failed
+       */
+      void write(int fd, const char * buffer, uint64_t nbytes, uint64_t offset, Callback callback = nullptr);
+
+      /**
+       * @brief Block until all requests in flight have completed.
+       *
+       * @throw std::runtime_error if any request failed
+       */
+      void wait();
+
+      /**
+       * @brief Get the maximum number of requests in flight
+       *
+       * @return uint32_t maximum number of requests in flight
+       */
+      auto get_depth() const -> uint32_t { return depth; }
+
+      /**
+       * @brief Get the number of requests that have been submitted and have not completed
+       *
+       * @return uint32_t number of requests in flight
+       */
+      auto get_in_flight() const -> uint32_t;
+
+      /**
+       * @brief Get the number of requests that have completed
+       *
+       * @return uint64_t number of completed requests
+       */
+      auto get_writes_completed() const -> uint64_t;
+
+      /**
+       * @brief Get the number of bytes written by the completed requests
+       *
+       * @return uint64_t number of bytes written
+       */
+      auto get_bytes_completed() const -> uint64_t;
+
+      /**
+       * @brief Get the number of calls to write that blocked because the maximum number of requests were in flight
+       *
+       * @return uint64_t number of blocked calls to write
+       */
+      auto get_backpressure_waits() const -> uint64_t;
+
+      /**
+       * @brief Return true if the requests are submitted to an io_uring, false if they are written by worker threads
+       *
+       * @return true if io_uring is used
+       */
+      auto uses_io_uring() const -> bool { return ring != nullptr; }
+
+    protected:
+
+      /**
+       * @brief Fail every outstanding request and refuse all further requests.
+       * Pending requests are discarded, the number of requests in flight drops to zero, and the callbacks and accounting
+       * of requests that are still being written are skipped when they complete.
+       *
+       * @param message description of the failure, re-thrown by every subsequent call to write or wait
+       */
+      void fail(const std::string& message);
+
+    private:
+
+      //! A single positioned write
+      struct Request
+      {
+        //! file descriptor to which the data are written
+        int fd{-1};
+
+        //! pointer to the data to write
+        const char * buffer{nullptr};
+
+        //! number of bytes to write
+        uint64_t nbytes{0};
+
+        //! offset in the file at which the data are written
+        uint64_t offset{0};
+
+        //! number of bytes written so far
+        uint64_t done{0};
+
+        //! function invoked when the request completes
+        Callback callback;
+      };
+
+      //! State of the io_uring, defined only when built with liburing
+      struct Ring;
+
+      //! Wait for a free slot, then count the request as in flight
+      void acquire_slot(std::unique_lock<std::mutex>& lock);
+
+      //! Record the completion or failure of a request and release its slot
+      void complete(const Request& request, const std::string& error);
+
+      //! Main loop of each pwrite worker thread
+      void worker_loop();
+
+      //! Write the remainder of a request with pwrite, returning an error message on failure
+      static auto write_request(Request& request) -> std::string;
+
+#ifdef HAVE_LIBURING
+      //! Prepare and submit the remainder of a request to the io_uring, returning an error message on failure
+      auto submit_to_ring(Request * request) -> std::string;
+
+      //! Main loop of the io_uring completion thread
+      void reap_loop();
+#endif
+
+      //! maximum number of requests in flight
+      uint32_t depth;
+
+      //! io_uring state, nullptr if the worker threads are used
+      std::unique_ptr<Ring> ring;
+
+      //! requests waiting for a worker thread
+      std::deque<Request> pending;
+
+      //! worker threads, or the single io_uring completion thread
+      std::vector<std::thread> threads;
+
+      //! serialises access to the queue state
+      mutable std::mutex mutex;
+
+      //! serialises the callbacks of requests completed by different threads
+      std::mutex callback_mutex;
+
+      //! signalled when a request is queued or the queue is stopping
+      std::condition_variable request_queued;
+
+      //! signalled when a request completes
+      std::condition_variable request_completed;
+
+      //! number of requests in flight
+      uint32_t in_flight{0};
+
+      //! number of completed requests
+      uint64_t writes_completed{0};
+
+      //! number of bytes written by the completed requests
+      uint64_t bytes_completed{0};
+
+      //! number of calls to write that blocked on a full queue
+      uint64_t backpressure_waits{0};
+
+      //! first error reported since the last call to wait
+      std::string error;
+
+      //! reason that the queue failed, after which no further requests are accepted
+      std::string failure;
+
+      //! flag that instructs the threads to exit
+      bool stopping{false};
+
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_AsyncWriteQueue_h
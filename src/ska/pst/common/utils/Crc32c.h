@@ -0,0 +1,70 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+
+#ifndef SKA_PST_COMMON_UTILS_Crc32c_h
+#define SKA_PST_COMMON_UTILS_Crc32c_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Compute the CRC-32C (Castagnoli) checksum of a buffer, continuing from a previous checksum.
+   * Uses the SSE4.2 crc32 instruction on three interleaved streams where supported by the CPU,
+   * and otherwise a table-driven implementation. crc32c(b, nb, crc32c(a, na)) equals the checksum of a followed by b.
+   *
+   * @param data pointer to the bytes to checksum
+   * @param nbytes number of bytes to checksum
+   * @param crc checksum of the preceding bytes, zero if there are none
+   * @return uint32_t checksum of the preceding bytes followed by the buffer
+   */
+  auto crc32c(const char * data, uint64_t nbytes, uint32_t crc = 0) -> uint32_t;
+
+  /**
+   * @brief Compute the CRC-32C checksum of a buffer with the table-driven implementation, for testing and for CPUs without SSE4.2
+   *
+   * @param data pointer to the bytes to checksum
+   * @param nbytes number of bytes to checksum
+   * @param crc checksum of the preceding bytes, zero if there are none
+   * @return uint32_t checksum of the preceding bytes followed by the buffer
+   */
+  auto crc32c_software(const char * data, uint64_t nbytes, uint32_t crc = 0) -> uint32_t;
+
+  /**
+   * @brief Return a boolean describing if crc32c uses the SSE4.2 crc32 instruction
+   *
+   * @return true the CPU supports SSE4.2 and the hardware implementation is used
+   * @return false the table-driven implementation is used
+   */
+  auto crc32c_uses_hardware() -> bool;
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_Crc32c_h
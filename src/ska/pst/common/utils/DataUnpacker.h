@@ -30,9 +30,22 @@
 
 #include "ska/pst/common/utils/AsciiHeader.h"
 #include "ska/pst/common/utils/HeapLayout.h"
+#include "ska/pst/common/utils/PackedSamples.h"
+#include "ska/pst/common/utils/PacketKernels.h"
+#include "ska/pst/common/utils/ReducedPrecision.h"
+#include "ska/pst/common/utils/SegmentProducer.h"
+#include "ska/pst/common/utils/UnpackedView.h"
+#include "ska/pst/common/utils/UnpackKernels.h"
+#include "ska/pst/common/utils/WeightsDecoder.h"
+#include "ska/pst/common/utils/WorkerPool.h"
 
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <complex>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <type_traits>
 
 #ifndef SKA_PST_COMMON_UTILS_DataUnpacker_h
 #define SKA_PST_COMMON_UTILS_DataUnpacker_h
@@ -59,6 +72,9 @@ namespace ska::pst::common
        */
       virtual ~DataUnpacker() = default;
 
+      //! Alignment, in bytes, of the contiguous unpacked data buffer
+      static constexpr uint64_t unpacked_buffer_alignment = 64;
+
       /**
        * @brief Configure the data unpacker with the AsciiHeader from the data and weights streams
        *
@@ -80,6 +96,152 @@ namespace ska::pst::common
        */
       auto unpack(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz) -> std::vector<std::vector<std::vector<std::complex<float>>>> &;
 
+      /**
+       * @brief Unpack the data and weights streams into a contiguous, aligned buffer owned by the DataUnpacker.
+       * The buffer is only reallocated when it is too small to store the unpacked data, so that repeated
+       * calls with the same data_bufsz do not allocate memory. Samples from invalid packets are set to zero.
+       *
+       * @param data pointer to raw data array
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to raw weights array
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @return UnpackedView<std::complex<float>> view of the unpacked data in the order returned by get_unpacked_order,
+       * which remains valid until the next call to unpack_flat
+       */
+      auto unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz) -> UnpackedView<std::complex<float>>;
+
+      /**
+       * @brief Unpack the data and weights streams into a contiguous buffer supplied by the caller.
+       * Samples from invalid packets are set to zero.
+       *
+       * @param data pointer to raw data array
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to raw weights array
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @param output base address of the buffer into which the data will be unpacked
+       * @param output_nval number of complex values that can be stored in output, see get_unpacked_nval
+       * @return UnpackedView<std::complex<float>> view of output in the order returned by get_unpacked_order
+       */
+      auto unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, std::complex<float> * output, uint64_t output_nval) -> UnpackedView<std::complex<float>>;
+
+      /**
+       * @brief Unpack the data and weights streams into a contiguous buffer of 16-bit complex integers supplied by the caller.
+       * Each value is multiplied by the reciprocal of the packet scale factor (unless disabled with set_apply_scale_factors),
+       * rounded to nearest and saturated. Samples from invalid packets are set to zero.
+       *
+       * @param data pointer to the raw data array to unpack
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to the raw weights array to unpack
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @param output pointer to the output array, which must store at least get_unpacked_nval(data_bufsz) values
+       * @param output_nval number of complex values that can be stored in output
+       * @return UnpackedView<ComplexInt16> view of output in the order returned by get_unpacked_order
+       */
+      auto unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, ComplexInt16 * output, uint64_t output_nval) -> UnpackedView<ComplexInt16>;
+
+      /**
+       * @brief Unpack the data and weights streams into a contiguous buffer of half-precision complex values supplied by the caller.
+       * Each value is multiplied by the reciprocal of the packet scale factor, unless disabled with set_apply_scale_factors.
+       * Samples from invalid packets are set to zero.
+       *
+       * @param data pointer to the raw data array to unpack
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to the raw weights array to unpack
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @param output pointer to the output array, which must store at least get_unpacked_nval(data_bufsz) values
+       * @param output_nval number of complex values that can be stored in output
+       * @return UnpackedView<ComplexFP16> view of output in the order returned by get_unpacked_order
+       */
+      auto unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, ComplexFP16 * output, uint64_t output_nval) -> UnpackedView<ComplexFP16>;
+
+      /**
+       * @brief Unpack the data and weights streams into a contiguous buffer of bfloat16 complex values supplied by the caller.
+       * Each value is multiplied by the reciprocal of the packet scale factor, unless disabled with set_apply_scale_factors.
+       * Samples from invalid packets are set to zero.
+       *
+       * @param data pointer to the raw data array to unpack
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to the raw weights array to unpack
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @param output pointer to the output array, which must store at least get_unpacked_nval(data_bufsz) values
+       * @param output_nval number of complex values that can be stored in output
+       * @return UnpackedView<ComplexBF16> view of output in the order returned by get_unpacked_order
+       */
+      auto unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, ComplexBF16 * output, uint64_t output_nval) -> UnpackedView<ComplexBF16>;
+
+      /**
+       * @brief Set whether unpack and unpack_flat multiply each sample by the reciprocal of its packet scale factor.
+       * When disabled, the samples retain the quantised values, which is exact for 16-bit integer output of
+       * 2, 4 and 8 bit data, and the reciprocal scale factor of each packet is available from get_packet_scales.
+       *
+       * @param apply true if the scale factors are applied to the unpacked samples
+       */
+      void set_apply_scale_factors(bool apply) { apply_scale_factors = apply; };
+
+      /**
+       * @brief Get whether unpack and unpack_flat multiply each sample by the reciprocal of its packet scale factor
+       *
+       * @return true if the scale factors are applied to the unpacked samples
+       */
+      auto get_apply_scale_factors() const -> bool { return apply_scale_factors; };
+
+      /**
+       * @brief Get the reciprocal of the scale factor of each packet in the most recently unpacked or integrated block, indexed
+       * by packet number (heap * packets per heap + packet), with zero for invalid packets.
+       * Multiplying the samples of a packet by this value yields the samples that would be unpacked with scale factors applied.
+       *
+       * @return const std::vector<float>& reciprocal scale factor of each packet
+       */
+      auto get_packet_scales() const -> const std::vector<float>& { return weights_decoder.get_reciprocal_scales(); };
+
+      //! Callback that receives each window of unpacked data and the byte offset, from the start of the data stream, of the first heap in the window
+      using WindowCallback = std::function<void(const UnpackedView<std::complex<float>>& window, uint64_t obs_offset)>;
+
+      /**
+       * @brief Unpack every segment returned by a SegmentProducer, at most nheaps_per_window heaps at a time,
+       * into a fixed window of the contiguous, aligned buffer owned by the DataUnpacker. Each window is passed
+       * to the callback before the next window is unpacked, so that the memory used is independent of the
+       * size of the segments and the length of the stream. Unpacking ends when the producer returns an empty segment.
+       *
+       * @param producer source of the data and weights segments, which must match the headers passed to configure
+       * @param nheaps_per_window maximum number of heaps unpacked into each window
+       * @param callback function called with the view of each window, which remains valid until the callback returns
+       * @return uint64_t total number of heaps unpacked
+       */
+      auto unpack_stream(SegmentProducer& producer, uint32_t nheaps_per_window, const WindowCallback& callback) -> uint64_t;
+
+      /**
+       * @brief Set the ordering of the data returned by unpack_flat.
+       * The samples are reordered from the heap, packet, pol, chan, samp input order one packet at a time,
+       * so that each sample is read and written only once, without a separate transpose of the block.
+       *
+       * @param order ordering of the unpacked data, TFP by default
+       */
+      void set_unpacked_order(UnpackedOrder order) { unpacked_order = order; };
+
+      /**
+       * @brief Get the ordering of the data returned by unpack_flat
+       *
+       * @return UnpackedOrder ordering of the unpacked data
+       */
+      auto get_unpacked_order() const -> UnpackedOrder { return unpacked_order; };
+
+      /**
+       * @brief Get the number of time samples that will be unpacked from a raw data array
+       *
+       * @param data_bufsz size of the raw data array in bytes
+       * @return uint64_t number of time samples
+       */
+      auto get_unpacked_nsamp(uint64_t data_bufsz) const -> uint64_t;
+
+      /**
+       * @brief Get the number of complex values that will be unpacked from a raw data array
+       *
+       * @param data_bufsz size of the raw data array in bytes
+       * @return uint64_t number of complex values
+       */
+      auto get_unpacked_nval(uint64_t data_bufsz) const -> uint64_t;
+
       /**
        * @brief Integrate the data and weights streams into the bandpass member attribute.
        * bandpass is a two dimensional floating point vector that is resized within this
@@ -105,164 +267,370 @@ namespace ska::pst::common
        */
       void reset();
 
+      /**
+       * @brief Set the number of threads used to unpack and integrate the heaps in each block.
+       * The heaps in each block are partitioned into contiguous ranges, one per thread. Each thread
+       * integrates into its own bandpass accumulator, which is added to the bandpass once all threads
+       * have completed. The calling thread processes the first range, and a persistent pool of nthreads-1
+       * threads, started by this method and joined when the DataUnpacker is destroyed, processes the others.
+       *
+       * @param nthreads number of threads, must be greater than zero
+       */
+      void set_nthreads(unsigned nthreads);
+
+      /**
+       * @brief Get the number of threads used to unpack and integrate the heaps in each block
+       *
+       * @return unsigned number of threads
+       */
+      auto get_nthreads() const -> unsigned { return static_cast<unsigned>(workers.size()); };
+
+      /**
+       * @brief Return true if configure selected kernels that are specialised at compile time for the packet geometry
+       *
+       * @return true if unpack_flat and integrate_bandpass use specialised kernels
+       * @return false if unpack_flat and integrate_bandpass use the generic implementation
+       */
+      auto has_packet_kernels() const -> bool { return packet_kernels.unpack != nullptr; };
+
+      /**
+       * @brief Get the number of dropped packets (scale factor = NaN) encountered since the last reset
+       *
+       * @return uint64_t number of invalid packets
+       */
+      auto get_invalid_packets() const -> uint64_t { return invalid_packets; };
+
+      /**
+       * @brief Get the number of invalid samples, arising from invalid packets, encountered since the last reset
+       *
+       * @return uint64_t number of invalid samples
+       */
+      auto get_invalid_samples() const -> uint64_t { return invalid_samples; };
+
     protected:
 
     private:
 
+      //! Scratch storage and counters used by a single thread when processing a range of heaps
+      struct WorkerState
+      {
+        //! Storage for one row of converted samples from a single channel and polarisation of a packet, of any output type no larger than std::complex<float>
+        std::vector<std::complex<float>> packet_row;
+
+        //! Row of zero-valued samples written in place of the samples from invalid packets, of any output type for which all bits zero is zero
+        std::vector<std::complex<float>> zero_row;
+
+        //! Storage for one row of 2 or 4 bit samples expanded to 8-bit integers
+        std::vector<int8_t> expanded_row;
+
+        //! Bandpass accumulated by this thread, ordered by frequency then polarisation
+        std::vector<float> bandpass;
+
+        //! Number of invalid packets encountered by this thread
+        uint64_t invalid_packets{0};
+
+        //! Number of invalid samples encountered by this thread
+        uint64_t invalid_samples{0};
+      };
+
       /**
-       * @brief Templated method to unpack 8 or 16 bit integers from data and weights pointers into the unpacked vector.
-       * The unpacked vector (private member attribute) must have been resized through a call to resize() before caling
-       * this method.
+       * @brief Partition the heaps of a block into contiguous ranges and process each range with a separate thread of the pool.
+       * When only one thread is configured, or there is only one heap, the heaps are processed on the calling thread.
+       * Any exception thrown by a worker is rethrown on the calling thread after all workers have completed.
        *
-       * @tparam T type of input data to unpack [int8_t or int16_t]
-       * @param in pointer to the input data array
-       * @param weights  pointer to the input weights array
-       * @param nheaps number of packed heaps to unpack.
+       * @tparam Func functor with signature void(uint32_t heap_begin, uint32_t heap_end, WorkerState& state)
+       * @param nheaps number of heaps in the block
+       * @param func functor that processes heaps in the range [heap_begin, heap_end)
        */
-      template <typename T>
-      void unpack_samples(const T* in, char * weights, uint32_t nheaps)
+      template <typename Func>
+      void process_heaps(uint32_t nheaps, Func func)
       {
-        const uint32_t packets_per_heap = layout.get_packets_per_heap();
-        const uint32_t nsamp_per_packet = layout.get_packet_layout().get_samples_per_packet();
-        const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
+        for (auto& state : workers)
+        {
+          state.invalid_packets = 0;
+          state.invalid_samples = 0;
+        }
 
-        const uint32_t nsamp = nheaps * nsamp_per_packet;
-        if (unpacked.size() != nsamp)
+        const auto nthreads = static_cast<uint32_t>(std::min(static_cast<size_t>(nheaps), workers.size()));
+        if (nthreads <= 1)
         {
-          SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_samples unpacked.size() [{}] did not match the number of samples to unpack [{}]", unpacked.size(), nsamp);
-          throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_samples size of unpacked did not match nsamp");
+          func(0, nheaps, workers[0]);
         }
-        if (unpacked[0].size() != nchan)
+        else
         {
-          SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_samples unpacked[0].size() [{}] did not match the number of channels to unpack [{}]", unpacked[0].size(), nchan);
-          throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_samples size of unpacked[0] did not match nchan");
+          pool->run(nthreads, [&](unsigned ithread) {
+            const auto heap_begin = static_cast<uint32_t>((static_cast<uint64_t>(nheaps) * ithread) / nthreads);
+            const auto heap_end = static_cast<uint32_t>((static_cast<uint64_t>(nheaps) * (ithread + 1)) / nthreads);
+            func(heap_begin, heap_end, workers[ithread]);
+          });
         }
-        if (unpacked[0][0].size() != npol)
+
+        for (auto& state : workers)
         {
-          SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_samples unpacked[0][0].size() [{}] did not match the number of polarisations to unpack [{}]", unpacked[0][0].size(), npol);
-          throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_samples size of unpacked[0][0] did not match npol");
+          invalid_packets += state.invalid_packets;
+          invalid_samples += state.invalid_samples;
         }
+      }
+
+      /**
+       * @brief Templated method to unpack the samples in a range of heaps from a data pointer into an output array.
+       * The validity of each packet is tested once, and each row of nsamp_per_packet complex samples from a
+       * single channel and polarisation is converted with the convert functor, one block of nsamp_per_weight samples
+       * at a time, multiplying by the reciprocal of the packet scale factor and the mask value of the relative weight.
+       * Each converted row is passed to the store functor, which writes it to the output array.
+       * The weights of the block must have been decoded by weights_decoder before calling this method.
+       *
+       * @tparam T type of each unpacked complex value
+       * @tparam Convert functor with signature void(const char* in, uint32_t nsamp, float scale, T* out)
+       * @tparam Store functor with signature void(uint64_t osamp, uint32_t ochan, uint32_t ipol, const T* row, uint32_t nsamp)
+       * @param data pointer to the raw data array
+       * @param heap_begin index of the first heap to unpack
+       * @param heap_end index of the heap after the last heap to unpack
+       * @param convert functor that converts a row of raw samples to complex values
+       * @param store functor that stores a row of complex values
+       * @param state scratch storage and counters of the calling thread
+       */
+      template <typename T, typename Convert, typename Store>
+      void unpack_rows(const char* data, uint32_t heap_begin, uint32_t heap_end, Convert& convert, Store& store, WorkerState& state)
+      {
+        const uint32_t nsamp_per_packet = layout.get_packet_layout().get_samples_per_packet();
+        const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
+        const uint64_t row_stride = layout.get_data_packet_stride() / (npol * nchan_per_packet);
+        const uint32_t nsamp_per_block = weights_decoder.get_nsamp_per_block();
+        const uint32_t nblocks_per_chan = weights_decoder.get_nblocks_per_chan();
+        // exact, as PacketLayout requires the WT_NSAMP samples of each block to fill a whole number of bytes
+        const uint64_t block_stride = row_stride / nblocks_per_chan;
+
+        static_assert(sizeof(T) <= sizeof(std::complex<float>), "unpacked type must fit in the scratch rows");
+        state.packet_row.resize(nsamp_per_packet);
+        state.zero_row.assign(nsamp_per_packet, std::complex<float>(0, 0));
+        T * packet_row = reinterpret_cast<T *>(state.packet_row.data()); // NOLINT
+        const T * zero_row = reinterpret_cast<const T *>(state.zero_row.data()); // NOLINT
 
         // Unpack quantised data store in heap, packet, pol, chan_block, samp_block ordering used in CBF/PSR formats
-        uint32_t packet_number = 0;
-        for (uint32_t iheap=0; iheap<nheaps; iheap++)
+        for (const auto& packet : layout.get_packets(data, nullptr, heap_begin, heap_end))
         {
-          for (uint32_t ipacket=0; ipacket<packets_per_heap; ipacket++)
+          const bool valid = weights_decoder.is_valid(packet.packet_number);
+          const float output_scale = apply_scale_factors ? weights_decoder.get_reciprocal_scale(packet.packet_number) : 1.0f;
+          const float * packet_mask = weights_decoder.get_packet_mask(packet.packet_number);
+          if (!valid)
           {
-            const float scale_factor = get_scale_factor(weights, packet_number);
-            if (std::isnan(scale_factor))
-            {
-              invalid_packets++;
-            }
-            for (uint32_t ipol=0; ipol<npol; ipol++)
+            state.invalid_packets++;
+            state.invalid_samples += static_cast<uint64_t>(npol) * nchan_per_packet * nsamp_per_packet;
+          }
+
+          const char* in = packet.data;
+          for (uint32_t ipol=0; ipol<npol; ipol++)
+          {
+            for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
             {
-              for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
+              const uint32_t ochan = packet.chan_begin + ichan;
+              if (valid)
               {
-                const uint32_t ochan = (ipacket * nchan_per_packet) + ichan;
-                for (uint32_t isamp=0; isamp<nsamp_per_packet; isamp++)
+                const float * chan_mask = packet_mask + (ichan * nblocks_per_chan); // NOLINT
+                for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
                 {
-                  if (std::isnan(scale_factor))
-                  {
-                    invalid_samples++;
-                  }
-                  else
-                  {
-                    uint32_t osamp = (iheap * nsamp_per_packet) + isamp;
-                    unpacked[osamp][ochan][ipol] = std::complex<float>(static_cast<float>(in[0]), static_cast<float>(in[1])) / scale_factor; // NOLINT
-                  }
-                  in += 2; // NOLINT
+                  convert(in + (iblock * block_stride), nsamp_per_block, output_scale * chan_mask[iblock], packet_row + (iblock * nsamp_per_block)); // NOLINT
                 }
+                store(packet.samp_begin, ochan, ipol, packet_row, nsamp_per_packet);
               }
+              else
+              {
+                store(packet.samp_begin, ochan, ipol, zero_row, nsamp_per_packet);
+              }
+              in += row_stride; // NOLINT
             }
-            packet_number++;
           }
         }
       }
 
       /**
-       * @brief Templated method to unpack 8 or 16 bit integers from data and weights pointers into the bandpass vector.
-       * The bandpass vector (private member attribute) must have been resized through a call to resize() before caling
-       * this method.
+       * @brief Unpack the 2, 4, 8 or 16 bit integers in the raw data array using the provided store functor.
+       * The 8 and 16 bit integers are converted with the vectorised kernels and the packed 2 and 4 bit integers with lookup tables.
+       * The packed integers are first expanded to 8-bit integers when converting to reduced-precision output.
        *
-       * @tparam T type of input data to unpack [int8_t or int16_t]
-       * @param in pointer to the input data array
-       * @param weights  pointer to the input weights array
+       * @tparam T type of each unpacked complex value
+       * @tparam Store functor with signature void(uint64_t osamp, uint32_t ochan, uint32_t ipol, const T* row, uint32_t nsamp)
+       * @param data pointer to raw data array
        * @param nheaps number of packed heaps to unpack.
+       * @param store functor that writes each row of unpacked samples to the output array, must be safe to call concurrently for different heaps
        */
-      template <typename T>
-      void integrate_samples(const T* in, char * weights, uint32_t nheaps)
+      template <typename T, typename Store>
+      void unpack_nbit(char * data, uint32_t nheaps, Store store)
+      {
+        process_heaps(nheaps, [&](uint32_t heap_begin, uint32_t heap_end, WorkerState& state) {
+          if (nbit == 8) // NOLINT
+          {
+            auto convert = [](const char* in, uint32_t nsamp, float scale, T* out) {
+              convert_complex_samples(reinterpret_cast<const int8_t*>(in), nsamp, scale, out);
+            };
+            unpack_rows<T>(data, heap_begin, heap_end, convert, store, state);
+          }
+          else if (nbit == 16) // NOLINT
+          {
+            auto convert = [](const char* in, uint32_t nsamp, float scale, T* out) {
+              convert_complex_samples(reinterpret_cast<const int16_t*>(in), nsamp, scale, out);
+            };
+            unpack_rows<T>(data, heap_begin, heap_end, convert, store, state);
+          }
+          else if constexpr (std::is_same_v<T, std::complex<float>>)
+          {
+            auto convert = [this](const char* in, uint32_t nsamp, float scale, T* out) {
+              convert_packed_complex_samples(in, nsamp, nbit, scale, out);
+            };
+            unpack_rows<T>(data, heap_begin, heap_end, convert, store, state);
+          }
+          else
+          {
+            auto convert = [this, &state](const char* in, uint32_t nsamp, float scale, T* out) {
+              state.expanded_row.resize(static_cast<uint64_t>(nsamp) * 2);
+              unpack_values(in, state.expanded_row.size(), nbit, state.expanded_row.data());
+              convert_complex_samples(state.expanded_row.data(), nsamp, scale, out);
+            };
+            unpack_rows<T>(data, heap_begin, heap_end, convert, store, state);
+          }
+        });
+      }
+
+      /**
+       * @brief Templated method to integrate the power of the samples in a range of heaps from a data pointer into
+       * the bandpass accumulator of the calling thread. The power of each block of nsamp_per_weight samples is multiplied
+       * by the mask value of its relative weight. The bandpass accumulator must have been zeroed, and the weights of the
+       * block decoded by weights_decoder, before calling this method.
+       *
+       * @tparam Power functor with signature float(const char* in, uint32_t nsamp) that returns the summed power of a row of packed samples
+       * @param data pointer to the raw data array
+       * @param heap_begin index of the first heap to integrate
+       * @param heap_end index of the heap after the last heap to integrate
+       * @param power functor that returns the summed power of a row of raw samples
+       * @param state scratch storage and counters of the calling thread
+       */
+      template <typename Power>
+      void integrate_rows(const char* data, uint32_t heap_begin, uint32_t heap_end, Power& power, WorkerState& state)
       {
-        const uint32_t packets_per_heap = layout.get_packets_per_heap();
         const uint32_t nsamp_per_packet = layout.get_packet_layout().get_samples_per_packet();
         const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
-        
-        if (bandpass.size() != nchan)
-        {
-          SPDLOG_ERROR("ska::pst::common::DataUnpacker::integrate_samples bandpass.size() [{}] did not match the number of channels to unpack [{}]", bandpass.size(), nchan);
-          throw std::runtime_error("ska::pst::common::DataUnpacker::integrate_samples size of bandpass did not match nchan");
-        }
-        if (bandpass[0].size() != npol)
-        {
-          SPDLOG_ERROR("ska::pst::common::DataUnpacker::integrate_samples bandpass[0].size() [{}] did not match the number of polarisations to unpack [{}]", bandpass[0].size(), npol);
-          throw std::runtime_error("ska::pst::common::DataUnpacker::integrate_samples size of bandpass[0] did not match npol");
-        }
+        const uint64_t row_stride = layout.get_data_packet_stride() / (npol * nchan_per_packet);
+        const uint32_t nsamp_per_block = weights_decoder.get_nsamp_per_block();
+        const uint32_t nblocks_per_chan = weights_decoder.get_nblocks_per_chan();
+        // exact, as PacketLayout requires the WT_NSAMP samples of each block to fill a whole number of bytes
+        const uint64_t block_stride = row_stride / nblocks_per_chan;
 
         // Unpack quantised data store in heap, packet, pol, chan_block, samp_block ordering
         // used in CBF/PSR formats
-        uint32_t packet_number = 0;
-        std::complex<float> sample{0,0};
-        for (uint32_t iheap=0; iheap<nheaps; iheap++)
+        for (const auto& packet : layout.get_packets(data, nullptr, heap_begin, heap_end))
         {
-          for (uint32_t ipacket=0; ipacket<packets_per_heap; ipacket++)
+          // skip the entire packet if the scale factor is invalid
+          if (!weights_decoder.is_valid(packet.packet_number))
           {
-            const float scale_factor = get_scale_factor(weights, packet_number);
-            if (std::isnan(scale_factor))
-            {
-              invalid_packets++;
-            }
+            state.invalid_packets++;
+            state.invalid_samples += static_cast<uint64_t>(npol) * nchan_per_packet * nsamp_per_packet;
+            continue;
+          }
 
-            for (uint32_t ipol=0; ipol<npol; ipol++)
+          // the power in each scaled sample is the power in the raw sample multiplied by the squared reciprocal of the scale factor
+          const float inverse_scale = weights_decoder.get_reciprocal_scale(packet.packet_number);
+          const float inverse_scale_squared = inverse_scale * inverse_scale;
+          const float * packet_mask = weights_decoder.get_packet_mask(packet.packet_number);
+          const char* in = packet.data;
+          for (uint32_t ipol=0; ipol<npol; ipol++)
+          {
+            for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
             {
-              for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
+              const uint32_t ochan = packet.chan_begin + ichan;
+              const float * chan_mask = packet_mask + (ichan * nblocks_per_chan); // NOLINT
+              float row_power = 0;
+              for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
               {
-                const uint32_t ochan = (ipacket * nchan_per_packet) + ichan;
-                for (uint32_t isamp=0; isamp<nsamp_per_packet; isamp++)
-                {
-                  if (std::isnan(scale_factor))
-                  {
-                    invalid_samples++;
-                  }
-                  else
-                  {
-                    sample = std::complex<float>(static_cast<float>(in[0]), static_cast<float>(in[1])) / scale_factor;  // NOLINT
-                    // integrate the power in each complex sample into the bandpass
-                    float power = sample.real() * sample.real() + sample.imag() * sample.imag();
-                    bandpass[ochan][ipol] += power;
-                  }
-                  in += 2; // NOLINT
-                }
+                row_power += power(in + (iblock * block_stride), nsamp_per_block) * chan_mask[iblock]; // NOLINT
               }
+              state.bandpass[(ochan * npol) + ipol] += row_power * inverse_scale_squared;
+              in += row_stride; // NOLINT
             }
-            packet_number++;
           }
         }
       }
 
+      /**
+       * @brief Unpack the heaps in the raw data array into the view using the specialised packet kernels.
+       * The samples in zero-weighted blocks of partially weighted packets are set to zero after unpacking.
+       *
+       * @param data pointer to raw data array
+       * @param nheaps number of packed heaps to unpack
+       * @param view output in any UnpackedOrder
+       */
+      void unpack_packets(char * data, uint32_t nheaps, UnpackedView<std::complex<float>>& view);
+
+      /**
+       * @brief Unpack the data and weights streams into a contiguous buffer of any supported complex type
+       *
+       * @tparam T type of each unpacked complex value
+       * @param data pointer to the raw data array to unpack
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to the raw weights array to unpack
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @param output pointer to the output array
+       * @param output_nval number of complex values that can be stored in output
+       * @return UnpackedView<T> view of output in the order returned by get_unpacked_order
+       */
+      template <typename T>
+      auto unpack_view(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, T * output, uint64_t output_nval) -> UnpackedView<T>;
+
+      /**
+       * @brief Integrate the heaps in the raw data array into the bandpass accumulator of each thread using the specialised packet kernels.
+       * Partially weighted packets are integrated one block of samples at a time.
+       *
+       * @param data pointer to raw data array
+       * @param nheaps number of packed heaps to integrate
+       */
+      void integrate_packets(char * data, uint32_t nheaps);
+
       //! Unpacked data vector
       std::vector<std::vector<std::vector<std::complex<float>>>> unpacked;
 
+      //! Releases memory allocated with posix_memalign
+      struct AlignedDeleter
+      {
+        void operator()(std::complex<float> * ptr) const { free(ptr); } // NOLINT
+      };
+
+      //! Contiguous, aligned buffer of unpacked data
+      std::unique_ptr<std::complex<float>, AlignedDeleter> unpacked_buffer;
+
+      //! Ordering of the data returned by unpack_flat
+      UnpackedOrder unpacked_order{TFP};
+
+      //! Flag to multiply the unpacked samples by the reciprocal of the packet scale factor
+      bool apply_scale_factors{true};
+
+
+      //! Number of complex values that can be stored in unpacked_buffer
+      uint64_t unpacked_buffer_nval{0};
+
+      //! Ensure that unpacked_buffer can store at least nval complex values
+      void resize_unpacked_buffer(uint64_t nval);
+
+      //! Scratch storage and counters of each thread, one per thread
+      std::vector<WorkerState> workers = std::vector<WorkerState>(1);
+
+      //! Persistent threads that process the heaps of each block when more than one thread is configured
+      std::unique_ptr<WorkerPool> pool;
+
       //! Integrated bandpass
       std::vector<std::vector<float>> bandpass;
 
       //! Resize the internal storage of the unpacked and bandpass vectors
       void resize(uint64_t data_bufsz);
 
-      //! Return the scale factor packed into the weights array, corresponding to the provided packet number
-      auto get_scale_factor(char * weights, uint32_t packet_number) -> float;
+      //! Decodes the scale factors and relative weights of each block
+      WeightsDecoder weights_decoder;
 
       //! The layout of data, weights and scales in each heap
       HeapLayout layout;
 
+      //! Kernels specialised for the packet geometry, selected during configure
+      PacketKernels packet_kernels;
+
       //! Number of polarisations in the data stream
       uint32_t npol{0};
 
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdint>
+
+#ifndef SKA_PST_COMMON_UTILS_DirectIO_h
+#define SKA_PST_COMMON_UTILS_DirectIO_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Alignment required for O_DIRECT access to a file
+   *
+   */
+  struct DirectIOAlignment
+  {
+    //! alignment in bytes of the file offset and transfer size, zero if unknown
+    uint32_t offset{0};
+
+    //! alignment in bytes of the memory buffer, zero if unknown
+    uint32_t memory{0};
+  };
+
+  /**
+   * @brief Detect the offset and memory alignment required for O_DIRECT access to an open file.
+   * Uses statx with STATX_DIOALIGN where available, then BLKSSZGET for block devices, then the logical block size
+   * of the underlying device from sysfs. The memory alignment defaults to the offset alignment if it is not reported.
+   *
+   * @param fd file descriptor of the open file
+   * @return DirectIOAlignment the detected alignment, with zero offset alignment if it could not be detected
+   */
+  auto detect_direct_io_alignment(int fd) -> DirectIOAlignment;
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_DirectIO_h
@@ -32,6 +32,7 @@
 #include "ska/pst/common/utils/FileReader.h"
 
 #include <memory>
+#include <vector>
 
 #ifndef __SKA_PST_COMMON_UTILS_FileBlockProducer_h
 #define __SKA_PST_COMMON_UTILS_FileBlockProducer_h
@@ -41,7 +42,12 @@ namespace ska::pst::common {
   /**
    * @brief Loads blocks of data from file.
    *
-   * Currently maps the entire file into memory as a single block.
+   * Maps the data region of the file into memory and, by default, returns it as a single block.
+   * In chunked mode, the mapping is returned as a sequence of heap-aligned blocks; the kernel is advised to
+   * read ahead of the current block and the pages of previous blocks are dropped, so that the resident
+   * memory and page cache used by the file remain bounded by the block size and read-ahead window.
+   * Files compressed by the FileWriter are not mapped; each block is instead decompressed into a buffer owned by the
+   * FileBlockProducer, which remains valid until the next call to next_block.
    */
   class FileBlockProducer : public BlockProducer
   {
@@ -72,13 +78,102 @@ namespace ska::pst::common {
        *
        * When first called, returns a pair containing
        * - the base address of the start of data in the memory-mapped DADA file
-       * - the size of the file in bytes (minus the size of the header)
-       * If called again, this function returns (nullptr, 0)
+       * - the size of the file in bytes (minus the size of the header), or the block size in chunked mode
+       * In chunked mode, subsequent calls return the following blocks, the last of which may be smaller than
+       * the block size, and the block returned by the previous call is no longer resident.
+       * At the end of the data, this function returns (nullptr, 0)
        */
       BlockProducer::Block next_block();
 
+      /**
+       * @brief Set the number of bytes in each block, or zero to return the entire file as a single block.
+       * Must be called before the first call to next_block.
+       *
+       * @param nbytes number of bytes in each block, which must be a multiple of RESOLUTION if it is defined in the header
+       */
+      void set_block_bytes(uint64_t nbytes);
+
+      /**
+       * @brief Get the number of bytes in each block
+       *
+       * @return uint64_t number of bytes in each block, zero if the entire file is returned as a single block
+       */
+      uint64_t get_block_bytes() const { return block_bytes; };
+
+      /**
+       * @brief Set the number of bytes following each block that the kernel is advised to read with MADV_WILLNEED, or zero to disable.
+       *
+       * @param nbytes number of bytes to read ahead
+       */
+      void set_read_ahead(uint64_t nbytes) { read_ahead_bytes = nbytes; };
+
+      /**
+       * @brief Get the number of bytes following each block that the kernel is advised to read
+       *
+       * @return uint64_t number of bytes to read ahead, zero if disabled
+       */
+      uint64_t get_read_ahead() const { return read_ahead_bytes; };
+
+      /**
+       * @brief Enable or disable the population of the page tables of each block before it is returned.
+       * Pre-faulting the block with MADV_POPULATE_READ (or MADV_WILLNEED on older kernels) avoids a page fault on
+       * first access to each page. In chunked mode only the current block is populated, keeping the memory bounded.
+       *
+       * @param enable flag to enable population
+       */
+      void set_populate(bool enable) { populate = enable; };
+
+      /**
+       * @brief Advise the kernel to read the first bytes of the data with MADV_WILLNEED, which returns without waiting for the reads.
+       *
+       * @param nbytes number of bytes to prefetch from the start of the data
+       */
+      void prefetch(uint64_t nbytes) const;
+
+      /**
+       * @brief Enable or disable verification of the CRC-32C checksums written by the FileWriter to the sidecar file.
+       * When enabled, the header is verified immediately and next_block throws an exception if the checksum of
+       * any chunk entirely contained in the returned block does not match. Verification reads every byte of each block,
+       * so the block size should be a multiple of the checksum chunk size.
+       *
+       * @param verify flag to enable verification
+       */
+      void set_verify_checksums(bool verify);
+
+      /**
+       * @brief Request transparent huge pages for the mapping with MADV_HUGEPAGE, which reduces TLB misses
+       * on file systems that support huge pages for read-only file mappings. Logs a warning if not supported.
+       *
+       * @param enable flag to enable huge pages
+       */
+      void set_huge_pages(bool enable);
+
     protected:
 
+      /**
+       * @brief Apply madvise to the pages that span the specified range of the mapping, logging a warning on failure
+       *
+       * @param offset offset of the range from the start of the mapping
+       * @param nbytes number of bytes in the range
+       * @param advice the madvise advice
+       * @param name name of the advice, for logging
+       */
+      void advise(uint64_t offset, uint64_t nbytes, int advice, const char* name) const;
+
+      /**
+       * @brief Get the next block of a compressed file, decompressed into the block buffer
+       *
+       * @return BlockProducer::Block the next block, or (nullptr, 0) at the end of the data
+       */
+      BlockProducer::Block next_decompressed_block();
+
+      /**
+       * @brief Release the pages and page cache of the blocks before the specified offset in the mapping
+       *
+       * @param offset offset in the mapping of the current block
+       */
+      void drop_behind(uint64_t offset);
+
       //! the DADA file reader
       std::unique_ptr<ska::pst::common::FileReader> reader;
 
@@ -87,6 +182,33 @@ namespace ska::pst::common {
 
       //! the details of the next block
       BlockProducer::Block next_block_info;
+
+      //! number of bytes in each block, zero if the entire file is returned as a single block
+      uint64_t block_bytes{0};
+
+      //! number of bytes following each block to read ahead, zero if disabled
+      uint64_t read_ahead_bytes{0};
+
+      //! flag to enable the population of the page tables of each block
+      bool populate{false};
+
+      //! flag to enable verification of the checksums of each block
+      bool verify_checksums{false};
+
+      //! flag indicating that next_block has been called
+      bool started{false};
+
+      //! buffer of the decompressed block of a compressed file
+      std::vector<char> decompressed_block;
+
+      //! offset in the mapping of the next block
+      uint64_t next_offset{0};
+
+      //! number of bytes at the start of the mapping that have been released
+      uint64_t dropped_bytes{0};
+
+      //! size of a memory page in bytes
+      uint64_t page_size{0};
   };
 
 } // namespace ska::pst::common
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <filesystem>
+#include <vector>
+#include <inttypes.h>
+
+#ifndef SKA_PST_COMMON_UTILS_FileChecksums_h
+#define SKA_PST_COMMON_UTILS_FileChecksums_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief CRC-32C checksums of the header and of each fixed-size chunk of the data in a DADA file.
+   *
+   * The checksums are computed by the \ref FileWriter as the data are written, and stored in a sidecar file
+   * alongside the DADA file, so that the format of the DADA file is unchanged. The sidecar contains, in host byte order,
+   * the magic string CRC32C01, the chunk size, the number of data bytes, the header size, the header checksum,
+   * the number of chunks, and the checksum of each chunk; the last chunk may be smaller than the chunk size.
+   */
+  class FileChecksums {
+
+    public:
+
+      /**
+       * @brief Reset the checksums and set the number of data bytes in each chunk
+       *
+       * @param chunk_bytes number of data bytes in each chunk
+       */
+      void configure(uint64_t chunk_bytes);
+
+      /**
+       * @brief Compute the checksum of the header
+       *
+       * @param header pointer to the header
+       * @param nbytes number of bytes in the header
+       */
+      void set_header(const char * header, uint64_t nbytes);
+
+      /**
+       * @brief Add data to the checksums, which must be added in the order in which they are written to the file
+       *
+       * @param data pointer to the data
+       * @param nbytes number of bytes of data
+       */
+      void update(const char * data, uint64_t nbytes);
+
+      /**
+       * @brief Complete the checksum of the last chunk, which may be smaller than the chunk size
+       *
+       */
+      void finalise();
+
+      /**
+       * @brief Write the checksums to a sidecar file
+       *
+       * @param file_path path to the sidecar file
+       */
+      void save(const std::filesystem::path& file_path) const;
+
+      /**
+       * @brief Read the checksums from a sidecar file
+       *
+       * @param file_path path to the sidecar file
+       */
+      void load(const std::filesystem::path& file_path);
+
+      /**
+       * @brief Throw an exception if the checksum of the header does not match
+       *
+       * @param header pointer to the header
+       * @param nbytes number of bytes in the header
+       */
+      void verify_header(const char * header, uint64_t nbytes) const;
+
+      /**
+       * @brief Verify the checksums of the chunks that are entirely contained in a range of the data,
+       * throwing an exception if any of them does not match.
+       *
+       * @param data pointer to the range of the data
+       * @param nbytes number of bytes in the range
+       * @param offset offset of the range from the start of the data
+       * @return uint64_t number of chunks verified
+       */
+      uint64_t verify(const char * data, uint64_t nbytes, uint64_t offset) const;
+
+      /**
+       * @brief Get the number of data bytes in each chunk
+       *
+       * @return uint64_t number of data bytes in each chunk
+       */
+      uint64_t get_chunk_bytes() const { return chunk_bytes; };
+
+      /**
+       * @brief Get the number of data bytes covered by the checksums
+       *
+       * @return uint64_t number of data bytes
+       */
+      uint64_t get_data_bytes() const { return data_bytes; };
+
+      /**
+       * @brief Get the number of chunks with a completed checksum
+       *
+       * @return uint64_t number of chunks
+       */
+      uint64_t get_nchunks() const { return chunk_checksums.size(); };
+
+      /**
+       * @brief Get the checksum of the specified chunk
+       *
+       * @param ichunk index of the chunk
+       * @return uint32_t checksum of the chunk
+       */
+      uint32_t get_chunk_checksum(uint64_t ichunk) const { return chunk_checksums.at(ichunk); };
+
+      /**
+       * @brief Get the number of bytes in the header
+       *
+       * @return uint64_t number of bytes in the header
+       */
+      uint64_t get_header_bytes() const { return header_bytes; };
+
+      /**
+       * @brief Get the checksum of the header
+       *
+       * @return uint32_t checksum of the header
+       */
+      uint32_t get_header_checksum() const { return header_checksum; };
+
+      /**
+       * @brief Get the path of the sidecar file of a DADA file, which has the additional extension .crc32c
+       *
+       * @param file_path path to the DADA file
+       * @return std::filesystem::path path to the sidecar file
+       */
+      static std::filesystem::path get_filename(const std::filesystem::path& file_path);
+
+    private:
+
+      //! number of data bytes in each chunk
+      uint64_t chunk_bytes{0};
+
+      //! number of data bytes added to the checksums
+      uint64_t data_bytes{0};
+
+      //! number of bytes in the header
+      uint64_t header_bytes{0};
+
+      //! checksum of the header
+      uint32_t header_checksum{0};
+
+      //! checksum of the bytes of the current chunk added so far
+      uint32_t current_checksum{0};
+
+      //! checksums of the completed chunks
+      std::vector<uint32_t> chunk_checksums;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_FileChecksums_h
@@ -28,12 +28,17 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <atomic>
 #include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <inttypes.h>
 
 #include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/FileChecksums.h"
+#include "ska/pst/common/utils/WeightsCodec.h"
 
 #ifndef SKA_PST_COMMON_UTILS_FileReader_h
 #define SKA_PST_COMMON_UTILS_FileReader_h
@@ -43,6 +48,8 @@ namespace ska::pst::common {
   /**
    * @brief Facilitates reading the data and weights files written by the \ref FileWriter class.
    *
+   * Files compressed by the FileWriter are decompressed transparently: once the header has been read, read_data and
+   * read_data_at return the decompressed data and their offsets refer to the decompressed data.
    */
   class FileReader {
 
@@ -52,8 +59,9 @@ namespace ska::pst::common {
        * @brief Construct a new FileReader object.
        *
        * @param file_path path to file to open for reading
+       * @param use_o_direct Flag to enable the O_DIRECT option, which bypasses the page cache.
        */
-      FileReader(const std::string& file_path);
+      FileReader(const std::string& file_path, bool use_o_direct = false);
 
       /**
        * @brief Destroy the FileReader object.
@@ -75,14 +83,15 @@ namespace ska::pst::common {
       void close_file();
 
       /**
-       * @brief Read the ascii header from the currently open file
+       * @brief Read the ascii header from the currently open file.
+       * Reads the default header size and, only if HDR_SIZE is larger, the remainder of the header.
        *
        * @return ssize_t number of bytes read from file
        */
       ssize_t read_header();
 
       /**
-       * @brief Read data from the currently opened file
+       * @brief Read data from the currently opened file, starting where the previous read_header or read_data ended.
        *
        * @param data_ptr pointer to the data to read from file
        * @param data_size number of bytes to read into the pointer
@@ -90,6 +99,109 @@ namespace ska::pst::common {
        */
       ssize_t read_data(char * data_ptr, uint64_t data_size);
 
+      /**
+       * @brief Read data from the specified offset of the currently opened file, without changing the position of read_data.
+       * Uses pread, so that several threads may read from the same FileReader concurrently.
+       *
+       * @param data_ptr pointer to the data to read from file
+       * @param data_size number of bytes to read into the pointer
+       * @param offset offset in bytes from the start of the data, which follows the header if read_header has been called
+       * @return ssize_t number of bytes read from file, which is less than data_size at the end of the file
+       */
+      ssize_t read_data_at(char * data_ptr, uint64_t data_size, uint64_t offset);
+
+      /**
+       * @brief Return a boolean describing if the data in the file are compressed, as determined by read_header
+       *
+       * @return true the data are compressed
+       * @return false the data are not compressed
+       */
+      bool is_compressed() const { return codec != nullptr; };
+
+      /**
+       * @brief Get the number of bytes of data in the file that follow the header, after decompression if the data are compressed
+       *
+       * @return uint64_t number of bytes of data
+       */
+      uint64_t get_data_size() const;
+
+      /**
+       * @brief Set the number of bytes beyond each read that the kernel is advised to read ahead into the page cache, or zero to disable.
+       * Read-ahead is requested with posix_fadvise, which schedules the reads in the background and returns immediately.
+       * Has no effect when O_DIRECT is enabled, as the page cache is bypassed.
+       *
+       * @param nbytes number of bytes to read ahead
+       */
+      void set_read_ahead(uint64_t nbytes);
+
+      /**
+       * @brief Get the number of bytes beyond each read that the kernel is advised to read ahead
+       *
+       * @return uint64_t number of bytes to read ahead, zero if read-ahead is disabled
+       */
+      uint64_t get_read_ahead() const { return read_ahead_bytes; };
+
+      /**
+       * @brief Enable or disable verification of the CRC-32C checksums written by the FileWriter to the sidecar file.
+       * When enabled, the sidecar file is loaded and read_header, read_data and read_data_at throw an exception if the
+       * checksum of the header, or of any checksum chunk entirely contained in the bytes read, does not match.
+       *
+       * @param verify flag to enable verification
+       */
+      void set_verify_checksums(bool verify);
+
+      /**
+       * @brief Return a boolean describing if checksums are verified as the file is read
+       *
+       * @return true checksums are verified
+       * @return false checksums are not verified
+       */
+      bool get_verify_checksums() const { return verify; };
+
+      /**
+       * @brief Get the number of checksum chunks verified by read_data, read_data_at and verify_data
+       *
+       * @return uint64_t number of checksum chunks verified
+       */
+      uint64_t get_chunks_verified() const { return chunks_verified; };
+
+      /**
+       * @brief Verify the checksums of a range of the data that was read from the file by other means, such as a memory mapping.
+       * Requires a prior call to set_verify_checksums(true).
+       *
+       * @param data_ptr pointer to the range of the data
+       * @param data_size number of bytes in the range
+       * @param offset offset in bytes of the range from the start of the data
+       * @return uint64_t number of checksum chunks entirely contained in the range, all of which were verified
+       */
+      uint64_t verify_data(const char * data_ptr, uint64_t data_size, uint64_t offset);
+
+      /**
+       * @brief Verify the checksums of the header and all of the data in the file against the sidecar file,
+       * throwing an exception if any checksum does not match or if the file is shorter than the checksummed data.
+       * Does not change the position of read_data.
+       *
+       * @return uint64_t number of data chunks verified
+       */
+      uint64_t verify_checksums();
+
+      /**
+       * @brief Return a boolean describing if the O_DIRECT option is enabled
+       *
+       * @return true the file is read with O_DIRECT
+       * @return false the file is read through the page cache
+       */
+      bool uses_o_direct() const { return o_direct; };
+
+      /**
+       * @brief Return the alignment of the file offset and transfer size required for O_DIRECT access to the opened file.
+       * Reads with an offset, size and buffer that are all aligned are transferred directly into the buffer,
+       * while other reads are copied through an aligned staging buffer.
+       *
+       * @return uint32_t alignment in bytes
+       */
+      uint32_t block_alignment() const { return o_direct_alignment; };
+
       /**
        * @brief Get a const reference to the AsciiHeader that is populated when
        * \ref read_header is called
@@ -98,6 +210,13 @@ namespace ska::pst::common {
        */
       const ska::pst::common::AsciiHeader& get_header() { return header; };
 
+      /**
+       * @brief Get the path of the opened file
+       *
+       * @return const std::string& path of the opened file
+       */
+      const std::string& get_file_path() const { return file_path; };
+
       /**
        * @brief Get the size of the file in bytes
        *
@@ -128,9 +247,142 @@ namespace ska::pst::common {
 
     private:
 
+      /**
+       * @brief Read bytes from the specified offset in the file, through the staging buffer if O_DIRECT is enabled and the request is not aligned.
+       *
+       * @param data_ptr pointer to the data to read from file
+       * @param data_size number of bytes to read
+       * @param file_offset offset in bytes from the start of the file
+       * @return uint64_t number of bytes read, which is less than data_size at the end of the file
+       */
+      uint64_t read_at(char * data_ptr, uint64_t data_size, uint64_t file_offset);
+
+      /**
+       * @brief Read bytes from the specified offset in the file, repeating pread until all bytes are read or the end of the file is reached.
+       *
+       * @param data_ptr pointer to the data to read from file
+       * @param data_size number of bytes to read
+       * @param file_offset offset in bytes from the start of the file
+       * @return uint64_t number of bytes read
+       */
+      uint64_t pread_fully(char * data_ptr, uint64_t data_size, uint64_t file_offset) const;
+
+      /**
+       * @brief Build the index of the frames of a compressed file, which follow the header
+       *
+       */
+      void index_frames();
+
+      /**
+       * @brief Read and decompress data from the specified offset of the decompressed data
+       *
+       * @param data_ptr pointer to the decompressed data
+       * @param data_size number of bytes of decompressed data to read
+       * @param offset offset in bytes from the start of the decompressed data
+       * @return uint64_t number of bytes read, which is less than data_size at the end of the data
+       */
+      uint64_t read_decompressed(char * data_ptr, uint64_t data_size, uint64_t offset);
+
+      /**
+       * @brief Read and decode the specified frame of a compressed file, verifying its checksums if enabled
+       *
+       * @param iframe index of the frame
+       * @param data_ptr destination of the decoded bytes, which must hold the decoded size of the frame
+       */
+      void decode_frame(uint64_t iframe, char * data_ptr);
+
+      /**
+       * @brief Advise the kernel to read ahead the bytes that follow the specified offset in the file
+       *
+       * @param file_offset offset in bytes from the start of the file
+       */
+      void advise_read_ahead(uint64_t file_offset) const;
+
+      //! flag to enable the O_DIRECT option
+      bool o_direct{false};
+
+      //! alignment of the file offset and transfer size required for O_DIRECT access
+      uint32_t o_direct_alignment{default_o_direct_alignment};
+
+      //! alignment of the memory buffer required for O_DIRECT access
+      uint32_t o_direct_memory_alignment{default_o_direct_alignment};
+
+      //! alignment assumed for O_DIRECT access when it cannot be detected
+      static constexpr uint32_t default_o_direct_alignment{4096};
+
+      //! size of the O_DIRECT staging buffer in bytes
+      static constexpr uint64_t staging_bufsz{4194304};
+
+      //! aligned staging buffer used for O_DIRECT reads that are not aligned
+      char * staging_buffer{nullptr};
+
+      //! serialises the use of the staging buffer
+      std::mutex staging_mutex;
+
+      //! number of bytes beyond each read to read ahead, zero if disabled
+      uint64_t read_ahead_bytes{0};
+
+      //! offset of the data from the start of the file, equal to the header size once the header has been read
+      uint64_t data_offset{0};
+
       //! the DADA file header
       ska::pst::common::AsciiHeader header;
 
+      //! path of the opened file
+      std::string file_path;
+
+      //! location of a frame of a compressed file
+      struct Frame {
+
+        //! offset of the frame header from the start of the file
+        uint64_t file_offset;
+
+        //! offset of the decoded bytes from the start of the decompressed data
+        uint64_t data_offset;
+
+        //! number of decoded bytes
+        uint64_t decoded_bytes;
+
+        //! number of encoded bytes that follow the frame header
+        uint64_t encoded_bytes;
+      };
+
+      //! codec used to decompress the data, nullptr if the data are not compressed
+      std::unique_ptr<WeightsCodec> codec;
+
+      //! frames of a compressed file
+      std::vector<Frame> frames;
+
+      //! number of bytes of decompressed data
+      uint64_t decompressed_size{0};
+
+      //! offset in the decompressed data at which the next read_data starts
+      uint64_t decompressed_position{0};
+
+      //! buffer of the frame header and encoded bytes of the frame being decoded
+      std::vector<char> encoded_buffer;
+
+      //! decoded bytes of the most recently decoded frame that was only partially read
+      std::vector<char> decoded_buffer;
+
+      //! index of the frame in the decoded buffer, frames.size() if none
+      uint64_t decoded_frame{0};
+
+      //! serialises the decoding of frames
+      std::mutex decode_mutex;
+
+      //! flag to enable verification of checksums
+      bool verify{false};
+
+      //! checksums loaded from the sidecar file
+      FileChecksums checksums;
+
+      //! number of checksum chunks verified by read_data, read_data_at and verify_data
+      std::atomic<uint64_t> chunks_verified{0};
+
+      //! size of the buffer used by verify_checksums in bytes
+      static constexpr uint64_t verify_bufsz{4194304};
+
       //! file descriptor of the currently opened file
       int fd{-1};
 
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/FileBlockProducer.h"
+#include "ska/pst/common/utils/SegmentProducer.h"
+
+#ifndef SKA_PST_COMMON_UTILS_FileSequenceSegmentProducer_h
+#define SKA_PST_COMMON_UTILS_FileSequenceSegmentProducer_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Reads the voltage data and weights of a recording that spans a sequence of files.
+   *
+   * The data files and weights files are each ordered by the OBS_OFFSET in their headers and paired in that order.
+   * Segments are returned from each pair of files in turn, without an end of data marker at the file boundaries.
+   * While a pair of files is being read, a background thread releases the previous pair and opens, maps and
+   * prefetches the next pair, so that there is no stall at the start of each file.
+   */
+  class FileSequenceSegmentProducer : public SegmentProducer
+  {
+    public:
+
+      /**
+       * @brief Create instance of a FileSequenceSegmentProducer object.
+       *
+       * @param data_file_paths paths to the data files of the recording, in any order
+       * @param weights_file_paths paths to the weights files of the recording, in any order
+       * @param heaps_per_segment number of heaps in each segment, or zero to return each file as a single segment
+       * @param read_ahead_segments number of segments beyond the current segment to prefetch
+       */
+      FileSequenceSegmentProducer(
+        const std::vector<std::string>& data_file_paths,
+        const std::vector<std::string>& weights_file_paths,
+        uint64_t heaps_per_segment = 0,
+        unsigned read_ahead_segments = 1
+      );
+
+      /**
+       * @brief Destroy the FileSequenceSegmentProducer object.
+       *
+       */
+      ~FileSequenceSegmentProducer();
+
+      /**
+       * @brief List the DADA files in a directory
+       *
+       * @param directory path to the directory
+       * @return std::vector<std::string> paths of the files with the .dada extension, sorted by name
+       */
+      static std::vector<std::string> list_files(const std::string& directory);
+
+      /**
+       * @brief Get the AsciiHeader of the first data file, which describes the data block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& header of the data block stream
+       */
+      const ska::pst::common::AsciiHeader& get_data_header() const override { return data_header; };
+
+      /**
+       * @brief Get the AsciiHeader of the first weights file, which describes the weights block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& header of the weights block stream
+       */
+      const ska::pst::common::AsciiHeader& get_weights_header() const override { return weights_header; };
+
+      /**
+       * @brief Get the next segment of data and weights.
+       * The blocks of the returned segment remain valid until the next call to next_segment.
+       * End of data is indicated after the last segment of the last pair of files.
+       *
+       * @return Segment the next segment of data and weights
+       */
+      Segment next_segment() override;
+
+      /**
+       * @brief Get the number of pairs of data and weights files
+       *
+       * @return size_t number of pairs of files
+       */
+      size_t get_nfiles() const { return data_file_paths.size(); };
+
+      /**
+       * @brief Get the index, in OBS_OFFSET order, of the pair of files currently being read
+       *
+       * @return size_t index of the current pair of files
+       */
+      size_t get_file_index() const { return file_index; };
+
+      /**
+       * @brief Get the paths of the data files in OBS_OFFSET order
+       *
+       * @return const std::vector<std::string>& paths of the data files
+       */
+      const std::vector<std::string>& get_data_file_paths() const { return data_file_paths; };
+
+      /**
+       * @brief Get the paths of the weights files in OBS_OFFSET order
+       *
+       * @return const std::vector<std::string>& paths of the weights files
+       */
+      const std::vector<std::string>& get_weights_file_paths() const { return weights_file_paths; };
+
+    private:
+
+      /**
+       * @brief The block producers of a pair of data and weights files
+       *
+       */
+      struct FilePair
+      {
+        //! producer of the data blocks
+        std::unique_ptr<FileBlockProducer> data;
+
+        //! producer of the weights blocks
+        std::unique_ptr<FileBlockProducer> weights;
+      };
+
+      /**
+       * @brief Sort file paths by the OBS_OFFSET in their headers
+       *
+       * @param file_paths paths to the files
+       * @param header populated with the header of the first file in OBS_OFFSET order
+       * @return std::vector<std::string> the file paths in OBS_OFFSET order
+       */
+      static std::vector<std::string> sort_by_obs_offset(const std::vector<std::string>& file_paths, ska::pst::common::AsciiHeader& header);
+
+      /**
+       * @brief Open, map and prefetch the pair of files at the specified index
+       *
+       * @param index index of the pair of files in OBS_OFFSET order
+       * @return std::unique_ptr<FilePair> the block producers of the pair of files
+       */
+      std::unique_ptr<FilePair> open_pair(size_t index) const;
+
+      /**
+       * @brief Start the background thread that releases the previous pair of files and, if there is one, opens the next pair
+       *
+       * @param previous the previous pair of files, which may be null
+       */
+      void start_background(std::unique_ptr<FilePair> previous);
+
+      /**
+       * @brief Wait for the background thread to complete, re-throwing any exception that it raised.
+       *
+       */
+      void join_background();
+
+      //! paths of the data files in OBS_OFFSET order
+      std::vector<std::string> data_file_paths;
+
+      //! paths of the weights files in OBS_OFFSET order
+      std::vector<std::string> weights_file_paths;
+
+      //! header of the first data file
+      ska::pst::common::AsciiHeader data_header;
+
+      //! header of the first weights file
+      ska::pst::common::AsciiHeader weights_header;
+
+      //! number of heaps in each segment, zero if each file is returned as a single segment
+      uint64_t heaps_per_segment;
+
+      //! number of segments beyond the current segment to prefetch
+      unsigned read_ahead_segments;
+
+      //! index of the pair of files currently being read
+      size_t file_index{0};
+
+      //! the pair of files currently being read
+      std::unique_ptr<FilePair> current{nullptr};
+
+      //! the prepared next pair of files
+      std::unique_ptr<FilePair> next{nullptr};
+
+      //! background thread that releases the previous pair of files and opens the next pair
+      std::unique_ptr<std::thread> background_thread{nullptr};
+
+      //! exception raised by the background thread
+      std::exception_ptr background_error{nullptr};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_FileSequenceSegmentProducer_h
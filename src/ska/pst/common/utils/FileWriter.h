@@ -29,10 +29,15 @@
  */
 
 #include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/AsyncWriteQueue.h"
+#include "ska/pst/common/utils/FileChecksums.h"
+#include "ska/pst/common/utils/WeightsCodec.h"
 
 #include <filesystem>
 #include <cstddef>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <inttypes.h>
 
 #ifndef SKA_PST_COMMON_UTILS_FileWriter_h
@@ -92,13 +97,14 @@ namespace ska::pst::common {
       void open_file(const std::filesystem::path& new_file);
 
       /**
-       * @brief Return the (assumed) logical block size of the filesystem
+       * @brief Return the logical block size of the filesystem, as detected when the current file was opened
+       * (or the default of 512 bytes before the first file is opened)
        *
        */
       uint32_t block_alignment() const { return o_direct_alignment; }
 
       /**
-       * @brief Throw an exception if the block size is not a multiple of the (assumed) logical block size of the filesystem
+       * @brief Throw an exception if the block size is not a multiple of the logical block size of the filesystem
        *
        * @param block_size the block size to be tested, in bytes
        */
@@ -113,7 +119,9 @@ namespace ska::pst::common {
       ssize_t write_header(const ska::pst::common::AsciiHeader& header);
 
       /**
-       * @brief Write data to the currently opened file
+       * @brief Write data to the currently opened file.
+       * When O_DIRECT is enabled, any remainder that does not fill a logical block is carried in an aligned staging buffer
+       * and merged with the next write; the final partial block is written by close_file.
        *
        * @param data_ptr pointer to the data to write
        * @param data_size number of bytes to write to the file
@@ -122,11 +130,138 @@ namespace ska::pst::common {
       ssize_t write_data(char * data_ptr, uint64_t data_size);
 
       /**
-       * @brief Close the currently opened file.
+       * @brief Enable asynchronous data writes with up to depth requests in flight, or disable them with a depth of zero.
+       * Any asynchronous writes in flight are completed before the queue is replaced.
+       *
+       * @param depth maximum number of asynchronous writes in flight
+       * @param use_io_uring use io_uring if the library was built with liburing support, otherwise use pwrite threads
+       */
+      void set_async_depth(uint32_t depth, bool use_io_uring = true);
+
+      /**
+       * @brief Get the maximum number of asynchronous writes in flight, zero if asynchronous writes are disabled
+       *
+       * @return uint32_t maximum number of asynchronous writes in flight
+       */
+      uint32_t get_async_depth() const { return async_queue ? async_queue->get_depth() : 0; };
+
+      /**
+       * @brief Submit an asynchronous write of data to the currently opened file and return without waiting for it to complete.
+       * Blocks while the maximum number of asynchronous writes are in flight. The data must remain valid and unmodified
+       * until the write completes, as signalled by the callback or by a return from wait_for_writes.
+       * Requires a prior call to set_async_depth with a non-zero depth. When O_DIRECT is enabled and either the data_size
+       * is not a multiple of the logical block size or a partial block is staged, the data are written synchronously.
+       *
+       * @param data_ptr pointer to the data to write
+       * @param data_size number of bytes to write to the file
+       * @param callback optional function invoked when the write completes, never concurrently with another callback
+       * @return uint64_t offset in the file at which the data will be written
+       */
+      uint64_t write_data_async(char * data_ptr, uint64_t data_size, AsyncWriteQueue::Callback callback = nullptr);
+
+      /**
+       * @brief Wait for all asynchronous writes in flight to complete, throwing an exception if any of them failed.
+       *
+       */
+      void wait_for_writes();
+
+      /**
+       * @brief Get the number of asynchronous writes that have been submitted and have not completed
+       *
+       * @return uint32_t number of asynchronous writes in flight
+       */
+      uint32_t get_writes_in_flight() const { return async_queue ? async_queue->get_in_flight() : 0; };
+
+      /**
+       * @brief Close the currently opened file, after waiting for any asynchronous writes in flight to complete.
+       * When O_DIRECT is enabled, any staged partial block is written padded to the logical block size and the file
+       * is then truncated to the number of bytes written.
        *
        */
       void close_file();
 
+      /**
+       * @brief Set the number of bytes to preallocate with fallocate when each file is opened, or zero to disable preallocation.
+       * Preallocating the expected size of the file keeps it on contiguous extents and removes the file size updates from
+       * the write path. A preallocated file is truncated to the number of bytes written when it is closed.
+       *
+       * @param nbytes number of bytes to preallocate, including the header
+       */
+      void set_preallocation_bytes(uint64_t nbytes) { preallocation_bytes = nbytes; };
+
+      /**
+       * @brief Get the number of bytes to preallocate when each file is opened
+       *
+       * @return uint64_t number of bytes to preallocate, zero if preallocation is disabled
+       */
+      uint64_t get_preallocation_bytes() const { return preallocation_bytes; };
+
+      /**
+       * @brief Get the number of bytes preallocated for the currently opened file
+       *
+       * @return uint64_t number of bytes preallocated, zero if preallocation is disabled or not supported by the file system
+       */
+      uint64_t get_preallocated_bytes() const { return preallocated_bytes; };
+
+      /**
+       * @brief Compute the expected number of bytes in a file that contains the header and the specified duration of the stream
+       *
+       * @param header AsciiHeader of the stream, which must define HDR_SIZE and the parameters of compute_bytes_per_second
+       * @param duration duration of the stream in seconds
+       * @return uint64_t expected number of bytes in the file
+       */
+      static uint64_t compute_file_bytes(const ska::pst::common::AsciiHeader& header, double duration);
+
+      /**
+       * @brief Set the number of data bytes in each chunk for which a CRC-32C checksum is computed as the data are written,
+       * or zero to disable checksums; takes effect when the next file is opened. The checksums of the header and of each chunk are written by close_file to a sidecar
+       * file, named by FileChecksums::get_filename, that may be used by the FileReader to verify the file when it is read.
+       *
+       * @param nbytes number of data bytes in each chunk, zero if checksums are disabled
+       */
+      void set_checksum_chunk_bytes(uint64_t nbytes) { checksum_chunk_bytes = nbytes; };
+
+      /**
+       * @brief Get the number of data bytes in each chunk for which a checksum is computed
+       *
+       * @return uint64_t number of data bytes in each chunk, zero if checksums are disabled
+       */
+      uint64_t get_checksum_chunk_bytes() const { return checksum_chunk_bytes; };
+
+      /**
+       * @brief Enable or disable compression of the data with the WeightsCodec, which is intended for the weights and scales stream;
+       * takes effect when the next header is written. The header written to a compressed file defines COMPRESSION and
+       * COMPRESSION_STRIDE, and the data passed to each call to write_data are written as one encoded frame.
+       * Compressed frames are always written synchronously, including those passed to write_data_async.
+       * Compressed files are decompressed transparently by the FileReader and FileBlockProducer.
+       *
+       * @param enable flag to enable compression
+       */
+      void set_compression(bool enable) { compression = enable; };
+
+      /**
+       * @brief Return a boolean describing if compression is enabled
+       *
+       * @return true the data are compressed
+       * @return false the data are written unchanged
+       */
+      bool get_compression() const { return compression; };
+
+      /**
+       * @brief Get the number of data bytes passed to write_data for the current file, which differs from the number of
+       * data bytes written to the file when the data are compressed
+       *
+       * @return uint64_t number of uncompressed data bytes
+       */
+      uint64_t get_uncompressed_bytes_written() const { return uncompressed_bytes_written; };
+
+      /**
+       * @brief Get the number of bytes held in the O_DIRECT staging buffer that have not yet been written to the file
+       *
+       * @return uint64_t number of staged bytes
+       */
+      uint64_t get_staged_bytes() const { return staged_bytes; };
+
       /**
        * @brief Get the number of header bytes written to the current file
        *
@@ -135,12 +270,19 @@ namespace ska::pst::common {
       uint64_t get_header_bytes_written() { return header_bytes_written; };
 
       /**
-       * @brief Get the number of data bytes written to the current file
+       * @brief Get the number of data bytes written to the current file, including asynchronous writes in flight
        *
        * @return uint64_t the number data bytes written to the current file
        */
       uint64_t get_data_bytes_written() { return data_bytes_written; };
 
+      /**
+       * @brief Get the full path of the currently opened file
+       *
+       * @return const std::filesystem::path& full path of the file most recently opened
+       */
+      const std::filesystem::path& get_opened_file() const { return opened_file; };
+
       /**
        * @brief Get the filename for the specified scan_id, obs_offset and file_number.
        * Output filename will be structured as [UTC_START]_[OBS_OFFSET]_[FILE_NUMBER].dada
@@ -155,10 +297,65 @@ namespace ska::pst::common {
     private:
 
       /**
-       * @brief Close and re-open the current file with the O_DIRECT flag disabled.
+       * @brief Write bytes to the currently opened file, updating the checksums
+       *
+       * @param data_ptr pointer to the bytes to write
+       * @param bytes_to_write number of bytes to write
+       * @return ssize_t number of bytes written to the file
+       */
+      ssize_t write_bytes(const char * data_ptr, uint64_t bytes_to_write);
+
+      /**
+       * @brief Encode the data and write them to the currently opened file as one frame
+       *
+       * @param data_ptr pointer to the data to encode
+       * @param bytes_to_write number of bytes to encode
+       */
+      void write_frame(const char * data_ptr, uint64_t bytes_to_write);
+
+      /**
+       * @brief Detect the offset and memory alignment required for O_DIRECT access to the currently opened file,
+       * assuming 512 bytes if it cannot be detected.
+       *
+       */
+      void detect_alignment();
+
+      /**
+       * @brief Write bytes through the O_DIRECT file descriptor, merging them with any staged partial block and staging any remainder.
+       * Aligned spans of the source are written directly, all other bytes are copied through the staging buffer.
+       *
+       * @param data_ptr pointer to the data to write
+       * @param bytes_to_write number of bytes to write
+       */
+      void write_direct(const char * data_ptr, uint64_t bytes_to_write);
+
+      /**
+       * @brief Write a buffer at the specified offset in the currently opened file, throwing an exception on failure or short write
+       *
+       * @param data_ptr pointer to the data to write
+       * @param bytes_to_write number of bytes to write
+       * @param offset offset in the file at which to write
+       */
+      void write_at(const char * data_ptr, uint64_t bytes_to_write, uint64_t offset);
+
+      /**
+       * @brief Write the staged partial block padded to the logical block size.
+       *
+       */
+      void write_staged_tail();
+
+      /**
+       * @brief Preallocate the extents of the currently opened file with fallocate, logging a warning if not supported.
        *
+       * @param nbytes number of bytes to preallocate
        */
-      void reopen_file();
+      void preallocate(uint64_t nbytes);
+
+      /**
+       * @brief Truncate the currently opened file to the number of header and data bytes written.
+       *
+       */
+      void truncate_file();
 
       //! path the currently opened file
       std::filesystem::path opened_file;
@@ -187,8 +384,56 @@ namespace ska::pst::common {
       //! flag which instructs open_file to enable O_DIRECT flag when opening files
       bool o_direct{false};
 
-      //! alignment for I/O operations on O-DIRECT buffers
-      const uint32_t o_direct_alignment{512};
+      //! default alignment for I/O operations on O_DIRECT buffers
+      static constexpr uint32_t default_o_direct_alignment{512};
+
+      //! alignment of file offsets and sizes for I/O operations on O_DIRECT file descriptors
+      uint32_t o_direct_alignment{default_o_direct_alignment};
+
+      //! alignment of memory buffers for I/O operations on O_DIRECT file descriptors
+      uint32_t o_direct_memory_alignment{default_o_direct_alignment};
+
+      //! number of bytes to preallocate when each file is opened
+      uint64_t preallocation_bytes{0};
+
+      //! number of bytes preallocated for the currently opened file
+      uint64_t preallocated_bytes{0};
+
+      //! number of data bytes in each checksum chunk, zero if checksums are disabled
+      uint64_t checksum_chunk_bytes{0};
+
+      //! flag indicating if checksums are computed for the currently opened file
+      bool compute_checksums{false};
+
+      //! checksums of the header and data written to the currently opened file
+      FileChecksums checksums;
+
+      //! flag to enable compression of the data in the next file
+      bool compression{false};
+
+      //! codec used to compress the data of the currently opened file, nullptr if the data are not compressed
+      std::unique_ptr<WeightsCodec> codec;
+
+      //! buffer of the frame header and encoded bytes of each compressed write
+      std::vector<char> frame_buffer;
+
+      //! number of data bytes passed to write_data for the currently opened file
+      uint64_t uncompressed_bytes_written{0};
+
+      //! default size of the O_DIRECT staging buffer in bytes
+      static constexpr uint64_t default_staging_bufsz{4194304};
+
+      //! aligned buffer that carries partial blocks between O_DIRECT writes
+      char * staging_buffer{nullptr};
+
+      //! size of the staging buffer in bytes
+      uint64_t staging_bufsz{0};
+
+      //! number of bytes in the staging buffer that have not been written to the file
+      uint64_t staged_bytes{0};
+
+      //! queue of asynchronous writes, nullptr if asynchronous writes are disabled
+      std::unique_ptr<AsyncWriteQueue> async_queue;
 
       uint64_t header_bytes_written{0};
 
@@ -32,6 +32,8 @@
 #include "ska/pst/common/utils/PacketLayout.h"
 #include "ska/pst/common/definitions.h"
 
+#include <cstddef>
+#include <iterator>
 #include <memory>
 
 #ifndef SKA_PST_COMMON_HeapLayout_h
@@ -40,6 +42,167 @@
 namespace ska::pst::common
 {
 
+  /**
+   * @brief Pointers to the data, scales and weights of one packet in a block of heaps, and the channels and samples it contains
+   *
+   * @tparam Byte char or const char
+   */
+  template <typename Byte>
+  struct HeapPacket
+  {
+    //! Pointer to the first byte of the packet in the data stream
+    Byte * data{nullptr};
+
+    //! Pointer to the scale factors of the packet in the weights stream, nullptr if there is no weights stream
+    Byte * scales{nullptr};
+
+    //! Pointer to the relative weights of the packet in the weights stream, nullptr if there is no weights stream
+    Byte * weights{nullptr};
+
+    //! Index of the packet in the block of heaps
+    uint64_t packet_number{0};
+
+    //! Index of the packet in its heap
+    uint32_t heap_packet{0};
+
+    //! Index of the first channel in the packet
+    uint32_t chan_begin{0};
+
+    //! Index of the channel after the last channel in the packet
+    uint32_t chan_end{0};
+
+    //! Index of the first time sample in the packet, relative to the start of the block of heaps
+    uint64_t samp_begin{0};
+
+    //! Index of the time sample after the last time sample in the packet
+    uint64_t samp_end{0};
+  };
+
+  /**
+   * @brief Forward iterator over the packets in a block of heaps, in the order that they are stored.
+   * Each increment advances the pointers by the packet strides and wraps the channel range at the end of each heap
+   * with conditional moves, so that loops over packets do not recompute offsets from the packet number.
+   *
+   * @tparam Byte char or const char
+   */
+  template <typename Byte>
+  class HeapPacketIterator
+  {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = HeapPacket<Byte>;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const value_type *;
+      using reference = const value_type &;
+
+      /**
+       * @brief Construct a new HeapPacketIterator object
+       *
+       * @param first the packet at which to start iterating
+       * @param data_packet_stride number of bytes per packet in the data stream
+       * @param weights_packet_stride number of bytes per packet in the weights stream, 0 if there is no weights stream
+       * @param packets_per_heap number of packets per heap
+       * @param nchan_per_packet number of channels per packet
+       * @param nsamp_per_packet number of time samples per packet
+       */
+      HeapPacketIterator(const HeapPacket<Byte>& first, uint64_t data_packet_stride, uint64_t weights_packet_stride,
+        uint32_t packets_per_heap, uint32_t nchan_per_packet, uint32_t nsamp_per_packet) :
+        packet(first), data_packet_stride(data_packet_stride), weights_packet_stride(weights_packet_stride),
+        packets_per_heap(packets_per_heap), nchan_per_packet(nchan_per_packet), nsamp_per_packet(nsamp_per_packet)
+      {
+      }
+
+      auto operator*() const -> reference { return packet; }
+
+      auto operator->() const -> pointer { return &packet; }
+
+      auto operator++() -> HeapPacketIterator&
+      {
+        packet.data += data_packet_stride; // NOLINT
+        packet.scales += weights_packet_stride; // NOLINT
+        packet.weights += weights_packet_stride; // NOLINT
+        packet.packet_number++;
+
+        const bool next_heap = (packet.heap_packet + 1 == packets_per_heap);
+        packet.heap_packet = next_heap ? 0 : packet.heap_packet + 1;
+        packet.chan_begin = next_heap ? 0 : packet.chan_end;
+        packet.chan_end = packet.chan_begin + nchan_per_packet;
+        const uint64_t samp_increment = next_heap ? nsamp_per_packet : 0;
+        packet.samp_begin += samp_increment;
+        packet.samp_end += samp_increment;
+        return *this;
+      }
+
+      auto operator++(int) -> HeapPacketIterator
+      {
+        HeapPacketIterator previous = *this;
+        ++(*this);
+        return previous;
+      }
+
+      auto operator==(const HeapPacketIterator& other) const -> bool { return packet.packet_number == other.packet.packet_number; }
+
+      auto operator!=(const HeapPacketIterator& other) const -> bool { return packet.packet_number != other.packet.packet_number; }
+
+    private:
+
+      //! The current packet
+      HeapPacket<Byte> packet;
+
+      //! Number of bytes per packet in the data stream
+      uint64_t data_packet_stride;
+
+      //! Number of bytes per packet in the weights stream
+      uint64_t weights_packet_stride;
+
+      //! Number of packets per heap
+      uint32_t packets_per_heap;
+
+      //! Number of channels per packet
+      uint32_t nchan_per_packet;
+
+      //! Number of time samples per packet
+      uint32_t nsamp_per_packet;
+  };
+
+  /**
+   * @brief Range of packets in a block of heaps, for use in range-based for loops
+   *
+   * @tparam Byte char or const char
+   */
+  template <typename Byte>
+  class HeapPacketRange
+  {
+    public:
+
+      /**
+       * @brief Construct a new HeapPacketRange object
+       *
+       * @param first iterator to the first packet in the range
+       * @param last iterator to the packet after the last packet in the range
+       */
+      HeapPacketRange(HeapPacketIterator<Byte> first, HeapPacketIterator<Byte> last) : first(first), last(last) {}
+
+      auto begin() const -> HeapPacketIterator<Byte> { return first; }
+
+      auto end() const -> HeapPacketIterator<Byte> { return last; }
+
+      /**
+       * @brief Get the number of packets in the range
+       *
+       * @return uint64_t number of packets
+       */
+      auto size() const -> uint64_t { return last->packet_number - first->packet_number; }
+
+    private:
+
+      //! Iterator to the first packet in the range
+      HeapPacketIterator<Byte> first;
+
+      //! Iterator to the packet after the last packet in the range
+      HeapPacketIterator<Byte> last;
+  };
+
   /**
    * @brief Stores the offsets and sizes of data, weights, and scales in heaps of packets
    *
@@ -136,6 +299,34 @@ namespace ska::pst::common
        */
       auto get_weights_heap_stride() const -> unsigned { return weights_heap_stride; }
 
+      /**
+       * @brief Get the range of packets in a contiguous subset of the heaps in blocks of data and weights
+       *
+       * @param data pointer to the first heap of the data stream
+       * @param weights pointer to the first heap of the weights stream, or nullptr if the weights are not required
+       * @param heap_begin index of the first heap in the range
+       * @param heap_end index of the heap after the last heap in the range
+       * @return HeapPacketRange<char> range of packets, numbered from the first heap of the block
+       */
+      auto get_packets(char * data, char * weights, uint32_t heap_begin, uint32_t heap_end) const -> HeapPacketRange<char>
+      {
+        return make_packet_range(data, weights, heap_begin, heap_end);
+      }
+
+      /**
+       * @brief Get the range of packets in a contiguous subset of the heaps in read-only blocks of data and weights
+       *
+       * @param data pointer to the first heap of the data stream
+       * @param weights pointer to the first heap of the weights stream, or nullptr if the weights are not required
+       * @param heap_begin index of the first heap in the range
+       * @param heap_end index of the heap after the last heap in the range
+       * @return HeapPacketRange<const char> range of packets, numbered from the first heap of the block
+       */
+      auto get_packets(const char * data, const char * weights, uint32_t heap_begin, uint32_t heap_end) const -> HeapPacketRange<const char>
+      {
+        return make_packet_range(data, weights, heap_begin, heap_end);
+      }
+
       /**
        * @brief Stores the offsets and sizes of data, weights, and scales of each packet in a heap
        *
@@ -144,6 +335,37 @@ namespace ska::pst::common
 
     protected:
 
+      /**
+       * @brief Construct the range of packets returned by get_packets
+       *
+       * @tparam Byte char or const char
+       */
+      template <typename Byte>
+      auto make_packet_range(Byte * data, Byte * weights, uint32_t heap_begin, uint32_t heap_end) const -> HeapPacketRange<Byte>
+      {
+        const uint32_t nchan_per_packet = packet_layout->get_nchan_per_packet();
+        const uint32_t nsamp_per_packet = packet_layout->get_samples_per_packet();
+        const uint64_t weights_stride = (weights == nullptr) ? 0 : weights_packet_stride;
+
+        auto make_iterator = [&](uint32_t iheap) {
+          HeapPacket<Byte> packet;
+          packet.data = data + (static_cast<uint64_t>(iheap) * data_heap_stride); // NOLINT
+          if (weights != nullptr)
+          {
+            Byte * heap_weights = weights + (static_cast<uint64_t>(iheap) * weights_heap_stride); // NOLINT
+            packet.scales = heap_weights + packet_layout->get_packet_scales_offset(); // NOLINT
+            packet.weights = heap_weights + packet_layout->get_packet_weights_offset(); // NOLINT
+          }
+          packet.packet_number = static_cast<uint64_t>(iheap) * packets_per_heap;
+          packet.chan_end = nchan_per_packet;
+          packet.samp_begin = static_cast<uint64_t>(iheap) * nsamp_per_packet;
+          packet.samp_end = packet.samp_begin + nsamp_per_packet;
+          return HeapPacketIterator<Byte>(packet, data_packet_stride, weights_stride, packets_per_heap, nchan_per_packet, nsamp_per_packet);
+        };
+
+        return HeapPacketRange<Byte>(make_iterator(heap_begin), make_iterator(heap_end));
+      }
+
       //! The layout of each packet in the heap
       std::shared_ptr<common::PacketLayout> packet_layout;
 
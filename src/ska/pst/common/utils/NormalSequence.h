@@ -30,6 +30,7 @@
 
 #include <cinttypes>
 #include <random>
+#include <vector>
 
 #include "ska/pst/common/utils/AsciiHeader.h"
 #include "ska/pst/common/definitions.h"
@@ -87,14 +88,25 @@ namespace ska::pst::common {
       void reset();
 
       /**
-       * @brief Generate a random sequence of normally distributed unsigned 8-bit or 16-bit integers.
+       * @brief Generate a random sequence of normally distributed signed 2, 4, 8 or 16-bit integers.
        * Each random number generated advances the sequence of random numbers.
+       * The 2 and 4-bit integers are packed into each byte, as described by is_packed_nbit.
        *
        * @param buffer pointer to memory to which the random sequence should be written
        * @param bufsz number of elements to write to the buffer
        */
       void generate(char * buffer, uint64_t bufsz);
 
+      /**
+       * @brief Generate a random sequence of normally distributed signed integers in the range of a 2, 4 or 8-bit integer,
+       * stored as unpacked 8-bit integers. Generating nval values advances the sequence of random numbers by
+       * the same amount as a call to generate that produces nval values.
+       *
+       * @param out pointer to memory to which the random sequence should be written
+       * @param nval number of values to write
+       */
+      void generate_values(int8_t * out, uint64_t nval);
+
       /**
        * @brief Compare contents of buffer to expected random sequence
        *
@@ -144,6 +156,12 @@ namespace ska::pst::common {
       //! get a 16-bit integer value from the normal distribution that is limited to min_val and max_val
       inline auto get_val(std::normal_distribution<float>& distribution) -> int16_t;
 
+      //! update the new red noise factor, once per generated buffer
+      void update_red_noise_factor();
+
+      //! unpacked values that are packed into the output of generate when nbit is 2 or 4
+      std::vector<int8_t> unpacked_values;
+
       //! number of bits per sample
       uint32_t nbit{0};
 
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+
+#include "ska/pst/common/utils/RateController.h"
+#include "ska/pst/common/utils/SegmentProducer.h"
+
+#ifndef SKA_PST_COMMON_UTILS_PacedSegmentProducer_h
+#define SKA_PST_COMMON_UTILS_PacedSegmentProducer_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Emits the segments of a SegmentProducer in real time, at the data rate of its data stream.
+   *
+   * @details Each segment is returned once the time at which its last byte of data would have been received has
+   * passed, as paced by a RateController. The caller sleeps while waiting, so that live beams can be simulated
+   * at line rate without occupying a CPU core per stream.
+   */
+  class PacedSegmentProducer : public SegmentProducer
+  {
+    public:
+
+      /**
+       * @brief Construct a new PacedSegmentProducer object
+       *
+       * @param producer the producer of segments
+       * @param bytes_per_second data rate of the data stream, or zero to compute it from the data header of the producer
+       * @param spin_nanoseconds time before each deadline at which the caller stops sleeping and spins
+       */
+      PacedSegmentProducer(std::shared_ptr<SegmentProducer> producer, double bytes_per_second = 0,
+        uint64_t spin_nanoseconds = RateController::default_spin_nanoseconds);
+
+      /**
+       * @brief Destroy the PacedSegmentProducer object.
+       *
+       */
+      ~PacedSegmentProducer() = default;
+
+      /**
+       * @brief Get the AsciiHeader that describes the data block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& data header of the producer
+       */
+      const ska::pst::common::AsciiHeader& get_data_header() const;
+
+      /**
+       * @brief Get the AsciiHeader that describes the weights block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& weights header of the producer
+       */
+      const ska::pst::common::AsciiHeader& get_weights_header() const;
+
+      /**
+       * @brief Get the next segment of data and weights from the producer, waiting until it is due.
+       * The end of data is returned without waiting.
+       *
+       */
+      Segment next_segment();
+
+      /**
+       * @brief Get the rate controller that paces the segments, which holds the drift statistics
+       *
+       * @return const RateController& the rate controller
+       */
+      const RateController& get_rate_controller() const { return controller; };
+
+    private:
+
+      //! the producer of segments
+      std::shared_ptr<SegmentProducer> producer;
+
+      //! paces the segments at the data rate
+      RateController controller;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_PacedSegmentProducer_h
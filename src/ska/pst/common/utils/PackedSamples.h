@@ -0,0 +1,93 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+#include <complex>
+
+#ifndef SKA_PST_COMMON_UTILS_PackedSamples_h
+#define SKA_PST_COMMON_UTILS_PackedSamples_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Return true if nbit is a bit depth at which several values are packed into each byte.
+   * Packed values are two's complement signed integers, with the first value stored in the least significant bits of each byte.
+   *
+   * @param nbit number of bits per value
+   * @return true if nbit is 2 or 4
+   */
+  auto is_packed_nbit(uint32_t nbit) -> bool;
+
+  /**
+   * @brief Pack signed integers into values of nbit bits. Each input value must be in the range of an nbit signed integer.
+   *
+   * @param in pointer to nval signed integers
+   * @param nval number of values to pack, nval * nbit must be a multiple of 8
+   * @param nbit number of bits per packed value [2 or 4]
+   * @param out pointer to nval * nbit / 8 bytes of packed values
+   */
+  void pack_values(const int8_t * in, uint64_t nval, uint32_t nbit, char * out);
+
+  /**
+   * @brief Unpack values of nbit bits to signed integers, using a lookup table that expands each byte
+   *
+   * @param in pointer to nval * nbit / 8 bytes of packed values
+   * @param nval number of values to unpack, nval * nbit must be a multiple of 8
+   * @param nbit number of bits per packed value [2 or 4]
+   * @param out pointer to nval signed integers
+   */
+  void unpack_values(const char * in, uint64_t nval, uint32_t nbit, int8_t * out);
+
+  /**
+   * @brief Convert packed complex-valued samples of nbit bits per dimension to single precision floating point, multiplied by scale.
+   * A lookup table expands each byte into 1 (4-bit) or 2 (2-bit) complex-valued samples.
+   *
+   * @param in pointer to the packed complex-valued input samples
+   * @param nsamp number of complex-valued samples to convert
+   * @param nbit number of bits per packed value [2 or 4]
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_packed_complex_samples(const char * in, uint64_t nsamp, uint32_t nbit, float scale, std::complex<float> * out);
+
+  /**
+   * @brief Sum the power (squared modulus) of packed complex-valued samples of nbit bits per dimension.
+   * A lookup table provides the total power of the samples in each byte.
+   *
+   * @param in pointer to the packed complex-valued input samples
+   * @param nsamp number of complex-valued samples to integrate
+   * @param nbit number of bits per packed value [2 or 4]
+   * @return float sum of the power of the input samples
+   */
+  auto sum_packed_complex_power(const char * in, uint64_t nsamp, uint32_t nbit) -> float;
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_PackedSamples_h
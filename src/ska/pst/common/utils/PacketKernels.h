@@ -0,0 +1,91 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+#include <complex>
+
+#ifndef SKA_PST_COMMON_UTILS_PacketKernels_h
+#define SKA_PST_COMMON_UTILS_PacketKernels_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Unpack all of the complex-valued samples in a single packet into an output array with arbitrary strides,
+   * multiplying each value by scale. The packet is small enough that its input samples and output tile remain in cache,
+   * so that reordering the samples into TFP, FTP or PFT order touches each sample only once.
+   *
+   * @param in pointer to the samples of the packet, in pol, chan, samp order
+   * @param scale multiplicative factor applied to each unpacked value
+   * @param out pointer to the output sample of the first channel and polarisation of the packet at the first time sample
+   * @param samp_stride number of complex values between consecutive time samples of the output array
+   * @param chan_stride number of complex values between consecutive channels of the output array
+   * @param pol_stride number of complex values between consecutive polarisations of the output array
+   */
+  using UnpackPacketKernel = void (*)(const char * in, float scale, std::complex<float> * out, uint64_t samp_stride, uint64_t chan_stride, uint64_t pol_stride);
+
+  /**
+   * @brief Add the power of all of the complex-valued samples in a single packet, multiplied by scale,
+   * to a bandpass ordered by frequency then polarisation.
+   *
+   * @param in pointer to the samples of the packet, in pol, chan, samp order
+   * @param scale multiplicative factor applied to the power of each channel and polarisation
+   * @param bandpass pointer to the bandpass element of the first channel and polarisation of the packet
+   */
+  using IntegratePacketKernel = void (*)(const char * in, float scale, float * bandpass);
+
+  /**
+   * @brief Kernels specialised at compile time for a single packet geometry
+   *
+   */
+  struct PacketKernels
+  {
+    //! specialised unpack kernel, nullptr if the geometry is not specialised
+    UnpackPacketKernel unpack{nullptr};
+
+    //! specialised integrate kernel, nullptr if the geometry is not specialised
+    IntegratePacketKernel integrate{nullptr};
+  };
+
+  /**
+   * @brief Get the kernels specialised for a packet geometry.
+   * Kernels are specialised for the standard Low (16-bit, 32 samples, 24 channels) and
+   * Mid (8 and 16-bit, 4 samples, 185 channels) CBF/PSR packet geometries with 2 polarisations.
+   *
+   * @param nbit number of bits per sample
+   * @param nsamp_per_packet number of time samples per packet
+   * @param nchan_per_packet number of channels per packet
+   * @param npol number of polarisations
+   * @return PacketKernels the specialised kernels, or null kernels if the geometry is not specialised
+   */
+  auto get_packet_kernels(uint32_t nbit, uint32_t nsamp_per_packet, uint32_t nchan_per_packet, uint32_t npol) -> PacketKernels;
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_PacketKernels_h
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+#include <vector>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+
+#ifndef SKA_PST_COMMON_UTILS_RateController_h
+#define SKA_PST_COMMON_UTILS_RateController_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Paces the emission of a stream of bytes at a fixed data rate without occupying a CPU core.
+   *
+   * @details The deadline of each call to wait is computed from CLOCK_MONOTONIC at the start of the stream and
+   * the total number of bytes emitted, so that errors do not accumulate. The caller sleeps with an absolute
+   * clock_nanosleep until shortly before the deadline and spins only for the remainder, which bounds both the
+   * CPU used and the wake-up jitter of the scheduler.
+   *
+   * The lateness of each wake-up is recorded in a histogram with logarithmic bins: bin 0 counts lateness of less
+   * than 1 microsecond, bin i counts lateness in [2^(i-1), 2^i) microseconds and the last bin counts the remainder.
+   * A deadline is missed when it has already passed on entry to wait, i.e. when the producer cannot keep up.
+   */
+  class RateController
+  {
+    public:
+
+      //! default time before each deadline at which the caller stops sleeping and spins, in nanoseconds
+      static constexpr uint64_t default_spin_nanoseconds = 50000;
+
+      //! number of bins in the lateness histogram
+      static constexpr unsigned lateness_bins = 16;
+
+      /**
+       * @brief Construct a new RateController object
+       *
+       * @param bytes_per_second data rate at which bytes are emitted, must be greater than zero
+       * @param spin_nanoseconds time before each deadline at which the caller stops sleeping and spins
+       */
+      RateController(double bytes_per_second, uint64_t spin_nanoseconds = default_spin_nanoseconds);
+
+      /**
+       * @brief Construct a new RateController object that emits bytes at the rate of the data stream described by the header
+       *
+       * @param header parameters that describe the data stream, used to compute the bytes per second
+       * @param spin_nanoseconds time before each deadline at which the caller stops sleeping and spins
+       */
+      RateController(const ska::pst::common::AsciiHeader& header, uint64_t spin_nanoseconds = default_spin_nanoseconds);
+
+      /**
+       * @brief Start the stream at the current time, resetting the number of bytes emitted and the statistics.
+       * Called implicitly by the first call to wait.
+       *
+       */
+      void start();
+
+      /**
+       * @brief Wait until the time at which nbytes more bytes have been emitted since the start of the stream.
+       *
+       * @param nbytes number of bytes emitted by the caller
+       */
+      void wait(uint64_t nbytes);
+
+      /**
+       * @brief Get the data rate at which bytes are emitted
+       *
+       * @return double bytes per second
+       */
+      double get_bytes_per_second() const { return bytes_per_second; };
+
+      /**
+       * @brief Get the number of bytes emitted since the start of the stream
+       *
+       * @return uint64_t number of bytes emitted
+       */
+      uint64_t get_bytes_emitted() const { return bytes_emitted; };
+
+      /**
+       * @brief Get the number of deadlines since the start of the stream
+       *
+       * @return uint64_t number of calls to wait
+       */
+      uint64_t get_deadlines() const { return deadlines; };
+
+      /**
+       * @brief Get the number of deadlines that had passed on entry to wait
+       *
+       * @return uint64_t number of missed deadlines
+       */
+      uint64_t get_missed_deadlines() const { return missed_deadlines; };
+
+      /**
+       * @brief Get the maximum lateness of a wake-up since the start of the stream
+       *
+       * @return uint64_t maximum lateness in nanoseconds
+       */
+      uint64_t get_max_lateness_nanoseconds() const { return max_lateness; };
+
+      /**
+       * @brief Get the mean lateness of the wake-ups since the start of the stream
+       *
+       * @return double mean lateness in nanoseconds
+       */
+      double get_mean_lateness_nanoseconds() const;
+
+      /**
+       * @brief Get the histogram of lateness, with lateness_bins logarithmic bins
+       *
+       * @return const std::vector<uint64_t>& number of wake-ups in each bin
+       */
+      const std::vector<uint64_t>& get_lateness_histogram() const { return lateness_histogram; };
+
+      /**
+       * @brief Get the bin of the lateness histogram that counts the specified lateness
+       *
+       * @param lateness lateness in nanoseconds
+       * @return unsigned index of the bin
+       */
+      static unsigned get_lateness_bin(uint64_t lateness);
+
+      /**
+       * @brief Log the drift statistics of the stream
+       *
+       */
+      void print_statistics() const;
+
+    private:
+
+      /**
+       * @brief Get the current time of CLOCK_MONOTONIC
+       *
+       * @return uint64_t nanoseconds since an arbitrary epoch
+       */
+      static uint64_t get_monotonic_nanoseconds();
+
+      /**
+       * @brief Record the lateness of a wake-up
+       *
+       * @param lateness lateness in nanoseconds
+       */
+      void record(uint64_t lateness);
+
+      //! data rate at which bytes are emitted
+      double bytes_per_second;
+
+      //! time before each deadline at which the caller stops sleeping and spins
+      uint64_t spin_nanoseconds;
+
+      //! flag indicating that the stream has started
+      bool started{false};
+
+      //! time of CLOCK_MONOTONIC at the start of the stream in nanoseconds
+      uint64_t start_time{0};
+
+      //! number of bytes emitted since the start of the stream
+      uint64_t bytes_emitted{0};
+
+      //! number of calls to wait since the start of the stream
+      uint64_t deadlines{0};
+
+      //! number of deadlines that had passed on entry to wait
+      uint64_t missed_deadlines{0};
+
+      //! sum of the lateness of every wake-up in nanoseconds
+      uint64_t total_lateness{0};
+
+      //! maximum lateness of a wake-up in nanoseconds
+      uint64_t max_lateness{0};
+
+      //! number of wake-ups in each bin of lateness
+      std::vector<uint64_t> lateness_histogram;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_RateController_h
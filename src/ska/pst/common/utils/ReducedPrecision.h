@@ -0,0 +1,119 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+
+#ifndef SKA_PST_COMMON_UTILS_ReducedPrecision_h
+#define SKA_PST_COMMON_UTILS_ReducedPrecision_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Complex-valued sample stored as a pair of 16-bit signed integers
+   *
+   */
+  struct ComplexInt16
+  {
+    //! real component
+    int16_t re;
+
+    //! imaginary component
+    int16_t im;
+  };
+
+  /**
+   * @brief Complex-valued sample stored as a pair of IEEE 754 half-precision (binary16) values
+   *
+   */
+  struct ComplexFP16
+  {
+    //! bit pattern of the real component
+    uint16_t re;
+
+    //! bit pattern of the imaginary component
+    uint16_t im;
+  };
+
+  /**
+   * @brief Complex-valued sample stored as a pair of bfloat16 values, i.e. the 16 most significant bits of an IEEE 754 single-precision value
+   *
+   */
+  struct ComplexBF16
+  {
+    //! bit pattern of the real component
+    uint16_t re;
+
+    //! bit pattern of the imaginary component
+    uint16_t im;
+  };
+
+  /**
+   * @brief Convert a single-precision value to a 16-bit signed integer, rounding to nearest and saturating at the limits of int16_t
+   *
+   * @param value single-precision value
+   * @return int16_t nearest representable 16-bit integer
+   */
+  auto float_to_int16(float value) -> int16_t;
+
+  /**
+   * @brief Convert a single-precision value to half precision, rounding to nearest even
+   *
+   * @param value single-precision value
+   * @return uint16_t bit pattern of the half-precision value
+   */
+  auto float_to_fp16(float value) -> uint16_t;
+
+  /**
+   * @brief Convert a half-precision value to single precision
+   *
+   * @param value bit pattern of the half-precision value
+   * @return float single-precision value
+   */
+  auto fp16_to_float(uint16_t value) -> float;
+
+  /**
+   * @brief Convert a single-precision value to bfloat16, rounding to nearest even
+   *
+   * @param value single-precision value
+   * @return uint16_t bit pattern of the bfloat16 value
+   */
+  auto float_to_bf16(float value) -> uint16_t;
+
+  /**
+   * @brief Convert a bfloat16 value to single precision
+   *
+   * @param value bit pattern of the bfloat16 value
+   * @return float single-precision value
+   */
+  auto bf16_to_float(uint16_t value) -> float;
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_ReducedPrecision_h
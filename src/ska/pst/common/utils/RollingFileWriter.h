@@ -0,0 +1,267 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/FileWriter.h"
+
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <inttypes.h>
+
+#ifndef SKA_PST_COMMON_UTILS_RollingFileWriter_h
+#define SKA_PST_COMMON_UTILS_RollingFileWriter_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief The Rolling File Writer writes a stream of data to a sequence of PSRDADA compliant files,
+   * switching to the next file in the sequence when a size or duration threshold is reached.
+   * Each file is written with a copy of the stream header in which FILE_NUMBER and OBS_OFFSET are advanced.
+   * The next file in the sequence is opened, preallocated and has its header written by a background thread
+   * while the current file is being written, and the previous file is closed by the same background thread.
+   *
+   */
+  class RollingFileWriter {
+
+    public:
+
+      /**
+       * @brief Construct a new RollingFileWriter object
+       *
+       * @param use_o_direct Flag to enable the O_DIRECT option on each file.
+       */
+      RollingFileWriter(bool use_o_direct = false);
+
+      /**
+       * @brief Destroy the RollingFileWriter object, closing any open files.
+       *
+       */
+      ~RollingFileWriter();
+
+      /**
+       * @brief Set the maximum number of data bytes written to each file, or zero for no limit.
+       * Must be called before open.
+       *
+       * @param nbytes maximum number of data bytes per file, excluding the header
+       */
+      void set_max_file_bytes(uint64_t nbytes);
+
+      /**
+       * @brief Get the maximum number of data bytes written to each file
+       *
+       * @return uint64_t maximum number of data bytes per file, zero if there is no limit
+       */
+      uint64_t get_max_file_bytes() const { return max_file_bytes; };
+
+      /**
+       * @brief Set the maximum duration of the stream written to each file, or zero for no limit.
+       * The duration is converted to bytes with AsciiHeader::compute_bytes_per_second. Must be called before open.
+       *
+       * @param seconds maximum duration per file in seconds
+       */
+      void set_max_file_seconds(double seconds);
+
+      /**
+       * @brief Get the maximum duration of the stream written to each file
+       *
+       * @return double maximum duration per file in seconds, zero if there is no limit
+       */
+      double get_max_file_seconds() const { return max_file_seconds; };
+
+      /**
+       * @brief Enable or disable preallocation of each file to its maximum size. Must be called before open.
+       *
+       * @param enable flag to enable preallocation
+       */
+      void set_preallocate(bool enable) { preallocate = enable; };
+
+      /**
+       * @brief Open the first file of the sequence and, if files have a size limit, prepare the second file in the background.
+       * The number of data bytes per file is the smaller of the byte and duration thresholds, rounded down to a multiple
+       * of RESOLUTION so that each file contains only complete heaps.
+       *
+       * @param output_dir directory in which the files are written
+       * @param header AsciiHeader of the stream, which must define UTC_START and HDR_SIZE; FILE_NUMBER and OBS_OFFSET default to zero
+       */
+      void open(const std::filesystem::path& output_dir, const ska::pst::common::AsciiHeader& header);
+
+      /**
+       * @brief Open the first file of the sequence, distributing the files round-robin across several output directories.
+       * Writing consecutive files to different devices aggregates their bandwidth, and the OBS_OFFSET and FILE_NUMBER
+       * in each filename record the order of the files.
+       *
+       * @param output_dirs directories in which the files are written, in the order of the files
+       * @param header AsciiHeader of the stream, which must define UTC_START and HDR_SIZE; FILE_NUMBER and OBS_OFFSET default to zero
+       */
+      void open(const std::vector<std::filesystem::path>& output_dirs, const ska::pst::common::AsciiHeader& header);
+
+      /**
+       * @brief Write data to the sequence of files, switching to the next file at each file boundary.
+       *
+       * @param data_ptr pointer to the data to write
+       * @param data_size number of bytes to write
+       * @return ssize_t number of bytes written
+       */
+      ssize_t write_data(char * data_ptr, uint64_t data_size);
+
+      /**
+       * @brief Close the current file and remove any prepared file to which no data were written.
+       *
+       */
+      void close();
+
+      /**
+       * @brief Return a boolean describing if the sequence of files is currently open for writing.
+       *
+       * @return true the sequence of files is open for writing
+       * @return false the sequence of files is not open for writing
+       */
+      bool is_open() const { return current != nullptr; };
+
+      /**
+       * @brief Get the number of data bytes written to each file before switching to the next file
+       *
+       * @return uint64_t number of data bytes per file, zero if files have no size limit
+       */
+      uint64_t get_file_data_bytes() const { return file_data_bytes; };
+
+      /**
+       * @brief Get the FILE_NUMBER of the file currently being written
+       *
+       * @return uint64_t file number of the current file
+       */
+      uint64_t get_file_number() const { return file_number; };
+
+      /**
+       * @brief Get the total number of data bytes written to all files since open
+       *
+       * @return uint64_t total number of data bytes written
+       */
+      uint64_t get_data_bytes_written() const { return data_bytes_written; };
+
+      /**
+       * @brief Get the full paths of the files written since open, in the order that they were written
+       *
+       * @return const std::vector<std::filesystem::path>& paths of the files written
+       */
+      const std::vector<std::filesystem::path>& get_filenames() const { return filenames; };
+
+    private:
+
+      /**
+       * @brief Open a file in the sequence and write its header, which is a copy of the stream header with FILE_NUMBER and OBS_OFFSET updated.
+       *
+       * @param number FILE_NUMBER of the file
+       * @param obs_offset OBS_OFFSET of the file
+       * @return std::unique_ptr<FileWriter> writer of the opened file
+       */
+      std::unique_ptr<FileWriter> open_file(uint64_t number, uint64_t obs_offset);
+
+      /**
+       * @brief Close the full current file and switch to the prepared next file, then prepare the following file in the background.
+       *
+       */
+      void roll();
+
+      /**
+       * @brief Start the background thread that closes the previous file and prepares the next file.
+       *
+       * @param previous writer of the previous file, which may be null
+       */
+      void start_background(std::unique_ptr<FileWriter> previous);
+
+      /**
+       * @brief Wait for the background thread to complete, re-throwing any exception that it raised.
+       *
+       */
+      void join_background();
+
+      //! flag to enable the O_DIRECT option on each file
+      bool use_o_direct;
+
+      //! maximum number of data bytes per file, zero if there is no limit
+      uint64_t max_file_bytes{0};
+
+      //! maximum duration per file in seconds, zero if there is no limit
+      double max_file_seconds{0};
+
+      //! flag to enable preallocation of each file
+      bool preallocate{false};
+
+      //! directories in which the files are written, used in turn
+      std::vector<std::filesystem::path> output_dirs;
+
+      //! copy of the stream header
+      ska::pst::common::AsciiHeader header;
+
+      //! UTC_START of the stream, used to name each file
+      std::string utc_start;
+
+      //! size of the header in each file
+      uint64_t header_size{0};
+
+      //! number of data bytes per file, zero if files have no size limit
+      uint64_t file_data_bytes{0};
+
+      //! FILE_NUMBER of the current file
+      uint64_t file_number{0};
+
+      //! FILE_NUMBER of the first file
+      uint64_t first_file_number{0};
+
+      //! OBS_OFFSET of the current file
+      uint64_t obs_offset{0};
+
+      //! total number of data bytes written since open
+      uint64_t data_bytes_written{0};
+
+      //! writer of the current file
+      std::unique_ptr<FileWriter> current{nullptr};
+
+      //! writer of the prepared next file
+      std::unique_ptr<FileWriter> next{nullptr};
+
+      //! background thread that closes the previous file and prepares the next file
+      std::unique_ptr<std::thread> background_thread{nullptr};
+
+      //! exception raised by the background thread
+      std::exception_ptr background_error{nullptr};
+
+      //! full paths of the files written since open
+      std::vector<std::filesystem::path> filenames;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_RollingFileWriter_h
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <inttypes.h>
+#include <vector>
+
+#include "ska/pst/common/utils/SegmentProducer.h"
+
+#ifndef SKA_PST_COMMON_UTILS_SegmentQueue_h
+#define SKA_PST_COMMON_UTILS_SegmentQueue_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Bounded single-producer, single-consumer queue of preallocated segment slots.
+   *
+   * @details The producer acquires a free slot, copies a segment into the buffers of the slot and publishes it;
+   * the consumer acquires the oldest published slot, processes it in place and releases it. The slots are
+   * handed over with a pair of cache-line padded atomic counters and no mutex. A side that must wait for the
+   * other spins briefly, then yields, then sleeps, so that a full queue applies backpressure to the producer.
+   *
+   * Exactly one thread may call the producer methods and exactly one thread may call the consumer methods.
+   */
+  class SegmentQueue {
+
+    public:
+
+      //! default number of slots in the queue
+      static constexpr size_t default_nslots = 4;
+
+      /**
+       * @brief A segment and the buffers that hold its data and weights
+       *
+       */
+      class Slot
+      {
+        public:
+
+          /**
+           * @brief Copy the data and weights blocks of a segment into the buffers of the slot,
+           * growing the buffers if required. The offsets of the blocks are preserved.
+           *
+           * @param source segment to be copied
+           */
+          void assign(const SegmentProducer::Segment& source);
+
+          //! the segment, whose blocks refer to the buffers of the slot
+          SegmentProducer::Segment segment;
+
+          //! buffer that holds the data block
+          std::vector<char> data;
+
+          //! buffer that holds the weights block
+          std::vector<char> weights;
+      };
+
+      /**
+       * @brief Construct a new SegmentQueue object
+       *
+       * @param nslots number of slots in the queue, must be greater than zero
+       * @param data_bytes number of bytes preallocated for the data block of each slot
+       * @param weights_bytes number of bytes preallocated for the weights block of each slot
+       */
+      SegmentQueue(size_t nslots = default_nslots, uint64_t data_bytes = 0, uint64_t weights_bytes = 0);
+
+      SegmentQueue(const SegmentQueue&) = delete;
+      auto operator=(const SegmentQueue&) -> SegmentQueue& = delete;
+
+      /**
+       * @brief Wait for a free slot and acquire it for writing. Called only by the producer.
+       *
+       * @return Slot* the free slot, or nullptr if the queue has been stopped
+       */
+      auto open_write_slot() -> Slot *;
+
+      /**
+       * @brief Publish the slot acquired by open_write_slot to the consumer. Called only by the producer.
+       *
+       */
+      void close_write_slot();
+
+      /**
+       * @brief Indicate that no further slots will be published. Called only by the producer.
+       * The consumer reads the slots already published before open_read_slot returns nullptr.
+       *
+       */
+      void signal_end();
+
+      /**
+       * @brief Wait for a published slot and acquire it for reading. Called only by the consumer.
+       *
+       * @return Slot* the oldest published slot, or nullptr at the end of data or if the queue has been stopped
+       */
+      auto open_read_slot() -> Slot *;
+
+      /**
+       * @brief Release the slot acquired by open_read_slot back to the producer. Called only by the consumer.
+       *
+       */
+      void close_read_slot();
+
+      /**
+       * @brief Wake both sides and cause all subsequent waits to return nullptr. May be called from any thread.
+       *
+       */
+      void stop();
+
+      /**
+       * @brief Get the number of slots in the queue
+       *
+       * @return size_t number of slots
+       */
+      auto get_nslots() const -> size_t { return slots.size(); }
+
+      /**
+       * @brief Get the number of bytes preallocated for the data block of each slot
+       *
+       * @return uint64_t number of bytes
+       */
+      auto get_data_bytes() const -> uint64_t { return data_bytes; }
+
+      /**
+       * @brief Get the number of bytes preallocated for the weights block of each slot
+       *
+       * @return uint64_t number of bytes
+       */
+      auto get_weights_bytes() const -> uint64_t { return weights_bytes; }
+
+      /**
+       * @brief Get the number of slots that have been published and not yet released
+       *
+       * @return size_t number of full slots
+       */
+      auto get_size() const -> size_t;
+
+      /**
+       * @brief Get the number of calls to open_write_slot that waited because every slot was full
+       *
+       * @return uint64_t number of producer waits
+       */
+      auto get_write_waits() const -> uint64_t { return write_waits.load(std::memory_order_relaxed); }
+
+      /**
+       * @brief Get the number of calls to open_read_slot that waited because every slot was free
+       *
+       * @return uint64_t number of consumer waits
+       */
+      auto get_read_waits() const -> uint64_t { return read_waits.load(std::memory_order_relaxed); }
+
+    private:
+
+      //! size of a cache line, which separates the counters updated by the producer and the consumer
+      static constexpr size_t cache_line_bytes = 64;
+
+      //! the slots of the queue
+      std::vector<Slot> slots;
+
+      //! number of bytes preallocated for the data block of each slot
+      uint64_t data_bytes;
+
+      //! number of bytes preallocated for the weights block of each slot
+      uint64_t weights_bytes;
+
+      //! number of slots published by the producer
+      alignas(cache_line_bytes) std::atomic<uint64_t> head{0};
+
+      //! flag indicating that the producer has published its last slot
+      std::atomic<bool> end{false};
+
+      //! number of calls to open_write_slot that waited
+      std::atomic<uint64_t> write_waits{0};
+
+      //! number of slots released by the consumer
+      alignas(cache_line_bytes) std::atomic<uint64_t> tail{0};
+
+      //! number of calls to open_read_slot that waited
+      std::atomic<uint64_t> read_waits{0};
+
+      //! flag that causes both sides to stop waiting
+      alignas(cache_line_bytes) std::atomic<bool> stopped{false};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_SegmentQueue_h
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+#include <string>
+
+#include "ska/pst/common/utils/BlockProducer.h"
+#include "ska/pst/common/utils/SharedMemoryRingBuffer.h"
+
+#ifndef SKA_PST_COMMON_UTILS_SharedMemoryBlockProducer_h
+#define SKA_PST_COMMON_UTILS_SharedMemoryBlockProducer_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Reads blocks of data from a SharedMemoryRingBuffer written by another process.
+   *
+   * Each block is returned in place in the shared memory segment, without copying, and is released
+   * back to the writer on the next call to next_block or when the producer is destroyed.
+   */
+  class SharedMemoryBlockProducer : public BlockProducer
+  {
+    public:
+
+      /**
+       * @brief Construct a new SharedMemoryBlockProducer object, attaching to the ring buffer and reading its header.
+       *
+       * @param name name of the shared memory ring buffer
+       * @param timeout maximum time to wait for the header and each block in seconds, zero to wait indefinitely
+       */
+      SharedMemoryBlockProducer(const std::string& name, double timeout = 0);
+
+      /**
+       * @brief Destroy the SharedMemoryBlockProducer object, releasing any block that is held.
+       *
+       */
+      ~SharedMemoryBlockProducer();
+
+      /**
+       * @brief Get the AsciiHeader that describes the block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& header read from the ring buffer
+       */
+      const ska::pst::common::AsciiHeader& get_header() const;
+
+      /**
+       * @brief Get the next block of data.
+       *
+       * Releases the block returned by the previous call and waits for the writer to publish the next block.
+       * The obs_offset of the block includes the OBS_OFFSET of the header, if defined.
+       * At the end of data, this function returns (nullptr, 0)
+       */
+      BlockProducer::Block next_block();
+
+      /**
+       * @brief Get the ring buffer from which blocks are read
+       *
+       * @return const SharedMemoryRingBuffer& the ring buffer
+       */
+      const SharedMemoryRingBuffer& get_ring() const { return *ring; };
+
+    private:
+
+      //! the ring buffer from which blocks are read
+      std::unique_ptr<SharedMemoryRingBuffer> ring;
+
+      //! header read from the header ring
+      ska::pst::common::AsciiHeader header;
+
+      //! OBS_OFFSET of the header, added to the offset of each block
+      uint64_t obs_offset{0};
+
+      //! flag indicating that a block is held
+      bool holding{false};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_SharedMemoryBlockProducer_h
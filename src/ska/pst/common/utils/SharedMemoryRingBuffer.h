@@ -0,0 +1,297 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+#include <string>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/BlockProducer.h"
+#include "ska/pst/lmc/ska_pst_lmc.pb.h"
+
+#ifndef SKA_PST_COMMON_UTILS_SharedMemoryRingBuffer_h
+#define SKA_PST_COMMON_UTILS_SharedMemoryRingBuffer_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Ring buffer in POSIX shared memory that passes a stream of headers and blocks of data from a single writer
+   * to a single reader, which may be in different processes on the same host.
+   *
+   * The shared memory segment contains a control block, a header ring and a data ring. Each ring is a sequence of
+   * fixed-size slots and a pair of counters, the number of slots written and the number of slots read, which are
+   * updated with release and observed with acquire semantics, so that ownership of a slot passes between the writer
+   * and the reader without locks or copies. The writer fills a slot in place between open_write_block and close_write_block,
+   * and the reader accesses it in place between open_read_block and close_read_block. A process that must wait for a slot
+   * polls the counters, yielding and then sleeping briefly between polls.
+   *
+   * The creating process publishes the control block only once the segment is sized and initialised, and a process that
+   * attaches while the segment is being created polls until the control block is published, so the reader may attach as soon
+   * as the name of the segment exists.
+   *
+   * The process that creates the ring buffer removes the shared memory segment from the file system when it is destroyed;
+   * processes that have attached to it retain access until they are also destroyed.
+   */
+  class SharedMemoryRingBuffer {
+
+    public:
+
+      //! default number of slots in the header ring
+      static constexpr uint64_t default_hdr_nbufs = 4;
+
+      //! version of the layout of the shared memory segment
+      static constexpr uint64_t layout_version = 1;
+
+      //! default maximum time in seconds to wait for a segment that is being created to be published
+      static constexpr double default_attach_timeout = 1.0;
+
+      /**
+       * @brief Create a new shared memory segment and ring buffer, throwing an exception if the name is already in use
+       *
+       * @param name name of the shared memory segment, to which a leading / is added if necessary
+       * @param nbufs number of slots in the data ring
+       * @param bufsz size of each slot in the data ring in bytes
+       * @param hdr_nbufs number of slots in the header ring
+       * @param hdr_bufsz size of each slot in the header ring in bytes
+       */
+      SharedMemoryRingBuffer(const std::string& name, uint64_t nbufs, uint64_t bufsz,
+        uint64_t hdr_nbufs = default_hdr_nbufs, uint64_t hdr_bufsz = AsciiHeader::default_header_size);
+
+      /**
+       * @brief Attach to an existing ring buffer, throwing an exception if it does not exist or has an incompatible layout.
+       * If the segment exists but its creator has not yet published the control block, wait for it to be published.
+       *
+       * @param name name of the shared memory segment, to which a leading / is added if necessary
+       * @param attach_timeout maximum time in seconds to wait for the control block to be published, zero to wait indefinitely
+       */
+      explicit SharedMemoryRingBuffer(const std::string& name, double attach_timeout = default_attach_timeout);
+
+      /**
+       * @brief Destroy the SharedMemoryRingBuffer object, unmapping the segment and, if this object created it, unlinking it
+       *
+       */
+      ~SharedMemoryRingBuffer();
+
+      SharedMemoryRingBuffer(const SharedMemoryRingBuffer&) = delete;
+      SharedMemoryRingBuffer& operator=(const SharedMemoryRingBuffer&) = delete;
+
+      /**
+       * @brief Write a header to the next slot of the header ring, waiting for a free slot
+       *
+       * @param header AsciiHeader to write, which must fit in the header slot
+       */
+      void write_header(const ska::pst::common::AsciiHeader& header);
+
+      /**
+       * @brief Read the next header from the header ring, waiting for it to be written
+       *
+       * @return ska::pst::common::AsciiHeader the header
+       */
+      ska::pst::common::AsciiHeader read_header();
+
+      /**
+       * @brief Acquire the next slot of the data ring for writing, waiting for the reader to release it
+       *
+       * @return char* base address of the slot, which holds get_bufsz() bytes
+       */
+      char * open_write_block();
+
+      /**
+       * @brief Publish the slot acquired by open_write_block to the reader
+       *
+       * @param nbytes number of bytes written to the slot, which may be less than get_bufsz() for the last block
+       */
+      void close_write_block(uint64_t nbytes);
+
+      /**
+       * @brief Copy data into the next slot of the data ring and publish it
+       *
+       * @param data pointer to the data
+       * @param nbytes number of bytes of data, which must not exceed get_bufsz()
+       */
+      void write_block(const char * data, uint64_t nbytes);
+
+      /**
+       * @brief Signal to the reader that no further blocks will be written
+       *
+       */
+      void signal_eod();
+
+      /**
+       * @brief Acquire the next published slot of the data ring for reading, waiting for the writer to publish it
+       *
+       * @return BlockProducer::Block the slot, its number of bytes and the number of bytes written before it,
+       * or (nullptr, 0) once all blocks written before the end of data have been read
+       */
+      BlockProducer::Block open_read_block();
+
+      /**
+       * @brief Release the slot acquired by open_read_block to the writer
+       *
+       */
+      void close_read_block();
+
+      /**
+       * @brief Set the maximum time to wait for a slot, after which an exception is thrown, or zero to wait indefinitely
+       *
+       * @param seconds maximum time to wait in seconds
+       */
+      void set_timeout(double seconds) { timeout = seconds; };
+
+      /**
+       * @brief Get the name of the shared memory segment
+       *
+       * @return const std::string& name of the shared memory segment, including the leading /
+       */
+      const std::string& get_name() const { return name; };
+
+      /**
+       * @brief Get the number of slots in the data ring
+       *
+       * @return uint64_t number of slots
+       */
+      uint64_t get_nbufs() const;
+
+      /**
+       * @brief Get the size of each slot in the data ring
+       *
+       * @return uint64_t size of each slot in bytes
+       */
+      uint64_t get_bufsz() const;
+
+      /**
+       * @brief Get the size of each slot in the header ring
+       *
+       * @return uint64_t size of each slot in bytes
+       */
+      uint64_t get_hdr_bufsz() const;
+
+      /**
+       * @brief Get the number of blocks published to the data ring
+       *
+       * @return uint64_t number of blocks written
+       */
+      uint64_t get_write_count() const;
+
+      /**
+       * @brief Get the number of blocks released by the reader of the data ring
+       *
+       * @return uint64_t number of blocks read
+       */
+      uint64_t get_read_count() const;
+
+      /**
+       * @brief Fill the statistics of the data ring from its counters. A slot is full from when it is published by the
+       * writer until it is released by the reader, clear otherwise, and available if it is clear and not acquired by the writer.
+       *
+       * @param stats the SmrbStatitics message to fill
+       */
+      void fill(ska::pst::lmc::SmrbStatitics& stats) const;
+
+      /**
+       * @brief Return the name with a leading / added if necessary, as required by shm_open
+       *
+       * @param name name of the shared memory segment
+       * @return std::string name with a leading /
+       */
+      static std::string get_shm_name(const std::string& name);
+
+      //! layout of the shared memory segment, defined in the implementation
+      struct Control;
+
+      //! control block of a ring, defined in the implementation
+      struct Ring;
+
+    private:
+
+      /**
+       * @brief Map the shared memory segment opened with the file descriptor
+       *
+       * @param nbytes size of the segment in bytes
+       */
+      void map(uint64_t nbytes);
+
+      /**
+       * @brief Wait for a slot of a ring to be free for writing
+       *
+       * @param ring the ring
+       * @param method name of the calling method, for logging
+       * @return uint64_t number of slots written, which selects the slot to write
+       */
+      uint64_t wait_for_write(Ring& ring, const char * method) const;
+
+      /**
+       * @brief Wait for a slot of a ring to be published, or for the end of data
+       *
+       * @param ring the ring
+       * @param method name of the calling method, for logging
+       * @return bool true if a slot is available, false at the end of data
+       */
+      bool wait_for_read(Ring& ring, const char * method) const;
+
+      /**
+       * @brief Get the base address of a slot of a ring
+       *
+       * @param ring the ring
+       * @param count number of slots written or read, which selects the slot
+       * @return char* base address of the slot
+       */
+      char * get_buffer(const Ring& ring, uint64_t count) const;
+
+      //! name of the shared memory segment
+      std::string name;
+
+      //! flag indicating that this object created the shared memory segment
+      bool owner{false};
+
+      //! file descriptor of the shared memory segment
+      int fd{-1};
+
+      //! base address of the mapped segment
+      char * base{nullptr};
+
+      //! size of the mapped segment in bytes
+      uint64_t segment_size{0};
+
+      //! the control block at the start of the segment
+      Control * control{nullptr};
+
+      //! flag indicating that a data slot is acquired for writing
+      bool writing{false};
+
+      //! flag indicating that a data slot is acquired for reading
+      bool reading{false};
+
+      //! maximum time to wait for a slot in seconds, zero to wait indefinitely
+      double timeout{0};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_SharedMemoryRingBuffer_h
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+#include <string>
+
+#include "ska/pst/common/utils/BlockSegmentProducer.h"
+#include "ska/pst/common/utils/SharedMemoryBlockProducer.h"
+#include "ska/pst/lmc/ska_pst_lmc.pb.h"
+
+#ifndef SKA_PST_COMMON_UTILS_SharedMemorySegmentProducer_h
+#define SKA_PST_COMMON_UTILS_SharedMemorySegmentProducer_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Class used for reading voltage data and weights from a pair of shared memory ring buffers.
+   *
+   */
+  class SharedMemorySegmentProducer : public BlockSegmentProducer
+  {
+    public:
+      /**
+       * @brief Create instance of a SharedMemorySegmentProducer object.
+       *
+       * @param data_name name of the ring buffer to which the data are written
+       * @param weights_name name of the ring buffer to which the weights are written
+       * @param timeout maximum time to wait for each header and block in seconds, zero to wait indefinitely
+       */
+      SharedMemorySegmentProducer(
+        const std::string& data_name,
+        const std::string& weights_name,
+        double timeout = 0
+      );
+
+      /**
+       * @brief Destroy the SharedMemorySegmentProducer object.
+       *
+       */
+      ~SharedMemorySegmentProducer();
+
+      /**
+       * @brief Fill the monitoring data with the statistics of the data and weights ring buffers
+       *
+       * @param monitor_data monitoring data to be filled
+       */
+      void fill(ska::pst::lmc::SmrbMonitorData& monitor_data) const;
+
+    private:
+
+      //! reads blocks from the data ring buffer
+      std::shared_ptr<SharedMemoryBlockProducer> data_ring_producer;
+
+      //! reads blocks from the weights ring buffer
+      std::shared_ptr<SharedMemoryBlockProducer> weights_ring_producer;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_SharedMemorySegmentProducer_h
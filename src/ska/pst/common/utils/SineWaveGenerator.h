@@ -29,6 +29,7 @@
  */
 
 #include <complex>
+#include <vector>
 #include <spdlog/spdlog.h>
 
 #include "ska/pst/common/utils/ScaleWeightGenerator.h"
@@ -191,6 +192,9 @@ namespace ska::pst::common {
       double amplitude{0};
 
       uint32_t current_channel{0};
+
+      //! unpacked values that are packed into, or unpacked from, the data stream when nbit is 2 or 4
+      std::vector<int8_t> unpacked_values;
   };
 
 }  // namespace ska::pst::common
@@ -180,6 +180,9 @@ namespace ska::pst::common {
 
       //! Temporary buffer used by test_data
       std::vector<char> temp_data;
+
+      //! Unpacked values of a single packet, packed into the data stream when nbit is 2 or 4
+      std::vector<int8_t> unpacked_values;
   };
 
 } // namespace ska::pst::common
@@ -0,0 +1,399 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/HeapLayout.h"
+#include "ska/pst/common/utils/WeightsDecoder.h"
+#include "ska/pst/lmc/ska_pst_lmc.pb.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#ifndef SKA_PST_COMMON_UTILS_StatisticsEngine_h
+#define SKA_PST_COMMON_UTILS_StatisticsEngine_h
+
+namespace ska::pst::common
+{
+  /**
+   * @brief Computes all of the products of the StatMonitorData message in a single pass over the raw heaps of a block.
+   *
+   * @details Samples from invalid packets (scale factor = NaN) and samples with a relative weight of zero are excluded from all products. The masked products
+   * additionally exclude the channels flagged in the RFI channel mask. Histograms and clipped sample counts are
+   * computed from the raw integer states, all other products from the samples divided by the packet scale factor.
+   *
+   * The repeated fields of the StatMonitorData message are filled in row-major order with the following dimensions
+   *
+   * - mean_frequency_avg[_masked], variance_frequency_avg[_masked], num_clipped_samples[_masked]: [npol][ndim]
+   * - mean_spectrum, variance_spectrum, num_clipped_samples_spectrum: [npol][ndim][nchan]
+   * - mean_spectral_power, max_spectral_power: [npol][nchan]
+   * - histogram_1d_freq_avg[_masked]: [npol][ndim][2^nbit]
+   * - histogram_rebinned_1d_freq_avg[_masked]: [npol][ndim][nrebin]
+   * - histogram_rebinned_2d_freq_avg[_masked]: [npol][nrebin (real)][nrebin (imag)]
+   * - spectrogram: [npol][nfreq_bins][ntime_bins], the summed power in each bin
+   * - timeseries[_masked]: [npol][ntime_bins][3], the maximum, minimum and mean power in each bin
+   *
+   */
+  class StatisticsEngine
+  {
+    public:
+
+      /**
+       * @brief Construct a new StatisticsEngine object
+       *
+       */
+      StatisticsEngine() = default;
+
+      /**
+       * @brief Destroy the StatisticsEngine object
+       *
+       */
+      virtual ~StatisticsEngine() = default;
+
+      //! Default number of bins in each dimension of the rebinned histograms
+      static constexpr uint32_t default_nrebin = 256;
+
+      //! Default maximum number of frequency bins in the spectrogram
+      static constexpr uint32_t default_nfreq_bins = 1024;
+
+      //! Default maximum number of time bins in the spectrogram and timeseries
+      static constexpr uint32_t default_ntime_bins = 1024;
+
+      /**
+       * @brief Configure the statistics engine with the AsciiHeader from the data and weights streams.
+       * The optional STAT_NREBIN, STAT_REQ_FREQ_BINS and STAT_REQ_TIME_BINS parameters of the data header
+       * override the number of rebinned histogram bins and the maximum number of frequency and time bins.
+       *
+       * @param data_config AsciiHeader containing the configuration of the data stream
+       * @param weights_config AsciiHeader containing the configuration of the weights stream
+       */
+      void configure(const ska::pst::common::AsciiHeader& data_config, const ska::pst::common::AsciiHeader& weights_config);
+
+      /**
+       * @brief Set the channels that are flagged for RFI and excluded from the masked products
+       *
+       * @param mask vector of nchan flags, true for channels that are flagged for RFI
+       */
+      void set_channel_mask(const std::vector<bool>& mask);
+
+      /**
+       * @brief Compute the statistics of a block of data and weights in a single pass, filling the provided message.
+       *
+       * @param data pointer to raw data array
+       * @param data_bufsz size of the raw data array in bytes
+       * @param weights pointer to raw weights array
+       * @param weights_bufsz size of the raw weights array in bytes
+       * @param stats message in which the statistics are returned, any existing content is cleared
+       */
+      void compute(char * data, uint64_t data_bufsz, char * weights, uint64_t weights_bufsz, ska::pst::lmc::StatMonitorData& stats);
+
+      /**
+       * @brief Get the number of bins in each dimension of the rebinned histograms
+       *
+       * @return uint32_t number of rebinned histogram bins
+       */
+      auto get_nrebin() const -> uint32_t { return nrebin; };
+
+      /**
+       * @brief Get the number of frequency bins in the spectrogram
+       *
+       * @return uint32_t number of frequency bins
+       */
+      auto get_nfreq_bins() const -> uint32_t { return nfreq_bins; };
+
+      /**
+       * @brief Get the number of time bins in the spectrogram and timeseries of the most recently computed block
+       *
+       * @return uint32_t number of time bins
+       */
+      auto get_ntime_bins() const -> uint32_t { return ntime_bins; };
+
+      /**
+       * @brief Get the number of dropped packets (scale factor = NaN) encountered in the most recently computed block
+       *
+       * @return uint64_t number of invalid packets
+       */
+      auto get_invalid_packets() const -> uint64_t { return invalid_packets; };
+
+    private:
+
+      //! Index of the accumulators for channels that are not flagged for RFI
+      static constexpr unsigned clean = 0;
+
+      //! Index of the accumulators for channels that are flagged for RFI
+      static constexpr unsigned flagged = 1;
+
+      //! Number of accumulator sets, one for clean and one for flagged channels
+      static constexpr unsigned nsets = 2;
+
+      //! Number of values stored for each bin of the timeseries: maximum, minimum and mean
+      static constexpr unsigned ntimeseries_values = 3;
+
+      /**
+       * @brief Templated method that accumulates the statistics of 8 or 16 bit integers in a single pass over the heaps.
+       * Each row of samples is processed one block of nsamp_per_weight samples at a time, skipping the zero-weighted blocks.
+       * All accumulators must have been reset through a call to reset(), and the weights decoded by weights_decoder,
+       * before calling this method.
+       *
+       * @tparam T type of input data [int8_t or int16_t]
+       * @param data pointer to the input data array
+       * @param nheaps number of packed heaps to process
+       */
+      template <typename T>
+      void accumulate_samples(const T* data, uint32_t nheaps)
+      {
+        const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
+        const int32_t state_offset = -static_cast<int32_t>(std::numeric_limits<T>::min());
+        const int32_t min_state = std::numeric_limits<T>::min();
+        const int32_t max_state = std::numeric_limits<T>::max();
+        const uint32_t nsamp_per_block = weights_decoder.get_nsamp_per_block();
+        const uint32_t nblocks_per_chan = weights_decoder.get_nblocks_per_chan();
+
+        for (const auto& packet : layout.get_packets(reinterpret_cast<const char*>(data), nullptr, 0, nheaps)) // NOLINT
+        {
+          // exclude the entire packet if the scale factor is invalid
+          if (!weights_decoder.is_valid(packet.packet_number))
+          {
+            invalid_packets++;
+            continue;
+          }
+
+          const float reciprocal_scale = weights_decoder.get_reciprocal_scale(packet.packet_number);
+          const float * packet_mask = weights_decoder.get_packet_mask(packet.packet_number);
+          const uint32_t * samp_time_bin = &time_bin[packet.samp_begin]; // NOLINT
+          const T* in = reinterpret_cast<const T*>(packet.data); // NOLINT
+
+          const float inverse_scale_squared = reciprocal_scale * reciprocal_scale;
+          for (uint32_t ipol=0; ipol<npol; ipol++)
+          {
+            uint32_t * hist_re = &histogram[index_hist(0, ipol, 0)];
+            uint32_t * hist_im = &histogram[index_hist(0, ipol, 1)];
+            for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
+            {
+              const uint32_t ochan = packet.chan_begin + ichan;
+              const unsigned set = channel_mask[ochan] ? flagged : clean;
+              const uint64_t set_hist_offset = set * hist_set_stride;
+
+              uint32_t * set_hist_re = hist_re + set_hist_offset; // NOLINT
+              uint32_t * set_hist_im = hist_im + set_hist_offset; // NOLINT
+              uint32_t * set_rebinned_2d = &rebinned_2d[index_rebinned_2d(set, ipol)];
+              float * set_timeseries = &timeseries[index_timeseries(set, ipol, 0)];
+              uint64_t * set_timeseries_count = &timeseries_count[index_timeseries_count(set, ipol, 0)];
+              float * chan_spectrogram = &spectrogram[index_spectrogram(ipol, freq_bin[ochan], 0)];
+
+              int64_t sum_re{0}, sum_im{0}, sumsq_re{0}, sumsq_im{0};
+              uint32_t clipped_re{0}, clipped_im{0};
+              float power_sum{0};
+              float power_max = max_spectral_power[index_pol_chan(ipol, ochan)];
+              uint32_t nsamp_weighted{0};
+
+              const float * chan_mask = packet_mask + (ichan * nblocks_per_chan); // NOLINT
+              for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
+              {
+                // exclude the entire block of samples if the relative weight is zero
+                if (chan_mask[iblock] == 0) // NOLINT
+                {
+                  in += 2 * nsamp_per_block; // NOLINT
+                  continue;
+                }
+                nsamp_weighted += nsamp_per_block;
+                for (uint32_t isamp=iblock*nsamp_per_block; isamp<(iblock+1)*nsamp_per_block; isamp++)
+                {
+                  const int32_t re = in[0]; // NOLINT
+                  const int32_t im = in[1]; // NOLINT
+                  in += 2; // NOLINT
+
+                  sum_re += re;
+                  sum_im += im;
+                  sumsq_re += re * re;
+                  sumsq_im += im * im;
+                  clipped_re += static_cast<uint32_t>(re == min_state || re == max_state);
+                  clipped_im += static_cast<uint32_t>(im == min_state || im == max_state);
+
+                  const uint32_t state_re = re + state_offset;
+                  const uint32_t state_im = im + state_offset;
+                  set_hist_re[state_re]++; // NOLINT
+                  set_hist_im[state_im]++; // NOLINT
+                  set_rebinned_2d[((state_re >> rebin_shift) * nrebin) + (state_im >> rebin_shift)]++; // NOLINT
+
+                  const float power = (static_cast<float>(re * re) + static_cast<float>(im * im)) * inverse_scale_squared;
+                  power_sum += power;
+                  power_max = std::max(power_max, power);
+
+                  const uint32_t itime = samp_time_bin[isamp]; // NOLINT
+                  chan_spectrogram[itime] += power; // NOLINT
+                  float * bin = set_timeseries + (itime * ntimeseries_values); // NOLINT
+                  bin[0] = std::max(bin[0], power); // NOLINT
+                  bin[1] = std::min(bin[1], power); // NOLINT
+                  bin[2] += power; // NOLINT
+                  set_timeseries_count[itime]++; // NOLINT
+                }
+              }
+
+              // the sums of the raw states are exact, the scale factor is applied once per row
+              const auto inverse_scale = static_cast<double>(reciprocal_scale);
+              const double inverse_scale_sq = inverse_scale * inverse_scale;
+              sum[index_pol_dim_chan(ipol, 0, ochan)] += static_cast<double>(sum_re) * inverse_scale;
+              sum[index_pol_dim_chan(ipol, 1, ochan)] += static_cast<double>(sum_im) * inverse_scale;
+              sumsq[index_pol_dim_chan(ipol, 0, ochan)] += static_cast<double>(sumsq_re) * inverse_scale_sq;
+              sumsq[index_pol_dim_chan(ipol, 1, ochan)] += static_cast<double>(sumsq_im) * inverse_scale_sq;
+              clipped[index_pol_dim_chan(ipol, 0, ochan)] += clipped_re;
+              clipped[index_pol_dim_chan(ipol, 1, ochan)] += clipped_im;
+              spectral_power_sum[index_pol_chan(ipol, ochan)] += power_sum;
+              max_spectral_power[index_pol_chan(ipol, ochan)] = power_max;
+              if (ipol == 0)
+              {
+                chan_nsamp[ochan] += nsamp_weighted;
+              }
+            }
+          }
+        }
+      }
+
+      //! Reset all accumulators and size the time bins for a block of nsamp samples
+      void reset(uint64_t nsamp);
+
+      //! Fill the StatMonitorData message from the accumulators
+      void fill(ska::pst::lmc::StatMonitorData& stats);
+
+      //! Decodes the scale factors and relative weights of each block
+      WeightsDecoder weights_decoder;
+
+      //! Index of the [npol][nchan] accumulators
+      auto index_pol_chan(uint32_t ipol, uint32_t ichan) const -> uint64_t { return (static_cast<uint64_t>(ipol) * nchan) + ichan; };
+
+      //! Index of the [npol][ndim][nchan] accumulators
+      auto index_pol_dim_chan(uint32_t ipol, uint32_t idim, uint32_t ichan) const -> uint64_t { return (((static_cast<uint64_t>(ipol) * ndim) + idim) * nchan) + ichan; };
+
+      //! Index of the first state of the [nsets][npol][ndim][nstates] histogram
+      auto index_hist(unsigned set, uint32_t ipol, uint32_t idim) const -> uint64_t { return (set * hist_set_stride) + (((static_cast<uint64_t>(ipol) * ndim) + idim) * nstates); };
+
+      //! Index of the first bin of the [nsets][npol][nrebin][nrebin] rebinned 2D histogram
+      auto index_rebinned_2d(unsigned set, uint32_t ipol) const -> uint64_t { return ((static_cast<uint64_t>(set) * npol) + ipol) * nrebin * nrebin; };
+
+      //! Index of the [npol][nfreq_bins][ntime_bins] spectrogram
+      auto index_spectrogram(uint32_t ipol, uint32_t ifreq, uint32_t itime) const -> uint64_t { return (((static_cast<uint64_t>(ipol) * nfreq_bins) + ifreq) * ntime_bins) + itime; };
+
+      //! Index of the first value in the [nsets][npol][ntime_bins][3] timeseries
+      auto index_timeseries(unsigned set, uint32_t ipol, uint32_t itime) const -> uint64_t { return index_timeseries_count(set, ipol, itime) * ntimeseries_values; };
+
+      //! Index of the [nsets][npol][ntime_bins] timeseries sample counts
+      auto index_timeseries_count(unsigned set, uint32_t ipol, uint32_t itime) const -> uint64_t { return (((static_cast<uint64_t>(set) * npol) + ipol) * ntime_bins) + itime; };
+
+      //! The layout of data, weights and scales in each heap
+      HeapLayout layout;
+
+      //! Number of polarisations in the data stream
+      uint32_t npol{0};
+
+      //! Number of dimensions in the data stream
+      uint32_t ndim{0};
+
+      //! Number of channels in the data stream
+      uint32_t nchan{0};
+
+      //! Number of bits per sample in the data stream
+      uint32_t nbit{0};
+
+      //! Number of integer states of each sample, 2^nbit
+      uint32_t nstates{0};
+
+      //! Number of bins in each dimension of the rebinned histograms
+      uint32_t nrebin{default_nrebin};
+
+      //! Number of bits that each integer state is shifted right to yield the rebinned histogram bin
+      uint32_t rebin_shift{0};
+
+      //! Maximum number of frequency bins requested
+      uint32_t req_freq_bins{default_nfreq_bins};
+
+      //! Maximum number of time bins requested
+      uint32_t req_time_bins{default_ntime_bins};
+
+      //! Number of frequency bins in the spectrogram
+      uint32_t nfreq_bins{0};
+
+      //! Number of time bins in the spectrogram and timeseries
+      uint32_t ntime_bins{0};
+
+      //! Stride between the clean and flagged sets of the histogram
+      uint64_t hist_set_stride{0};
+
+      //! Number of dropped packets (scale factor = NaN) encountered
+      uint64_t invalid_packets{0};
+
+      //! Channels flagged for RFI
+      std::vector<bool> channel_mask;
+
+      //! Spectrogram frequency bin of each channel
+      std::vector<uint32_t> freq_bin;
+
+      //! Spectrogram and timeseries time bin of each sample in the block
+      std::vector<uint32_t> time_bin;
+
+      //! Number of valid samples in each channel
+      std::vector<uint64_t> chan_nsamp;
+
+      //! Sum of the scaled samples for each polarisation, dimension and channel
+      std::vector<double> sum;
+
+      //! Sum of the squared scaled samples for each polarisation, dimension and channel
+      std::vector<double> sumsq;
+
+      //! Number of clipped samples for each polarisation, dimension and channel
+      std::vector<uint32_t> clipped;
+
+      //! Sum of the power for each polarisation and channel
+      std::vector<float> spectral_power_sum;
+
+      //! Maximum power for each polarisation and channel
+      std::vector<float> max_spectral_power;
+
+      //! Histogram of the integer states for clean and flagged channels
+      std::vector<uint32_t> histogram;
+
+      //! Rebinned 2D histogram of the integer states for clean and flagged channels
+      std::vector<uint32_t> rebinned_2d;
+
+      //! Summed power in each bin of the spectrogram
+      std::vector<float> spectrogram;
+
+      //! Maximum, minimum and summed power in each bin of the timeseries for clean and flagged channels
+      std::vector<float> timeseries;
+
+      //! Number of samples in each bin of the timeseries for clean and flagged channels
+      std::vector<uint64_t> timeseries_count;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_StatisticsEngine_h
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/FileWriter.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+#ifndef SKA_PST_COMMON_UTILS_StripedFileWriter_h
+#define SKA_PST_COMMON_UTILS_StripedFileWriter_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief The Striped File Writer distributes a stream across files in several output directories, which
+   * are normally on different devices, to aggregate their write bandwidth.
+   * The stream is divided into stripes of STRIPE_BYTES, a multiple of RESOLUTION, and stripe k is written to
+   * the file in directory k % NSTRIPE. Each file has its own FileWriter and asynchronous write queue,
+   * so that writes to the different directories proceed concurrently.
+   * On close, a manifest that records the stripe layout and the order of the files is written to the first directory.
+   *
+   */
+  class StripedFileWriter {
+
+    public:
+
+      /**
+       * @brief Construct a new StripedFileWriter object
+       *
+       * @param use_o_direct Flag to enable the O_DIRECT option on each file.
+       */
+      StripedFileWriter(bool use_o_direct = false);
+
+      /**
+       * @brief Destroy the StripedFileWriter object, closing any open files.
+       *
+       */
+      ~StripedFileWriter();
+
+      /**
+       * @brief Set the number of bytes in each stripe, or zero to use one heap of RESOLUTION bytes. Must be called before open.
+       *
+       * @param nbytes number of bytes in each stripe, which must be a multiple of RESOLUTION
+       */
+      void set_stripe_bytes(uint64_t nbytes);
+
+      /**
+       * @brief Set the depth of the asynchronous write queue of each directory, or zero for synchronous writes. Must be called before open.
+       *
+       * @param depth maximum number of asynchronous writes in flight to each directory
+       */
+      void set_async_depth(uint32_t depth);
+
+      /**
+       * @brief Get the depth of the asynchronous write queue of each directory
+       *
+       * @return uint32_t maximum number of asynchronous writes in flight to each directory
+       */
+      uint32_t get_async_depth() const { return async_depth; };
+
+      /**
+       * @brief Open one file in each of the output directories and write its header.
+       * Each header is a copy of the stream header with NSTRIPE, STRIPE_INDEX and STRIPE_BYTES added.
+       *
+       * @param output_dirs distinct directories in which the files are written
+       * @param header AsciiHeader of the stream, which must define UTC_START and HDR_SIZE; FILE_NUMBER and OBS_OFFSET default to zero
+       */
+      void open(const std::vector<std::filesystem::path>& output_dirs, const ska::pst::common::AsciiHeader& header);
+
+      /**
+       * @brief Write data to the files, submitting each stripe to the queue of its directory, and wait for all writes to complete.
+       *
+       * @param data_ptr pointer to the data to write
+       * @param data_size number of bytes to write
+       * @return ssize_t number of bytes written
+       */
+      ssize_t write_data(char * data_ptr, uint64_t data_size);
+
+      /**
+       * @brief Submit data to the queues of the directories and return without waiting for the writes to complete.
+       * The data must remain valid and unmodified until a return from wait_for_writes.
+       *
+       * @param data_ptr pointer to the data to write
+       * @param data_size number of bytes to write
+       * @return uint64_t offset in the stream at which the data will be written
+       */
+      uint64_t write_data_async(char * data_ptr, uint64_t data_size);
+
+      /**
+       * @brief Wait for the asynchronous writes to all directories to complete, throwing an exception if any of them failed.
+       *
+       */
+      void wait_for_writes();
+
+      /**
+       * @brief Complete all writes, close the files and write the manifest.
+       *
+       */
+      void close();
+
+      /**
+       * @brief Return a boolean describing if the files are currently open for writing.
+       *
+       * @return true the files are open for writing
+       * @return false the files are not open for writing
+       */
+      bool is_open() const { return !writers.empty(); };
+
+      /**
+       * @brief Get the number of bytes in each stripe of the currently opened files
+       *
+       * @return uint64_t number of bytes in each stripe
+       */
+      uint64_t get_stripe_bytes() const { return stripe_bytes; };
+
+      /**
+       * @brief Get the total number of data bytes submitted to all files since open
+       *
+       * @return uint64_t total number of data bytes submitted
+       */
+      uint64_t get_data_bytes_written() const { return data_bytes_written; };
+
+      /**
+       * @brief Get the full paths of the files, in stripe order
+       *
+       * @return const std::vector<std::filesystem::path>& paths of the files
+       */
+      const std::vector<std::filesystem::path>& get_filenames() const { return filenames; };
+
+      /**
+       * @brief Get the full path of the manifest, which is written on close
+       *
+       * @return const std::filesystem::path& path of the manifest
+       */
+      const std::filesystem::path& get_manifest_filename() const { return manifest_filename; };
+
+      /**
+       * @brief Get the filename of the manifest for the specified utc_start, obs_offset and file_number.
+       * The manifest filename will be structured as [UTC_START]_[OBS_OFFSET]_[FILE_NUMBER].manifest
+       *
+       * @param utc_start the UTC_START timestamp of the stream
+       * @param obs_offset offset in bytes from the start of the observation
+       * @param file_number file number in the sequence
+       * @return std::filesystem::path filename of the manifest
+       */
+      static std::filesystem::path get_manifest_filename(const std::string& utc_start, uint64_t obs_offset, unsigned file_number);
+
+    private:
+
+      /**
+       * @brief Write the manifest, which contains the stream header, the stripe layout, the total number of
+       * data bytes, and STRIPE_FILE_<i> for the path of the file of each stripe index.
+       *
+       */
+      void write_manifest();
+
+      //! flag to enable the O_DIRECT option on each file
+      bool use_o_direct;
+
+      //! requested number of bytes in each stripe, zero for one heap
+      uint64_t requested_stripe_bytes{0};
+
+      //! number of bytes in each stripe of the currently opened files
+      uint64_t stripe_bytes{0};
+
+      //! depth of the asynchronous write queue of each directory
+      uint32_t async_depth{default_async_depth};
+
+      //! default depth of the asynchronous write queue of each directory
+      static constexpr uint32_t default_async_depth{4};
+
+      //! copy of the stream header
+      ska::pst::common::AsciiHeader header;
+
+      //! total number of data bytes submitted since open
+      uint64_t data_bytes_written{0};
+
+      //! writer of the file in each directory, in stripe order
+      std::vector<std::unique_ptr<FileWriter>> writers;
+
+      //! full paths of the files, in stripe order
+      std::vector<std::filesystem::path> filenames;
+
+      //! full path of the manifest
+      std::filesystem::path manifest_filename;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_StripedFileWriter_h
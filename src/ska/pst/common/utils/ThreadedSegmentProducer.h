@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "ska/pst/common/utils/SegmentProducer.h"
+#include "ska/pst/common/utils/SegmentQueue.h"
+
+#ifndef SKA_PST_COMMON_UTILS_ThreadedSegmentProducer_h
+#define SKA_PST_COMMON_UTILS_ThreadedSegmentProducer_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Runs a SegmentProducer on its own thread, ahead of the consumer, behind a SegmentQueue.
+   *
+   * @details The producer thread copies each segment into a free slot of the queue, so that generating or reading
+   * the next segments overlaps with the processing of the current segment, and blocks while every slot is full.
+   * The segment returned by next_segment remains valid until the next call to next_segment.
+   * An exception thrown by the wrapped producer ends the stream and is re-thrown by next_segment once the
+   * segments produced before it have been consumed. The buffers of each slot are allocated up front, sized from
+   * the RESOLUTION of the data and weights headers and the number of heaps in each segment, so that the producer
+   * thread does not allocate memory while the segments fit in the slots.
+   */
+  class ThreadedSegmentProducer : public SegmentProducer
+  {
+    public:
+
+      /**
+       * @brief Construct a new ThreadedSegmentProducer object and start the producer thread.
+       *
+       * @param producer the producer of segments, which is accessed only by the producer thread
+       * @param nslots number of slots in the queue
+       * @param max_segments number of segments after which the stream ends, zero to end with the wrapped producer
+       * @param heaps_per_segment number of heaps in each segment of the wrapped producer, used to preallocate the slots
+       */
+      ThreadedSegmentProducer(std::shared_ptr<SegmentProducer> producer, size_t nslots = SegmentQueue::default_nslots,
+        uint64_t max_segments = 0, uint64_t heaps_per_segment = 1);
+
+      /**
+       * @brief Destroy the ThreadedSegmentProducer object, stopping and joining the producer thread.
+       *
+       */
+      ~ThreadedSegmentProducer();
+
+      ThreadedSegmentProducer(const ThreadedSegmentProducer&) = delete;
+      auto operator=(const ThreadedSegmentProducer&) -> ThreadedSegmentProducer& = delete;
+
+      /**
+       * @brief Get the AsciiHeader that describes the data block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& copy of the data header of the wrapped producer
+       */
+      const ska::pst::common::AsciiHeader& get_data_header() const;
+
+      /**
+       * @brief Get the AsciiHeader that describes the weights block stream
+       *
+       * @return const ska::pst::common::AsciiHeader& copy of the weights header of the wrapped producer
+       */
+      const ska::pst::common::AsciiHeader& get_weights_header() const;
+
+      /**
+       * @brief Get the next segment of data and weights, releasing the segment returned by the previous call.
+       *
+       * @throw std::runtime_error if the wrapped producer threw an exception
+       */
+      Segment next_segment();
+
+      /**
+       * @brief Get the queue between the producer thread and the consumer
+       *
+       * @return const SegmentQueue& the queue
+       */
+      auto get_queue() const -> const SegmentQueue& { return queue; }
+
+    private:
+
+      //! Main loop of the producer thread
+      void produce_loop();
+
+      //! the wrapped producer
+      std::shared_ptr<SegmentProducer> producer;
+
+      //! copy of the data header of the wrapped producer
+      ska::pst::common::AsciiHeader data_header;
+
+      //! copy of the weights header of the wrapped producer
+      ska::pst::common::AsciiHeader weights_header;
+
+      //! queue of segments produced and not yet consumed
+      SegmentQueue queue;
+
+      //! number of segments after which the stream ends, zero for no limit
+      uint64_t max_segments;
+
+      //! flag indicating that the consumer holds a slot
+      bool holding{false};
+
+      //! error reported by the wrapped producer, published to the consumer by the end of the queue
+      std::string error;
+
+      //! the producer thread
+      std::thread thread;
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_ThreadedSegmentProducer_h
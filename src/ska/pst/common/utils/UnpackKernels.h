@@ -0,0 +1,189 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+#include <complex>
+#include <string>
+
+#include "ska/pst/common/utils/ReducedPrecision.h"
+
+#ifndef SKA_PST_COMMON_UTILS_UnpackKernels_h
+#define SKA_PST_COMMON_UTILS_UnpackKernels_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Instruction set extensions used by the unpack kernels
+   *
+   */
+  enum SimdLevel
+  {
+    //! portable C++ implementation
+    Scalar,
+
+    //! 256-bit AVX2, FMA and F16C implementation
+    AVX2,
+
+    //! 512-bit AVX-512F implementation
+    AVX512
+  };
+
+  /**
+   * @brief Get the most capable SimdLevel supported by the CPU, as detected at runtime
+   *
+   * @return SimdLevel most capable instruction set extension supported by the CPU
+   */
+  auto get_supported_simd_level() -> SimdLevel;
+
+  /**
+   * @brief Get the SimdLevel currently used by the unpack kernels.
+   * By default, this is the level returned by get_supported_simd_level.
+   *
+   * @return SimdLevel instruction set extension currently in use
+   */
+  auto get_simd_level() -> SimdLevel;
+
+  /**
+   * @brief Set the SimdLevel used by the unpack kernels.
+   * Throws a std::runtime_error if the requested level is not supported by the CPU.
+   *
+   * @param level instruction set extension to be used
+   */
+  void set_simd_level(SimdLevel level);
+
+  /**
+   * @brief Get the name of the SimdLevel
+   *
+   * @param level instruction set extension
+   * @return std::string name of the instruction set extension
+   */
+  auto get_simd_level_name(SimdLevel level) -> std::string;
+
+  /**
+   * @brief Convert complex-valued 8-bit integers to single precision floating point, multiplied by scale.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int8_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, std::complex<float> * out);
+
+  /**
+   * @brief Convert complex-valued 16-bit integers to single precision floating point, multiplied by scale.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int16_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, std::complex<float> * out);
+
+  /**
+   * @brief Convert complex-valued 8-bit integers to 16-bit integers, multiplied by scale, rounded to nearest and saturated.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int8_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, ComplexInt16 * out);
+
+  /**
+   * @brief Convert complex-valued 16-bit integers to 16-bit integers, multiplied by scale, rounded to nearest and saturated.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int16_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, ComplexInt16 * out);
+
+  /**
+   * @brief Convert complex-valued 8-bit integers to half precision, multiplied by scale.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int8_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, ComplexFP16 * out);
+
+  /**
+   * @brief Convert complex-valued 16-bit integers to half precision, multiplied by scale.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int16_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, ComplexFP16 * out);
+
+  /**
+   * @brief Convert complex-valued 8-bit integers to bfloat16, multiplied by scale.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int8_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, ComplexBF16 * out);
+
+  /**
+   * @brief Convert complex-valued 16-bit integers to bfloat16, multiplied by scale.
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int16_t values)
+   * @param nsamp number of complex-valued samples to convert
+   * @param scale multiplicative factor applied to each converted value
+   * @param out pointer to nsamp complex-valued output samples
+   */
+  void convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, ComplexBF16 * out);
+
+  /**
+   * @brief Sum the power (squared modulus) of complex-valued 8-bit integers
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int8_t values)
+   * @param nsamp number of complex-valued samples to integrate
+   * @return float sum of the power of the input samples
+   */
+  auto sum_complex_power(const int8_t * in, uint64_t nsamp) -> float;
+
+  /**
+   * @brief Sum the power (squared modulus) of complex-valued 16-bit integers
+   *
+   * @param in pointer to nsamp complex-valued input samples (i.e. 2*nsamp int16_t values)
+   * @param nsamp number of complex-valued samples to integrate
+   * @return float sum of the power of the input samples
+   */
+  auto sum_complex_power(const int16_t * in, uint64_t nsamp) -> float;
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_UnpackKernels_h
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+
+#ifndef SKA_PST_COMMON_UTILS_UnpackedView_h
+#define SKA_PST_COMMON_UTILS_UnpackedView_h
+
+namespace ska::pst::common
+{
+  /**
+   * @brief Ordering of the dimensions of an array of unpacked samples, from slowest to fastest varying
+   *
+   */
+  enum UnpackedOrder
+  {
+    //! time, frequency, polarisation: all channels and polarisations of each time sample are contiguous
+    TFP,
+
+    //! frequency, time, polarisation: the time series of each channel is contiguous
+    FTP,
+
+    //! polarisation, frequency, time: the time series of each channel and polarisation is contiguous
+    PFT
+  };
+
+  /**
+   * @brief Non-owning view of a contiguous array of unpacked samples.
+   *
+   * The array is indexed by time sample, frequency channel and polarisation in any UnpackedOrder, with
+   * the stride of each dimension exposed so that the underlying memory can be passed
+   * directly to vectorised downstream code without copying.
+   *
+   * @tparam T type of each unpacked value (e.g. std::complex<float>)
+   */
+  template <typename T>
+  class UnpackedView
+  {
+    public:
+
+      /**
+       * @brief Construct an empty UnpackedView object
+       *
+       */
+      UnpackedView() = default;
+
+      /**
+       * @brief Construct a new UnpackedView object of an array in TFP order
+       *
+       * @param _base base address of the array
+       * @param _nsamp number of time samples in the array
+       * @param _nchan number of frequency channels in the array
+       * @param _npol number of polarisations in the array
+       */
+      UnpackedView(T * _base, uint64_t _nsamp, uint32_t _nchan, uint32_t _npol) :
+        UnpackedView(_base, _nsamp, _nchan, _npol, TFP)
+      {
+      }
+
+      /**
+       * @brief Construct a new UnpackedView object of an array in the specified order
+       *
+       * @param _base base address of the array
+       * @param _nsamp number of time samples in the array
+       * @param _nchan number of frequency channels in the array
+       * @param _npol number of polarisations in the array
+       * @param _order ordering of the dimensions of the array
+       */
+      UnpackedView(T * _base, uint64_t _nsamp, uint32_t _nchan, uint32_t _npol, UnpackedOrder _order) :
+        base(_base), nsamp(_nsamp), nchan(_nchan), npol(_npol), order(_order)
+      {
+        switch (order)
+        {
+          case FTP:
+            pol_stride = 1;
+            samp_stride = npol;
+            chan_stride = nsamp * npol;
+            break;
+          case PFT:
+            samp_stride = 1;
+            chan_stride = nsamp;
+            pol_stride = nsamp * nchan;
+            break;
+          case TFP:
+          default:
+            pol_stride = 1;
+            chan_stride = npol;
+            samp_stride = static_cast<uint64_t>(nchan) * npol;
+            break;
+        }
+      }
+
+      /**
+       * @brief Get the base address of the array
+       *
+       * @return T* base address of the array
+       */
+      auto data() const -> T * { return base; }
+
+      /**
+       * @brief Get the number of values in the array
+       *
+       * @return uint64_t number of values in the array
+       */
+      auto size() const -> uint64_t { return nsamp * nchan * npol; }
+
+      /**
+       * @brief Get the number of time samples in the array
+       *
+       * @return uint64_t number of time samples
+       */
+      auto get_nsamp() const -> uint64_t { return nsamp; }
+
+      /**
+       * @brief Get the number of frequency channels in the array
+       *
+       * @return uint32_t number of frequency channels
+       */
+      auto get_nchan() const -> uint32_t { return nchan; }
+
+      /**
+       * @brief Get the number of polarisations in the array
+       *
+       * @return uint32_t number of polarisations
+       */
+      auto get_npol() const -> uint32_t { return npol; }
+
+      /**
+       * @brief Get the ordering of the dimensions of the array
+       *
+       * @return UnpackedOrder ordering of the dimensions
+       */
+      auto get_order() const -> UnpackedOrder { return order; }
+
+      /**
+       * @brief Get the offset, in values, between consecutive time samples
+       *
+       * @return uint64_t time sample stride
+       */
+      auto get_samp_stride() const -> uint64_t { return samp_stride; }
+
+      /**
+       * @brief Get the offset, in values, between consecutive frequency channels
+       *
+       * @return uint64_t frequency channel stride
+       */
+      auto get_chan_stride() const -> uint64_t { return chan_stride; }
+
+      /**
+       * @brief Get the offset, in values, between consecutive polarisations
+       *
+       * @return uint64_t polarisation stride
+       */
+      auto get_pol_stride() const -> uint64_t { return pol_stride; }
+
+      /**
+       * @brief Get the offset, in values, of the specified element from the base address
+       *
+       * @param isamp time sample index
+       * @param ichan frequency channel index
+       * @param ipol polarisation index
+       * @return uint64_t offset of the element from the base address
+       */
+      auto offset(uint64_t isamp, uint32_t ichan, uint32_t ipol) const -> uint64_t
+      {
+        return (isamp * samp_stride) + (ichan * chan_stride) + (ipol * pol_stride);
+      }
+
+      /**
+       * @brief Access the specified element of the array
+       *
+       * @param isamp time sample index
+       * @param ichan frequency channel index
+       * @param ipol polarisation index
+       * @return T& reference to the element
+       */
+      auto operator()(uint64_t isamp, uint32_t ichan, uint32_t ipol) const -> T &
+      {
+        return base[offset(isamp, ichan, ipol)]; // NOLINT
+      }
+
+    private:
+
+      //! base address of the array
+      T * base{nullptr};
+
+      //! number of time samples
+      uint64_t nsamp{0};
+
+      //! number of frequency channels
+      uint32_t nchan{0};
+
+      //! number of polarisations
+      uint32_t npol{0};
+
+      //! ordering of the dimensions
+      UnpackedOrder order{TFP};
+
+      //! offset between consecutive time samples
+      uint64_t samp_stride{0};
+
+      //! offset between consecutive frequency channels
+      uint64_t chan_stride{0};
+
+      //! offset between consecutive polarisations
+      uint64_t pol_stride{0};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_UnpackedView_h
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cinttypes>
+#include <vector>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+
+#ifndef SKA_PST_COMMON_UTILS_WeightsCodec_h
+#define SKA_PST_COMMON_UTILS_WeightsCodec_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Lossless delta and run-length codec for the weights and scales stream.
+   *
+   * Each 32-bit word is replaced by its exclusive-or with the word one record stride earlier, which is zero
+   * wherever the weights and scales of a packet match those of the preceding packet, and the resulting words are
+   * run-length encoded. The encoded stream is a sequence of tokens, each a 32-bit word whose most significant bit
+   * distinguishes a run, followed by the single repeated word, from a literal, followed by the number of words in
+   * the lower 31 bits. The bytes that do not fill the last word are appended unencoded. All words are in host byte order.
+   * Each buffer is encoded independently, so that any frame of a compressed file may be decoded on its own.
+   *
+   * In a compressed file, written by the \ref FileWriter, the header defines COMPRESSION as DELTA_RLE and
+   * COMPRESSION_STRIDE as the record stride, and is followed by a sequence of frames, each of which is a FrameHeader
+   * followed by the encoded bytes of one call to FileWriter::write_data.
+   */
+  class WeightsCodec {
+
+    public:
+
+      //! value of the COMPRESSION header parameter of files written with this codec
+      static constexpr const char * compression_name = "DELTA_RLE";
+
+      //! default record stride in bytes, used when the header does not define the packet layout
+      static constexpr uint32_t default_stride = 4;
+
+      //! precedes each frame of encoded bytes in a compressed file
+      struct FrameHeader {
+
+        //! number of bytes in the frame after decoding
+        uint64_t decoded_bytes{0};
+
+        //! number of encoded bytes that follow the frame header
+        uint64_t encoded_bytes{0};
+      };
+
+      /**
+       * @brief Construct a new WeightsCodec object
+       *
+       * @param stride record stride in bytes, which must be at least 4
+       */
+      WeightsCodec(uint32_t stride = default_stride);
+
+      /**
+       * @brief Destroy the WeightsCodec object
+       *
+       */
+      ~WeightsCodec() = default;
+
+      /**
+       * @brief Encode a buffer
+       *
+       * @param data pointer to the bytes to encode
+       * @param nbytes number of bytes to encode
+       * @param encoded destination of the encoded bytes, which must hold at least get_max_encoded_bytes(nbytes) bytes
+       * @return uint64_t number of encoded bytes
+       */
+      uint64_t encode(const char * data, uint64_t nbytes, char * encoded) const;
+
+      /**
+       * @brief Decode a buffer, throwing an exception if the encoded bytes are malformed or do not decode to exactly nbytes
+       *
+       * @param encoded pointer to the encoded bytes
+       * @param encoded_bytes number of encoded bytes
+       * @param data destination of the decoded bytes
+       * @param nbytes number of decoded bytes expected
+       */
+      void decode(const char * encoded, uint64_t encoded_bytes, char * data, uint64_t nbytes) const;
+
+      /**
+       * @brief Get the record stride
+       *
+       * @return uint32_t record stride in bytes
+       */
+      uint32_t get_stride() const { return stride; };
+
+      /**
+       * @brief Get the maximum number of bytes produced by encoding a buffer
+       *
+       * @param nbytes number of bytes to encode
+       * @return uint64_t maximum number of encoded bytes
+       */
+      static uint64_t get_max_encoded_bytes(uint64_t nbytes);
+
+      /**
+       * @brief Get the record stride of a weights stream, which is the sum of PACKET_WEIGHTS_SIZE and PACKET_SCALES_SIZE
+       * if PACKET_WEIGHTS_SIZE is defined in the header, and otherwise the default stride
+       *
+       * @param header AsciiHeader of the weights stream
+       * @return uint32_t record stride in bytes
+       */
+      static uint32_t get_stride(const ska::pst::common::AsciiHeader& header);
+
+    private:
+
+      //! record stride in bytes
+      uint32_t stride;
+
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_WeightsCodec_h
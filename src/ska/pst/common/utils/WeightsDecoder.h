@@ -0,0 +1,209 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/HeapLayout.h"
+
+#include <cinttypes>
+#include <vector>
+
+#ifndef SKA_PST_COMMON_UTILS_WeightsDecoder_h
+#define SKA_PST_COMMON_UTILS_WeightsDecoder_h
+
+namespace ska::pst::common
+{
+  /**
+   * @brief Decodes the scale factors and relative weights of a block of weights heaps into compact per-packet arrays.
+   *
+   * @details Each packet in the weights stream contains a single precision scale factor followed by one relative weight
+   * for each channel of the packet and each block of nsamp_per_weight samples, ordered by channel then sample block.
+   * The decoder converts each scale factor to the reciprocal that is multiplied with the samples of the packet, and each
+   * relative weight to a mask value of 1 (non-zero weight) or 0 (zero weight), so that zero-weighted samples can be excluded
+   * by multiplication rather than by testing each sample.
+   *
+   * Packets with a scale factor of NaN are invalid: their reciprocal scale and all of their mask values are zero.
+   * Scale factors of zero are treated as unity.
+   */
+  class WeightsDecoder
+  {
+    public:
+
+      /**
+       * @brief Construct a new WeightsDecoder object
+       *
+       */
+      WeightsDecoder() = default;
+
+      /**
+       * @brief Destroy the WeightsDecoder object
+       *
+       */
+      ~WeightsDecoder() = default;
+
+      /**
+       * @brief Configure the decoder with the layout of the data and weights heaps
+       *
+       * @param layout layout of the data, weights and scales in each heap
+       */
+      void configure(const HeapLayout& layout);
+
+      /**
+       * @brief Decode the scale factors and relative weights of the packets in a block of weights heaps
+       *
+       * @param weights pointer to the raw weights array
+       * @param nheaps number of heaps in the weights array to decode
+       */
+      void decode(const char * weights, uint32_t nheaps);
+
+      /**
+       * @brief Get the number of packets decoded by the most recent call to decode
+       *
+       * @return uint64_t number of packets
+       */
+      auto get_npackets() const -> uint64_t { return reciprocal_scales.size(); };
+
+      /**
+       * @brief Get the number of samples to which each relative weight applies
+       *
+       * @return uint32_t number of samples per sample block
+       */
+      auto get_nsamp_per_block() const -> uint32_t { return nsamp_per_block; };
+
+      /**
+       * @brief Get the number of sample blocks in each channel of a packet
+       *
+       * @return uint32_t number of sample blocks per channel
+       */
+      auto get_nblocks_per_chan() const -> uint32_t { return nblocks_per_chan; };
+
+      /**
+       * @brief Get the number of mask values of each packet, i.e. channels per packet times sample blocks per channel
+       *
+       * @return uint32_t number of mask values per packet
+       */
+      auto get_nblocks_per_packet() const -> uint32_t { return nblocks_per_packet; };
+
+      /**
+       * @brief Return true if the scale factor of the packet is valid (not NaN)
+       *
+       * @param packet_number index of the packet in the decoded block
+       * @return true if the packet is valid
+       */
+      auto is_valid(uint64_t packet_number) const -> bool { return weighted_blocks[packet_number] >= 0; };
+
+      /**
+       * @brief Return true if the packet is valid and all of its relative weights are non-zero
+       *
+       * @param packet_number index of the packet in the decoded block
+       * @return true if none of the samples in the packet are masked
+       */
+      auto is_fully_weighted(uint64_t packet_number) const -> bool { return weighted_blocks[packet_number] == static_cast<int32_t>(nblocks_per_packet); };
+
+      /**
+       * @brief Get the reciprocal of the scale factor of the packet, or zero if the packet is invalid
+       *
+       * @param packet_number index of the packet in the decoded block
+       * @return float reciprocal of the scale factor
+       */
+      auto get_reciprocal_scale(uint64_t packet_number) const -> float { return reciprocal_scales[packet_number]; };
+
+      /**
+       * @brief Get the reciprocal scale factor of every packet in the decoded block, indexed by packet number
+       *
+       * @return const std::vector<float>& reciprocal scale factor of each packet
+       */
+      auto get_reciprocal_scales() const -> const std::vector<float>& { return reciprocal_scales; };
+
+      /**
+       * @brief Get the mask values of a packet, ordered by channel then sample block
+       *
+       * @param packet_number index of the packet in the decoded block
+       * @return const float* pointer to get_nblocks_per_packet mask values of 0 or 1
+       */
+      auto get_packet_mask(uint64_t packet_number) const -> const float * { return &mask[packet_number * nblocks_per_packet]; };
+
+      /**
+       * @brief Get the number of invalid packets in the decoded block
+       *
+       * @return uint64_t number of packets with a scale factor of NaN
+       */
+      auto get_invalid_packets() const -> uint64_t { return invalid_packets; };
+
+      /**
+       * @brief Get the number of sample blocks with zero relative weight in the valid packets of the decoded block
+       *
+       * @return uint64_t number of zero-weighted sample blocks
+       */
+      auto get_masked_blocks() const -> uint64_t { return masked_blocks; };
+
+    private:
+
+      //! Reciprocal of the scale factor of each packet
+      std::vector<float> reciprocal_scales;
+
+      //! Mask value of each sample block of each channel of each packet
+      std::vector<float> mask;
+
+      //! Number of non-zero weighted sample blocks in each packet, -1 for invalid packets
+      std::vector<int32_t> weighted_blocks;
+
+      //! Number of packets per heap
+      uint32_t packets_per_heap{0};
+
+      //! Number of bytes per packet in the weights stream
+      uint32_t weights_packet_stride{0};
+
+      //! Offset of the scale factor from the start of each weights packet
+      uint32_t scales_offset{0};
+
+      //! Offset of the relative weights from the start of each weights packet
+      uint32_t weights_offset{0};
+
+      //! Number of bits per relative weight
+      uint32_t weights_nbit{0};
+
+      //! Number of samples to which each relative weight applies
+      uint32_t nsamp_per_block{0};
+
+      //! Number of sample blocks in each channel of a packet
+      uint32_t nblocks_per_chan{0};
+
+      //! Number of relative weights in each packet
+      uint32_t nblocks_per_packet{0};
+
+      //! Number of invalid packets in the decoded block
+      uint64_t invalid_packets{0};
+
+      //! Number of zero-weighted sample blocks in the valid packets of the decoded block
+      uint64_t masked_blocks{0};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_WeightsDecoder_h
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef SKA_PST_COMMON_UTILS_WorkerPool_h
+#define SKA_PST_COMMON_UTILS_WorkerPool_h
+
+namespace ska::pst::common {
+
+  /**
+   * @brief Persistent pool of threads that run the tasks of a parallel section and wait for the next section.
+   *
+   * @details The threads are started when the pool is constructed and joined when it is destroyed, so that
+   * a parallel section does not create or join threads. The calling thread runs the first task of each section,
+   * and each of the other tasks runs on its own pool thread. run returns once every task has completed.
+   */
+  class WorkerPool {
+
+    public:
+
+      /**
+       * @brief Task run by a parallel section
+       *
+       * @param itask index of the task, in the range [0, ntasks)
+       */
+      using Task = std::function<void(unsigned itask)>;
+
+      /**
+       * @brief Construct a new WorkerPool object and start its threads
+       *
+       * @param nthreads number of threads that run tasks, including the calling thread, must be greater than zero
+       */
+      explicit WorkerPool(unsigned nthreads);
+
+      /**
+       * @brief Destroy the WorkerPool object, stopping and joining its threads
+       *
+       */
+      ~WorkerPool();
+
+      WorkerPool(const WorkerPool&) = delete;
+      auto operator=(const WorkerPool&) -> WorkerPool& = delete;
+
+      /**
+       * @brief Run ntasks tasks in parallel, waiting for all of them to complete.
+       * Any exception thrown by a task is rethrown on the calling thread once every task has completed.
+       *
+       * @param ntasks number of tasks, must not exceed get_nthreads()
+       * @param task the task, called once for each task index
+       */
+      void run(unsigned ntasks, const Task& task);
+
+      /**
+       * @brief Get the number of threads that run tasks, including the calling thread
+       *
+       * @return unsigned number of threads
+       */
+      auto get_nthreads() const -> unsigned { return static_cast<unsigned>(threads.size()) + 1; }
+
+    private:
+
+      /**
+       * @brief Main loop of a pool thread, which runs task ithread of each parallel section
+       *
+       * @param ithread index of the task run by this thread, greater than zero
+       */
+      void worker_loop(unsigned ithread);
+
+      //! the pool threads, which run the tasks with index greater than zero
+      std::vector<std::thread> threads;
+
+      //! protects the members below
+      std::mutex mutex;
+
+      //! signals the start of a parallel section, or that the pool is stopping, to the pool threads
+      std::condition_variable start_cond;
+
+      //! signals the completion of the tasks of a parallel section to the calling thread
+      std::condition_variable done_cond;
+
+      //! task of the current parallel section
+      const Task * current_task{nullptr};
+
+      //! number of tasks in the current parallel section
+      unsigned ntasks{0};
+
+      //! number of parallel sections started, which wakes each pool thread once per section
+      uint64_t generation{0};
+
+      //! number of tasks of the current parallel section that are running on pool threads
+      unsigned running{0};
+
+      //! exception thrown by each task of the current parallel section
+      std::vector<std::exception_ptr> errors;
+
+      //! flag indicating that the pool threads must exit
+      bool stopping{false};
+  };
+
+} // namespace ska::pst::common
+
+#endif // SKA_PST_COMMON_UTILS_WorkerPool_h
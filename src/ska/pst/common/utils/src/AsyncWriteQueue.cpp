@@ -0,0 +1,420 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "ska/pst/common/utils/AsyncWriteQueue.h"
+
+struct ska::pst::common::AsyncWriteQueue::Ring
+{
+#ifdef HAVE_LIBURING
+  //! the io_uring submission and completion queues
+  struct io_uring uring{};
+
+  //! storage for the requests in flight, one per slot
+  std::vector<Request> slots;
+
+  //! indices of the unused slots
+  std::vector<uint32_t> free_slots;
+#endif
+};
+
+ska::pst::common::AsyncWriteQueue::AsyncWriteQueue(uint32_t _depth, bool use_io_uring) :
+  depth(_depth)
+{
+  if (depth == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::AsyncWriteQueue depth is zero");
+    throw std::runtime_error("ska::pst::common::AsyncWriteQueue::AsyncWriteQueue depth is zero");
+  }
+
+#ifdef HAVE_LIBURING
+  if (use_io_uring)
+  {
+    auto new_ring = std::make_unique<Ring>();
+    int result = io_uring_queue_init(depth, &new_ring->uring, 0);
+    if (result == 0)
+    {
+      new_ring->slots.resize(depth);
+      for (uint32_t islot=0; islot<depth; islot++)
+      {
+        new_ring->free_slots.push_back(islot);
+      }
+      ring = std::move(new_ring);
+      SPDLOG_DEBUG("ska::pst::common::AsyncWriteQueue::AsyncWriteQueue io_uring created with depth={}", depth);
+      threads.emplace_back(&AsyncWriteQueue::reap_loop, this);
+      return;
+    }
+    SPDLOG_WARN("ska::pst::common::AsyncWriteQueue::AsyncWriteQueue io_uring_queue_init failed: {}, using pwrite threads", strerror(-result));
+  }
+#else
+  if (use_io_uring)
+  {
+    SPDLOG_DEBUG("ska::pst::common::AsyncWriteQueue::AsyncWriteQueue built without liburing, using pwrite threads");
+  }
+#endif
+
+  SPDLOG_DEBUG("ska::pst::common::AsyncWriteQueue::AsyncWriteQueue starting {} pwrite threads", depth);
+  for (uint32_t ithread=0; ithread<depth; ithread++)
+  {
+    threads.emplace_back(&AsyncWriteQueue::worker_loop, this);
+  }
+}
+
+ska::pst::common::AsyncWriteQueue::~AsyncWriteQueue()
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    request_completed.wait(lock, [this]{ return in_flight == 0; });
+    stopping = true;
+  }
+  request_queued.notify_all();
+
+#ifdef HAVE_LIBURING
+  if (ring)
+  {
+    // wake the completion thread with a request that carries no user data
+    struct io_uring_sqe * sqe = io_uring_get_sqe(&ring->uring);
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data(sqe, nullptr);
+    io_uring_submit(&ring->uring);
+  }
+#endif
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+#ifdef HAVE_LIBURING
+  if (ring)
+  {
+    io_uring_queue_exit(&ring->uring);
+  }
+#endif
+
+  if (!error.empty())
+  {
+    SPDLOG_WARN("ska::pst::common::AsyncWriteQueue::~AsyncWriteQueue unreported error: {}", error);
+  }
+}
+
+void ska::pst::common::AsyncWriteQueue::acquire_slot(std::unique_lock<std::mutex>& lock)
+{
+  if (in_flight == depth)
+  {
+    backpressure_waits++;
+    request_completed.wait(lock, [this]{ return in_flight < depth || !failure.empty(); });
+  }
+  if (!failure.empty())
+  {
+    SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::acquire_slot queue failed: {}", failure);
+    throw std::runtime_error("ska::pst::common::AsyncWriteQueue::acquire_slot queue failed: " + failure);
+  }
+  in_flight++;
+}
+
+void ska::pst::common::AsyncWriteQueue::write(int fd, const char * buffer, uint64_t nbytes, uint64_t offset, Callback callback)
+{
+  Request request;
+  request.fd = fd;
+  request.buffer = buffer;
+  request.nbytes = nbytes;
+  request.offset = offset;
+  request.callback = std::move(callback);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!error.empty())
+  {
+    std::string message = error;
+    error.clear();
+    SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::write previous request failed: {}", message);
+    throw std::runtime_error("ska::pst::common::AsyncWriteQueue::write previous request failed: " + message);
+  }
+
+  acquire_slot(lock);
+  SPDLOG_TRACE("ska::pst::common::AsyncWriteQueue::write fd={} nbytes={} offset={} in_flight={}", fd, nbytes, offset, in_flight);
+
+#ifdef HAVE_LIBURING
+  if (ring)
+  {
+    uint32_t islot = ring->free_slots.back();
+    ring->free_slots.pop_back();
+    ring->slots[islot] = std::move(request);
+    std::string submit_error = submit_to_ring(&ring->slots[islot]);
+    if (!submit_error.empty())
+    {
+      ring->free_slots.push_back(islot);
+      in_flight--;
+      SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::write {}", submit_error);
+      throw std::runtime_error("ska::pst::common::AsyncWriteQueue::write " + submit_error);
+    }
+    return;
+  }
+#endif
+
+  pending.push_back(std::move(request));
+  lock.unlock();
+  request_queued.notify_one();
+}
+
+void ska::pst::common::AsyncWriteQueue::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  request_completed.wait(lock, [this]{ return in_flight == 0; });
+  if (!failure.empty())
+  {
+    SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::wait queue failed: {}", failure);
+    throw std::runtime_error("ska::pst::common::AsyncWriteQueue::wait queue failed: " + failure);
+  }
+  if (!error.empty())
+  {
+    std::string message = error;
+    error.clear();
+    SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::wait request failed: {}", message);
+    throw std::runtime_error("ska::pst::common::AsyncWriteQueue::wait request failed: " + message);
+  }
+}
+
+auto ska::pst::common::AsyncWriteQueue::get_in_flight() const -> uint32_t
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return in_flight;
+}
+
+auto ska::pst::common::AsyncWriteQueue::get_writes_completed() const -> uint64_t
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return writes_completed;
+}
+
+auto ska::pst::common::AsyncWriteQueue::get_bytes_completed() const -> uint64_t
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return bytes_completed;
+}
+
+auto ska::pst::common::AsyncWriteQueue::get_backpressure_waits() const -> uint64_t
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return backpressure_waits;
+}
+
+void ska::pst::common::AsyncWriteQueue::fail(const std::string& message)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (failure.empty())
+    {
+      failure = message;
+    }
+    pending.clear();
+    in_flight = 0;
+  }
+  request_completed.notify_all();
+}
+
+void ska::pst::common::AsyncWriteQueue::complete(const Request& request, const std::string& request_error)
+{
+  // the callback is invoked before the slot is released, so that wait() returns after every callback
+  if (request_error.empty() && request.callback)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!failure.empty())
+      {
+        return;
+      }
+    }
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    request.callback(request.buffer, request.nbytes, request.offset);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // the slot of the request was already released when the queue failed
+    if (!failure.empty())
+    {
+      return;
+    }
+    if (request_error.empty())
+    {
+      writes_completed++;
+      bytes_completed += request.nbytes;
+    }
+    else if (error.empty())
+    {
+      error = request_error;
+    }
+#ifdef HAVE_LIBURING
+    if (ring)
+    {
+      ring->free_slots.push_back(static_cast<uint32_t>(&request - ring->slots.data()));
+    }
+#endif
+    in_flight--;
+  }
+  request_completed.notify_all();
+}
+
+auto ska::pst::common::AsyncWriteQueue::write_request(Request& request) -> std::string
+{
+  while (request.done < request.nbytes)
+  {
+    ssize_t wrote = pwrite(request.fd, request.buffer + request.done, request.nbytes - request.done, static_cast<off_t>(request.offset + request.done)); // NOLINT
+    if (wrote < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return std::string("pwrite failed: ") + strerror(errno);
+    }
+    if (wrote == 0)
+    {
+      return "pwrite wrote zero bytes";
+    }
+    request.done += wrote;
+  }
+  return {};
+}
+
+void ska::pst::common::AsyncWriteQueue::worker_loop()
+{
+  while (true)
+  {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      request_queued.wait(lock, [this]{ return stopping || !pending.empty(); });
+      if (pending.empty())
+      {
+        return;
+      }
+      request = std::move(pending.front());
+      pending.pop_front();
+    }
+    complete(request, write_request(request));
+  }
+}
+
+#ifdef HAVE_LIBURING
+auto ska::pst::common::AsyncWriteQueue::submit_to_ring(Request * request) -> std::string
+{
+  // called with the mutex held, which serialises access to the submission queue
+  struct io_uring_sqe * sqe = io_uring_get_sqe(&ring->uring);
+  if (sqe == nullptr)
+  {
+    return "io_uring submission queue is full";
+  }
+  io_uring_prep_write(sqe, request->fd, request->buffer + request->done, request->nbytes - request->done, request->offset + request->done); // NOLINT
+  io_uring_sqe_set_data(sqe, request);
+  int result = io_uring_submit(&ring->uring);
+  if (result < 0)
+  {
+    return std::string("io_uring_submit failed: ") + strerror(-result);
+  }
+  return {};
+}
+
+void ska::pst::common::AsyncWriteQueue::reap_loop()
+{
+  while (true)
+  {
+    struct io_uring_cqe * cqe = nullptr;
+    int result = io_uring_wait_cqe(&ring->uring, &cqe);
+    if (result == -EINTR)
+    {
+      continue;
+    }
+    if (result < 0)
+    {
+      SPDLOG_ERROR("ska::pst::common::AsyncWriteQueue::reap_loop io_uring_wait_cqe failed: {}", strerror(-result));
+      fail(std::string("io_uring_wait_cqe failed: ") + strerror(-result));
+      return;
+    }
+
+    auto * request = static_cast<Request *>(io_uring_cqe_get_data(cqe));
+    int res = cqe->res;
+    io_uring_cqe_seen(&ring->uring, cqe);
+
+    if (request == nullptr)
+    {
+      return;
+    }
+
+    std::string request_error;
+    if (res == -EINTR || res == -EAGAIN)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      request_error = submit_to_ring(request);
+      lock.unlock();
+      if (!request_error.empty())
+      {
+        complete(*request, request_error);
+      }
+      continue;
+    }
+    if (res < 0)
+    {
+      complete(*request, std::string("io_uring write failed: ") + strerror(-res));
+      continue;
+    }
+    if (res == 0)
+    {
+      complete(*request, "io_uring write wrote zero bytes");
+      continue;
+    }
+
+    request->done += res;
+    if (request->done < request->nbytes)
+    {
+      // resubmit the remainder of a short write
+      std::unique_lock<std::mutex> lock(mutex);
+      request_error = submit_to_ring(request);
+      lock.unlock();
+      if (!request_error.empty())
+      {
+        complete(*request, request_error);
+      }
+      continue;
+    }
+    complete(*request, {});
+  }
+}
+#endif
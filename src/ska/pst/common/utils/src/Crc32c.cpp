@@ -0,0 +1,241 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#define SKA_PST_COMMON_CRC32C_X86
+#include <immintrin.h>
+#endif
+
+#include "ska/pst/common/utils/Crc32c.h"
+
+namespace {
+
+  //! the CRC-32C polynomial in reflected bit order
+  constexpr uint32_t polynomial = 0x82F63B78;
+
+  //! number of bytes in each of the three streams that are checksummed in parallel
+  constexpr uint64_t lane_bytes = 4096;
+
+  //! tables of the CRC register update for each byte value, one per byte position of a 64-bit word
+  struct Tables
+  {
+    //! update of the register by one byte, indexed by table[k][byte] for the byte k positions before the end of a word
+    std::array<std::array<uint32_t, 256>, 8> bytes{};
+
+    //! register value after lane_bytes zero bytes, indexed by shift[k][byte] for byte k of the initial register
+    std::array<std::array<uint32_t, 256>, 4> shift{};
+
+    Tables()
+    {
+      for (uint32_t value=0; value<256; value++) // NOLINT
+      {
+        uint32_t crc = value;
+        for (unsigned bit=0; bit<8; bit++) // NOLINT
+        {
+          crc = (crc & 1U) ? (crc >> 1U) ^ polynomial : (crc >> 1U);
+        }
+        bytes[0][value] = crc;
+      }
+      for (unsigned k=1; k<8; k++) // NOLINT
+      {
+        for (uint32_t value=0; value<256; value++) // NOLINT
+        {
+          const uint32_t previous = bytes[k-1][value];
+          bytes[k][value] = (previous >> 8U) ^ bytes[0][previous & 0xFFU]; // NOLINT
+        }
+      }
+
+      // the shift is linear in the initial register, so it is built from the shift of each bit
+      std::array<uint32_t, 32> bit_shift{};
+      for (unsigned bit=0; bit<32; bit++) // NOLINT
+      {
+        uint32_t crc = 1U << bit;
+        for (uint64_t i=0; i<lane_bytes; i++)
+        {
+          crc = (crc >> 8U) ^ bytes[0][crc & 0xFFU]; // NOLINT
+        }
+        bit_shift[bit] = crc;
+      }
+      for (unsigned k=0; k<4; k++) // NOLINT
+      {
+        for (uint32_t value=0; value<256; value++) // NOLINT
+        {
+          uint32_t crc = 0;
+          for (unsigned bit=0; bit<8; bit++) // NOLINT
+          {
+            if (value & (1U << bit))
+            {
+              crc ^= bit_shift[k*8 + bit]; // NOLINT
+            }
+          }
+          shift[k][value] = crc;
+        }
+      }
+    }
+  };
+
+  auto tables() -> const Tables&
+  {
+    static const Tables instance;
+    return instance;
+  }
+
+  // advance the CRC register over lane_bytes zero bytes
+  auto shift_lane(uint32_t crc) -> uint32_t
+  {
+    const auto& shift = tables().shift;
+    return shift[0][crc & 0xFFU] ^ shift[1][(crc >> 8U) & 0xFFU] ^ shift[2][(crc >> 16U) & 0xFFU] ^ shift[3][crc >> 24U]; // NOLINT
+  }
+
+  // slicing-by-8 update of the CRC register
+  auto update_software(const uint8_t * data, uint64_t nbytes, uint32_t crc) -> uint32_t
+  {
+    const auto& table = tables().bytes;
+    while (nbytes >= 8) // NOLINT
+    {
+      uint64_t word{0};
+      memcpy(&word, data, sizeof(word));
+      word ^= crc;
+      crc = table[7][word & 0xFFU] ^ table[6][(word >> 8U) & 0xFFU] ^ table[5][(word >> 16U) & 0xFFU] ^ table[4][(word >> 24U) & 0xFFU] ^ // NOLINT
+        table[3][(word >> 32U) & 0xFFU] ^ table[2][(word >> 40U) & 0xFFU] ^ table[1][(word >> 48U) & 0xFFU] ^ table[0][word >> 56U]; // NOLINT
+      data += 8; // NOLINT
+      nbytes -= 8; // NOLINT
+    }
+    while (nbytes > 0)
+    {
+      crc = (crc >> 8U) ^ table[0][(crc ^ *data) & 0xFFU]; // NOLINT
+      data++; // NOLINT
+      nbytes--;
+    }
+    return crc;
+  }
+
+#ifdef SKA_PST_COMMON_CRC32C_X86
+
+  __attribute__((target("sse4.2")))
+  auto update_words(const uint8_t * data, uint64_t nwords, uint64_t crc) -> uint64_t
+  {
+    for (uint64_t i=0; i<nwords; i++)
+    {
+      uint64_t word{0};
+      memcpy(&word, data + i*8, sizeof(word)); // NOLINT
+      crc = _mm_crc32_u64(crc, word);
+    }
+    return crc;
+  }
+
+  // the crc32 instruction has a latency of three cycles and a throughput of one per cycle,
+  // so three independent streams are checksummed and then combined
+  __attribute__((target("sse4.2")))
+  auto update_hardware(const uint8_t * data, uint64_t nbytes, uint32_t crc) -> uint32_t
+  {
+    uint64_t crc0 = crc;
+    while (nbytes > 0 && (reinterpret_cast<uintptr_t>(data) % 8 != 0)) // NOLINT
+    {
+      crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data);
+      data++; // NOLINT
+      nbytes--;
+    }
+
+    static constexpr uint64_t lane_words = lane_bytes / 8;
+    while (nbytes >= 3 * lane_bytes)
+    {
+      uint64_t crc1 = 0;
+      uint64_t crc2 = 0;
+      const uint8_t * lane1 = data + lane_bytes; // NOLINT
+      const uint8_t * lane2 = data + 2 * lane_bytes; // NOLINT
+      for (uint64_t i=0; i<lane_words; i++)
+      {
+        uint64_t word0{0};
+        uint64_t word1{0};
+        uint64_t word2{0};
+        memcpy(&word0, data + i*8, sizeof(word0)); // NOLINT
+        memcpy(&word1, lane1 + i*8, sizeof(word1)); // NOLINT
+        memcpy(&word2, lane2 + i*8, sizeof(word2)); // NOLINT
+        crc0 = _mm_crc32_u64(crc0, word0);
+        crc1 = _mm_crc32_u64(crc1, word1);
+        crc2 = _mm_crc32_u64(crc2, word2);
+      }
+      crc0 = shift_lane(shift_lane(static_cast<uint32_t>(crc0)) ^ static_cast<uint32_t>(crc1)) ^ static_cast<uint32_t>(crc2);
+      data += 3 * lane_bytes; // NOLINT
+      nbytes -= 3 * lane_bytes;
+    }
+
+    crc0 = update_words(data, nbytes / 8, crc0);
+    data += (nbytes / 8) * 8; // NOLINT
+    nbytes %= 8;
+    while (nbytes > 0)
+    {
+      crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data);
+      data++; // NOLINT
+      nbytes--;
+    }
+    return static_cast<uint32_t>(crc0);
+  }
+
+  auto detect_hardware() -> bool
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+  }
+
+#endif
+
+} // namespace
+
+auto ska::pst::common::crc32c_uses_hardware() -> bool
+{
+#ifdef SKA_PST_COMMON_CRC32C_X86
+  static const bool supported = detect_hardware();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+auto ska::pst::common::crc32c(const char * data, uint64_t nbytes, uint32_t crc) -> uint32_t
+{
+  const auto * bytes = reinterpret_cast<const uint8_t *>(data);
+#ifdef SKA_PST_COMMON_CRC32C_X86
+  if (crc32c_uses_hardware())
+  {
+    return ~update_hardware(bytes, nbytes, ~crc);
+  }
+#endif
+  return ~update_software(bytes, nbytes, ~crc);
+}
+
+auto ska::pst::common::crc32c_software(const char * data, uint64_t nbytes, uint32_t crc) -> uint32_t
+{
+  return ~update_software(reinterpret_cast<const uint8_t *>(data), nbytes, ~crc);
+}
@@ -37,6 +37,7 @@
 void ska::pst::common::DataUnpacker::configure(const ska::pst::common::AsciiHeader& data_config, const ska::pst::common::AsciiHeader& weights_config)
 {
   layout.configure(data_config, weights_config);
+  weights_decoder.configure(layout);
 
   // extract the required parameters from the data header
   ndim = data_config.get_uint32("NDIM");
@@ -44,6 +45,11 @@ void ska::pst::common::DataUnpacker::configure(const ska::pst::common::AsciiHead
   nbit = data_config.get_uint32("NBIT");
   nchan = data_config.get_uint32("NCHAN");
 
+  // select the kernels specialised for the packet geometry, falling back to the generic implementation
+  const auto& packet_layout = layout.get_packet_layout();
+  packet_kernels = get_packet_kernels(nbit, packet_layout.get_samples_per_packet(), packet_layout.get_nchan_per_packet(), npol);
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::configure specialised packet kernels={}", has_packet_kernels());
+
   bandpass.resize(nchan);
   for (unsigned ichan=0; ichan<nchan; ichan++)
   {
@@ -52,21 +58,20 @@ void ska::pst::common::DataUnpacker::configure(const ska::pst::common::AsciiHead
   reset();
 }
 
-auto ska::pst::common::DataUnpacker::get_scale_factor(char * weights, uint32_t packet_number) -> float
+auto ska::pst::common::DataUnpacker::get_unpacked_nsamp(uint64_t data_bufsz) const -> uint64_t
 {
-  auto * weights_ptr = reinterpret_cast<float *>(weights + (packet_number * layout.get_weights_packet_stride())); // NOLINT
-  // return the scale factor, ignoring invalid value of 0
-  if (*weights_ptr == 0) {
-    return 1;
-  } else {
-    return *weights_ptr;
-  }
+  return (data_bufsz * ska::pst::common::bits_per_byte) / (nchan * npol * ndim * nbit);
+}
+
+auto ska::pst::common::DataUnpacker::get_unpacked_nval(uint64_t data_bufsz) const -> uint64_t
+{
+  return get_unpacked_nsamp(data_bufsz) * nchan * npol;
 }
 
 void ska::pst::common::DataUnpacker::resize(uint64_t data_bufsz)
 {
   // determine the unpacked data size in TFP order
-  const uint64_t nsamp = (data_bufsz * ska::pst::common::bits_per_byte) / (nchan * npol * ndim * nbit);
+  const uint64_t nsamp = get_unpacked_nsamp(data_bufsz);
   const uint64_t nval = nsamp * nchan * npol;
 
   SPDLOG_DEBUG("ska::pst::common::DataUnpacker::resize nsamp={} nchan={} npol={} nval={}", nsamp, nchan, npol, nval);
@@ -91,6 +96,24 @@ void ska::pst::common::DataUnpacker::resize(uint64_t data_bufsz)
   }
 }
 
+void ska::pst::common::DataUnpacker::resize_unpacked_buffer(uint64_t nval)
+{
+  if (nval <= unpacked_buffer_nval)
+  {
+    return;
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::resize_unpacked_buffer posix_memalign(unpacked_buffer, {}, {})", unpacked_buffer_alignment, nval * sizeof(std::complex<float>));
+  void * ptr = nullptr;
+  if (posix_memalign(&ptr, unpacked_buffer_alignment, nval * sizeof(std::complex<float>)) != 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::resize_unpacked_buffer failed to allocate {} complex values", nval);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::resize_unpacked_buffer failed to allocate memory");
+  }
+  unpacked_buffer.reset(reinterpret_cast<std::complex<float> *>(ptr));
+  unpacked_buffer_nval = nval;
+}
+
 void ska::pst::common::DataUnpacker::reset()
 {
   for (unsigned ichan=0; ichan<nchan; ichan++)
@@ -101,6 +124,25 @@ void ska::pst::common::DataUnpacker::reset()
   invalid_samples = 0;
 }
 
+void ska::pst::common::DataUnpacker::set_nthreads(unsigned nthreads)
+{
+  if (nthreads == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::set_nthreads nthreads must be greater than zero");
+    throw std::runtime_error("ska::pst::common::DataUnpacker::set_nthreads nthreads must be greater than zero");
+  }
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::set_nthreads nthreads={}", nthreads);
+  workers.resize(nthreads);
+  if (nthreads == 1)
+  {
+    pool.reset();
+  }
+  else if (!pool || pool->get_nthreads() != nthreads)
+  {
+    pool = std::make_unique<WorkerPool>(nthreads);
+  }
+}
+
 auto ska::pst::common::DataUnpacker::unpack(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz) -> std::vector<std::vector<std::vector<std::complex<float>>>>&
 {
   SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack data={} data_bufsz={} weights={} weights_bufsz={}",
@@ -114,15 +156,31 @@ auto ska::pst::common::DataUnpacker::unpack(char * data, uint64_t data_bufsz, ch
   SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack packets_per_heap={} npol={} nchan_per_packet={} nsamp_per_packet={}",
     layout.get_packets_per_heap(), npol, layout.get_packet_layout().get_nchan_per_packet(), layout.get_packet_layout().get_samples_per_packet());
 
-  // unpack the 8 or 16 bit signed integers
-  if (nbit == 8) // NOLINT
+  const uint64_t nsamp = static_cast<uint64_t>(nheaps) * layout.get_packet_layout().get_samples_per_packet();
+  if (unpacked.size() != nsamp)
   {
-    unpack_samples(reinterpret_cast<int8_t*>(data), weights, nheaps);
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack unpacked.size() [{}] did not match the number of samples to unpack [{}]", unpacked.size(), nsamp);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack size of unpacked did not match nsamp");
   }
-  else if (nbit == 16) // NOLINT
+  if (unpacked[0].size() != nchan)
   {
-    unpack_samples(reinterpret_cast<int16_t*>(data), weights, nheaps);
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack unpacked[0].size() [{}] did not match the number of channels to unpack [{}]", unpacked[0].size(), nchan);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack size of unpacked[0] did not match nchan");
   }
+  if (unpacked[0][0].size() != npol)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack unpacked[0][0].size() [{}] did not match the number of polarisations to unpack [{}]", unpacked[0][0].size(), npol);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack size of unpacked[0][0] did not match npol");
+  }
+
+  // unpack the 2, 4, 8 or 16 bit signed integers
+  weights_decoder.decode(weights, nheaps);
+  unpack_nbit<std::complex<float>>(data, nheaps, [this](uint64_t osamp, uint32_t ochan, uint32_t ipol, const std::complex<float>* row, uint32_t nsamp) {
+    for (uint32_t isamp=0; isamp<nsamp; isamp++)
+    {
+      unpacked[osamp + isamp][ochan][ipol] = row[isamp]; // NOLINT
+    }
+  });
 
   if (invalid_packets > 0)
   {
@@ -133,6 +191,256 @@ auto ska::pst::common::DataUnpacker::unpack(char * data, uint64_t data_bufsz, ch
   return unpacked;
 }
 
+auto ska::pst::common::DataUnpacker::unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz) -> UnpackedView<std::complex<float>>
+{
+  const uint64_t nval = get_unpacked_nval(data_bufsz);
+  resize_unpacked_buffer(nval);
+  return unpack_flat(data, data_bufsz, weights, weights_bufsz, unpacked_buffer.get(), unpacked_buffer_nval);
+}
+
+auto ska::pst::common::DataUnpacker::unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, std::complex<float> * output, uint64_t output_nval) -> UnpackedView<std::complex<float>>
+{
+  return unpack_view(data, data_bufsz, weights, weights_bufsz, output, output_nval);
+}
+
+auto ska::pst::common::DataUnpacker::unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, ComplexInt16 * output, uint64_t output_nval) -> UnpackedView<ComplexInt16>
+{
+  return unpack_view(data, data_bufsz, weights, weights_bufsz, output, output_nval);
+}
+
+auto ska::pst::common::DataUnpacker::unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, ComplexFP16 * output, uint64_t output_nval) -> UnpackedView<ComplexFP16>
+{
+  return unpack_view(data, data_bufsz, weights, weights_bufsz, output, output_nval);
+}
+
+auto ska::pst::common::DataUnpacker::unpack_flat(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, ComplexBF16 * output, uint64_t output_nval) -> UnpackedView<ComplexBF16>
+{
+  return unpack_view(data, data_bufsz, weights, weights_bufsz, output, output_nval);
+}
+
+template <typename T>
+auto ska::pst::common::DataUnpacker::unpack_view(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz, T * output, uint64_t output_nval) -> UnpackedView<T>
+{
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack_flat data={} data_bufsz={} weights={} weights_bufsz={} output={} output_nval={}",
+    reinterpret_cast<void*>(data), data_bufsz, reinterpret_cast<void *>(weights), weights_bufsz, reinterpret_cast<void *>(output), output_nval);
+
+  const uint32_t nheaps = data_bufsz / layout.get_data_heap_stride();
+  const uint64_t nsamp = static_cast<uint64_t>(nheaps) * layout.get_packet_layout().get_samples_per_packet();
+  const uint64_t nval = nsamp * nchan * npol;
+
+  if (output == nullptr)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_flat output is null");
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_flat output is null");
+  }
+  if (output_nval < nval)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_flat output_nval [{}] is less than the number of values to unpack [{}]", output_nval, nval);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_flat output buffer is too small");
+  }
+  const uint64_t weights_nbytes = static_cast<uint64_t>(nheaps) * layout.get_weights_heap_stride();
+  if (weights_bufsz < weights_nbytes)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_flat weights_bufsz [{}] is less than the weights size of {} heaps [{}]", weights_bufsz, nheaps, weights_nbytes);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_flat weights buffer is too small");
+  }
+
+  UnpackedView<T> view(output, nsamp, nchan, npol, unpacked_order);
+  weights_decoder.decode(weights, nheaps);
+
+  bool unpacked_packets = false;
+  if constexpr (std::is_same_v<T, std::complex<float>>)
+  {
+    if (has_packet_kernels())
+    {
+      unpack_packets(data, nheaps, view);
+      unpacked_packets = true;
+    }
+  }
+
+  if (!unpacked_packets)
+  {
+    // unpack the 2, 4, 8 or 16 bit signed integers
+    const uint64_t samp_stride = view.get_samp_stride();
+    unpack_nbit<T>(data, nheaps, [&view, samp_stride](uint64_t osamp, uint32_t ochan, uint32_t ipol, const T* row, uint32_t nsamp) {
+      T * out = &view(osamp, ochan, ipol);
+      if (samp_stride == 1)
+      {
+        std::copy(row, row + nsamp, out); // NOLINT
+        return;
+      }
+      for (uint32_t isamp=0; isamp<nsamp; isamp++)
+      {
+        out[isamp * samp_stride] = row[isamp]; // NOLINT
+      }
+    });
+  }
+
+  if (invalid_packets > 0)
+  {
+    SPDLOG_WARN("ska::pst::common::DataUnpacker::unpack_flat found {} dropped packets resulting in {} invalid samples", invalid_packets, invalid_samples);
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack_flat unpacking complete");
+  return view;
+}
+
+auto ska::pst::common::DataUnpacker::unpack_stream(SegmentProducer& producer, uint32_t nheaps_per_window, const WindowCallback& callback) -> uint64_t
+{
+  if (nheaps_per_window == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_stream nheaps_per_window must be greater than zero");
+    throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_stream nheaps_per_window must be greater than zero");
+  }
+
+  const uint64_t data_heap_stride = layout.get_data_heap_stride();
+  const uint64_t weights_heap_stride = layout.get_weights_heap_stride();
+  const uint64_t window_data_bufsz = static_cast<uint64_t>(nheaps_per_window) * data_heap_stride;
+  const uint64_t window_nval = get_unpacked_nval(window_data_bufsz);
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack_stream nheaps_per_window={} window_nval={}", nheaps_per_window, window_nval);
+
+  // the window is allocated once and re-used for every window of every segment
+  resize_unpacked_buffer(window_nval);
+
+  uint64_t total_nheaps = 0;
+  SegmentProducer::Segment segment = producer.next_segment();
+  while (segment.data.block != nullptr && segment.data.size > 0)
+  {
+    const uint64_t nheaps = segment.data.size / data_heap_stride;
+    if (segment.data.size % data_heap_stride != 0)
+    {
+      SPDLOG_WARN("ska::pst::common::DataUnpacker::unpack_stream ignoring {} bytes of partial heap at end of segment", segment.data.size % data_heap_stride);
+    }
+    if (segment.weights.size < nheaps * weights_heap_stride)
+    {
+      SPDLOG_ERROR("ska::pst::common::DataUnpacker::unpack_stream weights.size [{}] is less than required for {} heaps [{}]",
+        segment.weights.size, nheaps, nheaps * weights_heap_stride);
+      throw std::runtime_error("ska::pst::common::DataUnpacker::unpack_stream weights segment too small for data segment");
+    }
+
+    for (uint64_t iheap=0; iheap<nheaps; iheap+=nheaps_per_window)
+    {
+      const uint64_t window_nheaps = std::min(static_cast<uint64_t>(nheaps_per_window), nheaps - iheap);
+      char * data = segment.data.block + (iheap * data_heap_stride); // NOLINT
+      char * weights = segment.weights.block + (iheap * weights_heap_stride); // NOLINT
+      auto view = unpack_flat(data, window_nheaps * data_heap_stride, weights, window_nheaps * weights_heap_stride, unpacked_buffer.get(), unpacked_buffer_nval);
+      callback(view, segment.get_obs_offset() + (iheap * data_heap_stride));
+    }
+    total_nheaps += nheaps;
+    segment = producer.next_segment();
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack_stream unpacked {} heaps", total_nheaps);
+  return total_nheaps;
+}
+
+void ska::pst::common::DataUnpacker::unpack_packets(char * data, uint32_t nheaps, UnpackedView<std::complex<float>>& view)
+{
+  const uint32_t nsamp_per_packet = layout.get_packet_layout().get_samples_per_packet();
+  const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
+  const uint32_t nsamp_per_block = weights_decoder.get_nsamp_per_block();
+  const uint32_t nblocks_per_chan = weights_decoder.get_nblocks_per_chan();
+  const uint64_t samp_stride = view.get_samp_stride();
+  const uint64_t chan_stride = view.get_chan_stride();
+  const uint64_t pol_stride = view.get_pol_stride();
+
+  process_heaps(nheaps, [&](uint32_t heap_begin, uint32_t heap_end, WorkerState& state) {
+    for (const auto& packet : layout.get_packets(data, nullptr, heap_begin, heap_end))
+    {
+      std::complex<float> * out = &view(packet.samp_begin, packet.chan_begin, 0);
+      if (weights_decoder.is_valid(packet.packet_number))
+      {
+        const float scale = apply_scale_factors ? weights_decoder.get_reciprocal_scale(packet.packet_number) : 1.0f;
+        packet_kernels.unpack(packet.data, scale, out, samp_stride, chan_stride, pol_stride);
+        if (weights_decoder.is_fully_weighted(packet.packet_number))
+        {
+          continue;
+        }
+      }
+      else
+      {
+        state.invalid_packets++;
+        state.invalid_samples += static_cast<uint64_t>(npol) * nchan_per_packet * nsamp_per_packet;
+      }
+
+      // zero the samples of the zero-weighted blocks, which include every block of an invalid packet
+      const float * packet_mask = weights_decoder.get_packet_mask(packet.packet_number);
+      for (uint32_t ipol=0; ipol<npol; ipol++)
+      {
+        for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
+        {
+          std::complex<float> * row = out + (ichan * chan_stride) + (ipol * pol_stride); // NOLINT
+          for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
+          {
+            if (packet_mask[(ichan * nblocks_per_chan) + iblock] != 0) // NOLINT
+            {
+              continue;
+            }
+            for (uint32_t isamp=iblock*nsamp_per_block; isamp<(iblock+1)*nsamp_per_block; isamp++)
+            {
+              row[isamp * samp_stride] = std::complex<float>(0, 0); // NOLINT
+            }
+          }
+        }
+      }
+    }
+  });
+}
+
+void ska::pst::common::DataUnpacker::integrate_packets(char * data, uint32_t nheaps)
+{
+  const uint32_t nsamp_per_packet = layout.get_packet_layout().get_samples_per_packet();
+  const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
+  const uint64_t row_stride = layout.get_data_packet_stride() / (npol * nchan_per_packet);
+  const uint32_t nsamp_per_block = weights_decoder.get_nsamp_per_block();
+  const uint32_t nblocks_per_chan = weights_decoder.get_nblocks_per_chan();
+  // exact, as PacketLayout requires the WT_NSAMP samples of each block to fill a whole number of bytes
+  const uint64_t block_stride = row_stride / nblocks_per_chan;
+
+  // the specialised kernels are only provided for 8 and 16 bit samples
+  auto power = [this](const char* in, uint32_t nsamp) {
+    return (nbit == 8) ? sum_complex_power(reinterpret_cast<const int8_t*>(in), nsamp) : sum_complex_power(reinterpret_cast<const int16_t*>(in), nsamp); // NOLINT
+  };
+
+  process_heaps(nheaps, [&](uint32_t heap_begin, uint32_t heap_end, WorkerState& state) {
+    for (const auto& packet : layout.get_packets(data, nullptr, heap_begin, heap_end))
+    {
+      if (!weights_decoder.is_valid(packet.packet_number))
+      {
+        state.invalid_packets++;
+        state.invalid_samples += static_cast<uint64_t>(npol) * nchan_per_packet * nsamp_per_packet;
+        continue;
+      }
+
+      const float inverse_scale = weights_decoder.get_reciprocal_scale(packet.packet_number);
+      const float inverse_scale_squared = inverse_scale * inverse_scale;
+      const char * in = packet.data;
+      float * packet_bandpass = &state.bandpass[static_cast<uint64_t>(packet.chan_begin) * npol];
+      if (weights_decoder.is_fully_weighted(packet.packet_number))
+      {
+        packet_kernels.integrate(in, inverse_scale_squared, packet_bandpass);
+        continue;
+      }
+
+      // partially weighted packets are integrated one block of samples at a time
+      const float * packet_mask = weights_decoder.get_packet_mask(packet.packet_number);
+      for (uint32_t ipol=0; ipol<npol; ipol++)
+      {
+        for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
+        {
+          float row_power = 0;
+          for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
+          {
+            row_power += power(in + (iblock * block_stride), nsamp_per_block) * packet_mask[(ichan * nblocks_per_chan) + iblock]; // NOLINT
+          }
+          packet_bandpass[(ichan * npol) + ipol] += row_power * inverse_scale_squared; // NOLINT
+          in += row_stride; // NOLINT
+        }
+      }
+    }
+  });
+}
+
 void ska::pst::common::DataUnpacker::integrate_bandpass(char * data, uint64_t data_bufsz, char *weights, uint64_t weights_bufsz)
 {
   SPDLOG_DEBUG("ska::pst::common::DataUnpacker::unpack integrate_bandpass={} data_bufsz={} weights={} weights_bufsz={}",
@@ -144,14 +452,59 @@ void ska::pst::common::DataUnpacker::integrate_bandpass(char * data, uint64_t da
   SPDLOG_DEBUG("ska::pst::common::DataUnpacker::integrate_bandpass nheaps={} packets_per_heap={} npol={} nchan_per_packet={} nsamp_per_packet={}",
     nheaps, layout.get_packets_per_heap(), npol, layout.get_packet_layout().get_nchan_per_packet(), layout.get_packet_layout().get_samples_per_packet());
 
-  // integerate the 8 or 16 bit signed integers
-  if (nbit == 8) // NOLINT
+  if (bandpass.size() != nchan)
   {
-    integrate_samples(reinterpret_cast<int8_t*>(data), weights, nheaps);
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::integrate_bandpass bandpass.size() [{}] did not match the number of channels to unpack [{}]", bandpass.size(), nchan);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::integrate_bandpass size of bandpass did not match nchan");
   }
-  else if (nbit == 16) // NOLINT
+  if (bandpass[0].size() != npol)
   {
-    integrate_samples(reinterpret_cast<int16_t*>(data), weights, nheaps);
+    SPDLOG_ERROR("ska::pst::common::DataUnpacker::integrate_bandpass bandpass[0].size() [{}] did not match the number of polarisations to unpack [{}]", bandpass[0].size(), npol);
+    throw std::runtime_error("ska::pst::common::DataUnpacker::integrate_bandpass size of bandpass[0] did not match npol");
+  }
+
+  for (auto& state : workers)
+  {
+    state.bandpass.assign(static_cast<size_t>(nchan) * npol, 0);
+  }
+  weights_decoder.decode(weights, nheaps);
+
+  if (has_packet_kernels())
+  {
+    integrate_packets(data, nheaps);
+  }
+  else
+  {
+    // integerate the 2, 4, 8 or 16 bit signed integers, each thread accumulating into its own bandpass
+    process_heaps(nheaps, [&](uint32_t heap_begin, uint32_t heap_end, WorkerState& state) {
+      if (nbit == 8) // NOLINT
+      {
+        auto power = [](const char* in, uint32_t nsamp) { return sum_complex_power(reinterpret_cast<const int8_t*>(in), nsamp); };
+        integrate_rows(data, heap_begin, heap_end, power, state);
+      }
+      else if (nbit == 16) // NOLINT
+      {
+        auto power = [](const char* in, uint32_t nsamp) { return sum_complex_power(reinterpret_cast<const int16_t*>(in), nsamp); };
+        integrate_rows(data, heap_begin, heap_end, power, state);
+      }
+      else
+      {
+        auto power = [this](const char* in, uint32_t nsamp) { return sum_packed_complex_power(in, nsamp, nbit); };
+        integrate_rows(data, heap_begin, heap_end, power, state);
+      }
+    });
+  }
+
+  // reduce the bandpass accumulated by each thread
+  for (auto& state : workers)
+  {
+    for (unsigned ichan=0; ichan<nchan; ichan++)
+    {
+      for (unsigned ipol=0; ipol<npol; ipol++)
+      {
+        bandpass[ichan][ipol] += state.bandpass[(ichan * npol) + ipol];
+      }
+    }
   }
 
   if (invalid_packets > 0)
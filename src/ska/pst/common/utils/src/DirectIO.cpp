@@ -0,0 +1,96 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <string>
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+#include <linux/fs.h>
+
+#include "ska/pst/common/utils/DirectIO.h"
+
+// returns the logical block size of the block device (or its parent, for a partition) from sysfs, or zero if unknown
+static auto sysfs_logical_block_size(unsigned dev_major, unsigned dev_minor) -> uint32_t
+{
+  const std::string device = "/sys/dev/block/" + std::to_string(dev_major) + ":" + std::to_string(dev_minor);
+  for (const std::string& queue : { device + "/queue/logical_block_size", device + "/../queue/logical_block_size" })
+  {
+    std::ifstream input(queue);
+    uint32_t logical_block_size{0};
+    if (input >> logical_block_size)
+    {
+      return logical_block_size;
+    }
+  }
+  return 0;
+}
+
+auto ska::pst::common::detect_direct_io_alignment(int fd) -> ska::pst::common::DirectIOAlignment
+{
+  DirectIOAlignment alignment;
+
+#ifdef STATX_DIOALIGN
+  struct statx file_statx{};
+  if ((statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &file_statx) == 0) && (file_statx.stx_mask & STATX_DIOALIGN) && (file_statx.stx_dio_offset_align > 0))
+  {
+    alignment.offset = file_statx.stx_dio_offset_align;
+    alignment.memory = file_statx.stx_dio_mem_align;
+  }
+#endif
+
+  if (alignment.offset == 0)
+  {
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) == 0)
+    {
+      int logical_block_size{0};
+      if (S_ISBLK(file_stat.st_mode) && (ioctl(fd, BLKSSZGET, &logical_block_size) == 0) && (logical_block_size > 0)) // NOLINT
+      {
+        alignment.offset = static_cast<uint32_t>(logical_block_size);
+      }
+      else
+      {
+        alignment.offset = sysfs_logical_block_size(major(file_stat.st_dev), minor(file_stat.st_dev));
+      }
+    }
+  }
+
+  if (alignment.memory == 0)
+  {
+    alignment.memory = alignment.offset;
+  }
+  SPDLOG_DEBUG("ska::pst::common::detect_direct_io_alignment fd={} offset={} memory={}", fd, alignment.offset, alignment.memory);
+  return alignment;
+}
@@ -30,13 +30,25 @@
 
 #include "ska/pst/common/utils/FileBlockProducer.h"
 
+#include <algorithm>
+#include <cstring>
 #include <spdlog/spdlog.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 ska::pst::common::FileBlockProducer::FileBlockProducer(const std::string& file_path)
 	: reader(new FileReader(file_path))
 {
   auto hdr_size = reader->read_header();
+  page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  if (reader->is_compressed())
+  {
+    block_info = BlockProducer::Block(nullptr, reader->get_data_size(), reader->get_obs_offset());
+    next_block_info = block_info;
+    return;
+  }
+
   auto data_size = reader->get_file_size()-hdr_size;
 
   void* map = mmap(nullptr, data_size, PROT_READ, MAP_SHARED, reader->_get_fd(), hdr_size);
@@ -74,10 +86,161 @@ auto ska::pst::common::FileBlockProducer::get_header() const -> const ska::pst::
   return reader->get_header();
 }
 
+void ska::pst::common::FileBlockProducer::set_block_bytes(uint64_t nbytes)
+{
+  if (started)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileBlockProducer::set_block_bytes cannot be called after next_block");
+    throw std::runtime_error("ska::pst::common::FileBlockProducer::set_block_bytes cannot be called after next_block");
+  }
+
+  const auto& header = reader->get_header();
+  if (nbytes > 0 && header.has("RESOLUTION") && (nbytes % header.get_uint64("RESOLUTION") != 0))
+  {
+    SPDLOG_ERROR("ska::pst::common::FileBlockProducer::set_block_bytes nbytes={} is not a multiple of RESOLUTION={}", nbytes, header.get_uint64("RESOLUTION"));
+    throw std::runtime_error("ska::pst::common::FileBlockProducer::set_block_bytes block size is not a multiple of RESOLUTION");
+  }
+  block_bytes = nbytes;
+}
+
+void ska::pst::common::FileBlockProducer::set_huge_pages(bool enable)
+{
+  advise(0, block_info.size, enable ? MADV_HUGEPAGE : MADV_NOHUGEPAGE, enable ? "MADV_HUGEPAGE" : "MADV_NOHUGEPAGE");
+}
+
+void ska::pst::common::FileBlockProducer::set_verify_checksums(bool verify)
+{
+  reader->set_verify_checksums(verify);
+  if (verify)
+  {
+    // re-read the header, which is verified by the reader
+    reader->read_header();
+  }
+  verify_checksums = verify;
+}
+
+void ska::pst::common::FileBlockProducer::prefetch(uint64_t nbytes) const
+{
+  advise(0, std::min(nbytes, static_cast<uint64_t>(block_info.size)), MADV_WILLNEED, "MADV_WILLNEED");
+}
+
 auto ska::pst::common::FileBlockProducer::next_block() -> BlockProducer::Block
 {
-  auto result = next_block_info;
-  next_block_info = BlockProducer::Block(nullptr, 0); // next call to next_block returns EOD marker
+  started = true;
+  if (reader->is_compressed())
+  {
+    return next_decompressed_block();
+  }
+
+  if (block_bytes == 0)
+  {
+    auto result = next_block_info;
+    next_block_info = BlockProducer::Block(nullptr, 0); // next call to next_block returns EOD marker
+    if (result.block && populate)
+    {
+#ifdef MADV_POPULATE_READ
+      advise(0, result.size, MADV_POPULATE_READ, "MADV_POPULATE_READ");
+#else
+      advise(0, result.size, MADV_WILLNEED, "MADV_WILLNEED");
+#endif
+    }
+    if (result.block && verify_checksums)
+    {
+      reader->verify_data(result.block, result.size, 0);
+    }
+    return result;
+  }
+
+  if (next_offset == 0)
+  {
+    advise(0, block_info.size, MADV_SEQUENTIAL, "MADV_SEQUENTIAL");
+  }
+
+  // the previous block has been consumed
+  drop_behind(next_offset);
+
+  if (next_offset >= block_info.size)
+  {
+    next_block_info = BlockProducer::Block(nullptr, 0);
+    return next_block_info;
+  }
+
+  const uint64_t size = std::min(block_bytes, block_info.size - next_offset);
+  BlockProducer::Block result(block_info.block + next_offset, size, block_info.obs_offset + next_offset); // NOLINT
+  if (populate)
+  {
+#ifdef MADV_POPULATE_READ
+    advise(next_offset, size, MADV_POPULATE_READ, "MADV_POPULATE_READ");
+#else
+    advise(next_offset, size, MADV_WILLNEED, "MADV_WILLNEED");
+#endif
+  }
+  if (verify_checksums)
+  {
+    reader->verify_data(result.block, size, next_offset);
+  }
+
+  next_offset += size;
+  if (read_ahead_bytes > 0 && next_offset < block_info.size)
+  {
+    advise(next_offset, std::min(read_ahead_bytes, block_info.size - next_offset), MADV_WILLNEED, "MADV_WILLNEED");
+  }
+
+  SPDLOG_TRACE("ska::pst::common::FileBlockProducer::next_block obs_offset={} size={}", result.obs_offset, result.size);
+  return result;
+}
+
+auto ska::pst::common::FileBlockProducer::next_decompressed_block() -> BlockProducer::Block
+{
+  if (next_offset >= block_info.size)
+  {
+    next_block_info = BlockProducer::Block(nullptr, 0);
+    return next_block_info;
+  }
+
+  // the reader verifies the checksums of the compressed frames, if enabled
+  const uint64_t size = (block_bytes == 0) ? block_info.size : std::min(block_bytes, block_info.size - next_offset);
+  decompressed_block.resize(size);
+  reader->read_data_at(decompressed_block.data(), size, next_offset);
+
+  BlockProducer::Block result(decompressed_block.data(), size, block_info.obs_offset + next_offset);
+  next_offset += size;
+  SPDLOG_TRACE("ska::pst::common::FileBlockProducer::next_decompressed_block obs_offset={} size={}", result.obs_offset, result.size);
   return result;
 }
 
+void ska::pst::common::FileBlockProducer::advise(uint64_t offset, uint64_t nbytes, int advice, const char* name) const
+{
+  // compressed files are not mapped
+  if (nbytes == 0 || block_info.block == nullptr)
+  {
+    return;
+  }
+
+  // madvise requires a page-aligned address
+  const auto base = reinterpret_cast<uintptr_t>(block_info.block) + offset; // NOLINT
+  const uintptr_t start = base - (base % page_size);
+  if (madvise(reinterpret_cast<void*>(start), nbytes + (base - start), advice) != 0) // NOLINT
+  {
+    SPDLOG_WARN("ska::pst::common::FileBlockProducer::advise madvise {} failed: {}", name, strerror(errno));
+  }
+}
+
+void ska::pst::common::FileBlockProducer::drop_behind(uint64_t offset)
+{
+  // the mapping is page-aligned, so release only the whole pages before the offset, leaving any page shared with the current block
+  const uint64_t drop_end = (std::min(offset, block_info.size) / page_size) * page_size;
+  if (drop_end <= dropped_bytes)
+  {
+    return;
+  }
+
+  SPDLOG_TRACE("ska::pst::common::FileBlockProducer::drop_behind releasing bytes {} - {}", dropped_bytes, drop_end);
+  advise(dropped_bytes, drop_end - dropped_bytes, MADV_DONTNEED, "MADV_DONTNEED");
+
+  // also release the page cache, so that memory use does not grow with the file size
+  const auto file_offset = static_cast<off_t>(reader->get_header().get_uint64("HDR_SIZE") + dropped_bytes);
+  posix_fadvise(reader->_get_fd(), file_offset, static_cast<off_t>(drop_end - dropped_bytes), POSIX_FADV_DONTNEED);
+  dropped_bytes = drop_end;
+}
+
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/Crc32c.h"
+#include "ska/pst/common/utils/FileChecksums.h"
+
+//! identifies the format of the sidecar file
+static constexpr std::array<char, 8> checksums_magic{'C', 'R', 'C', '3', '2', 'C', '0', '1'};
+
+void ska::pst::common::FileChecksums::configure(uint64_t _chunk_bytes)
+{
+  if (_chunk_bytes == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileChecksums::configure chunk_bytes must be greater than zero");
+    throw std::runtime_error("ska::pst::common::FileChecksums::configure chunk_bytes must be greater than zero");
+  }
+  chunk_bytes = _chunk_bytes;
+  data_bytes = 0;
+  header_bytes = 0;
+  header_checksum = 0;
+  current_checksum = 0;
+  chunk_checksums.clear();
+}
+
+void ska::pst::common::FileChecksums::set_header(const char * header, uint64_t nbytes)
+{
+  header_bytes = nbytes;
+  header_checksum = crc32c(header, nbytes);
+}
+
+void ska::pst::common::FileChecksums::update(const char * data, uint64_t nbytes)
+{
+  while (nbytes > 0)
+  {
+    const uint64_t chunk_offset = data_bytes % chunk_bytes;
+    const uint64_t to_add = std::min(nbytes, chunk_bytes - chunk_offset);
+    current_checksum = crc32c(data, to_add, current_checksum);
+    data += to_add; // NOLINT
+    nbytes -= to_add;
+    data_bytes += to_add;
+    if (chunk_offset + to_add == chunk_bytes)
+    {
+      chunk_checksums.push_back(current_checksum);
+      current_checksum = 0;
+    }
+  }
+}
+
+void ska::pst::common::FileChecksums::finalise()
+{
+  if (data_bytes % chunk_bytes != 0)
+  {
+    chunk_checksums.push_back(current_checksum);
+    current_checksum = 0;
+  }
+}
+
+void ska::pst::common::FileChecksums::save(const std::filesystem::path& file_path) const
+{
+  SPDLOG_DEBUG("ska::pst::common::FileChecksums::save writing {} checksums to {}", chunk_checksums.size(), file_path.generic_string());
+  std::ofstream output(file_path, std::ios::binary | std::ios::trunc);
+  const uint64_t nchunks = chunk_checksums.size();
+  output.write(checksums_magic.data(), checksums_magic.size());
+  output.write(reinterpret_cast<const char *>(&chunk_bytes), sizeof(chunk_bytes)); // NOLINT
+  output.write(reinterpret_cast<const char *>(&data_bytes), sizeof(data_bytes)); // NOLINT
+  output.write(reinterpret_cast<const char *>(&header_bytes), sizeof(header_bytes)); // NOLINT
+  output.write(reinterpret_cast<const char *>(&header_checksum), sizeof(header_checksum)); // NOLINT
+  output.write(reinterpret_cast<const char *>(&nchunks), sizeof(nchunks)); // NOLINT
+  output.write(reinterpret_cast<const char *>(chunk_checksums.data()), static_cast<std::streamsize>(nchunks * sizeof(uint32_t))); // NOLINT
+  output.close();
+  if (output.fail())
+  {
+    SPDLOG_ERROR("ska::pst::common::FileChecksums::save failed to write {}", file_path.generic_string());
+    throw std::runtime_error("ska::pst::common::FileChecksums::save failed to write " + file_path.generic_string());
+  }
+}
+
+void ska::pst::common::FileChecksums::load(const std::filesystem::path& file_path)
+{
+  SPDLOG_DEBUG("ska::pst::common::FileChecksums::load reading {}", file_path.generic_string());
+  std::ifstream input(file_path, std::ios::binary);
+  if (!input)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileChecksums::load could not open {}", file_path.generic_string());
+    throw std::runtime_error("ska::pst::common::FileChecksums::load could not open " + file_path.generic_string());
+  }
+
+  std::array<char, checksums_magic.size()> magic{};
+  uint64_t nchunks{0};
+  input.read(magic.data(), magic.size());
+  input.read(reinterpret_cast<char *>(&chunk_bytes), sizeof(chunk_bytes)); // NOLINT
+  input.read(reinterpret_cast<char *>(&data_bytes), sizeof(data_bytes)); // NOLINT
+  input.read(reinterpret_cast<char *>(&header_bytes), sizeof(header_bytes)); // NOLINT
+  input.read(reinterpret_cast<char *>(&header_checksum), sizeof(header_checksum)); // NOLINT
+  input.read(reinterpret_cast<char *>(&nchunks), sizeof(nchunks)); // NOLINT
+  if (!input || magic != checksums_magic || chunk_bytes == 0 || nchunks != (data_bytes + chunk_bytes - 1) / chunk_bytes)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileChecksums::load {} is not a valid checksums file", file_path.generic_string());
+    throw std::runtime_error("ska::pst::common::FileChecksums::load invalid checksums file " + file_path.generic_string());
+  }
+
+  chunk_checksums.resize(nchunks);
+  input.read(reinterpret_cast<char *>(chunk_checksums.data()), static_cast<std::streamsize>(nchunks * sizeof(uint32_t))); // NOLINT
+  if (!input)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileChecksums::load {} is truncated", file_path.generic_string());
+    throw std::runtime_error("ska::pst::common::FileChecksums::load truncated checksums file " + file_path.generic_string());
+  }
+  current_checksum = 0;
+}
+
+void ska::pst::common::FileChecksums::verify_header(const char * header, uint64_t nbytes) const
+{
+  if (nbytes != header_bytes || crc32c(header, nbytes) != header_checksum)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileChecksums::verify_header checksum of {} byte header does not match", nbytes);
+    throw std::runtime_error("ska::pst::common::FileChecksums::verify_header header checksum mismatch");
+  }
+}
+
+auto ska::pst::common::FileChecksums::verify(const char * data, uint64_t nbytes, uint64_t offset) const -> uint64_t
+{
+  const uint64_t end = std::min(offset + nbytes, data_bytes);
+  uint64_t verified = 0;
+  for (uint64_t ichunk=(offset + chunk_bytes - 1) / chunk_bytes; ichunk < chunk_checksums.size(); ichunk++)
+  {
+    const uint64_t chunk_start = ichunk * chunk_bytes;
+    const uint64_t chunk_end = std::min(chunk_start + chunk_bytes, data_bytes);
+    if (chunk_end > end)
+    {
+      break;
+    }
+    const uint32_t checksum = crc32c(data + (chunk_start - offset), chunk_end - chunk_start); // NOLINT
+    if (checksum != chunk_checksums[ichunk])
+    {
+      SPDLOG_ERROR("ska::pst::common::FileChecksums::verify checksum of chunk {} at data offset {} is {:#010x}, expected {:#010x}",
+        ichunk, chunk_start, checksum, chunk_checksums[ichunk]);
+      throw std::runtime_error("ska::pst::common::FileChecksums::verify checksum mismatch in chunk " + std::to_string(ichunk));
+    }
+    verified++;
+  }
+  return verified;
+}
+
+auto ska::pst::common::FileChecksums::get_filename(const std::filesystem::path& file_path) -> std::filesystem::path
+{
+  std::filesystem::path result(file_path);
+  result += ".crc32c";
+  return result;
+}
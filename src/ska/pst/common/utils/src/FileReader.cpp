@@ -29,6 +29,8 @@
  */
 
 #include <unistd.h>
+#include <algorithm>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <stdexcept>
@@ -39,9 +41,11 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "ska/pst/common/utils/DirectIO.h"
 #include "ska/pst/common/utils/FileReader.h"
 
-ska::pst::common::FileReader::FileReader(const std::string& file_path)
+ska::pst::common::FileReader::FileReader(const std::string& file_path, bool use_o_direct) :
+  o_direct(use_o_direct)
 {
   open_file(file_path);
 }
@@ -53,19 +57,25 @@ ska::pst::common::FileReader::~FileReader()
   {
     close_file();
   }
+  free(staging_buffer); // NOLINT
 }
 
-void ska::pst::common::FileReader::open_file(const std::string& file_path)
+void ska::pst::common::FileReader::open_file(const std::string& _file_path)
 {
   if (fd >= 0)
   {
     SPDLOG_ERROR("ska::pst::common::FileReader::open_file file is already opened fd={}", fd);
     throw std::runtime_error("ska::pst::common::FileReader::open_file file already opened");
   }
+  file_path = _file_path;
 
   int flags = O_RDONLY;
+  if (o_direct)
+  {
+    flags |= O_DIRECT;
+  }
 
-  SPDLOG_DEBUG("ska::pst::common::FileReader::open_file opening {}", file_path);
+  SPDLOG_DEBUG("ska::pst::common::FileReader::open_file opening {} o_direct={}", file_path, o_direct);
   fd = ::open(file_path.c_str(), flags); // NOLINT
   if (fd < 0)
   {
@@ -74,9 +84,36 @@ void ska::pst::common::FileReader::open_file(const std::string& file_path)
   }
 
   bytes_read_from_file = 0;
+  data_offset = 0;
+  codec = nullptr;
+  frames.clear();
+  decompressed_size = 0;
+  decompressed_position = 0;
+  decoded_frame = 0;
 
   // determine the size of the file in bytes
   file_size = std::filesystem::file_size(std::filesystem::path(file_path));
+
+  if (o_direct)
+  {
+    DirectIOAlignment alignment = detect_direct_io_alignment(fd);
+    o_direct_alignment = (alignment.offset > 0) ? alignment.offset : default_o_direct_alignment;
+    o_direct_memory_alignment = (alignment.memory > 0) ? alignment.memory : o_direct_alignment;
+
+    // the staging buffer is a multiple of any power-of-two alignment up to its size
+    free(staging_buffer); // NOLINT
+    staging_buffer = nullptr;
+    const uint64_t buffer_alignment = std::max(o_direct_alignment, o_direct_memory_alignment);
+    if (posix_memalign(reinterpret_cast<void **>(&staging_buffer), buffer_alignment, staging_bufsz) != 0)
+    {
+      staging_buffer = nullptr;
+      SPDLOG_ERROR("ska::pst::common::FileReader::open_file could not allocate {} byte staging buffer", staging_bufsz);
+      throw std::runtime_error("ska::pst::common::FileReader::open_file could not allocate staging buffer");
+    }
+  }
+
+  set_read_ahead(read_ahead_bytes);
+  set_verify_checksums(verify);
 }
 
 void ska::pst::common::FileReader::close_file()
@@ -96,6 +133,83 @@ void ska::pst::common::FileReader::close_file()
   fd = -1;
 }
 
+void ska::pst::common::FileReader::set_read_ahead(uint64_t nbytes)
+{
+  read_ahead_bytes = nbytes;
+  if (fd < 0 || o_direct)
+  {
+    return;
+  }
+
+  // sequential access doubles the kernel's default read-ahead window
+  int advice = (read_ahead_bytes > 0) ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_NORMAL;
+  int result = posix_fadvise(fd, 0, 0, advice);
+  if (result != 0)
+  {
+    SPDLOG_WARN("ska::pst::common::FileReader::set_read_ahead posix_fadvise failed: {}", strerror(result));
+  }
+}
+
+void ska::pst::common::FileReader::set_verify_checksums(bool _verify)
+{
+  verify = _verify;
+  chunks_verified = 0;
+  if (verify && fd >= 0)
+  {
+    checksums.load(FileChecksums::get_filename(file_path));
+  }
+}
+
+auto ska::pst::common::FileReader::verify_data(const char * data_ptr, uint64_t data_size, uint64_t offset) -> uint64_t
+{
+  if (!verify)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileReader::verify_data checksum verification is not enabled");
+    throw std::runtime_error("ska::pst::common::FileReader::verify_data checksum verification is not enabled");
+  }
+  const uint64_t verified = checksums.verify(data_ptr, data_size, offset);
+  chunks_verified += verified;
+  return verified;
+}
+
+auto ska::pst::common::FileReader::verify_checksums() -> uint64_t
+{
+  if (!verify)
+  {
+    checksums.load(FileChecksums::get_filename(file_path));
+  }
+
+  const uint64_t hdr_size = checksums.get_header_bytes();
+  const uint64_t data_bytes = checksums.get_data_bytes();
+  SPDLOG_DEBUG("ska::pst::common::FileReader::verify_checksums verifying {} header bytes and {} data bytes of {}", hdr_size, data_bytes, file_path);
+
+  std::vector<char> buffer(hdr_size);
+  if (read_at(buffer.data(), hdr_size, 0) != hdr_size)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileReader::verify_checksums {} is shorter than the {} byte header", file_path, hdr_size);
+    throw std::runtime_error("ska::pst::common::FileReader::verify_checksums file is shorter than the header");
+  }
+  checksums.verify_header(buffer.data(), hdr_size);
+
+  // read whole chunks, so that every chunk is verified
+  const uint64_t chunk_bytes = checksums.get_chunk_bytes();
+  buffer.resize(std::max(chunk_bytes, (verify_bufsz / chunk_bytes) * chunk_bytes));
+
+  uint64_t verified = 0;
+  for (uint64_t offset = 0; offset < data_bytes; offset += buffer.size())
+  {
+    const uint64_t to_read = std::min(static_cast<uint64_t>(buffer.size()), data_bytes - offset);
+    if (read_at(buffer.data(), to_read, hdr_size + offset) != to_read)
+    {
+      SPDLOG_ERROR("ska::pst::common::FileReader::verify_checksums {} is shorter than the {} bytes of checksummed data", file_path, data_bytes);
+      throw std::runtime_error("ska::pst::common::FileReader::verify_checksums file is shorter than the checksummed data");
+    }
+    verified += checksums.verify(buffer.data(), to_read, offset);
+  }
+  SPDLOG_DEBUG("ska::pst::common::FileReader::verify_checksums verified {} chunks", verified);
+  return verified;
+}
+
 auto ska::pst::common::FileReader::read_header() -> ssize_t
 {
   static constexpr uint32_t default_header_size = ska::pst::common::AsciiHeader::default_header_size;
@@ -103,7 +217,7 @@ auto ska::pst::common::FileReader::read_header() -> ssize_t
   buffer.resize(default_header_size);
 
   // read the expected default header size, so that the exact header size can be determined
-  ssize_t bytes_read = read(fd, &buffer[0], buffer.size());
+  uint64_t bytes_read = read_at(&buffer[0], buffer.size(), 0);
   if (bytes_read != buffer.size())
   {
     SPDLOG_ERROR("ska::pst::common::FileReader::read_header attempted to read {} bytes from file, but only {} bytes were read", buffer.size(), bytes_read);
@@ -113,20 +227,30 @@ auto ska::pst::common::FileReader::read_header() -> ssize_t
 
   uint32_t hdr_size = header.get_uint32("HDR_SIZE");
 
-  // if the header size does not match the default, resize the buffer
-  if (hdr_size != default_header_size)
+  // if the header is larger than the default, read only the remainder
+  if (hdr_size > default_header_size)
   {
     buffer.resize(hdr_size);
-    lseek(fd, 0, SEEK_SET);
-    ssize_t bytes_read = read(fd, &buffer[0], buffer.size());
-    if (bytes_read != buffer.size())
+    uint64_t remainder = hdr_size - default_header_size;
+    bytes_read = read_at(&buffer[default_header_size], remainder, default_header_size);
+    if (bytes_read != remainder)
     {
       SPDLOG_ERROR("ska::pst::common::FileReader::read_header attempted to read {} bytes from file, but only {} bytes were read",
-        buffer.size(), bytes_read);
+        hdr_size, default_header_size + bytes_read);
       throw std::runtime_error("ska::pst::common::FileReader::read_header failed to read header from file");
     }
     header.load_from_string(std::string(buffer.begin(), buffer.end()));
   }
+  else if (hdr_size < default_header_size)
+  {
+    buffer.resize(hdr_size);
+    header.load_from_string(std::string(buffer.begin(), buffer.end()));
+  }
+
+  if (verify)
+  {
+    checksums.verify_header(buffer.data(), hdr_size);
+  }
 
   if (header.has("OBS_OFFSET"))
   {
@@ -135,6 +259,22 @@ auto ska::pst::common::FileReader::read_header() -> ssize_t
 
   // increment the counter for bytes read
   bytes_read_from_file = hdr_size;
+  data_offset = hdr_size;
+
+  codec = nullptr;
+  if (header.has("COMPRESSION"))
+  {
+    const std::string compression = header.get_val("COMPRESSION");
+    if (compression != WeightsCodec::compression_name)
+    {
+      SPDLOG_ERROR("ska::pst::common::FileReader::read_header unsupported COMPRESSION={}", compression);
+      throw std::runtime_error("ska::pst::common::FileReader::read_header unsupported COMPRESSION " + compression);
+    }
+    codec = std::make_unique<WeightsCodec>(header.get_uint32("COMPRESSION_STRIDE"));
+    index_frames();
+  }
+
+  advise_read_ahead(bytes_read_from_file);
   return static_cast<ssize_t>(hdr_size);
 }
 
@@ -146,6 +286,13 @@ auto ska::pst::common::FileReader::read_data(char * data_ptr, uint64_t bytes_to_
     throw std::runtime_error("ska::pst::common::FileReader::read_data data_ptr is null");
   }
 
+  if (codec)
+  {
+    const uint64_t bytes_read = read_decompressed(data_ptr, bytes_to_read, decompressed_position);
+    decompressed_position += bytes_read;
+    return static_cast<ssize_t>(bytes_read);
+  }
+
   size_t bytes_remaining = file_size - bytes_read_from_file;
   SPDLOG_TRACE("ska::pst::common::FileReader::read_data bytes_to_read={} bytes_remaining={}", bytes_to_read, bytes_remaining);
 
@@ -160,15 +307,232 @@ auto ska::pst::common::FileReader::read_data(char * data_ptr, uint64_t bytes_to_
   }
   SPDLOG_DEBUG("ska::pst::common::FileReader::read_data reading bytes {} - {} of {}", bytes_read_from_file, bytes_read_from_file + bytes_to_read, file_size);
 
-  ssize_t bytes_read = read(fd, reinterpret_cast<void *>(data_ptr), bytes_to_read);
+  uint64_t bytes_read = read_at(data_ptr, bytes_to_read, bytes_read_from_file);
   if (bytes_read != bytes_to_read)
   {
     SPDLOG_ERROR("ska::pst::common::FileReader::read_data bytes_read fewer bytes than expected requested={} actual={}", bytes_to_read, bytes_read);
     throw std::runtime_error("ska::pst::common::FileReader::read_data bytes_read fewer bytes than expected");
   }
 
+  if (verify && data_offset > 0)
+  {
+    verify_data(data_ptr, bytes_read, bytes_read_from_file - data_offset);
+  }
+
   bytes_read_from_file += bytes_to_read;
+  advise_read_ahead(bytes_read_from_file);
 
   SPDLOG_TRACE("ska::pst::common::FileReader::read_data bytes_read {} bytes to file, total read {}", bytes_to_read, bytes_read_from_file);
+  return static_cast<ssize_t>(bytes_read);
+}
+
+auto ska::pst::common::FileReader::read_data_at(char * data_ptr, uint64_t bytes_to_read, uint64_t offset) -> ssize_t
+{
+  if ( data_ptr == nullptr )
+  {
+    SPDLOG_WARN("ska::pst::common::FileReader::read_data_at data_ptr is null");
+    throw std::runtime_error("ska::pst::common::FileReader::read_data_at data_ptr is null");
+  }
+
+  if (codec)
+  {
+    return static_cast<ssize_t>(read_decompressed(data_ptr, bytes_to_read, offset));
+  }
+
+  const uint64_t file_offset = data_offset + offset;
+  if (file_offset >= file_size || bytes_to_read == 0)
+  {
+    return 0;
+  }
+  bytes_to_read = std::min(bytes_to_read, file_size - file_offset);
+  SPDLOG_TRACE("ska::pst::common::FileReader::read_data_at reading bytes {} - {} of {}", file_offset, file_offset + bytes_to_read, file_size);
+
+  uint64_t bytes_read = read_at(data_ptr, bytes_to_read, file_offset);
+  if (bytes_read != bytes_to_read)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileReader::read_data_at bytes_read fewer bytes than expected requested={} actual={}", bytes_to_read, bytes_read);
+    throw std::runtime_error("ska::pst::common::FileReader::read_data_at bytes_read fewer bytes than expected");
+  }
+  if (verify && data_offset > 0)
+  {
+    verify_data(data_ptr, bytes_read, offset);
+  }
+  advise_read_ahead(file_offset + bytes_read);
+  return static_cast<ssize_t>(bytes_read);
+}
+
+auto ska::pst::common::FileReader::get_data_size() const -> uint64_t
+{
+  if (codec)
+  {
+    return decompressed_size;
+  }
+  return (file_size > data_offset) ? file_size - data_offset : 0;
+}
+
+void ska::pst::common::FileReader::index_frames()
+{
+  frames.clear();
+  decompressed_size = 0;
+
+  uint64_t offset = data_offset;
+  while (offset < file_size)
+  {
+    WeightsCodec::FrameHeader frame_header;
+    const uint64_t remaining = file_size - offset;
+    if (remaining < sizeof(frame_header) || read_at(reinterpret_cast<char *>(&frame_header), sizeof(frame_header), offset) != sizeof(frame_header) || // NOLINT
+        frame_header.encoded_bytes > remaining - sizeof(frame_header))
+    {
+      SPDLOG_ERROR("ska::pst::common::FileReader::index_frames frame {} at offset {} of {} is truncated", frames.size(), offset, file_path);
+      throw std::runtime_error("ska::pst::common::FileReader::index_frames truncated frame in compressed file");
+    }
+    frames.push_back({offset, decompressed_size, frame_header.decoded_bytes, frame_header.encoded_bytes});
+    decompressed_size += frame_header.decoded_bytes;
+    offset += sizeof(frame_header) + frame_header.encoded_bytes;
+  }
+  decoded_frame = frames.size();
+  SPDLOG_DEBUG("ska::pst::common::FileReader::index_frames {} frames contain {} bytes compressed to {} bytes", frames.size(), decompressed_size, file_size - data_offset);
+}
+
+auto ska::pst::common::FileReader::read_decompressed(char * data_ptr, uint64_t data_size, uint64_t offset) -> uint64_t
+{
+  std::lock_guard<std::mutex> lock(decode_mutex);
+  if (offset >= decompressed_size || data_size == 0)
+  {
+    return 0;
+  }
+  data_size = std::min(data_size, decompressed_size - offset);
+
+  // the last frame that starts at or before the offset
+  auto next = std::upper_bound(frames.begin(), frames.end(), offset, [](uint64_t value, const Frame& frame) { return value < frame.data_offset; });
+  auto iframe = static_cast<uint64_t>(std::distance(frames.begin(), next)) - 1;
+
+  uint64_t bytes_read = 0;
+  while (bytes_read < data_size)
+  {
+    const Frame& frame = frames[iframe];
+    const uint64_t frame_offset = offset + bytes_read - frame.data_offset;
+    const uint64_t to_copy = std::min(frame.decoded_bytes - frame_offset, data_size - bytes_read);
+
+    // whole frames are decoded directly into the destination, partial frames through the decoded buffer
+    if (to_copy == frame.decoded_bytes)
+    {
+      decode_frame(iframe, data_ptr + bytes_read); // NOLINT
+    }
+    else
+    {
+      if (decoded_frame != iframe)
+      {
+        decoded_buffer.resize(frame.decoded_bytes);
+        decode_frame(iframe, decoded_buffer.data());
+        decoded_frame = iframe;
+      }
+      memcpy(data_ptr + bytes_read, decoded_buffer.data() + frame_offset, to_copy); // NOLINT
+    }
+    bytes_read += to_copy;
+    iframe++;
+  }
+
+  const Frame& last = frames[iframe - 1];
+  advise_read_ahead(last.file_offset + sizeof(WeightsCodec::FrameHeader) + last.encoded_bytes);
+  return bytes_read;
+}
+
+void ska::pst::common::FileReader::decode_frame(uint64_t iframe, char * data_ptr)
+{
+  const Frame& frame = frames[iframe];
+  const uint64_t frame_bytes = sizeof(WeightsCodec::FrameHeader) + frame.encoded_bytes;
+  if (encoded_buffer.size() < frame_bytes)
+  {
+    encoded_buffer.resize(frame_bytes);
+  }
+
+  if (read_at(encoded_buffer.data(), frame_bytes, frame.file_offset) != frame_bytes)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileReader::decode_frame could not read {} bytes of frame {} at offset {}", frame_bytes, iframe, frame.file_offset);
+    throw std::runtime_error("ska::pst::common::FileReader::decode_frame could not read frame");
+  }
+
+  // checksums cover the bytes in the file, so only the chunks entirely within the frame are verified
+  if (verify)
+  {
+    verify_data(encoded_buffer.data(), frame_bytes, frame.file_offset - data_offset);
+  }
+
+  codec->decode(&encoded_buffer[sizeof(WeightsCodec::FrameHeader)], frame.encoded_bytes, data_ptr, frame.decoded_bytes);
+}
+
+auto ska::pst::common::FileReader::read_at(char * data_ptr, uint64_t data_size, uint64_t file_offset) -> uint64_t
+{
+  const bool aligned = (file_offset % o_direct_alignment == 0) && (data_size % o_direct_alignment == 0) &&
+    (reinterpret_cast<uintptr_t>(data_ptr) % o_direct_memory_alignment == 0);
+  if (!o_direct || aligned)
+  {
+    return pread_fully(data_ptr, data_size, file_offset);
+  }
+
+  // copy the requested bytes out of whole aligned blocks read into the staging buffer
+  std::lock_guard<std::mutex> lock(staging_mutex);
+  uint64_t bytes_read = 0;
+  while (bytes_read < data_size)
+  {
+    const uint64_t position = file_offset + bytes_read;
+    const uint64_t block_offset = position - (position % o_direct_alignment);
+    const uint64_t skip = position - block_offset;
+    const uint64_t required = ((skip + data_size - bytes_read + o_direct_alignment - 1) / o_direct_alignment) * o_direct_alignment;
+    const uint64_t to_read = std::min(staging_bufsz, required);
+
+    const uint64_t staged = pread_fully(staging_buffer, to_read, block_offset);
+    if (staged <= skip)
+    {
+      break;
+    }
+    const uint64_t to_copy = std::min(staged - skip, data_size - bytes_read);
+    memcpy(data_ptr + bytes_read, staging_buffer + skip, to_copy); // NOLINT
+    bytes_read += to_copy;
+    if (staged < to_read)
+    {
+      break;
+    }
+  }
   return bytes_read;
 }
+
+auto ska::pst::common::FileReader::pread_fully(char * data_ptr, uint64_t data_size, uint64_t file_offset) const -> uint64_t
+{
+  uint64_t bytes_read = 0;
+  while (bytes_read < data_size)
+  {
+    ssize_t result = ::pread(fd, data_ptr + bytes_read, data_size - bytes_read, static_cast<off_t>(file_offset + bytes_read)); // NOLINT
+    if (result < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      SPDLOG_ERROR("ska::pst::common::FileReader::pread_fully pread({}, {}, {}) failed: {}", fd, data_size - bytes_read, file_offset + bytes_read, strerror(errno));
+      throw std::runtime_error("ska::pst::common::FileReader::pread_fully failed to read from file");
+    }
+    if (result == 0)
+    {
+      break;
+    }
+    bytes_read += static_cast<uint64_t>(result);
+  }
+  return bytes_read;
+}
+
+void ska::pst::common::FileReader::advise_read_ahead(uint64_t file_offset) const
+{
+  if (read_ahead_bytes == 0 || o_direct || file_offset >= file_size)
+  {
+    return;
+  }
+
+  const uint64_t nbytes = std::min(read_ahead_bytes, file_size - file_offset);
+  int result = posix_fadvise(fd, static_cast<off_t>(file_offset), static_cast<off_t>(nbytes), POSIX_FADV_WILLNEED);
+  if (result != 0)
+  {
+    SPDLOG_TRACE("ska::pst::common::FileReader::advise_read_ahead posix_fadvise failed: {}", strerror(result));
+  }
+}
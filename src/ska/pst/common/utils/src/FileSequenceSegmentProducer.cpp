@@ -0,0 +1,221 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/FileReader.h"
+#include "ska/pst/common/utils/FileSequenceSegmentProducer.h"
+
+ska::pst::common::FileSequenceSegmentProducer::FileSequenceSegmentProducer(
+        const std::vector<std::string>& data_files,
+        const std::vector<std::string>& weights_files,
+        uint64_t _heaps_per_segment,
+        unsigned _read_ahead_segments) :
+  heaps_per_segment(_heaps_per_segment),
+  read_ahead_segments(_read_ahead_segments)
+{
+  SPDLOG_DEBUG("ska::pst::common::FileSequenceSegmentProducer::FileSequenceSegmentProducer ndata={} nweights={}", data_files.size(), weights_files.size());
+  if (data_files.empty())
+  {
+    SPDLOG_ERROR("ska::pst::common::FileSequenceSegmentProducer::FileSequenceSegmentProducer no data files");
+    throw std::runtime_error("ska::pst::common::FileSequenceSegmentProducer::FileSequenceSegmentProducer no data files");
+  }
+  if (data_files.size() != weights_files.size())
+  {
+    SPDLOG_ERROR("ska::pst::common::FileSequenceSegmentProducer::FileSequenceSegmentProducer {} data files but {} weights files", data_files.size(), weights_files.size());
+    throw std::runtime_error("ska::pst::common::FileSequenceSegmentProducer::FileSequenceSegmentProducer number of data and weights files differ");
+  }
+
+  data_file_paths = sort_by_obs_offset(data_files, data_header);
+  weights_file_paths = sort_by_obs_offset(weights_files, weights_header);
+
+  current = open_pair(0);
+  if (get_nfiles() > 1)
+  {
+    start_background(nullptr);
+  }
+}
+
+ska::pst::common::FileSequenceSegmentProducer::~FileSequenceSegmentProducer()
+{
+  SPDLOG_DEBUG("ska::pst::common::FileSequenceSegmentProducer::~FileSequenceSegmentProducer()");
+  try
+  {
+    join_background();
+  }
+  catch (std::exception& exc)
+  {
+    SPDLOG_WARN("ska::pst::common::FileSequenceSegmentProducer::~FileSequenceSegmentProducer background thread failed: {}", exc.what());
+  }
+}
+
+auto ska::pst::common::FileSequenceSegmentProducer::list_files(const std::string& directory) -> std::vector<std::string>
+{
+  std::vector<std::string> file_paths;
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+  {
+    if (entry.is_regular_file() && entry.path().extension() == ".dada")
+    {
+      file_paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(file_paths.begin(), file_paths.end());
+  return file_paths;
+}
+
+auto ska::pst::common::FileSequenceSegmentProducer::sort_by_obs_offset(const std::vector<std::string>& file_paths, ska::pst::common::AsciiHeader& header) -> std::vector<std::string>
+{
+  struct FileExtent
+  {
+    std::string path;
+    uint64_t obs_offset;
+    uint64_t data_size;
+  };
+
+  std::vector<FileExtent> extents;
+  for (const auto& file_path : file_paths)
+  {
+    FileReader reader(file_path);
+    reader.read_header();
+    const auto& file_header = reader.get_header();
+    uint64_t obs_offset = file_header.has("OBS_OFFSET") ? file_header.get_uint64("OBS_OFFSET") : 0;
+
+    // the offsets count uncompressed bytes, so the size of compressed data is taken after decompression
+    extents.push_back({file_path, obs_offset, reader.get_data_size()});
+  }
+
+  std::stable_sort(extents.begin(), extents.end(), [](const FileExtent& a, const FileExtent& b) { return a.obs_offset < b.obs_offset; });
+
+  std::vector<std::string> sorted;
+  for (size_t ifile=0; ifile<extents.size(); ifile++)
+  {
+    if (ifile > 0 && extents[ifile].obs_offset != extents[ifile-1].obs_offset + extents[ifile-1].data_size)
+    {
+      SPDLOG_WARN("ska::pst::common::FileSequenceSegmentProducer::sort_by_obs_offset {} does not follow {} contiguously",
+        extents[ifile].path, extents[ifile-1].path);
+    }
+    sorted.push_back(extents[ifile].path);
+  }
+
+  FileReader first(sorted.front());
+  first.read_header();
+  header.clone(first.get_header());
+  return sorted;
+}
+
+auto ska::pst::common::FileSequenceSegmentProducer::next_segment() -> Segment
+{
+  while (true)
+  {
+    Segment result;
+    result.data = current->data->next_block();
+    result.weights = current->weights->next_block();
+    if (result.data.block != nullptr)
+    {
+      return result;
+    }
+
+    if (file_index + 1 >= get_nfiles())
+    {
+      SPDLOG_DEBUG("ska::pst::common::FileSequenceSegmentProducer::next_segment end of data");
+      return result;
+    }
+
+    // the last segment of the current pair has been consumed
+    join_background();
+    std::unique_ptr<FilePair> previous = std::move(current);
+    current = std::move(next);
+    file_index++;
+    SPDLOG_DEBUG("ska::pst::common::FileSequenceSegmentProducer::next_segment reading file {} of {}", file_index, get_nfiles());
+    start_background(std::move(previous));
+  }
+}
+
+auto ska::pst::common::FileSequenceSegmentProducer::open_pair(size_t index) const -> std::unique_ptr<FilePair>
+{
+  SPDLOG_DEBUG("ska::pst::common::FileSequenceSegmentProducer::open_pair {} and {}", data_file_paths[index], weights_file_paths[index]);
+  auto pair = std::make_unique<FilePair>();
+  pair->data = std::make_unique<FileBlockProducer>(data_file_paths[index]);
+  pair->weights = std::make_unique<FileBlockProducer>(weights_file_paths[index]);
+
+  if (heaps_per_segment > 0)
+  {
+    const uint64_t data_block_bytes = heaps_per_segment * data_header.get_uint64("RESOLUTION");
+    const uint64_t weights_block_bytes = heaps_per_segment * weights_header.get_uint64("RESOLUTION");
+    pair->data->set_block_bytes(data_block_bytes);
+    pair->weights->set_block_bytes(weights_block_bytes);
+    pair->data->set_read_ahead(read_ahead_segments * data_block_bytes);
+    pair->weights->set_read_ahead(read_ahead_segments * weights_block_bytes);
+
+    // the first segment and the read-ahead window that follows it
+    pair->data->prefetch((read_ahead_segments + 1) * data_block_bytes);
+    pair->weights->prefetch((read_ahead_segments + 1) * weights_block_bytes);
+  }
+  return pair;
+}
+
+void ska::pst::common::FileSequenceSegmentProducer::start_background(std::unique_ptr<FilePair> previous)
+{
+  const size_t next_index = file_index + 1;
+  background_thread = std::make_unique<std::thread>([this, next_index, releasing = std::move(previous)]() mutable {
+    try
+    {
+      releasing = nullptr;
+      if (next_index < get_nfiles())
+      {
+        next = open_pair(next_index);
+      }
+    }
+    catch (std::exception& exc)
+    {
+      SPDLOG_ERROR("ska::pst::common::FileSequenceSegmentProducer::start_background failed: {}", exc.what());
+      background_error = std::current_exception();
+    }
+  });
+}
+
+void ska::pst::common::FileSequenceSegmentProducer::join_background()
+{
+  if (background_thread)
+  {
+    background_thread->join();
+    background_thread = nullptr;
+  }
+  if (background_error)
+  {
+    std::exception_ptr error = background_error;
+    background_error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
@@ -29,6 +29,9 @@
  */
 
 #include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <stdexcept>
@@ -39,6 +42,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "ska/pst/common/utils/DirectIO.h"
 #include "ska/pst/common/utils/FileWriter.h"
 
 // casts an unsigned integer to an integer and throws an out-of-range exception if the unsigned argument is greater than the maximum possible signed value
@@ -107,6 +111,14 @@ void ska::pst::common::FileWriter::deconfigure()
   }
   header_buffer = nullptr;
   header_bufsz = 0;
+
+  if (staging_buffer)
+  {
+    SPDLOG_DEBUG("ska::pst::common::FileWriter::deconfigure free(staging_buffer)");
+    free(staging_buffer); // NOLINT
+  }
+  staging_buffer = nullptr;
+  staging_bufsz = 0;
 }
 
 auto ska::pst::common::FileWriter::get_filename(const std::string& utc_start, uint64_t obs_offset, unsigned file_number) -> std::filesystem::path
@@ -148,39 +160,56 @@ void ska::pst::common::FileWriter::open_file(const std::filesystem::path& new_fi
   opened_file = new_file;
   header_bytes_written = 0;
   data_bytes_written = 0;
-}
-
-void ska::pst::common::FileWriter::reopen_file()
-{
-  // save the header and data bytes written to file
-  uint64_t current_data_bytes_written = data_bytes_written;
-  uint64_t current_header_bytes_written = header_bytes_written;
-  SPDLOG_DEBUG("ska::pst::common::FileWriter::reopen_file current_data_bytes_written={} current_header_bytes_written={}", current_data_bytes_written, current_header_bytes_written);
-
-  SPDLOG_DEBUG("ska::pst::common::FileWriter::reopen_file close_file()");
-  close_file();
-
-  SPDLOG_DEBUG("ska::pst::common::FileWriter::reopen_file open_file without O_TRUNC");
-
-  flags = O_WRONLY | O_CREAT;
-  open_file(opened_file);
+  uncompressed_bytes_written = 0;
+  staged_bytes = 0;
+  preallocated_bytes = 0;
+  codec = nullptr;
 
-  // restore the usual O_TRUNC behaviour
-  flags = O_WRONLY | O_CREAT | O_TRUNC;
-
-  data_bytes_written = current_data_bytes_written;
-  header_bytes_written = current_header_bytes_written;
+  compute_checksums = (checksum_chunk_bytes > 0);
+  if (compute_checksums)
+  {
+    checksums.configure(checksum_chunk_bytes);
+  }
 
-  SPDLOG_DEBUG("ska::pst::common::FileWriter::reopen_file lseek({}, 0, SEEK_END)", fd);
-  auto offset = lseek(fd, 0, SEEK_END);
+  if (preallocation_bytes > 0)
+  {
+    preallocate(preallocation_bytes);
+  }
 
-  if (offset != data_bytes_written + header_bytes_written)
+  if (o_direct)
   {
-    SPDLOG_ERROR("ska::pst::common::FileWriter::reopen_file lseek returns offset={} != bytes_written={}", offset, data_bytes_written + header_bytes_written);
-    throw std::runtime_error("ska::pst::common::FileWriter::reopen_file lseek returns offset != bytes_written");
+    detect_alignment();
+
+    // (re)allocate the staging buffer if it does not satisfy the alignment of the new file
+    const uint64_t buffer_alignment = std::max(o_direct_alignment, o_direct_memory_alignment);
+    const uint64_t required_bufsz = ((std::max(default_staging_bufsz, static_cast<uint64_t>(o_direct_alignment)) + o_direct_alignment - 1) / o_direct_alignment) * o_direct_alignment;
+    if (staging_buffer && ((reinterpret_cast<uintptr_t>(staging_buffer) % buffer_alignment != 0) || (staging_bufsz % o_direct_alignment != 0)))
+    {
+      free(staging_buffer); // NOLINT
+      staging_buffer = nullptr;
+    }
+    if (!staging_buffer)
+    {
+      SPDLOG_DEBUG("ska::pst::common::FileWriter::open_file posix_memalign(staging_buffer, {}, {})", buffer_alignment, required_bufsz);
+      if (posix_memalign(reinterpret_cast<void **>(&staging_buffer), buffer_alignment, required_bufsz) != 0)
+      {
+        staging_buffer = nullptr;
+        SPDLOG_ERROR("ska::pst::common::FileWriter::open_file could not allocate {} byte staging buffer", required_bufsz);
+        throw std::runtime_error("ska::pst::common::FileWriter::open_file could not allocate staging buffer");
+      }
+      staging_bufsz = required_bufsz;
+    }
   }
 }
 
+void ska::pst::common::FileWriter::detect_alignment()
+{
+  DirectIOAlignment alignment = detect_direct_io_alignment(fd);
+  o_direct_alignment = (alignment.offset > 0) ? alignment.offset : default_o_direct_alignment;
+  o_direct_memory_alignment = (alignment.memory > 0) ? alignment.memory : o_direct_alignment;
+  SPDLOG_DEBUG("ska::pst::common::FileWriter::detect_alignment offset_alignment={} memory_alignment={}", o_direct_alignment, o_direct_memory_alignment);
+}
+
 void ska::pst::common::FileWriter::close_file()
 {
   if (!file_open)
@@ -189,6 +218,45 @@ void ska::pst::common::FileWriter::close_file()
     throw std::runtime_error("ska::pst::common::FileWriter::close_file not open");
   }
 
+  // files with a padded final block or unused preallocated extents are truncated to the bytes written
+  const bool truncate = (staged_bytes > 0) || (preallocated_bytes > 0);
+
+  try
+  {
+    wait_for_writes();
+
+    if (staged_bytes > 0)
+    {
+      write_staged_tail();
+    }
+    if (truncate)
+    {
+      truncate_file();
+    }
+
+    if (compute_checksums)
+    {
+      checksums.finalise();
+      checksums.save(FileChecksums::get_filename(opened_file));
+    }
+  }
+  catch (std::exception& exc)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::close_file failed to complete writes: {}", exc.what());
+
+    // do not leave padding or preallocated extents that would be mistaken for data
+    if (truncate && ftruncate(fd, safe_signed_cast(header_bytes_written + data_bytes_written)) < 0)
+    {
+      SPDLOG_ERROR("ska::pst::common::FileWriter::close_file ftruncate({}) failed: {}", fd, strerror(errno));
+    }
+    ::close(fd);
+    fd = -1;
+    file_open = false;
+    staged_bytes = 0;
+    preallocated_bytes = 0;
+    throw;
+  }
+
   SPDLOG_DEBUG("ska::pst::common::FileWriter::close_file fd={}", fd);
   if (::close(fd) < 0)
   {
@@ -196,6 +264,7 @@ void ska::pst::common::FileWriter::close_file()
   }
   fd = -1;
   file_open = false;
+  preallocated_bytes = 0;
 }
 
 auto ska::pst::common::FileWriter::write_header(const ska::pst::common::AsciiHeader& header) -> ssize_t
@@ -212,13 +281,23 @@ auto ska::pst::common::FileWriter::write_header(const ska::pst::common::AsciiHea
   auto header_size = header.get_uint32("HDR_SIZE");
   configure (header_size);
 
-  if (header_bufsz < header.raw().length())
+  std::string raw = header.raw();
+  if (compression)
   {
-    SPDLOG_ERROR("ska::pst::common::FileWriter::write_header header_bufsz={} smaller than header.raw.length()={} (HDR_SIZE={})", header_bufsz, header.raw().length(), header_size);
+    ska::pst::common::AsciiHeader compressed_header(header);
+    codec = std::make_unique<WeightsCodec>(WeightsCodec::get_stride(header));
+    compressed_header.set_val("COMPRESSION", WeightsCodec::compression_name);
+    compressed_header.set("COMPRESSION_STRIDE", codec->get_stride());
+    raw = compressed_header.raw();
+  }
+
+  if (header_bufsz < raw.length())
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::write_header header_bufsz={} smaller than header.raw.length()={} (HDR_SIZE={})", header_bufsz, raw.length(), header_size);
     throw std::runtime_error("ska::pst::common::FileWriter::write_header header_bufsz smaller than header.raw.length after calling configure()");
   }
 
-  sprintf(header_buffer, header.raw().c_str(), header.raw().length()); // NOLINT
+  sprintf(header_buffer, raw.c_str(), raw.length()); // NOLINT
 
   ssize_t wrote = write(fd, header_buffer, header_bufsz);
   if (wrote < 0)
@@ -239,6 +318,10 @@ auto ska::pst::common::FileWriter::write_header(const ska::pst::common::AsciiHea
     sync_file_range(fd, 0, safe_signed_cast(header_bufsz), SYNC_FILE_RANGE_WRITE);
   }
   header_bytes_written = header_bufsz;
+  if (compute_checksums)
+  {
+    checksums.set_header(header_buffer, header_bufsz);
+  }
   return wrote;
 }
 
@@ -252,20 +335,61 @@ auto ska::pst::common::FileWriter::write_data(char * data_ptr, uint64_t bytes_to
     throw std::runtime_error("ska::pst::common::FileWriter::write_data header not written");
   }
 
-  if (o_direct && (bytes_to_write % o_direct_alignment != 0))
+  if (codec)
+  {
+    write_frame(data_ptr, bytes_to_write);
+    return safe_signed_cast(bytes_to_write);
+  }
+
+  uncompressed_bytes_written += bytes_to_write;
+  return write_bytes(data_ptr, bytes_to_write);
+}
+
+void ska::pst::common::FileWriter::write_frame(const char * data_ptr, uint64_t bytes_to_write)
+{
+  if (bytes_to_write == 0)
+  {
+    return;
+  }
+
+  const uint64_t max_frame_bytes = sizeof(WeightsCodec::FrameHeader) + WeightsCodec::get_max_encoded_bytes(bytes_to_write);
+  if (frame_buffer.size() < max_frame_bytes)
   {
-    SPDLOG_WARN("ska::pst::common::FileWriter::write_data bytes_to_write={} not a multiple of {} bytes", bytes_to_write, o_direct_alignment);
+    frame_buffer.resize(max_frame_bytes);
+  }
+
+  WeightsCodec::FrameHeader frame;
+  frame.decoded_bytes = bytes_to_write;
+  frame.encoded_bytes = codec->encode(data_ptr, bytes_to_write, &frame_buffer[sizeof(frame)]);
+  memcpy(&frame_buffer[0], &frame, sizeof(frame));
+  SPDLOG_DEBUG("ska::pst::common::FileWriter::write_frame encoded {} bytes as {} bytes", frame.decoded_bytes, frame.encoded_bytes);
 
-    // disable o_direct flag and re-open the file
-    o_direct = false;
-    reopen_file();
+  write_bytes(&frame_buffer[0], sizeof(frame) + frame.encoded_bytes);
+  uncompressed_bytes_written += bytes_to_write;
+}
+
+auto ska::pst::common::FileWriter::write_bytes(const char * data_ptr, uint64_t bytes_to_write) -> ssize_t
+{
+  if (compute_checksums)
+  {
+    checksums.update(data_ptr, bytes_to_write);
+  }
+
+  if (o_direct)
+  {
+    write_direct(data_ptr, bytes_to_write);
+    data_bytes_written += bytes_to_write;
+    SPDLOG_DEBUG("ska::pst::common::FileWriter::write_data wrote {} bytes to file, total written {} staged {}", bytes_to_write, data_bytes_written, staged_bytes);
+    return safe_signed_cast(bytes_to_write);
   }
 
-  ssize_t wrote = write(fd, reinterpret_cast<void *>(data_ptr), bytes_to_write);
+  // write at an explicit offset, as asynchronous writes do not advance the file position
+  auto file_offset = safe_signed_cast(header_bytes_written + data_bytes_written);
+  ssize_t wrote = pwrite(fd, reinterpret_cast<const void *>(data_ptr), bytes_to_write, file_offset);
 
   if (wrote < 0)
   {
-    SPDLOG_ERROR("ska::pst::common::FileWriter::write_data write({}, {}, {}) failed: {}", fd, reinterpret_cast<void *>(data_ptr), bytes_to_write, strerror(errno));
+    SPDLOG_ERROR("ska::pst::common::FileWriter::write_data pwrite({}, {}, {}, {}) failed: {}", fd, reinterpret_cast<const void *>(data_ptr), bytes_to_write, file_offset, strerror(errno));
     throw std::runtime_error("ska::pst::common::FileWriter::write_data could not write data to file");
   }
 
@@ -275,19 +399,16 @@ auto ska::pst::common::FileWriter::write_data(char * data_ptr, uint64_t bytes_to
     throw std::runtime_error("ska::pst::common::FileWriter::write_data wrote fewer bytes than expected");
   }
 
-  if (!o_direct)
-  {
-    auto offset = safe_signed_cast(header_bytes_written + data_bytes_written);
-    auto nbytes = safe_signed_cast(bytes_to_write);
+  auto offset = safe_signed_cast(header_bytes_written + data_bytes_written);
+  auto nbytes = safe_signed_cast(bytes_to_write);
 
-    // This won't block, but will start writeout asynchronously
-    sync_file_range(fd, offset, nbytes, SYNC_FILE_RANGE_WRITE);
+  // This won't block, but will start writeout asynchronously
+  sync_file_range(fd, offset, nbytes, SYNC_FILE_RANGE_WRITE);
 
-    // This does a blocking write-and-wait on any old ranges
-    if (data_bytes_written > 0)
-    {
-      sync_file_range(fd, offset, nbytes, SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE|SYNC_FILE_RANGE_WAIT_AFTER);
-    }
+  // This does a blocking write-and-wait on any old ranges
+  if (data_bytes_written > 0)
+  {
+    sync_file_range(fd, offset, nbytes, SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE|SYNC_FILE_RANGE_WAIT_AFTER);
   }
 
   data_bytes_written += wrote;
@@ -295,3 +416,182 @@ auto ska::pst::common::FileWriter::write_data(char * data_ptr, uint64_t bytes_to
   SPDLOG_DEBUG("ska::pst::common::FileWriter::write_data wrote {} bytes to file, total written {}", bytes_to_write, data_bytes_written);
   return wrote;
 }
+
+void ska::pst::common::FileWriter::set_async_depth(uint32_t depth, bool use_io_uring)
+{
+  if (async_queue)
+  {
+    SPDLOG_DEBUG("ska::pst::common::FileWriter::set_async_depth waiting for {} writes in flight", async_queue->get_in_flight());
+    async_queue->wait();
+    async_queue = nullptr;
+  }
+
+  if (depth > 0)
+  {
+    async_queue = std::make_unique<AsyncWriteQueue>(depth, use_io_uring);
+    SPDLOG_DEBUG("ska::pst::common::FileWriter::set_async_depth depth={} io_uring={}", depth, async_queue->uses_io_uring());
+  }
+}
+
+auto ska::pst::common::FileWriter::write_data_async(char * data_ptr, uint64_t bytes_to_write, AsyncWriteQueue::Callback callback) -> uint64_t
+{
+  SPDLOG_DEBUG("ska::pst::common::FileWriter::write_data_async submitting {} bytes", bytes_to_write);
+
+  if (!async_queue)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::write_data_async asynchronous writes not enabled");
+    throw std::runtime_error("ska::pst::common::FileWriter::write_data_async asynchronous writes not enabled");
+  }
+
+  if (header_bytes_written == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::write_data_async header not written");
+    throw std::runtime_error("ska::pst::common::FileWriter::write_data_async header not written");
+  }
+
+  const uint64_t file_offset = header_bytes_written + data_bytes_written;
+
+  // partial blocks and unaligned buffers are merged through the staging buffer, and frames are encoded into the frame buffer, which are only accessed synchronously
+  const bool unaligned = (bytes_to_write % o_direct_alignment != 0) || (reinterpret_cast<uintptr_t>(data_ptr) % o_direct_memory_alignment != 0);
+  if (codec || (o_direct && (unaligned || (staged_bytes > 0))))
+  {
+    SPDLOG_DEBUG("ska::pst::common::FileWriter::write_data_async bytes_to_write={} staged_bytes={} written synchronously", bytes_to_write, staged_bytes);
+    write_data(data_ptr, bytes_to_write);
+    if (callback)
+    {
+      callback(data_ptr, bytes_to_write, file_offset);
+    }
+    return file_offset;
+  }
+
+  if (compute_checksums)
+  {
+    checksums.update(data_ptr, bytes_to_write);
+  }
+
+  const int write_fd = fd;
+  const bool start_writeout = !o_direct;
+
+  async_queue->write(fd, data_ptr, bytes_to_write, file_offset,
+    [write_fd, start_writeout, callback=std::move(callback)](const char * buffer, uint64_t nbytes, uint64_t offset) {
+      if (start_writeout)
+      {
+        // This won't block, but will start writeout asynchronously
+        sync_file_range(write_fd, safe_signed_cast(offset), safe_signed_cast(nbytes), SYNC_FILE_RANGE_WRITE);
+      }
+      if (callback)
+      {
+        callback(buffer, nbytes, offset);
+      }
+    });
+
+  data_bytes_written += bytes_to_write;
+  uncompressed_bytes_written += bytes_to_write;
+  return file_offset;
+}
+
+void ska::pst::common::FileWriter::wait_for_writes()
+{
+  if (async_queue)
+  {
+    async_queue->wait();
+  }
+}
+
+void ska::pst::common::FileWriter::write_direct(const char * data_ptr, uint64_t bytes_to_write)
+{
+  uint64_t file_offset = header_bytes_written + data_bytes_written - staged_bytes;
+  const char * ptr = data_ptr;
+  uint64_t remaining = bytes_to_write;
+
+  while (remaining > 0)
+  {
+    // write whole blocks directly from the caller's buffer while nothing is staged and the source address is suitably aligned
+    const bool source_aligned = (reinterpret_cast<uintptr_t>(ptr) % o_direct_memory_alignment) == 0;
+    if (staged_bytes == 0 && source_aligned && remaining >= o_direct_alignment)
+    {
+      const uint64_t aligned_bytes = remaining - (remaining % o_direct_alignment);
+      write_at(ptr, aligned_bytes, file_offset);
+      ptr += aligned_bytes; // NOLINT
+      remaining -= aligned_bytes;
+      file_offset += aligned_bytes;
+      continue;
+    }
+
+    // otherwise append to the staging buffer and write all of its whole blocks
+    const uint64_t to_stage = std::min(remaining, staging_bufsz - staged_bytes);
+    memcpy(staging_buffer + staged_bytes, ptr, to_stage); // NOLINT
+    staged_bytes += to_stage;
+    ptr += to_stage; // NOLINT
+    remaining -= to_stage;
+
+    const uint64_t aligned_bytes = staged_bytes - (staged_bytes % o_direct_alignment);
+    if (aligned_bytes > 0)
+    {
+      write_at(staging_buffer, aligned_bytes, file_offset);
+      file_offset += aligned_bytes;
+      staged_bytes -= aligned_bytes;
+      memmove(staging_buffer, staging_buffer + aligned_bytes, staged_bytes); // NOLINT
+    }
+  }
+}
+
+void ska::pst::common::FileWriter::write_at(const char * data_ptr, uint64_t bytes_to_write, uint64_t offset)
+{
+  ssize_t wrote = pwrite(fd, data_ptr, bytes_to_write, safe_signed_cast(offset));
+  if (wrote < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::write_at pwrite({}, {}, {}, {}) failed: {}", fd, reinterpret_cast<const void *>(data_ptr), bytes_to_write, offset, strerror(errno));
+    throw std::runtime_error("ska::pst::common::FileWriter::write_at could not write data to file");
+  }
+
+  if (static_cast<uint64_t>(wrote) != bytes_to_write)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::write_at wrote fewer bytes than expected requested={} actual={}", bytes_to_write, wrote);
+    throw std::runtime_error("ska::pst::common::FileWriter::write_at wrote fewer bytes than expected");
+  }
+}
+
+void ska::pst::common::FileWriter::write_staged_tail()
+{
+  const uint64_t file_size = header_bytes_written + data_bytes_written;
+  const uint64_t padded_bytes = ((staged_bytes + o_direct_alignment - 1) / o_direct_alignment) * o_direct_alignment;
+  SPDLOG_DEBUG("ska::pst::common::FileWriter::write_staged_tail staged_bytes={} padded_bytes={} file_size={}", staged_bytes, padded_bytes, file_size);
+
+  memset(staging_buffer + staged_bytes, 0, padded_bytes - staged_bytes); // NOLINT
+  write_at(staging_buffer, padded_bytes, file_size - staged_bytes);
+  staged_bytes = 0;
+}
+
+void ska::pst::common::FileWriter::preallocate(uint64_t nbytes)
+{
+  SPDLOG_DEBUG("ska::pst::common::FileWriter::preallocate fallocate({}, 0, 0, {})", fd, nbytes);
+  if (fallocate(fd, 0, 0, safe_signed_cast(nbytes)) < 0)
+  {
+    SPDLOG_WARN("ska::pst::common::FileWriter::preallocate fallocate({}, 0, 0, {}) failed: {}, continuing without preallocation", fd, nbytes, strerror(errno));
+    return;
+  }
+  preallocated_bytes = nbytes;
+}
+
+void ska::pst::common::FileWriter::truncate_file()
+{
+  const uint64_t file_size = header_bytes_written + data_bytes_written;
+  SPDLOG_DEBUG("ska::pst::common::FileWriter::truncate_file ftruncate({}, {})", fd, file_size);
+  if (ftruncate(fd, safe_signed_cast(file_size)) < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::truncate_file ftruncate({}, {}) failed: {}", fd, file_size, strerror(errno));
+    throw std::runtime_error("ska::pst::common::FileWriter::truncate_file could not truncate file");
+  }
+}
+
+auto ska::pst::common::FileWriter::compute_file_bytes(const ska::pst::common::AsciiHeader& header, double duration) -> uint64_t
+{
+  if (duration < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::FileWriter::compute_file_bytes duration={} is negative", duration);
+    throw std::runtime_error("ska::pst::common::FileWriter::compute_file_bytes duration is negative");
+  }
+  const auto data_bytes = static_cast<uint64_t>(std::ceil(header.compute_bytes_per_second() * duration));
+  return header.get_uint64("HDR_SIZE") + data_bytes;
+}
@@ -114,12 +114,26 @@ ska::pst::common::HeapLayout::PacketLayout::PacketLayout(const AsciiHeader& data
   assert_equal("NDIM", ndim, 2);
 
   uint32_t nbit = data_config.get_uint32("NBIT");
-  if (nbit != 8 && nbit != 16) // NOLINT
+  if (nbit != 2 && nbit != 4 && nbit != 8 && nbit != 16) // NOLINT
   {
-    SPDLOG_ERROR("ska::pst::common::HeapLayout::PacketLayout ctor expected NBIT=8 or 16, but found {}", nbit);
+    SPDLOG_ERROR("ska::pst::common::HeapLayout::PacketLayout ctor expected NBIT=2, 4, 8 or 16, but found {}", nbit);
     throw std::runtime_error("ska::pst::common::HeapLayout::PacketLayout ctor invalid data_config NBIT");
   }
 
+  // each channel and polarisation of a packet must occupy a whole number of bytes
+  if ((nsamp_per_packet * ndim * nbit) % ska::pst::common::bits_per_byte)
+  {
+    SPDLOG_ERROR("ska::pst::common::HeapLayout::PacketLayout ctor UDP_NSAMP={} samples of NBIT={} do not fill a whole number of bytes", nsamp_per_packet, nbit);
+    throw std::runtime_error("ska::pst::common::HeapLayout::PacketLayout ctor UDP_NSAMP samples do not fill a whole number of bytes");
+  }
+
+  // each block of samples that share a weight must also occupy a whole number of bytes
+  if ((nsamp_per_weight * ndim * nbit) % ska::pst::common::bits_per_byte)
+  {
+    SPDLOG_ERROR("ska::pst::common::HeapLayout::PacketLayout ctor WT_NSAMP={} samples of NBIT={} do not fill a whole number of bytes", nsamp_per_weight, nbit);
+    throw std::runtime_error("ska::pst::common::HeapLayout::PacketLayout ctor WT_NSAMP samples do not fill a whole number of bytes");
+  }
+
   uint32_t weights_npol = weights_config.get_uint32("NPOL");
   assert_equal("NPOL", weights_npol, 1);
 
@@ -33,6 +33,7 @@
 
 #include "ska/pst/common/utils/Time.h"
 #include "ska/pst/common/utils/NormalSequence.h"
+#include "ska/pst/common/utils/PackedSamples.h"
 
 #ifdef DEBUG
 #include <stdio.h>
@@ -94,16 +95,19 @@ auto ska::pst::common::NormalSequence::get_val(std::normal_distribution<float>&
   return static_cast<int16_t>(rintf(std::min(std::max(value, min_val), max_val)));
 }
 
-void ska::pst::common::NormalSequence::generate(char * buffer, uint64_t bufsz)
+void ska::pst::common::NormalSequence::update_red_noise_factor()
 {
-  SPDLOG_TRACE("ska::pst::common::NormalSequence::generate generating {} bytes of normal data", bufsz);
-
   if (red_stddev > 0)
   {
     // update the new red noise factor once per buffer
     std::normal_distribution<float> red_noise_distribution(0, red_stddev);
     new_red_noise_factor = std::abs(red_noise_distribution(red_noise_generator));
   }
+}
+
+void ska::pst::common::NormalSequence::generate(char * buffer, uint64_t bufsz)
+{
+  SPDLOG_TRACE("ska::pst::common::NormalSequence::generate generating {} bytes of normal data", bufsz);
 
   if (nbit == 0)
   {
@@ -112,6 +116,18 @@ void ska::pst::common::NormalSequence::generate(char * buffer, uint64_t bufsz)
   }
 
   uint64_t nval = bufsz * ska::pst::common::bits_per_byte / nbit;
+  if (ska::pst::common::is_packed_nbit(nbit))
+  {
+    // values are generated as 8-bit signed integers in the range of the packed integers
+    unpacked_values.resize(nval);
+    generate_values(unpacked_values.data(), nval);
+    ska::pst::common::pack_values(unpacked_values.data(), nval, nbit, buffer);
+    byte_offset += bufsz;
+    return;
+  }
+
+  update_red_noise_factor();
+
   // floating point values are requantised to signed integers at 8 or 16 bits per sample
   if (nbit == 8) // NOLINT
   {
@@ -124,6 +140,17 @@ void ska::pst::common::NormalSequence::generate(char * buffer, uint64_t bufsz)
   byte_offset += bufsz;
 }
 
+void ska::pst::common::NormalSequence::generate_values(int8_t * out, uint64_t nval)
+{
+  if (nbit == 0 || nbit > ska::pst::common::bits_per_byte)
+  {
+    SPDLOG_ERROR("ska::pst::common::NormalSequence::generate_values nbit={} cannot be stored in 8-bit integers", nbit);
+    throw std::runtime_error("ska::pst::common::NormalSequence::generate_values invalid nbit");
+  }
+  update_red_noise_factor();
+  generate_samples(out, nval);
+}
+
 auto ska::pst::common::NormalSequence::validate(char * buffer, uint64_t bufsz) -> bool
 {
   // generate a new set a data
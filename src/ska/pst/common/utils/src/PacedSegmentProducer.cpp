@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/PacedSegmentProducer.h"
+
+ska::pst::common::PacedSegmentProducer::PacedSegmentProducer(std::shared_ptr<SegmentProducer> _producer, double bytes_per_second, uint64_t spin_nanoseconds) :
+  producer(std::move(_producer)),
+  controller((bytes_per_second > 0) ? bytes_per_second : producer->get_data_header().compute_bytes_per_second(), spin_nanoseconds)
+{
+  SPDLOG_DEBUG("ska::pst::common::PacedSegmentProducer::PacedSegmentProducer bytes_per_second={}", controller.get_bytes_per_second());
+}
+
+auto ska::pst::common::PacedSegmentProducer::get_data_header() const -> const ska::pst::common::AsciiHeader&
+{
+  return producer->get_data_header();
+}
+
+auto ska::pst::common::PacedSegmentProducer::get_weights_header() const -> const ska::pst::common::AsciiHeader&
+{
+  return producer->get_weights_header();
+}
+
+auto ska::pst::common::PacedSegmentProducer::next_segment() -> Segment
+{
+  Segment segment = producer->next_segment();
+  if (segment.data.block != nullptr)
+  {
+    controller.wait(segment.data.size);
+  }
+  return segment;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <array>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/PackedSamples.h"
+#include "ska/pst/common/definitions.h"
+
+namespace {
+
+  //! number of distinct byte values
+  constexpr uint32_t nbyte_values = 256;
+
+  //! lookup tables that expand a byte of packed values of NBIT bits
+  template <uint32_t NBIT>
+  struct PackedTables
+  {
+    //! number of values packed into each byte
+    static constexpr uint32_t nval_per_byte = ska::pst::common::bits_per_byte / NBIT;
+
+    //! number of complex-valued samples packed into each byte
+    static constexpr uint32_t nsamp_per_byte = nval_per_byte / 2;
+
+    //! the signed integers packed into each byte
+    std::array<std::array<int8_t, nval_per_byte>, nbyte_values> values{};
+
+    //! the complex-valued samples packed into each byte
+    std::array<std::array<std::complex<float>, nsamp_per_byte>, nbyte_values> samples{};
+
+    //! the total power of the complex-valued samples packed into each byte
+    std::array<uint32_t, nbyte_values> power{};
+
+    PackedTables()
+    {
+      static constexpr uint32_t mask = (1U << NBIT) - 1;
+      static constexpr uint32_t shift = ska::pst::common::bits_per_byte - NBIT;
+      for (uint32_t byte=0; byte<nbyte_values; byte++)
+      {
+        for (uint32_t ival=0; ival<nval_per_byte; ival++)
+        {
+          // sign extend the NBIT two's complement value
+          const auto bits = static_cast<uint8_t>(((byte >> (ival * NBIT)) & mask) << shift);
+          values[byte][ival] = static_cast<int8_t>(static_cast<int8_t>(bits) >> shift); // NOLINT
+        }
+        power[byte] = 0;
+        for (uint32_t isamp=0; isamp<nsamp_per_byte; isamp++)
+        {
+          const int32_t re = values[byte][2*isamp]; // NOLINT
+          const int32_t im = values[byte][(2*isamp)+1]; // NOLINT
+          samples[byte][isamp] = std::complex<float>(static_cast<float>(re), static_cast<float>(im)); // NOLINT
+          power[byte] += static_cast<uint32_t>((re * re) + (im * im)); // NOLINT
+        }
+      }
+    }
+  };
+
+  template <uint32_t NBIT>
+  auto get_tables() -> const PackedTables<NBIT>&
+  {
+    static const PackedTables<NBIT> tables;
+    return tables;
+  }
+
+  template <uint32_t NBIT>
+  void unpack_values_nbit(const uint8_t * in, uint64_t nval, int8_t * out)
+  {
+    const auto& tables = get_tables<NBIT>();
+    const uint64_t nbyte = nval / PackedTables<NBIT>::nval_per_byte;
+    for (uint64_t ibyte=0; ibyte<nbyte; ibyte++)
+    {
+      const auto& values = tables.values[in[ibyte]]; // NOLINT
+      for (uint32_t ival=0; ival<PackedTables<NBIT>::nval_per_byte; ival++)
+      {
+        *out++ = values[ival]; // NOLINT
+      }
+    }
+  }
+
+  template <uint32_t NBIT>
+  void convert_nbit(const uint8_t * in, uint64_t nsamp, float scale, std::complex<float> * out)
+  {
+    const auto& tables = get_tables<NBIT>();
+    static constexpr uint32_t nsamp_per_byte = PackedTables<NBIT>::nsamp_per_byte;
+    const uint64_t nbyte = nsamp / nsamp_per_byte;
+    for (uint64_t ibyte=0; ibyte<nbyte; ibyte++)
+    {
+      const auto& samples = tables.samples[in[ibyte]]; // NOLINT
+      for (uint32_t isamp=0; isamp<nsamp_per_byte; isamp++)
+      {
+        *out++ = samples[isamp] * scale; // NOLINT
+      }
+    }
+    // samples that only partially fill the last byte
+    const uint64_t remainder = nsamp - (nbyte * nsamp_per_byte);
+    for (uint64_t isamp=0; isamp<remainder; isamp++)
+    {
+      *out++ = tables.samples[in[nbyte]][isamp] * scale; // NOLINT
+    }
+  }
+
+  template <uint32_t NBIT>
+  auto power_nbit(const uint8_t * in, uint64_t nsamp) -> float
+  {
+    const auto& tables = get_tables<NBIT>();
+    static constexpr uint32_t nsamp_per_byte = PackedTables<NBIT>::nsamp_per_byte;
+    const uint64_t nbyte = nsamp / nsamp_per_byte;
+    uint64_t power = 0;
+    for (uint64_t ibyte=0; ibyte<nbyte; ibyte++)
+    {
+      power += tables.power[in[ibyte]]; // NOLINT
+    }
+    const uint64_t remainder = nsamp - (nbyte * nsamp_per_byte);
+    for (uint64_t isamp=0; isamp<remainder; isamp++)
+    {
+      power += static_cast<uint64_t>(std::norm(tables.samples[in[nbyte]][isamp])); // NOLINT
+    }
+    return static_cast<float>(power);
+  }
+
+  void assert_packed_nbit(uint32_t nbit, const char * method)
+  {
+    if (!ska::pst::common::is_packed_nbit(nbit))
+    {
+      SPDLOG_ERROR("ska::pst::common::{} nbit={} is not a packed bit depth", method, nbit);
+      throw std::runtime_error("ska::pst::common::PackedSamples invalid nbit");
+    }
+  }
+
+} // namespace
+
+auto ska::pst::common::is_packed_nbit(uint32_t nbit) -> bool
+{
+  return (nbit == 2 || nbit == 4); // NOLINT
+}
+
+void ska::pst::common::pack_values(const int8_t * in, uint64_t nval, uint32_t nbit, char * out)
+{
+  assert_packed_nbit(nbit, "pack_values");
+  const uint32_t mask = (1U << nbit) - 1;
+  const uint32_t nval_per_byte = bits_per_byte / nbit;
+  const uint64_t nbyte = nval / nval_per_byte;
+  for (uint64_t ibyte=0; ibyte<nbyte; ibyte++)
+  {
+    uint32_t byte = 0;
+    for (uint32_t ival=0; ival<nval_per_byte; ival++)
+    {
+      byte |= (static_cast<uint32_t>(*in++) & mask) << (ival * nbit); // NOLINT
+    }
+    out[ibyte] = static_cast<char>(byte); // NOLINT
+  }
+}
+
+void ska::pst::common::unpack_values(const char * in, uint64_t nval, uint32_t nbit, int8_t * out)
+{
+  assert_packed_nbit(nbit, "unpack_values");
+  if (nbit == 2)
+  {
+    unpack_values_nbit<2>(reinterpret_cast<const uint8_t *>(in), nval, out);
+  }
+  else
+  {
+    unpack_values_nbit<4>(reinterpret_cast<const uint8_t *>(in), nval, out); // NOLINT
+  }
+}
+
+void ska::pst::common::convert_packed_complex_samples(const char * in, uint64_t nsamp, uint32_t nbit, float scale, std::complex<float> * out)
+{
+  if (nbit == 2)
+  {
+    convert_nbit<2>(reinterpret_cast<const uint8_t *>(in), nsamp, scale, out);
+  }
+  else if (nbit == 4) // NOLINT
+  {
+    convert_nbit<4>(reinterpret_cast<const uint8_t *>(in), nsamp, scale, out); // NOLINT
+  }
+  else
+  {
+    assert_packed_nbit(nbit, "convert_packed_complex_samples");
+  }
+}
+
+auto ska::pst::common::sum_packed_complex_power(const char * in, uint64_t nsamp, uint32_t nbit) -> float
+{
+  if (nbit == 2)
+  {
+    return power_nbit<2>(reinterpret_cast<const uint8_t *>(in), nsamp);
+  }
+  if (nbit == 4) // NOLINT
+  {
+    return power_nbit<4>(reinterpret_cast<const uint8_t *>(in), nsamp); // NOLINT
+  }
+  assert_packed_nbit(nbit, "sum_packed_complex_power");
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <array>
+#include <type_traits>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/PacketKernels.h"
+#include "ska/pst/common/utils/UnpackKernels.h"
+
+namespace {
+
+  template <typename T, uint32_t NSAMP, uint32_t NCHAN, uint32_t NPOL>
+  void unpack_packet(const char * in, float scale, std::complex<float> * out, uint64_t samp_stride, uint64_t chan_stride, uint64_t pol_stride)
+  {
+    const auto * samples = reinterpret_cast<const T *>(in); // NOLINT
+    for (uint32_t ipol=0; ipol<NPOL; ipol++)
+    {
+      for (uint32_t ichan=0; ichan<NCHAN; ichan++)
+      {
+        std::complex<float> * chan_out = out + (ichan * chan_stride) + (ipol * pol_stride); // NOLINT
+        for (uint32_t isamp=0; isamp<NSAMP; isamp++)
+        {
+          chan_out[isamp * samp_stride] = std::complex<float>(static_cast<float>(samples[0]) * scale, static_cast<float>(samples[1]) * scale); // NOLINT
+          samples += 2; // NOLINT
+        }
+      }
+    }
+  }
+
+  template <typename T, uint32_t NSAMP, uint32_t NCHAN, uint32_t NPOL>
+  void unpack_packet_tiled(const char * in, float scale, std::complex<float> * out, uint64_t samp_stride, uint64_t chan_stride, uint64_t pol_stride)
+  {
+    // in TFP order the output of a packet is a strided scatter, which the direct kernel performs without the tile
+    if (samp_stride > chan_stride)
+    {
+      unpack_packet<T, NSAMP, NCHAN, NPOL>(in, scale, out, samp_stride, chan_stride, pol_stride);
+      return;
+    }
+
+    // rows of a few samples are too short for the vectorised kernel, which converts the whole packet into a tile
+    // that remains in cache, from which each row is copied to the output
+    std::array<std::complex<float>, NSAMP * NCHAN * NPOL> tile;
+    ska::pst::common::convert_complex_samples(reinterpret_cast<const T *>(in), tile.size(), scale, tile.data()); // NOLINT
+    const std::complex<float> * row = tile.data();
+    for (uint32_t ipol=0; ipol<NPOL; ipol++)
+    {
+      for (uint32_t ichan=0; ichan<NCHAN; ichan++)
+      {
+        std::complex<float> * chan_out = out + (ichan * chan_stride) + (ipol * pol_stride); // NOLINT
+        for (uint32_t isamp=0; isamp<NSAMP; isamp++)
+        {
+          chan_out[isamp * samp_stride] = row[isamp]; // NOLINT
+        }
+        row += NSAMP; // NOLINT
+      }
+    }
+  }
+
+  template <typename T, uint32_t NSAMP, uint32_t NCHAN, uint32_t NPOL>
+  void integrate_packet(const char * in, float scale, float * bandpass)
+  {
+    // the sum of the squared integers in each row is exact, 8-bit rows fit in 32-bit integers
+    using Accumulator = std::conditional_t<sizeof(T) == 1, int32_t, int64_t>;
+    const auto * samples = reinterpret_cast<const T *>(in); // NOLINT
+    for (uint32_t ipol=0; ipol<NPOL; ipol++)
+    {
+      for (uint32_t ichan=0; ichan<NCHAN; ichan++)
+      {
+        Accumulator power = 0;
+        for (uint32_t ival=0; ival<NSAMP*2; ival++)
+        {
+          const auto value = static_cast<Accumulator>(samples[ival]); // NOLINT
+          power += value * value;
+        }
+        bandpass[(ichan * NPOL) + ipol] += static_cast<float>(power) * scale; // NOLINT
+        samples += NSAMP * 2; // NOLINT
+      }
+    }
+  }
+
+  struct Geometry
+  {
+    uint32_t nbit;
+    uint32_t nsamp_per_packet;
+    uint32_t nchan_per_packet;
+    uint32_t npol;
+    ska::pst::common::PacketKernels kernels;
+  };
+
+  template <typename T, uint32_t NSAMP, uint32_t NCHAN, uint32_t NPOL, bool TILED>
+  constexpr auto make_geometry() -> Geometry
+  {
+    constexpr ska::pst::common::UnpackPacketKernel unpack = TILED ? &unpack_packet_tiled<T, NSAMP, NCHAN, NPOL> : &unpack_packet<T, NSAMP, NCHAN, NPOL>;
+    return { sizeof(T) * 8, NSAMP, NCHAN, NPOL, { unpack, &integrate_packet<T, NSAMP, NCHAN, NPOL> } };
+  }
+
+  // the packet geometries of the standard Low and Mid CBF/PSR formats. Mid packets are converted by the vectorised
+  // UnpackKernels into FTP and PFT order; the 32-sample rows of Low packets are vectorised by the compiler and unpacked directly
+  constexpr std::array<Geometry, 3> geometries = {
+    make_geometry<int16_t, 32, 24, 2, false>(), // NOLINT Low
+    make_geometry<int16_t, 4, 185, 2, true>(), // NOLINT Mid 16-bit
+    make_geometry<int8_t, 4, 185, 2, true>(), // NOLINT Mid 8-bit
+  };
+
+} // namespace
+
+auto ska::pst::common::get_packet_kernels(uint32_t nbit, uint32_t nsamp_per_packet, uint32_t nchan_per_packet, uint32_t npol) -> PacketKernels
+{
+  for (const auto& geometry : geometries)
+  {
+    if (geometry.nbit == nbit && geometry.nsamp_per_packet == nsamp_per_packet && geometry.nchan_per_packet == nchan_per_packet && geometry.npol == npol)
+    {
+      SPDLOG_DEBUG("ska::pst::common::get_packet_kernels using kernels specialised for nbit={} nsamp_per_packet={} nchan_per_packet={} npol={}",
+        nbit, nsamp_per_packet, nchan_per_packet, npol);
+      return geometry.kernels;
+    }
+  }
+  SPDLOG_DEBUG("ska::pst::common::get_packet_kernels no kernels specialised for nbit={} nsamp_per_packet={} nchan_per_packet={} npol={}",
+    nbit, nsamp_per_packet, nchan_per_packet, npol);
+  return {};
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <ctime>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/definitions.h"
+#include "ska/pst/common/utils/RateController.h"
+
+ska::pst::common::RateController::RateController(double _bytes_per_second, uint64_t _spin_nanoseconds) :
+  bytes_per_second(_bytes_per_second), spin_nanoseconds(_spin_nanoseconds), lateness_histogram(lateness_bins, 0)
+{
+  if (!(bytes_per_second > 0))
+  {
+    SPDLOG_ERROR("ska::pst::common::RateController::RateController invalid bytes_per_second={}", bytes_per_second);
+    throw std::runtime_error("ska::pst::common::RateController::RateController bytes_per_second must be greater than zero");
+  }
+  SPDLOG_DEBUG("ska::pst::common::RateController::RateController bytes_per_second={} spin_nanoseconds={}", bytes_per_second, spin_nanoseconds);
+}
+
+ska::pst::common::RateController::RateController(const ska::pst::common::AsciiHeader& header, uint64_t _spin_nanoseconds) :
+  RateController(header.compute_bytes_per_second(), _spin_nanoseconds)
+{
+}
+
+auto ska::pst::common::RateController::get_monotonic_nanoseconds() -> uint64_t
+{
+  struct timespec now{};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * nanoseconds_per_second + static_cast<uint64_t>(now.tv_nsec);
+}
+
+void ska::pst::common::RateController::start()
+{
+  start_time = get_monotonic_nanoseconds();
+  started = true;
+  bytes_emitted = 0;
+  deadlines = 0;
+  missed_deadlines = 0;
+  total_lateness = 0;
+  max_lateness = 0;
+  std::fill(lateness_histogram.begin(), lateness_histogram.end(), 0);
+}
+
+void ska::pst::common::RateController::wait(uint64_t nbytes)
+{
+  if (!started)
+  {
+    start();
+  }
+
+  // the deadline is computed from the start of the stream, so that rounding errors do not accumulate
+  bytes_emitted += nbytes;
+  const auto offset = static_cast<uint64_t>(std::llround(static_cast<double>(bytes_emitted) / bytes_per_second * static_cast<double>(nanoseconds_per_second)));
+  const uint64_t deadline = start_time + offset;
+  deadlines++;
+
+  uint64_t now = get_monotonic_nanoseconds();
+  if (now >= deadline)
+  {
+    missed_deadlines++;
+    record(now - deadline);
+    return;
+  }
+
+  // sleep until shortly before the deadline, then spin for the remainder
+  if (deadline - now > spin_nanoseconds)
+  {
+    const uint64_t wake_time = deadline - spin_nanoseconds;
+    struct timespec request{};
+    request.tv_sec = static_cast<time_t>(wake_time / nanoseconds_per_second);
+    request.tv_nsec = static_cast<long>(wake_time % nanoseconds_per_second);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &request, nullptr) == EINTR)
+    {
+      ;
+    }
+  }
+
+  do
+  {
+    now = get_monotonic_nanoseconds();
+  } while (now < deadline);
+
+  record(now - deadline);
+}
+
+void ska::pst::common::RateController::record(uint64_t lateness)
+{
+  total_lateness += lateness;
+  max_lateness = std::max(max_lateness, lateness);
+  lateness_histogram[get_lateness_bin(lateness)]++;
+}
+
+auto ska::pst::common::RateController::get_lateness_bin(uint64_t lateness) -> unsigned
+{
+  uint64_t microseconds = lateness / nanoseconds_per_microsecond;
+  unsigned bin = 0;
+  while (microseconds > 0 && bin < lateness_bins - 1)
+  {
+    microseconds >>= 1U;
+    bin++;
+  }
+  return bin;
+}
+
+auto ska::pst::common::RateController::get_mean_lateness_nanoseconds() const -> double
+{
+  return (deadlines > 0) ? static_cast<double>(total_lateness) / static_cast<double>(deadlines) : 0;
+}
+
+void ska::pst::common::RateController::print_statistics() const
+{
+  SPDLOG_INFO("Deadlines: {} missed: {}", deadlines, missed_deadlines);
+  SPDLOG_INFO("Lateness: mean {} ns, max {} ns", get_mean_lateness_nanoseconds(), max_lateness);
+  for (unsigned bin = 0; bin < lateness_bins; bin++)
+  {
+    if (lateness_histogram[bin] == 0)
+    {
+      continue;
+    }
+    const uint64_t lower = (bin == 0) ? 0 : (1UL << (bin - 1));
+    if (bin == lateness_bins - 1)
+    {
+      SPDLOG_INFO("Lateness >= {} us: {}", lower, lateness_histogram[bin]);
+    }
+    else
+    {
+      SPDLOG_INFO("Lateness [{}, {}) us: {}", lower, 1UL << bin, lateness_histogram[bin]);
+    }
+  }
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "ska/pst/common/utils/ReducedPrecision.h"
+
+namespace {
+
+  auto float_bits(float value) -> uint32_t
+  {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  auto bits_float(uint32_t bits) -> float
+  {
+    float value = 0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+} // namespace
+
+auto ska::pst::common::float_to_int16(float value) -> int16_t
+{
+  static constexpr float lower = std::numeric_limits<int16_t>::min();
+  static constexpr float upper = std::numeric_limits<int16_t>::max();
+  return static_cast<int16_t>(std::lrintf(std::fmin(std::fmax(value, lower), upper)));
+}
+
+auto ska::pst::common::float_to_fp16(float value) -> uint16_t
+{
+  static constexpr uint32_t sign_mask = 0x80000000U;
+  static constexpr uint32_t float_infinity = 0x7f800000U;
+  static constexpr uint32_t half_infinity = 0x7c00U;
+  static constexpr uint32_t half_nan = 0x7e00U;
+  // values of at least 2^16 overflow half precision; smaller values that round up to 2^16 overflow in the exponent
+  static constexpr uint32_t half_overflow = 143U << 23U;
+  // smallest single-precision value that is normal in half precision (2^-14)
+  static constexpr uint32_t half_normal = 113U << 23U;
+  // adding 0.5 shifts the subnormal half-precision mantissa into the least significant bits, rounding to nearest even
+  static constexpr uint32_t subnormal_magic = 126U << 23U;
+  // rebias the exponent from single to half precision
+  static constexpr uint32_t rebias = static_cast<uint32_t>(-112) << 23U;
+  static constexpr uint32_t round_half = 0xfffU;
+  static constexpr uint32_t mantissa_shift = 13;
+
+  uint32_t bits = float_bits(value);
+  const uint32_t sign = bits & sign_mask;
+  bits ^= sign;
+
+  uint32_t half = 0;
+  if (bits >= half_overflow)
+  {
+    half = (bits > float_infinity) ? half_nan : half_infinity;
+  }
+  else if (bits < half_normal)
+  {
+    half = float_bits(bits_float(bits) + bits_float(subnormal_magic)) - subnormal_magic;
+  }
+  else
+  {
+    const uint32_t mantissa_odd = (bits >> mantissa_shift) & 1U;
+    bits += rebias + round_half + mantissa_odd;
+    half = bits >> mantissa_shift;
+  }
+  return static_cast<uint16_t>(half | (sign >> 16U));
+}
+
+auto ska::pst::common::fp16_to_float(uint16_t value) -> float
+{
+  static constexpr uint32_t exponent_mask = 0x1fU;
+  static constexpr uint32_t mantissa_mask = 0x3ffU;
+  static constexpr int subnormal_exponent = -24;
+
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000U) << 16U;
+  const uint32_t exponent = (value >> 10U) & exponent_mask;
+  const uint32_t mantissa = value & mantissa_mask;
+
+  if (exponent == 0)
+  {
+    const float magnitude = std::ldexp(static_cast<float>(mantissa), subnormal_exponent);
+    return (sign != 0) ? -magnitude : magnitude;
+  }
+  if (exponent == exponent_mask)
+  {
+    return bits_float(sign | 0x7f800000U | (mantissa << 13U));
+  }
+  return bits_float(sign | ((exponent + 112U) << 23U) | (mantissa << 13U));
+}
+
+auto ska::pst::common::float_to_bf16(float value) -> uint16_t
+{
+  const uint32_t bits = float_bits(value);
+  if (std::isnan(value))
+  {
+    // preserve the sign and force a quiet NaN
+    return static_cast<uint16_t>((bits >> 16U) | 0x40U);
+  }
+  const uint32_t rounding = 0x7fffU + ((bits >> 16U) & 1U);
+  return static_cast<uint16_t>((bits + rounding) >> 16U);
+}
+
+auto ska::pst::common::bf16_to_float(uint16_t value) -> float
+{
+  return bits_float(static_cast<uint32_t>(value) << 16U);
+}
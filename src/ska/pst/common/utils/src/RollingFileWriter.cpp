@@ -0,0 +1,299 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/RollingFileWriter.h"
+
+ska::pst::common::RollingFileWriter::RollingFileWriter(bool _use_o_direct) :
+  use_o_direct(_use_o_direct)
+{
+}
+
+ska::pst::common::RollingFileWriter::~RollingFileWriter()
+{
+  if (is_open())
+  {
+    try
+    {
+      close();
+    }
+    catch (std::exception& exc)
+    {
+      SPDLOG_WARN("ska::pst::common::RollingFileWriter::~RollingFileWriter close failed: {}", exc.what());
+    }
+  }
+}
+
+void ska::pst::common::RollingFileWriter::set_max_file_bytes(uint64_t nbytes)
+{
+  if (is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::set_max_file_bytes cannot be called while open");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::set_max_file_bytes cannot be called while open");
+  }
+  max_file_bytes = nbytes;
+}
+
+void ska::pst::common::RollingFileWriter::set_max_file_seconds(double seconds)
+{
+  if (is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::set_max_file_seconds cannot be called while open");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::set_max_file_seconds cannot be called while open");
+  }
+  if (seconds < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::set_max_file_seconds seconds={} is negative", seconds);
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::set_max_file_seconds seconds is negative");
+  }
+  max_file_seconds = seconds;
+}
+
+void ska::pst::common::RollingFileWriter::open(const std::filesystem::path& output_dir, const ska::pst::common::AsciiHeader& _header)
+{
+  open(std::vector<std::filesystem::path>{output_dir}, _header);
+}
+
+void ska::pst::common::RollingFileWriter::open(const std::vector<std::filesystem::path>& _output_dirs, const ska::pst::common::AsciiHeader& _header)
+{
+  if (is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::open already open");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::open already open");
+  }
+  if (_output_dirs.empty())
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::open no output directories");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::open no output directories");
+  }
+
+  output_dirs = _output_dirs;
+  header.clone(_header);
+  utc_start = header.get_val("UTC_START");
+  header_size = header.get_uint64("HDR_SIZE");
+  file_number = header.has("FILE_NUMBER") ? header.get_uint64("FILE_NUMBER") : 0;
+  first_file_number = file_number;
+  obs_offset = header.has("OBS_OFFSET") ? header.get_uint64("OBS_OFFSET") : 0;
+
+  // the number of data bytes per file is the smaller of the non-zero thresholds
+  file_data_bytes = max_file_bytes;
+  if (max_file_seconds > 0)
+  {
+    auto duration_bytes = static_cast<uint64_t>(std::floor(header.compute_bytes_per_second() * max_file_seconds));
+    file_data_bytes = (file_data_bytes > 0) ? std::min(file_data_bytes, duration_bytes) : duration_bytes;
+  }
+
+  // each file contains only complete heaps
+  const bool rolling = (max_file_bytes > 0) || (max_file_seconds > 0);
+  if (rolling && header.has("RESOLUTION"))
+  {
+    const uint64_t resolution = header.get_uint64("RESOLUTION");
+    file_data_bytes = (file_data_bytes / resolution) * resolution;
+  }
+  if (rolling && file_data_bytes == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::open max_file_bytes={} max_file_seconds={} is less than one heap", max_file_bytes, max_file_seconds);
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::open file size threshold is less than one heap");
+  }
+  SPDLOG_DEBUG("ska::pst::common::RollingFileWriter::open ndirs={} file_data_bytes={}", output_dirs.size(), file_data_bytes);
+
+  data_bytes_written = 0;
+  filenames.clear();
+  current = open_file(file_number, obs_offset);
+  filenames.push_back(current->get_opened_file());
+
+  if (file_data_bytes > 0)
+  {
+    start_background(nullptr);
+  }
+}
+
+auto ska::pst::common::RollingFileWriter::write_data(char * data_ptr, uint64_t data_size) -> ssize_t
+{
+  if (!is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::write_data not open");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::write_data not open");
+  }
+
+  uint64_t bytes_written = 0;
+  while (bytes_written < data_size)
+  {
+    uint64_t bytes_to_write = data_size - bytes_written;
+    if (file_data_bytes > 0)
+    {
+      // switch files only when there are more data to write, so that the last file is never empty
+      if (current->get_data_bytes_written() == file_data_bytes)
+      {
+        roll();
+      }
+      bytes_to_write = std::min(bytes_to_write, file_data_bytes - current->get_data_bytes_written());
+    }
+
+    current->write_data(data_ptr + bytes_written, bytes_to_write); // NOLINT
+    bytes_written += bytes_to_write;
+    data_bytes_written += bytes_to_write;
+  }
+  return static_cast<ssize_t>(bytes_written);
+}
+
+void ska::pst::common::RollingFileWriter::close()
+{
+  if (!is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::close not open");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::close not open");
+  }
+
+  std::exception_ptr error{nullptr};
+  try
+  {
+    join_background();
+  }
+  catch (std::exception& exc)
+  {
+    error = std::current_exception();
+  }
+
+  std::unique_ptr<FileWriter> closing = std::move(current);
+  std::unique_ptr<FileWriter> unused = std::move(next);
+  try
+  {
+    closing->close_file();
+  }
+  catch (std::exception& exc)
+  {
+    if (!error)
+    {
+      error = std::current_exception();
+    }
+  }
+
+  // the prepared next file contains only a header
+  if (unused)
+  {
+    std::filesystem::path unused_file = unused->get_opened_file();
+    SPDLOG_DEBUG("ska::pst::common::RollingFileWriter::close removing unused file {}", unused_file.generic_string());
+    try
+    {
+      unused->close_file();
+    }
+    catch (std::exception& exc)
+    {
+      SPDLOG_WARN("ska::pst::common::RollingFileWriter::close failed to close unused file: {}", exc.what());
+    }
+    std::filesystem::remove(unused_file);
+  }
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+auto ska::pst::common::RollingFileWriter::open_file(uint64_t number, uint64_t offset) -> std::unique_ptr<FileWriter>
+{
+  ska::pst::common::AsciiHeader file_header(header);
+  file_header.set("FILE_NUMBER", number);
+  file_header.set("OBS_OFFSET", offset);
+
+  const std::filesystem::path& output_dir = output_dirs[(number - first_file_number) % output_dirs.size()];
+  std::filesystem::path filename = output_dir / FileWriter::get_filename(utc_start, offset, number);
+  SPDLOG_DEBUG("ska::pst::common::RollingFileWriter::open_file opening {}", filename.generic_string());
+
+  auto writer = std::make_unique<FileWriter>(use_o_direct);
+  if (preallocate && file_data_bytes > 0)
+  {
+    writer->set_preallocation_bytes(header_size + file_data_bytes);
+  }
+  writer->open_file(filename);
+  writer->write_header(file_header);
+  return writer;
+}
+
+void ska::pst::common::RollingFileWriter::roll()
+{
+  // the next file must be ready before the switch
+  join_background();
+  if (!next)
+  {
+    SPDLOG_ERROR("ska::pst::common::RollingFileWriter::roll next file was not prepared");
+    throw std::runtime_error("ska::pst::common::RollingFileWriter::roll next file was not prepared");
+  }
+
+  std::unique_ptr<FileWriter> previous = std::move(current);
+  current = std::move(next);
+  file_number++;
+  obs_offset += file_data_bytes;
+  filenames.push_back(current->get_opened_file());
+  SPDLOG_DEBUG("ska::pst::common::RollingFileWriter::roll file_number={} obs_offset={}", file_number, obs_offset);
+
+  start_background(std::move(previous));
+}
+
+void ska::pst::common::RollingFileWriter::start_background(std::unique_ptr<FileWriter> previous)
+{
+  const uint64_t next_number = file_number + 1;
+  const uint64_t next_offset = obs_offset + file_data_bytes;
+  background_thread = std::make_unique<std::thread>([this, next_number, next_offset, closing = std::move(previous)]() {
+    try
+    {
+      if (closing)
+      {
+        closing->close_file();
+      }
+      next = open_file(next_number, next_offset);
+    }
+    catch (std::exception& exc)
+    {
+      SPDLOG_ERROR("ska::pst::common::RollingFileWriter::start_background failed: {}", exc.what());
+      background_error = std::current_exception();
+    }
+  });
+}
+
+void ska::pst::common::RollingFileWriter::join_background()
+{
+  if (background_thread)
+  {
+    background_thread->join();
+    background_thread = nullptr;
+  }
+  if (background_error)
+  {
+    std::exception_ptr error = background_error;
+    background_error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
@@ -131,22 +131,16 @@ auto ska::pst::common::SegmentGenerator::next_segment() -> Segment
     throw std::runtime_error("ska::pst::common::SegmentGenerator::next_segment nheap is zero");
   }
 
-  const uint32_t packets_per_heap = layout.get_packets_per_heap();
-  const uint64_t num_packets = nheap * packets_per_heap;
-
   const PacketLayout& packet_layout = layout.get_packet_layout();
 
-  for (auto packet_number = 0; packet_number < num_packets; packet_number++)
+  for (const auto& packet : layout.get_packets(segment.data.block, segment.weights.block, 0, nheap))
   {
-    auto data_offset = packet_number * layout.get_data_packet_stride();
-    auto weights_offset = packet_number * layout.get_weights_packet_stride();
-
-    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::next_segment generating data packet {}", packet_number);
-    generator->fill_data(segment.data.block + data_offset, packet_layout.get_packet_data_size()); // NOLINT
-    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::next_segment generating scales packet {}", packet_number);
-    generator->fill_scales(segment.weights.block + weights_offset + packet_layout.get_packet_scales_offset(), packet_layout.get_packet_scales_size()); // NOLINT
-    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::next_segment generating weights packet {}", packet_number);
-    generator->fill_weights(segment.weights.block + weights_offset + packet_layout.get_packet_weights_offset(), packet_layout.get_packet_weights_size()); // NOLINT
+    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::next_segment generating data packet {}", packet.packet_number);
+    generator->fill_data(packet.data, packet_layout.get_packet_data_size());
+    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::next_segment generating scales packet {}", packet.packet_number);
+    generator->fill_scales(packet.scales, packet_layout.get_packet_scales_size());
+    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::next_segment generating weights packet {}", packet.packet_number);
+    generator->fill_weights(packet.weights, packet_layout.get_packet_weights_size());
   }
 
   return segment;
@@ -160,28 +154,22 @@ auto ska::pst::common::SegmentGenerator::test_segment(const Segment& test) -> bo
     throw std::runtime_error("ska::pst::common::SegmentGenerator::test_segment nheap is zero");
   }
 
-  const uint32_t packets_per_heap = layout.get_packets_per_heap();
-  const uint64_t num_packets = nheap * packets_per_heap;
-
   const PacketLayout& packet_layout = layout.get_packet_layout();
 
-  for (auto packet_number = 0; packet_number < num_packets; packet_number++)
+  for (const auto& packet : layout.get_packets(test.data.block, test.weights.block, 0, nheap))
   {
-    auto data_offset = packet_number * layout.get_data_packet_stride();
-    auto weights_offset = packet_number * layout.get_weights_packet_stride();
-
-    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::test_segment generating data packet {}", packet_number);
-    if (generator->test_data(test.data.block + data_offset, packet_layout.get_packet_data_size()) == false) // NOLINT
+    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::test_segment generating data packet {}", packet.packet_number);
+    if (generator->test_data(packet.data, packet_layout.get_packet_data_size()) == false)
     {
       return false;
     }
-    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::test_segment generating scales packet {}", packet_number);
-    if (generator->test_scales(test.weights.block + weights_offset + packet_layout.get_packet_scales_offset(), packet_layout.get_packet_scales_size()) == false) // NOLINT
+    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::test_segment generating scales packet {}", packet.packet_number);
+    if (generator->test_scales(packet.scales, packet_layout.get_packet_scales_size()) == false)
     {
       return false;
     }
-    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::test_segment generating weights packet {}", packet_number);
-    if (generator->test_weights(test.weights.block + weights_offset + packet_layout.get_packet_weights_offset(), packet_layout.get_packet_weights_size()) == false) // NOLINT
+    SPDLOG_TRACE("ska::pst::common::SegmentGenerator::test_segment generating weights packet {}", packet.packet_number);
+    if (generator->test_weights(packet.weights, packet_layout.get_packet_weights_size()) == false)
     {
       return false;
     }
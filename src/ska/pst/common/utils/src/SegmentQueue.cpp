@@ -0,0 +1,180 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/SegmentQueue.h"
+
+//! number of polls that spin before a waiting thread yields
+static constexpr unsigned spin_polls = 64;
+
+//! number of polls that yield before a waiting thread sleeps
+static constexpr unsigned yield_polls = 128;
+
+//! time that a waiting thread sleeps between polls
+static constexpr std::chrono::microseconds poll_sleep{20};
+
+static void backoff(unsigned poll)
+{
+  if (poll < spin_polls)
+  {
+    return;
+  }
+  if (poll < yield_polls)
+  {
+    std::this_thread::yield();
+    return;
+  }
+  std::this_thread::sleep_for(poll_sleep);
+}
+
+static void copy_block(const ska::pst::common::BlockProducer::Block& source, std::vector<char>& buffer, ska::pst::common::BlockProducer::Block& destination)
+{
+  if (source.block == nullptr)
+  {
+    destination = ska::pst::common::BlockProducer::Block(nullptr, 0, source.obs_offset);
+    return;
+  }
+  if (buffer.size() < source.size)
+  {
+    buffer.resize(source.size);
+  }
+  memcpy(buffer.data(), source.block, source.size);
+  destination = ska::pst::common::BlockProducer::Block(buffer.data(), source.size, source.obs_offset);
+}
+
+void ska::pst::common::SegmentQueue::Slot::assign(const SegmentProducer::Segment& source)
+{
+  copy_block(source.data, data, segment.data);
+  copy_block(source.weights, weights, segment.weights);
+}
+
+ska::pst::common::SegmentQueue::SegmentQueue(size_t nslots, uint64_t _data_bytes, uint64_t _weights_bytes) :
+  data_bytes(_data_bytes),
+  weights_bytes(_weights_bytes)
+{
+  if (nslots == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::SegmentQueue::SegmentQueue nslots must be greater than zero");
+    throw std::runtime_error("ska::pst::common::SegmentQueue::SegmentQueue nslots must be greater than zero");
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::SegmentQueue::SegmentQueue nslots={} data_bytes={} weights_bytes={}", nslots, data_bytes, weights_bytes);
+  slots.resize(nslots);
+  for (auto& slot : slots)
+  {
+    slot.data.resize(data_bytes);
+    slot.weights.resize(weights_bytes);
+  }
+}
+
+auto ska::pst::common::SegmentQueue::open_write_slot() -> Slot *
+{
+  // only the producer modifies head
+  const uint64_t count = head.load(std::memory_order_relaxed);
+  unsigned poll = 0;
+  while (count - tail.load(std::memory_order_acquire) >= slots.size())
+  {
+    if (stopped.load(std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+    if (poll == 0)
+    {
+      write_waits.fetch_add(1, std::memory_order_relaxed);
+    }
+    backoff(poll++);
+  }
+  if (stopped.load(std::memory_order_relaxed))
+  {
+    return nullptr;
+  }
+  return &slots[count % slots.size()];
+}
+
+void ska::pst::common::SegmentQueue::close_write_slot()
+{
+  head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void ska::pst::common::SegmentQueue::signal_end()
+{
+  end.store(true, std::memory_order_release);
+}
+
+auto ska::pst::common::SegmentQueue::open_read_slot() -> Slot *
+{
+  // only the consumer modifies tail
+  const uint64_t count = tail.load(std::memory_order_relaxed);
+  unsigned poll = 0;
+  while (true)
+  {
+    if (stopped.load(std::memory_order_relaxed))
+    {
+      return nullptr;
+    }
+
+    // the end flag is loaded before head, so that a slot published before the end is not missed
+    const bool ended = end.load(std::memory_order_acquire);
+    if (head.load(std::memory_order_acquire) > count)
+    {
+      return &slots[count % slots.size()];
+    }
+    if (ended)
+    {
+      return nullptr;
+    }
+    if (poll == 0)
+    {
+      read_waits.fetch_add(1, std::memory_order_relaxed);
+    }
+    backoff(poll++);
+  }
+}
+
+void ska::pst::common::SegmentQueue::close_read_slot()
+{
+  tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void ska::pst::common::SegmentQueue::stop()
+{
+  stopped.store(true, std::memory_order_relaxed);
+}
+
+auto ska::pst::common::SegmentQueue::get_size() const -> size_t
+{
+  const uint64_t released = tail.load(std::memory_order_acquire);
+  return head.load(std::memory_order_acquire) - released;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/SharedMemoryBlockProducer.h"
+
+ska::pst::common::SharedMemoryBlockProducer::SharedMemoryBlockProducer(const std::string& name, double timeout) :
+  ring(std::make_unique<SharedMemoryRingBuffer>(name))
+{
+  SPDLOG_DEBUG("ska::pst::common::SharedMemoryBlockProducer::SharedMemoryBlockProducer name={} timeout={}", name, timeout);
+  ring->set_timeout(timeout);
+  header = ring->read_header();
+  if (header.has("OBS_OFFSET"))
+  {
+    obs_offset = header.get_uint64("OBS_OFFSET");
+  }
+}
+
+ska::pst::common::SharedMemoryBlockProducer::~SharedMemoryBlockProducer()
+{
+  SPDLOG_DEBUG("ska::pst::common::SharedMemoryBlockProducer::~SharedMemoryBlockProducer");
+  if (holding)
+  {
+    ring->close_read_block();
+  }
+}
+
+auto ska::pst::common::SharedMemoryBlockProducer::get_header() const -> const ska::pst::common::AsciiHeader&
+{
+  return header;
+}
+
+auto ska::pst::common::SharedMemoryBlockProducer::next_block() -> ska::pst::common::BlockProducer::Block
+{
+  if (holding)
+  {
+    ring->close_read_block();
+    holding = false;
+  }
+
+  BlockProducer::Block block = ring->open_read_block();
+  if (block.block == nullptr)
+  {
+    SPDLOG_DEBUG("ska::pst::common::SharedMemoryBlockProducer::next_block end of data after {} blocks", ring->get_read_count());
+    return block;
+  }
+
+  holding = true;
+  block.obs_offset += obs_offset;
+  SPDLOG_TRACE("ska::pst::common::SharedMemoryBlockProducer::next_block obs_offset={} size={}", block.obs_offset, block.size);
+  return block;
+}
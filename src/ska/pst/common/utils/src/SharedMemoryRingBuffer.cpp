@@ -0,0 +1,502 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ska/pst/common/utils/SharedMemoryRingBuffer.h"
+
+//! size of a cache line, which separates the counters updated by the writer and the reader
+static constexpr uint64_t cache_line_bytes = 64;
+
+//! identifies a shared memory segment created by SharedMemoryRingBuffer, the characters SKAPSTRB in little-endian order
+static constexpr uint64_t ring_magic = 0x4252545350414b53;
+
+//! number of polls that spin before a waiting process yields
+static constexpr unsigned spin_polls = 64;
+
+//! number of polls that yield before a waiting process sleeps
+static constexpr unsigned yield_polls = 128;
+
+//! time that a waiting process sleeps between polls
+static constexpr std::chrono::microseconds poll_sleep{20};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory counters must be lock-free");
+
+//! size and position of the data in a slot
+struct Slot
+{
+  //! number of bytes written to the slot
+  uint64_t nbytes;
+
+  //! number of bytes written to the ring before the slot
+  uint64_t offset;
+};
+
+struct ska::pst::common::SharedMemoryRingBuffer::Ring
+{
+  //! number of slots
+  uint64_t nbufs;
+
+  //! size of each slot in bytes
+  uint64_t bufsz;
+
+  //! distance between the base addresses of consecutive slots
+  uint64_t buffer_stride;
+
+  //! offset of the array of Slot from the start of the segment
+  uint64_t slots_offset;
+
+  //! offset of the first slot from the start of the segment
+  uint64_t buffers_offset;
+
+  //! number of slots published by the writer
+  alignas(cache_line_bytes) std::atomic<uint64_t> write_count;
+
+  //! number of bytes published by the writer, accessed only by the writer
+  uint64_t bytes_written;
+
+  //! non-zero while the writer has acquired a slot
+  std::atomic<uint32_t> write_open;
+
+  //! non-zero once the writer has signalled the end of data
+  std::atomic<uint32_t> eod;
+
+  //! number of slots released by the reader
+  alignas(cache_line_bytes) std::atomic<uint64_t> read_count;
+};
+
+struct ska::pst::common::SharedMemoryRingBuffer::Control
+{
+  //! identifies the segment, stored with release semantics once the rest of the control block is initialised
+  std::atomic<uint64_t> magic;
+
+  //! version of the layout of the segment
+  uint64_t version;
+
+  //! size of the segment in bytes
+  uint64_t segment_size;
+
+  //! the header ring
+  Ring header_ring;
+
+  //! the data ring
+  Ring data_ring;
+};
+
+static auto round_up(uint64_t nbytes, uint64_t alignment) -> uint64_t
+{
+  return ((nbytes + alignment - 1) / alignment) * alignment;
+}
+
+static auto get_slots(char * base, const ska::pst::common::SharedMemoryRingBuffer::Ring& ring) -> Slot *
+{
+  return reinterpret_cast<Slot *>(base + ring.slots_offset); // NOLINT
+}
+
+template<typename Predicate>
+static auto wait_until(Predicate ready, double timeout, const std::string& name, const char * method) -> void
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned poll = 0; !ready(); poll++)
+  {
+    if (poll < spin_polls)
+    {
+      continue;
+    }
+    if (poll < yield_polls)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    std::this_thread::sleep_for(poll_sleep);
+    if (timeout > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout)
+    {
+      SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::{} timed out after {} seconds waiting for {}", method, timeout, name);
+      throw std::runtime_error(std::string("ska::pst::common::SharedMemoryRingBuffer::") + method + " timed out");
+    }
+  }
+}
+
+ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer(const std::string& _name, uint64_t nbufs, uint64_t bufsz, uint64_t hdr_nbufs, uint64_t hdr_bufsz) :
+  name(get_shm_name(_name))
+{
+  if (nbufs == 0 || bufsz == 0 || hdr_nbufs == 0 || hdr_bufsz == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer invalid nbufs={} bufsz={} hdr_nbufs={} hdr_bufsz={}", nbufs, bufsz, hdr_nbufs, hdr_bufsz);
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer number and size of slots must be greater than zero");
+  }
+
+  // the control block and slot arrays are followed by page-aligned slots of the header and data rings
+  const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t header_slots_offset = round_up(sizeof(Control), cache_line_bytes);
+  const uint64_t data_slots_offset = header_slots_offset + hdr_nbufs * sizeof(Slot);
+  const uint64_t header_buffers_offset = round_up(data_slots_offset + nbufs * sizeof(Slot), page_size);
+  const uint64_t header_stride = round_up(hdr_bufsz, cache_line_bytes);
+  const uint64_t data_buffers_offset = round_up(header_buffers_offset + hdr_nbufs * header_stride, page_size);
+  const uint64_t data_stride = round_up(bufsz, page_size);
+  const uint64_t nbytes = data_buffers_offset + nbufs * data_stride;
+
+  SPDLOG_DEBUG("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer creating {} nbufs={} bufsz={} hdr_nbufs={} hdr_bufsz={} size={}",
+    name, nbufs, bufsz, hdr_nbufs, hdr_bufsz, nbytes);
+  fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR); // NOLINT
+  if (fd < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer shm_open({}) failed: {}", name, strerror(errno));
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer could not create " + name);
+  }
+  owner = true;
+
+  if (ftruncate(fd, static_cast<off_t>(nbytes)) < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer ftruncate({}, {}) failed: {}", name, nbytes, strerror(errno));
+    ::close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer could not size " + name);
+  }
+  map(nbytes);
+
+  control = new (base) Control{};
+  control->version = layout_version;
+  control->segment_size = nbytes;
+  control->header_ring.nbufs = hdr_nbufs;
+  control->header_ring.bufsz = hdr_bufsz;
+  control->header_ring.buffer_stride = header_stride;
+  control->header_ring.slots_offset = header_slots_offset;
+  control->header_ring.buffers_offset = header_buffers_offset;
+  control->data_ring.nbufs = nbufs;
+  control->data_ring.bufsz = bufsz;
+  control->data_ring.buffer_stride = data_stride;
+  control->data_ring.slots_offset = data_slots_offset;
+  control->data_ring.buffers_offset = data_buffers_offset;
+
+  // the magic is written last, with release semantics, so that a process that attaches sees a complete control block
+  control->magic.store(ring_magic, std::memory_order_release);
+}
+
+ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer(const std::string& _name, double attach_timeout) :
+  name(get_shm_name(_name))
+{
+  SPDLOG_DEBUG("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer attaching to {}", name);
+  fd = shm_open(name.c_str(), O_RDWR, 0); // NOLINT
+  if (fd < 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer shm_open({}) failed: {}", name, strerror(errno));
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer could not open " + name);
+  }
+
+  // the creator may not yet have sized the segment, which is zero bytes until ftruncate completes
+  struct stat statbuf{};
+  try
+  {
+    wait_until([this, &statbuf]() {
+      return fstat(fd, &statbuf) == 0 && static_cast<uint64_t>(statbuf.st_size) >= sizeof(Control);
+    }, attach_timeout, name, "SharedMemoryRingBuffer");
+  }
+  catch (std::exception& exc)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer {} is not a ring buffer: {}", name, exc.what());
+    ::close(fd);
+    fd = -1;
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer invalid segment " + name);
+  }
+  map(static_cast<uint64_t>(statbuf.st_size));
+  control = reinterpret_cast<Control *>(base);
+
+  // the creator may not yet have initialised the control block, which is published by the release store of the magic
+  try
+  {
+    wait_until([this]() { return control->magic.load(std::memory_order_acquire) == ring_magic; }, attach_timeout, name, "SharedMemoryRingBuffer");
+  }
+  catch (std::exception& exc)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer {} control block was not published: {}", name, exc.what());
+  }
+
+  if (control->magic.load(std::memory_order_acquire) != ring_magic || control->version != layout_version || control->segment_size != segment_size)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer {} has an incompatible layout version={} size={}", name, control->version, control->segment_size);
+    munmap(base, segment_size);
+    ::close(fd);
+    fd = -1;
+    base = nullptr;
+    control = nullptr;
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::SharedMemoryRingBuffer incompatible segment " + name);
+  }
+}
+
+ska::pst::common::SharedMemoryRingBuffer::~SharedMemoryRingBuffer()
+{
+  SPDLOG_DEBUG("ska::pst::common::SharedMemoryRingBuffer::~SharedMemoryRingBuffer {} owner={}", name, owner);
+  if (base)
+  {
+    munmap(base, segment_size);
+  }
+  if (fd >= 0)
+  {
+    ::close(fd);
+  }
+  if (owner)
+  {
+    shm_unlink(name.c_str());
+  }
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::map(uint64_t nbytes)
+{
+  void * addr = mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::map mmap({}, {}) failed: {}", name, nbytes, strerror(errno));
+    ::close(fd);
+    fd = -1;
+    if (owner)
+    {
+      shm_unlink(name.c_str());
+    }
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::map could not map " + name);
+  }
+  base = reinterpret_cast<char *>(addr);
+  segment_size = nbytes;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_shm_name(const std::string& name) -> std::string
+{
+  return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_buffer(const Ring& ring, uint64_t count) const -> char *
+{
+  return base + ring.buffers_offset + (count % ring.nbufs) * ring.buffer_stride; // NOLINT
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::wait_for_write(Ring& ring, const char * method) const -> uint64_t
+{
+  const uint64_t count = ring.write_count.load(std::memory_order_relaxed);
+  wait_until([&ring, count]() { return count - ring.read_count.load(std::memory_order_acquire) < ring.nbufs; }, timeout, name, method);
+  return count;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::wait_for_read(Ring& ring, const char * method) const -> bool
+{
+  const uint64_t count = ring.read_count.load(std::memory_order_relaxed);
+  bool available = false;
+  wait_until([&ring, count, &available]() {
+    // the end of data is checked before the counter, so that a slot published before the end of data is not missed
+    const bool eod = ring.eod.load(std::memory_order_acquire) != 0;
+    available = ring.write_count.load(std::memory_order_acquire) > count;
+    return available || eod;
+  }, timeout, name, method);
+  return available;
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::write_header(const ska::pst::common::AsciiHeader& header)
+{
+  Ring& ring = control->header_ring;
+  const std::string raw = header.raw();
+  if (raw.length() >= ring.bufsz)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::write_header header length={} does not fit in hdr_bufsz={}", raw.length(), ring.bufsz);
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::write_header header larger than header slot");
+  }
+
+  const uint64_t count = wait_for_write(ring, "write_header");
+  char * buffer = get_buffer(ring, count);
+  memcpy(buffer, raw.c_str(), raw.length() + 1);
+
+  Slot& slot = get_slots(base, ring)[count % ring.nbufs]; // NOLINT
+  slot.nbytes = raw.length();
+  slot.offset = 0;
+  ring.write_count.store(count + 1, std::memory_order_release);
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::read_header() -> ska::pst::common::AsciiHeader
+{
+  Ring& ring = control->header_ring;
+  if (!wait_for_read(ring, "read_header"))
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::read_header end of data reached before a header was written to {}", name);
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::read_header end of data before header");
+  }
+
+  const uint64_t count = ring.read_count.load(std::memory_order_relaxed);
+  const Slot& slot = get_slots(base, ring)[count % ring.nbufs]; // NOLINT
+  ska::pst::common::AsciiHeader header;
+  header.load_from_string(std::string(get_buffer(ring, count), slot.nbytes));
+  ring.read_count.store(count + 1, std::memory_order_release);
+  return header;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::open_write_block() -> char *
+{
+  if (writing)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::open_write_block a block is already open for writing");
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::open_write_block block already open");
+  }
+
+  Ring& ring = control->data_ring;
+  const uint64_t count = wait_for_write(ring, "open_write_block");
+  ring.write_open.store(1, std::memory_order_relaxed);
+  writing = true;
+  return get_buffer(ring, count);
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::close_write_block(uint64_t nbytes)
+{
+  Ring& ring = control->data_ring;
+  if (!writing || nbytes > ring.bufsz)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::close_write_block writing={} nbytes={} bufsz={}", writing, nbytes, ring.bufsz);
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::close_write_block no block open or nbytes larger than bufsz");
+  }
+
+  const uint64_t count = ring.write_count.load(std::memory_order_relaxed);
+  Slot& slot = get_slots(base, ring)[count % ring.nbufs]; // NOLINT
+  slot.nbytes = nbytes;
+  slot.offset = ring.bytes_written;
+  ring.bytes_written += nbytes;
+  ring.write_open.store(0, std::memory_order_relaxed);
+  ring.write_count.store(count + 1, std::memory_order_release);
+  writing = false;
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::write_block(const char * data, uint64_t nbytes)
+{
+  if (nbytes > get_bufsz())
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::write_block nbytes={} larger than bufsz={}", nbytes, get_bufsz());
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::write_block nbytes larger than bufsz");
+  }
+  char * buffer = open_write_block();
+  memcpy(buffer, data, nbytes);
+  close_write_block(nbytes);
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::signal_eod()
+{
+  if (writing)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::signal_eod a block is open for writing");
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::signal_eod block open for writing");
+  }
+  SPDLOG_DEBUG("ska::pst::common::SharedMemoryRingBuffer::signal_eod {} after {} blocks", name, get_write_count());
+  control->header_ring.eod.store(1, std::memory_order_release);
+  control->data_ring.eod.store(1, std::memory_order_release);
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::open_read_block() -> BlockProducer::Block
+{
+  if (reading)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::open_read_block a block is already open for reading");
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::open_read_block block already open");
+  }
+
+  Ring& ring = control->data_ring;
+  if (!wait_for_read(ring, "open_read_block"))
+  {
+    return {nullptr, 0};
+  }
+
+  const uint64_t count = ring.read_count.load(std::memory_order_relaxed);
+  const Slot& slot = get_slots(base, ring)[count % ring.nbufs]; // NOLINT
+  reading = true;
+  return {get_buffer(ring, count), slot.nbytes, slot.offset};
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::close_read_block()
+{
+  if (!reading)
+  {
+    SPDLOG_ERROR("ska::pst::common::SharedMemoryRingBuffer::close_read_block no block open for reading");
+    throw std::runtime_error("ska::pst::common::SharedMemoryRingBuffer::close_read_block no block open");
+  }
+
+  Ring& ring = control->data_ring;
+  ring.read_count.store(ring.read_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  reading = false;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_nbufs() const -> uint64_t
+{
+  return control->data_ring.nbufs;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_bufsz() const -> uint64_t
+{
+  return control->data_ring.bufsz;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_hdr_bufsz() const -> uint64_t
+{
+  return control->header_ring.bufsz;
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_write_count() const -> uint64_t
+{
+  return control->data_ring.write_count.load(std::memory_order_acquire);
+}
+
+auto ska::pst::common::SharedMemoryRingBuffer::get_read_count() const -> uint64_t
+{
+  return control->data_ring.read_count.load(std::memory_order_acquire);
+}
+
+void ska::pst::common::SharedMemoryRingBuffer::fill(ska::pst::lmc::SmrbStatitics& stats) const
+{
+  const Ring& ring = control->data_ring;
+
+  // the read count is loaded first, so that the number of full slots is never negative
+  const uint64_t read = ring.read_count.load(std::memory_order_acquire);
+  const uint64_t written = ring.write_count.load(std::memory_order_acquire);
+  const auto full = static_cast<uint32_t>(written - read);
+  const auto clear = static_cast<uint32_t>(ring.nbufs) - full;
+  const uint32_t write_open = ring.write_open.load(std::memory_order_relaxed);
+
+  stats.set_nbufs(static_cast<uint32_t>(ring.nbufs));
+  stats.set_bufsz(ring.bufsz);
+  stats.set_written(written);
+  stats.set_read(read);
+  stats.set_full(full);
+  stats.set_clear(clear);
+  stats.set_available(clear - std::min(clear, write_open));
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/SharedMemorySegmentProducer.h"
+
+#include <spdlog/spdlog.h>
+
+ska::pst::common::SharedMemorySegmentProducer::SharedMemorySegmentProducer(
+        const std::string& data_name,
+        const std::string& weights_name,
+        double timeout)
+{
+  SPDLOG_DEBUG("ska::pst::common::SharedMemorySegmentProducer::SharedMemorySegmentProducer data={} weights={}", data_name, weights_name);
+
+  data_ring_producer = std::make_shared<SharedMemoryBlockProducer>(data_name, timeout);
+  weights_ring_producer = std::make_shared<SharedMemoryBlockProducer>(weights_name, timeout);
+  data_block_producer = data_ring_producer;
+  weights_block_producer = weights_ring_producer;
+}
+
+ska::pst::common::SharedMemorySegmentProducer::~SharedMemorySegmentProducer()
+{
+  SPDLOG_DEBUG("ska::pst::common::SharedMemorySegmentProducer::~SharedMemorySegmentProducer()");
+}
+
+void ska::pst::common::SharedMemorySegmentProducer::fill(ska::pst::lmc::SmrbMonitorData& monitor_data) const
+{
+  data_ring_producer->get_ring().fill(*monitor_data.mutable_data());
+  weights_ring_producer->get_ring().fill(*monitor_data.mutable_weights());
+}
@@ -34,6 +34,8 @@
 #include <spdlog/spdlog.h>
 
 #include "ska/pst/common/utils/SineWaveGenerator.h"
+#include "ska/pst/common/utils/PackedSamples.h"
+#include "ska/pst/common/definitions.h"
 
 ska::pst::common::SineWaveGenerator::SineWaveGenerator(std::shared_ptr<ska::pst::common::PacketLayout> _layout) :
   ska::pst::common::ScaleWeightGenerator(std::move(_layout))
@@ -47,6 +49,8 @@ void ska::pst::common::SineWaveGenerator::configure(const ska::pst::common::Asci
   ska::pst::common::ScaleWeightGenerator::configure(config);
 
   // determine the amplitude when nbit == ?
+  //  2 -> -1 to 1
+  //  4 -> -7 to 7
   //  8 -> -127 to  127
   // 12 -> -2047 to 2048
   // 16 -> -32767 to 32767
@@ -92,6 +96,14 @@ void ska::pst::common::SineWaveGenerator::fill_data(char * buf, uint64_t size)
     SPDLOG_TRACE("ska::pst::common::SineWaveGenerator::fill_data fill_complex_data<int16_t>(buf, size)");
     fill_complex_data<int16_t>(buf, size);
   }
+  else if (is_packed_nbit(nbit))
+  {
+    // generate 8-bit values in the range of the packed integers, then pack them into the buffer
+    const uint64_t nval = size * ska::pst::common::bits_per_byte / nbit;
+    unpacked_values.resize(nval);
+    fill_complex_data<int8_t>(reinterpret_cast<char *>(unpacked_values.data()), size);
+    pack_values(unpacked_values.data(), nval, nbit, buf);
+  }
 }
 
 auto ska::pst::common::SineWaveGenerator::test_data(char * buf, uint64_t size) -> bool
@@ -107,6 +119,13 @@ auto ska::pst::common::SineWaveGenerator::test_data(char * buf, uint64_t size) -
     SPDLOG_TRACE("ska::pst::common::SineWaveGenerator::test_data test_complex_data<int16_t>(buf, size)");
     return test_complex_data<int16_t>(buf, size);
   }
+  else if (is_packed_nbit(nbit))
+  {
+    const uint64_t nval = size * ska::pst::common::bits_per_byte / nbit;
+    unpacked_values.resize(nval);
+    unpack_values(buf, nval, nbit, unpacked_values.data());
+    return test_complex_data<int8_t>(reinterpret_cast<char *>(unpacked_values.data()), size);
+  }
   else
   {
     return false;
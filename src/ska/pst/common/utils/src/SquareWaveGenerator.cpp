@@ -29,6 +29,7 @@
  */
 
 #include "ska/pst/common/utils/SquareWaveGenerator.h"
+#include "ska/pst/common/utils/PackedSamples.h"
 #include "ska/pst/common/definitions.h"
 
 #include <spdlog/spdlog.h>
@@ -204,9 +205,17 @@ void ska::pst::common::SquareWaveGenerator::fill_data(char * buf, uint64_t size)
   const uint32_t nbyte_per_sample = ndim * nbit / ska::pst::common::bits_per_byte;
   const uint32_t nbyte_stride = nsamp_per_packet * nbyte_per_sample;
   const uint32_t narray = nchan_per_packet * npol;
-  const uint32_t resolution = narray * nbyte_stride;
+  const uint32_t resolution = narray * nsamp_per_packet * ndim * nbit / ska::pst::common::bits_per_byte;
   const uint32_t nblocks = size / resolution;
 
+  // packed 2 and 4 bit values are generated as 8-bit values and packed once per block
+  const bool packed = is_packed_nbit(nbit);
+  const uint32_t nval_stride = nsamp_per_packet * ndim;
+  if (packed)
+  {
+    unpacked_values.resize(static_cast<size_t>(narray) * nval_stride);
+  }
+
   assert(size % resolution == 0);
 
   SPDLOG_DEBUG("ska::pst::common::SquareWaveGenerator::fill_data nsamp_per_packet={} nchan_per_packet={} size={} resolution={} nblocks={}",
@@ -267,14 +276,27 @@ void ska::pst::common::SquareWaveGenerator::fill_data(char * buf, uint64_t size)
             dat_sequence.set_stddev(on_stddev.at(ipol).at(current_channel+ichan));
           }
 
-          uint32_t offset = (ipol*nchan_per_packet + ichan)*nbyte_stride + isamp*nbyte_per_sample;
-          dat_sequence.generate(buf + offset, nsamp * nbyte_per_sample); // NOLINT
+          if (packed)
+          {
+            uint32_t offset = (ipol*nchan_per_packet + ichan)*nval_stride + isamp*ndim;
+            dat_sequence.generate_values(unpacked_values.data() + offset, nsamp * ndim); // NOLINT
+          }
+          else
+          {
+            uint32_t offset = (ipol*nchan_per_packet + ichan)*nbyte_stride + isamp*nbyte_per_sample;
+            dat_sequence.generate(buf + offset, nsamp * nbyte_per_sample); // NOLINT
+          }
         }
       }
 
       isamp += nsamp;
     }
 
+    if (packed)
+    {
+      pack_values(unpacked_values.data(), unpacked_values.size(), nbit, buf);
+    }
+
     buf += resolution; // NOLINT
 
     current_channel += nchan_per_packet;
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/StatisticsEngine.h"
+#include "ska/pst/common/definitions.h"
+
+void ska::pst::common::StatisticsEngine::configure(const ska::pst::common::AsciiHeader& data_config, const ska::pst::common::AsciiHeader& weights_config)
+{
+  layout.configure(data_config, weights_config);
+  weights_decoder.configure(layout);
+
+  // extract the required parameters from the data header
+  ndim = data_config.get_uint32("NDIM");
+  npol = data_config.get_uint32("NPOL");
+  nbit = data_config.get_uint32("NBIT");
+  nchan = data_config.get_uint32("NCHAN");
+
+  if (ndim != 2)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::configure NDIM={} is not supported", ndim);
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::configure NDIM not supported");
+  }
+  if (nbit != 8 && nbit != 16) // NOLINT
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::configure NBIT={} is not supported", nbit);
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::configure NBIT not supported");
+  }
+
+  nrebin = data_config.has("STAT_NREBIN") ? data_config.get_uint32("STAT_NREBIN") : default_nrebin;
+  req_freq_bins = data_config.has("STAT_REQ_FREQ_BINS") ? data_config.get_uint32("STAT_REQ_FREQ_BINS") : default_nfreq_bins;
+  req_time_bins = data_config.has("STAT_REQ_TIME_BINS") ? data_config.get_uint32("STAT_REQ_TIME_BINS") : default_ntime_bins;
+
+  // the rebinned histograms are formed by shifting the integer states, which requires a power of two number of bins
+  nstates = 1U << nbit;
+  if (nrebin == 0 || nrebin > nstates || (nrebin & (nrebin - 1)) != 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::configure STAT_NREBIN={} must be a power of two no greater than {}", nrebin, nstates);
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::configure invalid STAT_NREBIN");
+  }
+  rebin_shift = 0;
+  while ((nrebin << rebin_shift) < nstates)
+  {
+    rebin_shift++;
+  }
+
+  if (req_freq_bins == 0 || req_time_bins == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::configure STAT_REQ_FREQ_BINS={} and STAT_REQ_TIME_BINS={} must be greater than zero", req_freq_bins, req_time_bins);
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::configure invalid number of frequency or time bins");
+  }
+  nfreq_bins = std::min(req_freq_bins, nchan);
+  freq_bin.resize(nchan);
+  for (uint32_t ichan=0; ichan<nchan; ichan++)
+  {
+    freq_bin[ichan] = static_cast<uint32_t>((static_cast<uint64_t>(ichan) * nfreq_bins) / nchan);
+  }
+
+  channel_mask.assign(nchan, false);
+  hist_set_stride = static_cast<uint64_t>(npol) * ndim * nstates;
+
+  SPDLOG_DEBUG("ska::pst::common::StatisticsEngine::configure nchan={} npol={} nbit={} nrebin={} nfreq_bins={} req_time_bins={}",
+    nchan, npol, nbit, nrebin, nfreq_bins, req_time_bins);
+}
+
+void ska::pst::common::StatisticsEngine::set_channel_mask(const std::vector<bool>& mask)
+{
+  if (mask.size() != nchan)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::set_channel_mask mask.size() [{}] did not match nchan [{}]", mask.size(), nchan);
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::set_channel_mask size of mask did not match nchan");
+  }
+  channel_mask = mask;
+}
+
+void ska::pst::common::StatisticsEngine::reset(uint64_t nsamp)
+{
+  ntime_bins = static_cast<uint32_t>(std::min(static_cast<uint64_t>(req_time_bins), nsamp));
+  time_bin.resize(nsamp);
+  for (uint64_t isamp=0; isamp<nsamp; isamp++)
+  {
+    time_bin[isamp] = static_cast<uint32_t>((isamp * ntime_bins) / nsamp);
+  }
+
+  const uint64_t npol_chan = static_cast<uint64_t>(npol) * nchan;
+  const uint64_t npol_dim_chan = npol_chan * ndim;
+  chan_nsamp.assign(nchan, 0);
+  sum.assign(npol_dim_chan, 0);
+  sumsq.assign(npol_dim_chan, 0);
+  clipped.assign(npol_dim_chan, 0);
+  spectral_power_sum.assign(npol_chan, 0);
+  max_spectral_power.assign(npol_chan, 0);
+  histogram.assign(nsets * hist_set_stride, 0);
+  rebinned_2d.assign(static_cast<uint64_t>(nsets) * npol * nrebin * nrebin, 0);
+  spectrogram.assign(static_cast<uint64_t>(npol) * nfreq_bins * ntime_bins, 0);
+
+  const uint64_t ntimeseries_bins = static_cast<uint64_t>(nsets) * npol * ntime_bins;
+  timeseries.resize(ntimeseries_bins * ntimeseries_values);
+  for (uint64_t ibin=0; ibin<ntimeseries_bins; ibin++)
+  {
+    timeseries[(ibin * ntimeseries_values) + 0] = -std::numeric_limits<float>::max();
+    timeseries[(ibin * ntimeseries_values) + 1] = std::numeric_limits<float>::max();
+    timeseries[(ibin * ntimeseries_values) + 2] = 0;
+  }
+  timeseries_count.assign(ntimeseries_bins, 0);
+
+  invalid_packets = 0;
+}
+
+void ska::pst::common::StatisticsEngine::compute(char * data, uint64_t data_bufsz, char * weights, uint64_t weights_bufsz, ska::pst::lmc::StatMonitorData& stats)
+{
+  SPDLOG_DEBUG("ska::pst::common::StatisticsEngine::compute data={} data_bufsz={} weights={} weights_bufsz={}",
+    reinterpret_cast<void*>(data), data_bufsz, reinterpret_cast<void *>(weights), weights_bufsz);
+
+  if (nchan == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::compute not configured");
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::compute not configured");
+  }
+
+  const uint32_t nheaps = data_bufsz / layout.get_data_heap_stride();
+  const uint64_t nsamp = static_cast<uint64_t>(nheaps) * layout.get_packet_layout().get_samples_per_packet();
+  if (nsamp == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::compute data_bufsz={} is smaller than a heap [{}]", data_bufsz, layout.get_data_heap_stride());
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::compute data_bufsz is smaller than a heap");
+  }
+  const uint64_t weights_nbytes = static_cast<uint64_t>(nheaps) * layout.get_weights_heap_stride();
+  if (weights_bufsz < weights_nbytes)
+  {
+    SPDLOG_ERROR("ska::pst::common::StatisticsEngine::compute weights_bufsz={} is less than the weights size of {} heaps [{}]", weights_bufsz, nheaps, weights_nbytes);
+    throw std::runtime_error("ska::pst::common::StatisticsEngine::compute weights_bufsz is smaller than the weights of the data heaps");
+  }
+
+  reset(nsamp);
+
+  weights_decoder.decode(weights, nheaps);
+  if (nbit == 8) // NOLINT
+  {
+    accumulate_samples(reinterpret_cast<int8_t*>(data), nheaps);
+  }
+  else if (nbit == 16) // NOLINT
+  {
+    accumulate_samples(reinterpret_cast<int16_t*>(data), nheaps);
+  }
+
+  if (invalid_packets > 0)
+  {
+    SPDLOG_WARN("ska::pst::common::StatisticsEngine::compute found {} dropped packets", invalid_packets);
+  }
+
+  fill(stats);
+}
+
+void ska::pst::common::StatisticsEngine::fill(ska::pst::lmc::StatMonitorData& stats)
+{
+  stats.Clear();
+
+  // per channel products and frequency averaged products, with and without the flagged channels
+  for (uint32_t ipol=0; ipol<npol; ipol++)
+  {
+    for (uint32_t idim=0; idim<ndim; idim++)
+    {
+      double total_sum[nsets] = {0, 0};
+      double total_sumsq[nsets] = {0, 0};
+      uint64_t total_nsamp[nsets] = {0, 0};
+      uint64_t total_clipped[nsets] = {0, 0};
+      for (uint32_t ichan=0; ichan<nchan; ichan++)
+      {
+        const uint64_t idx = index_pol_dim_chan(ipol, idim, ichan);
+        const uint64_t count = chan_nsamp[ichan];
+        const double mean = (count > 0) ? sum[idx] / static_cast<double>(count) : 0;
+        const double variance = (count > 1) ? (sumsq[idx] - (sum[idx] * mean)) / static_cast<double>(count - 1) : 0;
+        stats.add_mean_spectrum(static_cast<float>(mean));
+        stats.add_variance_spectrum(static_cast<float>(variance));
+        stats.add_num_clipped_samples_spectrum(clipped[idx]);
+
+        const unsigned set = channel_mask[ichan] ? flagged : clean;
+        total_sum[set] += sum[idx];
+        total_sumsq[set] += sumsq[idx];
+        total_nsamp[set] += count;
+        total_clipped[set] += clipped[idx];
+      }
+
+      auto mean_variance = [](double sum, double sumsq, uint64_t count) {
+        const double mean = (count > 0) ? sum / static_cast<double>(count) : 0;
+        const double variance = (count > 1) ? (sumsq - (sum * mean)) / static_cast<double>(count - 1) : 0;
+        return std::make_pair(static_cast<float>(mean), static_cast<float>(variance));
+      };
+
+      auto all = mean_variance(total_sum[clean] + total_sum[flagged], total_sumsq[clean] + total_sumsq[flagged], total_nsamp[clean] + total_nsamp[flagged]);
+      auto masked = mean_variance(total_sum[clean], total_sumsq[clean], total_nsamp[clean]);
+      stats.add_mean_frequency_avg(all.first);
+      stats.add_variance_frequency_avg(all.second);
+      stats.add_mean_frequency_avg_masked(masked.first);
+      stats.add_variance_frequency_avg_masked(masked.second);
+      stats.add_num_clipped_samples(static_cast<uint32_t>(total_clipped[clean] + total_clipped[flagged]));
+      stats.add_num_clipped_samples_masked(static_cast<uint32_t>(total_clipped[clean]));
+
+      // the 1D histograms and their rebinned counterparts are derived from the clean and flagged histograms
+      const uint32_t * hist_clean = &histogram[index_hist(clean, ipol, idim)];
+      const uint32_t * hist_flagged = &histogram[index_hist(flagged, ipol, idim)];
+      std::vector<uint32_t> rebinned(nrebin, 0);
+      std::vector<uint32_t> rebinned_masked(nrebin, 0);
+      for (uint32_t istate=0; istate<nstates; istate++)
+      {
+        stats.add_histogram_1d_freq_avg(hist_clean[istate] + hist_flagged[istate]); // NOLINT
+        stats.add_histogram_1d_freq_avg_masked(hist_clean[istate]); // NOLINT
+        rebinned[istate >> rebin_shift] += hist_clean[istate] + hist_flagged[istate]; // NOLINT
+        rebinned_masked[istate >> rebin_shift] += hist_clean[istate]; // NOLINT
+      }
+      for (uint32_t ibin=0; ibin<nrebin; ibin++)
+      {
+        stats.add_histogram_rebinned_1d_freq_avg(rebinned[ibin]);
+        stats.add_histogram_rebinned_1d_freq_avg_masked(rebinned_masked[ibin]);
+      }
+    }
+
+    for (uint32_t ichan=0; ichan<nchan; ichan++)
+    {
+      const uint64_t idx = index_pol_chan(ipol, ichan);
+      const uint64_t count = chan_nsamp[ichan];
+      stats.add_mean_spectral_power((count > 0) ? spectral_power_sum[idx] / static_cast<float>(count) : 0);
+      stats.add_max_spectral_power(max_spectral_power[idx]);
+    }
+
+    const uint32_t * rebinned_2d_clean = &rebinned_2d[index_rebinned_2d(clean, ipol)];
+    const uint32_t * rebinned_2d_flagged = &rebinned_2d[index_rebinned_2d(flagged, ipol)];
+    const uint64_t nrebin_2d = static_cast<uint64_t>(nrebin) * nrebin;
+    for (uint64_t ibin=0; ibin<nrebin_2d; ibin++)
+    {
+      stats.add_histogram_rebinned_2d_freq_avg(rebinned_2d_clean[ibin] + rebinned_2d_flagged[ibin]); // NOLINT
+      stats.add_histogram_rebinned_2d_freq_avg_masked(rebinned_2d_clean[ibin]); // NOLINT
+    }
+
+    const uint64_t nspectrogram = static_cast<uint64_t>(nfreq_bins) * ntime_bins;
+    const float * pol_spectrogram = &spectrogram[index_spectrogram(ipol, 0, 0)];
+    for (uint64_t ibin=0; ibin<nspectrogram; ibin++)
+    {
+      stats.add_spectrogram(pol_spectrogram[ibin]); // NOLINT
+    }
+
+    // the timeseries combines the clean and flagged channels, the masked timeseries only the clean channels
+    for (uint32_t itime=0; itime<ntime_bins; itime++)
+    {
+      const float * ts_clean = &timeseries[index_timeseries(clean, ipol, itime)];
+      const float * ts_flagged = &timeseries[index_timeseries(flagged, ipol, itime)];
+      const uint64_t count_clean = timeseries_count[index_timeseries_count(clean, ipol, itime)];
+      const uint64_t count_flagged = timeseries_count[index_timeseries_count(flagged, ipol, itime)];
+      const uint64_t count_all = count_clean + count_flagged;
+
+      if (count_all > 0)
+      {
+        stats.add_timeseries(std::max(ts_clean[0], ts_flagged[0])); // NOLINT
+        stats.add_timeseries(std::min(ts_clean[1], ts_flagged[1])); // NOLINT
+        stats.add_timeseries((ts_clean[2] + ts_flagged[2]) / static_cast<float>(count_all)); // NOLINT
+      }
+      else
+      {
+        stats.add_timeseries(0);
+        stats.add_timeseries(0);
+        stats.add_timeseries(0);
+      }
+
+      if (count_clean > 0)
+      {
+        stats.add_timeseries_masked(ts_clean[0]); // NOLINT
+        stats.add_timeseries_masked(ts_clean[1]); // NOLINT
+        stats.add_timeseries_masked(ts_clean[2] / static_cast<float>(count_clean)); // NOLINT
+      }
+      else
+      {
+        stats.add_timeseries_masked(0);
+        stats.add_timeseries_masked(0);
+        stats.add_timeseries_masked(0);
+      }
+    }
+  }
+}
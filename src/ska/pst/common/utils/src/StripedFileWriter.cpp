@@ -0,0 +1,278 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/StripedFileWriter.h"
+
+ska::pst::common::StripedFileWriter::StripedFileWriter(bool _use_o_direct) :
+  use_o_direct(_use_o_direct)
+{
+}
+
+ska::pst::common::StripedFileWriter::~StripedFileWriter()
+{
+  if (is_open())
+  {
+    try
+    {
+      close();
+    }
+    catch (std::exception& exc)
+    {
+      SPDLOG_WARN("ska::pst::common::StripedFileWriter::~StripedFileWriter close failed: {}", exc.what());
+    }
+  }
+}
+
+void ska::pst::common::StripedFileWriter::set_stripe_bytes(uint64_t nbytes)
+{
+  if (is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::set_stripe_bytes cannot be called while open");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::set_stripe_bytes cannot be called while open");
+  }
+  requested_stripe_bytes = nbytes;
+}
+
+void ska::pst::common::StripedFileWriter::set_async_depth(uint32_t depth)
+{
+  if (is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::set_async_depth cannot be called while open");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::set_async_depth cannot be called while open");
+  }
+  async_depth = depth;
+}
+
+void ska::pst::common::StripedFileWriter::open(const std::vector<std::filesystem::path>& output_dirs, const ska::pst::common::AsciiHeader& _header)
+{
+  if (is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::open already open");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::open already open");
+  }
+  if (output_dirs.empty())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::open no output directories");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::open no output directories");
+  }
+
+  std::set<std::filesystem::path> distinct_dirs;
+  for (const auto& output_dir : output_dirs)
+  {
+    if (!distinct_dirs.insert(std::filesystem::weakly_canonical(output_dir)).second)
+    {
+      SPDLOG_ERROR("ska::pst::common::StripedFileWriter::open output directory {} is repeated", output_dir.generic_string());
+      throw std::runtime_error("ska::pst::common::StripedFileWriter::open output directories are not distinct");
+    }
+  }
+
+  header.clone(_header);
+  const std::string utc_start = header.get_val("UTC_START");
+  const uint64_t file_number = header.has("FILE_NUMBER") ? header.get_uint64("FILE_NUMBER") : 0;
+  const uint64_t obs_offset = header.has("OBS_OFFSET") ? header.get_uint64("OBS_OFFSET") : 0;
+  const uint64_t resolution = header.has("RESOLUTION") ? header.get_uint64("RESOLUTION") : 0;
+
+  stripe_bytes = (requested_stripe_bytes > 0) ? requested_stripe_bytes : resolution;
+  if (stripe_bytes == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::open stripe bytes not set and RESOLUTION not defined");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::open stripe bytes not set and RESOLUTION not defined");
+  }
+  if (resolution > 0 && stripe_bytes % resolution != 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::open stripe_bytes={} is not a multiple of RESOLUTION={}", stripe_bytes, resolution);
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::open stripe bytes is not a multiple of RESOLUTION");
+  }
+
+  const auto nstripe = static_cast<uint32_t>(output_dirs.size());
+  SPDLOG_DEBUG("ska::pst::common::StripedFileWriter::open nstripe={} stripe_bytes={} async_depth={}", nstripe, stripe_bytes, async_depth);
+
+  filenames.clear();
+  try
+  {
+    for (uint32_t istripe=0; istripe<nstripe; istripe++)
+    {
+      ska::pst::common::AsciiHeader stripe_header(header);
+      stripe_header.set("NSTRIPE", nstripe);
+      stripe_header.set("STRIPE_INDEX", istripe);
+      stripe_header.set("STRIPE_BYTES", stripe_bytes);
+
+      std::filesystem::path filename = output_dirs[istripe] / FileWriter::get_filename(utc_start, obs_offset, file_number);
+      auto writer = std::make_unique<FileWriter>(use_o_direct);
+      if (async_depth > 0)
+      {
+        writer->set_async_depth(async_depth);
+      }
+      writer->open_file(filename);
+      writer->write_header(stripe_header);
+      writers.push_back(std::move(writer));
+      filenames.push_back(filename);
+    }
+  }
+  catch (std::exception& exc)
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::open failed: {}", exc.what());
+    for (auto& writer : writers)
+    {
+      writer->close_file();
+    }
+    writers.clear();
+    filenames.clear();
+    throw;
+  }
+
+  manifest_filename = output_dirs[0] / get_manifest_filename(utc_start, obs_offset, file_number);
+  data_bytes_written = 0;
+}
+
+auto ska::pst::common::StripedFileWriter::write_data(char * data_ptr, uint64_t data_size) -> ssize_t
+{
+  write_data_async(data_ptr, data_size);
+  wait_for_writes();
+  return static_cast<ssize_t>(data_size);
+}
+
+auto ska::pst::common::StripedFileWriter::write_data_async(char * data_ptr, uint64_t data_size) -> uint64_t
+{
+  if (!is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::write_data_async not open");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::write_data_async not open");
+  }
+
+  const uint64_t stream_offset = data_bytes_written;
+  uint64_t bytes_written = 0;
+  while (bytes_written < data_size)
+  {
+    const uint64_t stripe = data_bytes_written / stripe_bytes;
+    const uint64_t bytes_to_write = std::min(data_size - bytes_written, stripe_bytes - (data_bytes_written % stripe_bytes));
+    auto& writer = writers[stripe % writers.size()];
+    if (async_depth > 0)
+    {
+      writer->write_data_async(data_ptr + bytes_written, bytes_to_write); // NOLINT
+    }
+    else
+    {
+      writer->write_data(data_ptr + bytes_written, bytes_to_write); // NOLINT
+    }
+    bytes_written += bytes_to_write;
+    data_bytes_written += bytes_to_write;
+  }
+  return stream_offset;
+}
+
+void ska::pst::common::StripedFileWriter::wait_for_writes()
+{
+  // wait for every queue before reporting the first error
+  std::exception_ptr error{nullptr};
+  for (auto& writer : writers)
+  {
+    try
+    {
+      writer->wait_for_writes();
+    }
+    catch (std::exception& exc)
+    {
+      if (!error)
+      {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+void ska::pst::common::StripedFileWriter::close()
+{
+  if (!is_open())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::close not open");
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::close not open");
+  }
+
+  std::exception_ptr error{nullptr};
+  for (auto& writer : writers)
+  {
+    try
+    {
+      writer->close_file();
+    }
+    catch (std::exception& exc)
+    {
+      if (!error)
+      {
+        error = std::current_exception();
+      }
+    }
+  }
+  writers.clear();
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+  write_manifest();
+}
+
+void ska::pst::common::StripedFileWriter::write_manifest()
+{
+  ska::pst::common::AsciiHeader manifest(header);
+  manifest.set("NSTRIPE", filenames.size());
+  manifest.set("STRIPE_BYTES", stripe_bytes);
+  manifest.set("DATA_BYTES", data_bytes_written);
+  for (unsigned istripe=0; istripe<filenames.size(); istripe++)
+  {
+    manifest.set("STRIPE_FILE_" + std::to_string(istripe), std::filesystem::absolute(filenames[istripe]).generic_string());
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::StripedFileWriter::write_manifest writing {}", manifest_filename.generic_string());
+  std::ofstream output(manifest_filename);
+  output << manifest.raw();
+  output.close();
+  if (output.fail())
+  {
+    SPDLOG_ERROR("ska::pst::common::StripedFileWriter::write_manifest failed to write {}", manifest_filename.generic_string());
+    throw std::runtime_error("ska::pst::common::StripedFileWriter::write_manifest failed to write " + manifest_filename.generic_string());
+  }
+}
+
+auto ska::pst::common::StripedFileWriter::get_manifest_filename(const std::string& utc_start, uint64_t obs_offset, unsigned file_number) -> std::filesystem::path
+{
+  return FileWriter::get_filename(utc_start, obs_offset, file_number).replace_extension(".manifest");
+}
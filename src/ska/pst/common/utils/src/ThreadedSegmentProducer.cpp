@@ -0,0 +1,127 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/ThreadedSegmentProducer.h"
+
+static auto get_segment_bytes(const ska::pst::common::AsciiHeader& header, uint64_t heaps_per_segment) -> uint64_t
+{
+  return header.has("RESOLUTION") ? heaps_per_segment * header.get_uint64("RESOLUTION") : 0;
+}
+
+ska::pst::common::ThreadedSegmentProducer::ThreadedSegmentProducer(std::shared_ptr<SegmentProducer> _producer, size_t nslots, uint64_t _max_segments, uint64_t heaps_per_segment) :
+  producer(std::move(_producer)),
+  data_header(producer->get_data_header()),
+  weights_header(producer->get_weights_header()),
+  queue(nslots, get_segment_bytes(data_header, heaps_per_segment), get_segment_bytes(weights_header, heaps_per_segment)),
+  max_segments(_max_segments)
+{
+  SPDLOG_DEBUG("ska::pst::common::ThreadedSegmentProducer::ThreadedSegmentProducer nslots={} max_segments={} data_bytes={} weights_bytes={}",
+    nslots, max_segments, queue.get_data_bytes(), queue.get_weights_bytes());
+  thread = std::thread(&ThreadedSegmentProducer::produce_loop, this);
+}
+
+ska::pst::common::ThreadedSegmentProducer::~ThreadedSegmentProducer()
+{
+  SPDLOG_DEBUG("ska::pst::common::ThreadedSegmentProducer::~ThreadedSegmentProducer");
+  queue.stop();
+  if (thread.joinable())
+  {
+    thread.join();
+  }
+}
+
+auto ska::pst::common::ThreadedSegmentProducer::get_data_header() const -> const ska::pst::common::AsciiHeader&
+{
+  return data_header;
+}
+
+auto ska::pst::common::ThreadedSegmentProducer::get_weights_header() const -> const ska::pst::common::AsciiHeader&
+{
+  return weights_header;
+}
+
+auto ska::pst::common::ThreadedSegmentProducer::next_segment() -> Segment
+{
+  if (holding)
+  {
+    queue.close_read_slot();
+    holding = false;
+  }
+
+  SegmentQueue::Slot * slot = queue.open_read_slot();
+  if (slot == nullptr)
+  {
+    if (!error.empty())
+    {
+      throw std::runtime_error("ska::pst::common::ThreadedSegmentProducer::next_segment producer failed: " + error);
+    }
+    return {};
+  }
+
+  holding = true;
+  return slot->segment;
+}
+
+void ska::pst::common::ThreadedSegmentProducer::produce_loop()
+{
+  uint64_t nsegments = 0;
+  try
+  {
+    while (max_segments == 0 || nsegments < max_segments)
+    {
+      SegmentQueue::Slot * slot = queue.open_write_slot();
+      if (slot == nullptr)
+      {
+        SPDLOG_DEBUG("ska::pst::common::ThreadedSegmentProducer::produce_loop stopped after {} segments", nsegments);
+        return;
+      }
+
+      Segment segment = producer->next_segment();
+      if (segment.data.block == nullptr)
+      {
+        break;
+      }
+      slot->assign(segment);
+      queue.close_write_slot();
+      nsegments++;
+    }
+  }
+  catch (const std::exception& exc)
+  {
+    SPDLOG_ERROR("ska::pst::common::ThreadedSegmentProducer::produce_loop producer failed after {} segments: {}", nsegments, exc.what());
+    error = exc.what();
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::ThreadedSegmentProducer::produce_loop end of data after {} segments", nsegments);
+  queue.signal_end();
+}
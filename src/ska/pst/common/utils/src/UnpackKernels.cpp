@@ -0,0 +1,494 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SKA_PST_COMMON_UNPACK_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#include "ska/pst/common/utils/UnpackKernels.h"
+
+namespace {
+
+  //! Narrow single-precision values to 16-bit integers
+  struct ToInt16
+  {
+    using type = int16_t;
+    static auto narrow(float value) -> int16_t { return ska::pst::common::float_to_int16(value); }
+  };
+
+  //! Narrow single-precision values to half precision
+  struct ToFP16
+  {
+    using type = uint16_t;
+    static auto narrow(float value) -> uint16_t { return ska::pst::common::float_to_fp16(value); }
+  };
+
+  //! Narrow single-precision values to bfloat16
+  struct ToBF16
+  {
+    using type = uint16_t;
+    static auto narrow(float value) -> uint16_t { return ska::pst::common::float_to_bf16(value); }
+  };
+
+  template <typename T>
+  void convert_scalar(const T * in, uint64_t nval, float scale, float * out)
+  {
+    for (uint64_t i=0; i<nval; i++)
+    {
+      out[i] = static_cast<float>(in[i]) * scale; // NOLINT
+    }
+  }
+
+  template <typename T>
+  auto power_scalar(const T * in, uint64_t nval) -> float
+  {
+    float sum = 0;
+    for (uint64_t i=0; i<nval; i++)
+    {
+      const auto value = static_cast<float>(in[i]); // NOLINT
+      sum += value * value;
+    }
+    return sum;
+  }
+
+  template <typename T, typename Narrow>
+  void narrow_scalar(const T * in, uint64_t nval, float scale, typename Narrow::type * out)
+  {
+    for (uint64_t i=0; i<nval; i++)
+    {
+      out[i] = Narrow::narrow(static_cast<float>(in[i]) * scale); // NOLINT
+    }
+  }
+
+#ifdef SKA_PST_COMMON_UNPACK_KERNELS_X86
+
+  // 8 values per iteration: sign extend to 32-bit integers, convert to float and scale
+  __attribute__((target("avx2,fma")))
+  void convert_int8_avx2(const int8_t * in, uint64_t nval, float scale, float * out)
+  {
+    static constexpr uint64_t width = 8;
+    const __m256 vscale = _mm256_set1_ps(scale);
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i)); // NOLINT
+      __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(packed));
+      _mm256_storeu_ps(out + i, _mm256_mul_ps(values, vscale)); // NOLINT
+    }
+    convert_scalar(in + i, nval - i, scale, out + i); // NOLINT
+  }
+
+  __attribute__((target("avx2,fma")))
+  void convert_int16_avx2(const int16_t * in, uint64_t nval, float scale, float * out)
+  {
+    static constexpr uint64_t width = 8;
+    const __m256 vscale = _mm256_set1_ps(scale);
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)); // NOLINT
+      __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed));
+      _mm256_storeu_ps(out + i, _mm256_mul_ps(values, vscale)); // NOLINT
+    }
+    convert_scalar(in + i, nval - i, scale, out + i); // NOLINT
+  }
+
+  __attribute__((target("avx2,fma")))
+  auto horizontal_sum_avx2(__m256 acc) -> float
+  {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    return _mm_cvtss_f32(sum);
+  }
+
+  __attribute__((target("avx2,fma")))
+  auto power_int8_avx2(const int8_t * in, uint64_t nval) -> float
+  {
+    static constexpr uint64_t width = 8;
+    __m256 acc = _mm256_setzero_ps();
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i)); // NOLINT
+      __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(packed));
+      acc = _mm256_fmadd_ps(values, values, acc);
+    }
+    return horizontal_sum_avx2(acc) + power_scalar(in + i, nval - i); // NOLINT
+  }
+
+  __attribute__((target("avx2,fma")))
+  auto power_int16_avx2(const int16_t * in, uint64_t nval) -> float
+  {
+    static constexpr uint64_t width = 8;
+    __m256 acc = _mm256_setzero_ps();
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)); // NOLINT
+      __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed));
+      acc = _mm256_fmadd_ps(values, values, acc);
+    }
+    return horizontal_sum_avx2(acc) + power_scalar(in + i, nval - i); // NOLINT
+  }
+
+  // load 8 values and convert them to single precision
+  __attribute__((target("avx2,fma")))
+  inline auto load_avx2(const int8_t * in) -> __m256
+  {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(in)))); // NOLINT
+  }
+
+  __attribute__((target("avx2,fma")))
+  inline auto load_avx2(const int16_t * in) -> __m256
+  {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)))); // NOLINT
+  }
+
+  // clamp to the limits of int16_t, round to nearest and pack with signed saturation
+  __attribute__((target("avx2,fma")))
+  inline void store_avx2(ToInt16 /*unused*/, __m256 values, int16_t * out)
+  {
+    static constexpr float lower = -32768.0;
+    static constexpr float upper = 32767.0;
+    values = _mm256_min_ps(_mm256_max_ps(values, _mm256_set1_ps(lower)), _mm256_set1_ps(upper));
+    __m256i integers = _mm256_cvtps_epi32(values);
+    __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), packed); // NOLINT
+  }
+
+  __attribute__((target("avx2,fma,f16c")))
+  inline void store_avx2(ToFP16 /*unused*/, __m256 values, uint16_t * out)
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); // NOLINT
+  }
+
+  // round to nearest even by adding 0x7fff plus the least significant retained bit, then keep the upper 16 bits
+  __attribute__((target("avx2,fma")))
+  inline void store_avx2(ToBF16 /*unused*/, __m256 values, uint16_t * out)
+  {
+    static constexpr int round_half = 0x7fff;
+    __m256i bits = _mm256_castps_si256(values);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    bits = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(round_half))), 16);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), packed); // NOLINT
+  }
+
+  template <typename T, typename Narrow>
+  __attribute__((target("avx2,fma,f16c")))
+  void narrow_avx2(const T * in, uint64_t nval, float scale, typename Narrow::type * out)
+  {
+    static constexpr uint64_t width = 8;
+    const __m256 vscale = _mm256_set1_ps(scale);
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      store_avx2(Narrow(), _mm256_mul_ps(load_avx2(in + i), vscale), out + i); // NOLINT
+    }
+    narrow_scalar<T, Narrow>(in + i, nval - i, scale, out + i); // NOLINT
+  }
+
+  // GCC 12 reports the _mm512_undefined_* operands of the AVX-512 intrinsics as uninitialised (GCC bug 105593)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+  // 16 values per iteration: sign extend to 32-bit integers, convert to float and scale
+  __attribute__((target("avx512f")))
+  void convert_int8_avx512(const int8_t * in, uint64_t nval, float scale, float * out)
+  {
+    static constexpr uint64_t width = 16;
+    const __m512 vscale = _mm512_set1_ps(scale);
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)); // NOLINT
+      __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(packed));
+      _mm512_storeu_ps(out + i, _mm512_mul_ps(values, vscale)); // NOLINT
+    }
+    convert_scalar(in + i, nval - i, scale, out + i); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  void convert_int16_avx512(const int16_t * in, uint64_t nval, float scale, float * out)
+  {
+    static constexpr uint64_t width = 16;
+    const __m512 vscale = _mm512_set1_ps(scale);
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)); // NOLINT
+      __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(packed));
+      _mm512_storeu_ps(out + i, _mm512_mul_ps(values, vscale)); // NOLINT
+    }
+    convert_scalar(in + i, nval - i, scale, out + i); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  auto power_int8_avx512(const int8_t * in, uint64_t nval) -> float
+  {
+    static constexpr uint64_t width = 16;
+    __m512 acc = _mm512_setzero_ps();
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)); // NOLINT
+      __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(packed));
+      acc = _mm512_fmadd_ps(values, values, acc);
+    }
+    return _mm512_reduce_add_ps(acc) + power_scalar(in + i, nval - i); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  auto power_int16_avx512(const int16_t * in, uint64_t nval) -> float
+  {
+    static constexpr uint64_t width = 16;
+    __m512 acc = _mm512_setzero_ps();
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i)); // NOLINT
+      __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(packed));
+      acc = _mm512_fmadd_ps(values, values, acc);
+    }
+    return _mm512_reduce_add_ps(acc) + power_scalar(in + i, nval - i); // NOLINT
+  }
+
+  // load 16 values and convert them to single precision
+  __attribute__((target("avx512f")))
+  inline auto load_avx512(const int8_t * in) -> __m512
+  {
+    return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)))); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  inline auto load_avx512(const int16_t * in) -> __m512
+  {
+    return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in)))); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  inline void store_avx512(ToInt16 /*unused*/, __m512 values, int16_t * out)
+  {
+    static constexpr float lower = -32768.0;
+    static constexpr float upper = 32767.0;
+    values = _mm512_min_ps(_mm512_max_ps(values, _mm512_set1_ps(lower)), _mm512_set1_ps(upper));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm512_cvtsepi32_epi16(_mm512_cvtps_epi32(values))); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  inline void store_avx512(ToFP16 /*unused*/, __m512 values, uint16_t * out)
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm512_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)); // NOLINT
+  }
+
+  __attribute__((target("avx512f")))
+  inline void store_avx512(ToBF16 /*unused*/, __m512 values, uint16_t * out)
+  {
+    static constexpr int round_half = 0x7fff;
+    __m512i bits = _mm512_castps_si512(values);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+    bits = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(round_half))), 16);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm512_cvtepi32_epi16(bits)); // NOLINT
+  }
+
+  template <typename T, typename Narrow>
+  __attribute__((target("avx512f")))
+  void narrow_avx512(const T * in, uint64_t nval, float scale, typename Narrow::type * out)
+  {
+    static constexpr uint64_t width = 16;
+    const __m512 vscale = _mm512_set1_ps(scale);
+    uint64_t i = 0;
+    for (; i + width <= nval; i += width)
+    {
+      store_avx512(Narrow(), _mm512_mul_ps(load_avx512(in + i), vscale), out + i); // NOLINT
+    }
+    narrow_scalar<T, Narrow>(in + i, nval - i, scale, out + i); // NOLINT
+  }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SKA_PST_COMMON_UNPACK_KERNELS_X86
+
+  //! Table of kernels implemented for a single SimdLevel
+  struct Kernels
+  {
+    void (*convert_int8)(const int8_t *, uint64_t, float, float *);
+    void (*convert_int16)(const int16_t *, uint64_t, float, float *);
+    float (*power_int8)(const int8_t *, uint64_t);
+    float (*power_int16)(const int16_t *, uint64_t);
+    void (*int16_int8)(const int8_t *, uint64_t, float, int16_t *);
+    void (*int16_int16)(const int16_t *, uint64_t, float, int16_t *);
+    void (*fp16_int8)(const int8_t *, uint64_t, float, uint16_t *);
+    void (*fp16_int16)(const int16_t *, uint64_t, float, uint16_t *);
+    void (*bf16_int8)(const int8_t *, uint64_t, float, uint16_t *);
+    void (*bf16_int16)(const int16_t *, uint64_t, float, uint16_t *);
+  };
+
+  //! Kernels indexed by SimdLevel
+  const Kernels kernels[] = { // NOLINT
+    { convert_scalar<int8_t>, convert_scalar<int16_t>, power_scalar<int8_t>, power_scalar<int16_t>,
+      narrow_scalar<int8_t, ToInt16>, narrow_scalar<int16_t, ToInt16>, narrow_scalar<int8_t, ToFP16>,
+      narrow_scalar<int16_t, ToFP16>, narrow_scalar<int8_t, ToBF16>, narrow_scalar<int16_t, ToBF16> },
+#ifdef SKA_PST_COMMON_UNPACK_KERNELS_X86
+    { convert_int8_avx2, convert_int16_avx2, power_int8_avx2, power_int16_avx2,
+      narrow_avx2<int8_t, ToInt16>, narrow_avx2<int16_t, ToInt16>, narrow_avx2<int8_t, ToFP16>,
+      narrow_avx2<int16_t, ToFP16>, narrow_avx2<int8_t, ToBF16>, narrow_avx2<int16_t, ToBF16> },
+    { convert_int8_avx512, convert_int16_avx512, power_int8_avx512, power_int16_avx512,
+      narrow_avx512<int8_t, ToInt16>, narrow_avx512<int16_t, ToInt16>, narrow_avx512<int8_t, ToFP16>,
+      narrow_avx512<int16_t, ToFP16>, narrow_avx512<int8_t, ToBF16>, narrow_avx512<int16_t, ToBF16> },
+#endif
+  };
+
+  auto detect_simd_level() -> ska::pst::common::SimdLevel
+  {
+#ifdef SKA_PST_COMMON_UNPACK_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+      return ska::pst::common::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c"))
+    {
+      return ska::pst::common::AVX2;
+    }
+#endif
+    return ska::pst::common::Scalar;
+  }
+
+  auto selected_level() -> std::atomic<ska::pst::common::SimdLevel>&
+  {
+    static std::atomic<ska::pst::common::SimdLevel> level{ska::pst::common::get_supported_simd_level()};
+    return level;
+  }
+
+  auto selected_kernels() -> const Kernels&
+  {
+    return kernels[selected_level().load(std::memory_order_relaxed)]; // NOLINT
+  }
+
+} // namespace
+
+auto ska::pst::common::get_supported_simd_level() -> SimdLevel
+{
+  static const SimdLevel supported = detect_simd_level();
+  return supported;
+}
+
+auto ska::pst::common::get_simd_level() -> SimdLevel
+{
+  return selected_level().load();
+}
+
+void ska::pst::common::set_simd_level(SimdLevel level)
+{
+  if (level > get_supported_simd_level())
+  {
+    SPDLOG_ERROR("ska::pst::common::set_simd_level {} is not supported by this CPU, maximum supported is {}",
+      get_simd_level_name(level), get_simd_level_name(get_supported_simd_level()));
+    throw std::runtime_error("ska::pst::common::set_simd_level level not supported by this CPU");
+  }
+  SPDLOG_DEBUG("ska::pst::common::set_simd_level {}", get_simd_level_name(level));
+  selected_level().store(level);
+}
+
+auto ska::pst::common::get_simd_level_name(SimdLevel level) -> std::string
+{
+  switch (level)
+  {
+    case AVX2:
+      return "AVX2";
+    case AVX512:
+      return "AVX512";
+    case Scalar:
+    default:
+      return "Scalar";
+  }
+}
+
+void ska::pst::common::convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, std::complex<float> * out)
+{
+  selected_kernels().convert_int8(in, nsamp * 2, scale, reinterpret_cast<float *>(out));
+}
+
+void ska::pst::common::convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, std::complex<float> * out)
+{
+  selected_kernels().convert_int16(in, nsamp * 2, scale, reinterpret_cast<float *>(out));
+}
+
+auto ska::pst::common::sum_complex_power(const int8_t * in, uint64_t nsamp) -> float
+{
+  return selected_kernels().power_int8(in, nsamp * 2);
+}
+
+auto ska::pst::common::sum_complex_power(const int16_t * in, uint64_t nsamp) -> float
+{
+  return selected_kernels().power_int16(in, nsamp * 2);
+}
+
+void ska::pst::common::convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, ComplexInt16 * out)
+{
+  selected_kernels().int16_int8(in, nsamp * 2, scale, reinterpret_cast<int16_t *>(out));
+}
+
+void ska::pst::common::convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, ComplexInt16 * out)
+{
+  selected_kernels().int16_int16(in, nsamp * 2, scale, reinterpret_cast<int16_t *>(out));
+}
+
+void ska::pst::common::convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, ComplexFP16 * out)
+{
+  selected_kernels().fp16_int8(in, nsamp * 2, scale, reinterpret_cast<uint16_t *>(out));
+}
+
+void ska::pst::common::convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, ComplexFP16 * out)
+{
+  selected_kernels().fp16_int16(in, nsamp * 2, scale, reinterpret_cast<uint16_t *>(out));
+}
+
+void ska::pst::common::convert_complex_samples(const int8_t * in, uint64_t nsamp, float scale, ComplexBF16 * out)
+{
+  selected_kernels().bf16_int8(in, nsamp * 2, scale, reinterpret_cast<uint16_t *>(out));
+}
+
+void ska::pst::common::convert_complex_samples(const int16_t * in, uint64_t nsamp, float scale, ComplexBF16 * out)
+{
+  selected_kernels().bf16_int16(in, nsamp * 2, scale, reinterpret_cast<uint16_t *>(out));
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/WeightsCodec.h"
+
+//! flag in the token that distinguishes a run from a literal
+static constexpr uint32_t run_flag = 0x80000000;
+
+//! maximum number of words described by a token
+static constexpr uint64_t max_token_words = 0x7fffffff;
+
+//! minimum number of repeated words encoded as a run, shorter runs are cheaper as part of a literal
+static constexpr uint64_t min_run_words = 3;
+
+//! number of bytes in a word and a token
+static constexpr uint64_t word_bytes = sizeof(uint32_t);
+
+static inline auto load_word(const char * ptr) -> uint32_t
+{
+  uint32_t word{0};
+  memcpy(&word, ptr, word_bytes);
+  return word;
+}
+
+static inline void store_word(char * ptr, uint32_t word)
+{
+  memcpy(ptr, &word, word_bytes);
+}
+
+ska::pst::common::WeightsCodec::WeightsCodec(uint32_t _stride) :
+  stride(_stride)
+{
+  if (stride < word_bytes)
+  {
+    SPDLOG_ERROR("ska::pst::common::WeightsCodec::WeightsCodec stride={} must be at least {} bytes", stride, word_bytes);
+    throw std::runtime_error("ska::pst::common::WeightsCodec::WeightsCodec stride is less than 4 bytes");
+  }
+}
+
+auto ska::pst::common::WeightsCodec::get_max_encoded_bytes(uint64_t nbytes) -> uint64_t
+{
+  // the worst case is a sequence of literals, each preceded by a token
+  const uint64_t nwords = nbytes / word_bytes;
+  return nbytes + (nwords / max_token_words + 1) * word_bytes;
+}
+
+auto ska::pst::common::WeightsCodec::get_stride(const ska::pst::common::AsciiHeader& header) -> uint32_t
+{
+  if (!header.has("PACKET_WEIGHTS_SIZE"))
+  {
+    return default_stride;
+  }
+  const uint32_t scales_size = header.has("PACKET_SCALES_SIZE") ? header.get_uint32("PACKET_SCALES_SIZE") : sizeof(float);
+  return std::max(header.get_uint32("PACKET_WEIGHTS_SIZE") + scales_size, static_cast<uint32_t>(default_stride));
+}
+
+auto ska::pst::common::WeightsCodec::encode(const char * data, uint64_t nbytes, char * encoded) const -> uint64_t
+{
+  const uint64_t nwords = nbytes / word_bytes;
+
+  // exclusive-or of each word with the word one stride earlier
+  auto delta = [data, this](uint64_t iword) -> uint32_t {
+    const uint64_t offset = iword * word_bytes;
+    uint32_t word = load_word(data + offset); // NOLINT
+    if (offset >= stride)
+    {
+      word ^= load_word(data + offset - stride); // NOLINT
+    }
+    return word;
+  };
+
+  char * out = encoded;
+  uint64_t literal_start = 0;
+  auto write_literals = [&](uint64_t literal_end) {
+    while (literal_start < literal_end)
+    {
+      const uint64_t count = std::min(literal_end - literal_start, max_token_words);
+      store_word(out, static_cast<uint32_t>(count));
+      out += word_bytes; // NOLINT
+      for (uint64_t iword=literal_start; iword<literal_start+count; iword++)
+      {
+        store_word(out, delta(iword));
+        out += word_bytes; // NOLINT
+      }
+      literal_start += count;
+    }
+  };
+
+  uint64_t iword = 0;
+  while (iword < nwords)
+  {
+    const uint32_t value = delta(iword);
+    uint64_t run = 1;
+    while (iword + run < nwords && run < max_token_words && delta(iword + run) == value)
+    {
+      run++;
+    }
+
+    if (run >= min_run_words)
+    {
+      write_literals(iword);
+      store_word(out, static_cast<uint32_t>(run) | run_flag);
+      store_word(out + word_bytes, value); // NOLINT
+      out += 2 * word_bytes; // NOLINT
+      literal_start = iword + run;
+    }
+    iword += run;
+  }
+  write_literals(nwords);
+
+  const uint64_t tail_bytes = nbytes - nwords * word_bytes;
+  memcpy(out, data + nwords * word_bytes, tail_bytes); // NOLINT
+  out += tail_bytes; // NOLINT
+
+  return static_cast<uint64_t>(out - encoded);
+}
+
+void ska::pst::common::WeightsCodec::decode(const char * encoded, uint64_t encoded_bytes, char * data, uint64_t nbytes) const
+{
+  const uint64_t nwords = nbytes / word_bytes;
+  const char * in = encoded;
+  const char * end = encoded + encoded_bytes; // NOLINT
+
+  auto check_remaining = [&in, end](uint64_t required) {
+    if (static_cast<uint64_t>(end - in) < required)
+    {
+      SPDLOG_ERROR("ska::pst::common::WeightsCodec::decode encoded stream ends {} bytes early", required - static_cast<uint64_t>(end - in));
+      throw std::runtime_error("ska::pst::common::WeightsCodec::decode truncated encoded stream");
+    }
+  };
+
+  // the word one stride earlier has always been decoded, as the stride is at least one word
+  uint64_t iword = 0;
+  auto emit = [data, this, &iword](uint32_t word) {
+    const uint64_t offset = iword * word_bytes;
+    if (offset >= stride)
+    {
+      word ^= load_word(data + offset - stride); // NOLINT
+    }
+    store_word(data + offset, word); // NOLINT
+    iword++;
+  };
+
+  while (iword < nwords)
+  {
+    check_remaining(word_bytes);
+    const uint32_t token = load_word(in);
+    in += word_bytes; // NOLINT
+    const uint64_t count = token & ~run_flag;
+    if (count == 0 || iword + count > nwords)
+    {
+      SPDLOG_ERROR("ska::pst::common::WeightsCodec::decode invalid token count={} at word {} of {}", count, iword, nwords);
+      throw std::runtime_error("ska::pst::common::WeightsCodec::decode invalid token");
+    }
+
+    if (token & run_flag)
+    {
+      check_remaining(word_bytes);
+      const uint32_t value = load_word(in);
+      in += word_bytes; // NOLINT
+      for (uint64_t i=0; i<count; i++)
+      {
+        emit(value);
+      }
+    }
+    else
+    {
+      check_remaining(count * word_bytes);
+      for (uint64_t i=0; i<count; i++)
+      {
+        emit(load_word(in));
+        in += word_bytes; // NOLINT
+      }
+    }
+  }
+
+  const uint64_t tail_bytes = nbytes - nwords * word_bytes;
+  if (static_cast<uint64_t>(end - in) != tail_bytes)
+  {
+    SPDLOG_ERROR("ska::pst::common::WeightsCodec::decode {} bytes remain after decoding, expected {}", end - in, tail_bytes);
+    throw std::runtime_error("ska::pst::common::WeightsCodec::decode encoded stream does not match decoded size");
+  }
+  memcpy(data + nwords * word_bytes, in, tail_bytes); // NOLINT
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/WeightsDecoder.h"
+#include "ska/pst/common/definitions.h"
+
+namespace {
+
+  //! Convert the relative weights of a packet to mask values of 0 or 1, returning the number of non-zero weights
+  template <typename T>
+  auto decode_mask(const char * in, uint32_t nweights, float * out) -> int32_t
+  {
+    int32_t nonzero = 0;
+    for (uint32_t i=0; i<nweights; i++)
+    {
+      T weight{0};
+      std::memcpy(&weight, in + (i * sizeof(T)), sizeof(T)); // NOLINT
+      const auto value = static_cast<int32_t>(weight != 0);
+      out[i] = static_cast<float>(value); // NOLINT
+      nonzero += value;
+    }
+    return nonzero;
+  }
+
+} // namespace
+
+void ska::pst::common::WeightsDecoder::configure(const HeapLayout& layout)
+{
+  const auto& packet_layout = layout.get_packet_layout();
+  packets_per_heap = layout.get_packets_per_heap();
+  weights_packet_stride = layout.get_weights_packet_stride();
+  scales_offset = packet_layout.get_packet_scales_offset();
+  weights_offset = packet_layout.get_packet_weights_offset();
+  nsamp_per_block = packet_layout.get_nsamp_per_weight();
+  nblocks_per_chan = packet_layout.get_samples_per_packet() / nsamp_per_block;
+  nblocks_per_packet = packet_layout.get_nchan_per_packet() * nblocks_per_chan;
+  weights_nbit = (packet_layout.get_packet_weights_size() * ska::pst::common::bits_per_byte) / nblocks_per_packet;
+
+  if (weights_nbit != 8 && weights_nbit != 16) // NOLINT
+  {
+    SPDLOG_ERROR("ska::pst::common::WeightsDecoder::configure packet_weights_size={} does not store {} weights of 8 or 16 bits",
+      packet_layout.get_packet_weights_size(), nblocks_per_packet);
+    throw std::runtime_error("ska::pst::common::WeightsDecoder::configure unsupported relative weights size");
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::WeightsDecoder::configure packets_per_heap={} nsamp_per_block={} nblocks_per_packet={} weights_nbit={}",
+    packets_per_heap, nsamp_per_block, nblocks_per_packet, weights_nbit);
+}
+
+void ska::pst::common::WeightsDecoder::decode(const char * weights, uint32_t nheaps)
+{
+  const uint64_t npackets = static_cast<uint64_t>(nheaps) * packets_per_heap;
+  reciprocal_scales.resize(npackets);
+  weighted_blocks.resize(npackets);
+  mask.resize(npackets * nblocks_per_packet);
+  invalid_packets = 0;
+  masked_blocks = 0;
+
+  const char * packet = weights;
+  for (uint64_t ipacket=0; ipacket<npackets; ipacket++)
+  {
+    float scale_factor{0};
+    std::memcpy(&scale_factor, packet + scales_offset, sizeof(scale_factor)); // NOLINT
+    float * packet_mask = &mask[ipacket * nblocks_per_packet];
+
+    if (std::isnan(scale_factor))
+    {
+      reciprocal_scales[ipacket] = 0;
+      weighted_blocks[ipacket] = -1;
+      std::fill(packet_mask, packet_mask + nblocks_per_packet, 0.0f); // NOLINT
+      invalid_packets++;
+    }
+    else
+    {
+      // ignore the invalid scale factor of 0
+      reciprocal_scales[ipacket] = (scale_factor == 0) ? 1.0f : 1.0f / scale_factor;
+      const int32_t nonzero = (weights_nbit == 8) // NOLINT
+        ? decode_mask<uint8_t>(packet + weights_offset, nblocks_per_packet, packet_mask) // NOLINT
+        : decode_mask<uint16_t>(packet + weights_offset, nblocks_per_packet, packet_mask); // NOLINT
+      weighted_blocks[ipacket] = nonzero;
+      masked_blocks += nblocks_per_packet - nonzero;
+    }
+    packet += weights_packet_stride; // NOLINT
+  }
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/utils/WorkerPool.h"
+
+ska::pst::common::WorkerPool::WorkerPool(unsigned nthreads)
+{
+  if (nthreads == 0)
+  {
+    SPDLOG_ERROR("ska::pst::common::WorkerPool::WorkerPool nthreads must be greater than zero");
+    throw std::runtime_error("ska::pst::common::WorkerPool::WorkerPool nthreads must be greater than zero");
+  }
+
+  SPDLOG_DEBUG("ska::pst::common::WorkerPool::WorkerPool nthreads={}", nthreads);
+  errors.resize(nthreads);
+  threads.reserve(nthreads - 1);
+  for (unsigned ithread=1; ithread<nthreads; ithread++)
+  {
+    threads.emplace_back(&WorkerPool::worker_loop, this, ithread);
+  }
+}
+
+ska::pst::common::WorkerPool::~WorkerPool()
+{
+  SPDLOG_DEBUG("ska::pst::common::WorkerPool::~WorkerPool");
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start_cond.notify_all();
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+}
+
+void ska::pst::common::WorkerPool::run(unsigned _ntasks, const Task& task)
+{
+  if (_ntasks > get_nthreads())
+  {
+    SPDLOG_ERROR("ska::pst::common::WorkerPool::run ntasks={} exceeds nthreads={}", _ntasks, get_nthreads());
+    throw std::runtime_error("ska::pst::common::WorkerPool::run ntasks exceeds the number of threads");
+  }
+  if (_ntasks == 0)
+  {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(errors.begin(), errors.end(), nullptr);
+    current_task = &task;
+    ntasks = _ntasks;
+    running = _ntasks - 1;
+    generation++;
+  }
+  if (_ntasks > 1)
+  {
+    start_cond.notify_all();
+  }
+
+  // the calling thread runs the first task while the pool threads run the others
+  try
+  {
+    task(0);
+  }
+  catch (...)
+  {
+    errors[0] = std::current_exception();
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cond.wait(lock, [this]() { return running == 0; });
+    current_task = nullptr;
+  }
+
+  for (auto& error : errors)
+  {
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+void ska::pst::common::WorkerPool::worker_loop(unsigned ithread)
+{
+  uint64_t seen = 0;
+  while (true)
+  {
+    const Task * task = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start_cond.wait(lock, [this, seen]() { return stopping || generation != seen; });
+      if (stopping)
+      {
+        return;
+      }
+      seen = generation;
+      if (ithread >= ntasks)
+      {
+        continue;
+      }
+      task = current_task;
+    }
+
+    std::exception_ptr error;
+    try
+    {
+      (*task)(ithread);
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      errors[ithread] = error;
+      running--;
+      if (running == 0)
+      {
+        done_cond.notify_one();
+      }
+    }
+  }
+}
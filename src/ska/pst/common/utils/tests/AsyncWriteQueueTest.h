@@ -0,0 +1,93 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "ska/pst/common/utils/AsyncWriteQueue.h"
+
+#ifndef SKA_PST_COMMON_UTILS_TESTS_AsyncWriteQueueTest_h
+#define SKA_PST_COMMON_UTILS_TESTS_AsyncWriteQueueTest_h
+
+namespace ska::pst::common::test {
+
+  /**
+   * @brief AsyncWriteQueue that exposes fail, to inject the failure of the completion thread
+   *
+   */
+  class FailingAsyncWriteQueue : public AsyncWriteQueue
+  {
+    public:
+      using AsyncWriteQueue::AsyncWriteQueue;
+      using AsyncWriteQueue::fail;
+  };
+
+  /**
+   * @brief Test the AsyncWriteQueue class
+   *
+   * @details Parameterised by the use_io_uring flag, which has no effect when built without liburing
+   *
+   */
+  class AsyncWriteQueueTest : public ::testing::TestWithParam<bool>
+  {
+    protected:
+      void SetUp() override;
+
+      void TearDown() override;
+
+      /**
+       * @brief Read the entire contents of the output file
+       *
+       * @return std::vector<char> contents of the file
+       */
+      auto read_file() const -> std::vector<char>;
+
+    public:
+      AsyncWriteQueueTest() = default;
+
+      ~AsyncWriteQueueTest() = default;
+
+      //! file descriptor of the output file
+      int fd{-1};
+
+      //! path to the output file
+      std::string file_name{"/tmp/AsyncWriteQueueTest.dat"};
+
+      //! data written to the output file
+      std::vector<char> data;
+
+    private:
+
+  };
+
+} // namespace ska::pst::common::test
+
+#endif // SKA_PST_COMMON_UTILS_TESTS_AsyncWriteQueueTest_h
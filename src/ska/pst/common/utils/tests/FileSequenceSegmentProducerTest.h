@@ -0,0 +1,102 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/FileSequenceSegmentProducer.h"
+
+#ifndef SKA_PST_COMMON_UTILS_TESTS_FileSequenceSegmentProducerTest_h
+#define SKA_PST_COMMON_UTILS_TESTS_FileSequenceSegmentProducerTest_h
+
+namespace ska::pst::common::test {
+
+  /**
+   * @brief Test the FileSequenceSegmentProducer class
+   *
+   * @details Writes a recording of data and weights that spans several files
+   *
+   */
+  class FileSequenceSegmentProducerTest : public ::testing::Test
+  {
+    protected:
+      void SetUp() override;
+
+      void TearDown() override;
+
+      /**
+       * @brief Write a sequence of files that contain consecutive parts of a stream
+       *
+       * @param directory directory in which the files are written
+       * @param header header of the stream
+       * @param stream data of the stream
+       * @param file_bytes number of data bytes in each file
+       * @param compress compress the data of each file
+       * @return std::vector<std::string> paths of the files written, in order
+       */
+      static auto write_files(const std::filesystem::path& directory, const ska::pst::common::AsciiHeader& header,
+        const std::vector<char>& stream, uint64_t file_bytes, bool compress = false) -> std::vector<std::string>;
+
+    public:
+      FileSequenceSegmentProducerTest() = default;
+
+      ~FileSequenceSegmentProducerTest() = default;
+
+      //! header of the data stream
+      ska::pst::common::AsciiHeader data_header;
+
+      //! header of the weights stream
+      ska::pst::common::AsciiHeader weights_header;
+
+      //! data stream written to the data files
+      std::vector<char> data;
+
+      //! weights stream written to the weights files
+      std::vector<char> weights;
+
+      //! paths of the data files, in order
+      std::vector<std::string> data_files;
+
+      //! paths of the weights files, in order
+      std::vector<std::string> weights_files;
+
+      //! directory that contains the data and weights directories
+      std::filesystem::path base_dir{"/tmp/FileSequenceSegmentProducerTest"};
+
+    private:
+
+  };
+
+} // namespace ska::pst::common::test
+
+#endif // SKA_PST_COMMON_UTILS_TESTS_FileSequenceSegmentProducerTest_h
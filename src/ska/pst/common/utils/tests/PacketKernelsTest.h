@@ -0,0 +1,95 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <tuple>
+#include <vector>
+
+#include "ska/pst/common/utils/PacketKernels.h"
+
+#ifndef SKA_PST_COMMON_UTILS_TESTS_PacketKernelsTest_h
+#define SKA_PST_COMMON_UTILS_TESTS_PacketKernelsTest_h
+
+namespace ska::pst::common::test {
+
+  //! Packet geometry tested: nbit, nsamp_per_packet, nchan_per_packet, npol
+  using PacketGeometry = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>;
+
+  /**
+   * @brief Test the specialised packet kernels against a reference implementation
+   *
+   * @details
+   *
+   */
+  class PacketKernelsTest : public ::testing::TestWithParam<PacketGeometry>
+  {
+    protected:
+      void SetUp() override;
+
+      void TearDown() override;
+
+      //! Fill the packet with nval integers of type T
+      template <typename T>
+      void fill_packet(uint64_t nval)
+      {
+        packet.resize(nval * sizeof(T));
+        auto * values = reinterpret_cast<T *>(packet.data());
+        for (uint64_t i=0; i<nval; i++)
+        {
+          values[i] = static_cast<T>((i * 37) % 251) - 125; // NOLINT
+        }
+      }
+
+      //! Return the value of the ith integer in the packet
+      auto get_packet_value(uint64_t i) const -> float;
+
+    public:
+      PacketKernelsTest() = default;
+
+      ~PacketKernelsTest() = default;
+
+      //! Raw packet data
+      std::vector<char> packet;
+
+      uint32_t nbit{0};
+
+      uint32_t nsamp{0};
+
+      uint32_t nchan{0};
+
+      uint32_t npol{0};
+
+    private:
+
+  };
+
+} // namespace ska::pst::common::test
+
+#endif // SKA_PST_COMMON_UTILS_TESTS_PacketKernelsTest_h
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/RollingFileWriter.h"
+
+#ifndef SKA_PST_COMMON_UTILS_TESTS_RollingFileWriterTest_h
+#define SKA_PST_COMMON_UTILS_TESTS_RollingFileWriterTest_h
+
+namespace ska::pst::common::test {
+
+  /**
+   * @brief Test the RollingFileWriter class
+   *
+   * @details Parameterised by the use_o_direct flag
+   *
+   */
+  class RollingFileWriterTest : public ::testing::TestWithParam<bool>
+  {
+    protected:
+      void SetUp() override;
+
+      void TearDown() override;
+
+      /**
+       * @brief Write the test data to the writer in chunks that do not align with the heaps
+       *
+       * @param writer RollingFileWriter that has been opened
+       * @param nbytes number of bytes of the test data to write
+       */
+      void write_chunks(RollingFileWriter& writer, uint64_t nbytes);
+
+      /**
+       * @brief Check that the files written contain consecutive FILE_NUMBER and OBS_OFFSET and, concatenated, the test data
+       *
+       * @param writer RollingFileWriter that has been closed
+       * @param nbytes number of bytes of the test data written
+       */
+      void check_files(const RollingFileWriter& writer, uint64_t nbytes);
+
+    public:
+      RollingFileWriterTest() = default;
+
+      ~RollingFileWriterTest() = default;
+
+      //! header of the stream
+      ska::pst::common::AsciiHeader header;
+
+      //! directory to which the files are written
+      std::filesystem::path output_dir{"/tmp/RollingFileWriterTest"};
+
+      //! data written to the files
+      char* data{nullptr};
+
+      //! size of the data in bytes
+      uint64_t data_size{1048576};
+
+      //! size of a heap in bytes
+      uint64_t resolution{0};
+
+    private:
+
+  };
+
+} // namespace ska::pst::common::test
+
+#endif // SKA_PST_COMMON_UTILS_TESTS_RollingFileWriterTest_h
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "ska/pst/common/utils/AsciiHeader.h"
+#include "ska/pst/common/utils/HeapLayout.h"
+#include "ska/pst/common/utils/StatisticsEngine.h"
+
+#ifndef SKA_PST_COMMON_UTILS_TESTS_StatisticsEngineTest_h
+#define SKA_PST_COMMON_UTILS_TESTS_StatisticsEngineTest_h
+
+namespace ska::pst::common::test {
+
+  /**
+   * @brief Test the StatisticsEngine class
+   *
+   * @details
+   *
+   */
+  class StatisticsEngineTest : public ::testing::Test
+  {
+    protected:
+      void SetUp() override;
+
+      void TearDown() override;
+
+      //! Generate nheaps of packed 16-bit data and the corresponding weights
+      void generate_packed_data(uint32_t nheaps);
+
+      //! Return the value of the sample at the specified polarisation, channel, time sample and dimension
+      auto get_value(uint32_t ipol, uint32_t ichan, uint32_t isamp, uint32_t idim) const -> int16_t;
+
+      //! Return true if the packet that contains the channel is invalid
+      auto is_invalid_channel(uint32_t ichan) const -> bool;
+
+    public:
+      StatisticsEngineTest() = default;
+
+      ~StatisticsEngineTest() = default;
+
+      ska::pst::common::AsciiHeader data_header;
+
+      ska::pst::common::AsciiHeader weights_header;
+
+      ska::pst::common::HeapLayout layout;
+
+      std::vector<char> data;
+
+      std::vector<char> weights;
+
+      //! Scale factor of the valid packets
+      float scale_factor{2.0};
+
+      //! Number of time samples in the generated data
+      uint32_t nsamp{0};
+
+      //! Time sample at which the real part of every channel is clipped
+      static constexpr uint32_t clipped_sample = 5;
+
+    private:
+
+  };
+
+} // namespace ska::pst::common::test
+
+#endif // SKA_PST_COMMON_UTILS_TESTS_StatisticsEngineTest_h
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/HeapLayout.h"
+#include "ska/pst/common/utils/WeightsDecoder.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#ifndef SKA_PST_COMMON_UTILS_TESTS_WeightsDecoderTest_h
+#define SKA_PST_COMMON_UTILS_TESTS_WeightsDecoderTest_h
+
+namespace ska::pst::common::test {
+
+  /**
+   * @brief Test the WeightsDecoder class
+   *
+   * @details Parameterised over the number of bits per relative weight
+   *
+   */
+  class WeightsDecoderTest : public ::testing::TestWithParam<uint32_t>
+  {
+    protected:
+      void SetUp() override;
+      void TearDown() override;
+
+      /**
+       * @brief Write the scale factors and relative weights of nheaps weights heaps
+       *
+       * @details packet 0 of each heap has a scale factor of NaN, packet 1 has a scale factor of 0,
+       * and the remaining packets have a scale factor equal to the packet number.
+       * Relative weights selected by is_masked are zero, all others are non-zero.
+       *
+       * @param nheaps number of heaps to generate
+       */
+      void generate_weights(uint32_t nheaps);
+
+      /**
+       * @brief Return true if the relative weight of the sample block is zero in the generated weights
+       *
+       * @param ipacket packet number in the heap
+       * @param ichan channel number in the packet
+       * @param iblock sample block number in the channel
+       * @return true if the sample block has zero relative weight
+       */
+      static auto is_masked(uint32_t ipacket, uint32_t ichan, uint32_t iblock) -> bool;
+
+    public:
+      WeightsDecoderTest() = default;
+      ~WeightsDecoderTest() = default;
+
+      ska::pst::common::AsciiHeader data_header;
+      ska::pst::common::AsciiHeader weights_header;
+      ska::pst::common::HeapLayout layout;
+      std::vector<char> weights;
+
+  };
+
+} // namespace ska::pst::common::test
+
+#endif // SKA_PST_COMMON_UTILS_TESTS_WeightsDecoderTest_h
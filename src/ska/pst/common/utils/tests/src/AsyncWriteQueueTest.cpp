@@ -0,0 +1,222 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <unistd.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/AsyncWriteQueueTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+static constexpr uint64_t chunk_size = 65536;
+static constexpr uint32_t nchunks = 16;
+
+void AsyncWriteQueueTest::SetUp()
+{
+  data.resize(chunk_size * nchunks);
+  for (uint64_t i=0; i<data.size(); i++)
+  {
+    data[i] = static_cast<char>(i % 251); // NOLINT
+  }
+  fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR); // NOLINT
+  ASSERT_GE(fd, 0);
+}
+
+void AsyncWriteQueueTest::TearDown()
+{
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+  std::filesystem::remove(std::filesystem::path(file_name));
+}
+
+auto AsyncWriteQueueTest::read_file() const -> std::vector<char>
+{
+  std::ifstream input(file_name, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+TEST_P(AsyncWriteQueueTest, test_zero_depth) // NOLINT
+{
+  EXPECT_THROW(AsyncWriteQueue(0, GetParam()), std::runtime_error); // NOLINT
+}
+
+TEST_P(AsyncWriteQueueTest, test_write) // NOLINT
+{
+  static constexpr uint32_t depth = 4;
+  AsyncWriteQueue queue(depth, GetParam());
+  EXPECT_EQ(queue.get_depth(), depth);
+
+  std::atomic<uint32_t> callbacks{0};
+  std::atomic<uint64_t> callback_bytes{0};
+
+  // submit the chunks in reverse order, which the positioned writes must place correctly
+  for (uint32_t ichunk=nchunks; ichunk>0; ichunk--)
+  {
+    const uint64_t offset = (ichunk - 1) * chunk_size;
+    queue.write(fd, &data[offset], chunk_size, offset, [&](const char * buffer, uint64_t nbytes, uint64_t write_offset) {
+      EXPECT_EQ(buffer, &data[write_offset]);
+      callbacks++;
+      callback_bytes += nbytes;
+    });
+    EXPECT_LE(queue.get_in_flight(), depth);
+  }
+  queue.wait();
+
+  EXPECT_EQ(queue.get_in_flight(), 0);
+  EXPECT_EQ(queue.get_writes_completed(), nchunks);
+  EXPECT_EQ(queue.get_bytes_completed(), data.size());
+  EXPECT_EQ(callbacks, nchunks);
+  EXPECT_EQ(callback_bytes, data.size());
+  EXPECT_EQ(read_file(), data);
+}
+
+TEST_P(AsyncWriteQueueTest, test_serialised_callbacks) // NOLINT
+{
+  static constexpr uint32_t depth = 4;
+  static constexpr auto callback_duration = std::chrono::milliseconds(1);
+  AsyncWriteQueue queue(depth, GetParam());
+
+  // each callback holds the flag for long enough that concurrent callbacks would overlap
+  std::atomic<bool> active{false};
+  std::atomic<uint32_t> overlaps{0};
+  uint32_t callbacks = 0;
+  for (uint32_t ichunk=0; ichunk<nchunks; ichunk++)
+  {
+    const uint64_t offset = ichunk * chunk_size;
+    queue.write(fd, &data[offset], chunk_size, offset, [&](const char *, uint64_t, uint64_t) {
+      if (active.exchange(true))
+      {
+        overlaps++;
+      }
+      std::this_thread::sleep_for(callback_duration);
+      callbacks++;
+      active = false;
+    });
+  }
+  queue.wait();
+
+  EXPECT_EQ(overlaps, 0);
+  EXPECT_EQ(callbacks, nchunks);
+}
+
+TEST_P(AsyncWriteQueueTest, test_backpressure) // NOLINT
+{
+  AsyncWriteQueue queue(1, GetParam());
+
+  // the first request does not complete until its callback is released
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  queue.write(fd, &data[0], chunk_size, 0, [released](const char *, uint64_t, uint64_t) { released.wait(); });
+
+  auto second = std::async(std::launch::async, [&]() { queue.write(fd, &data[chunk_size], chunk_size, chunk_size); });
+
+  static constexpr auto poll_interval = std::chrono::milliseconds(1);
+  while (queue.get_backpressure_waits() == 0)
+  {
+    std::this_thread::sleep_for(poll_interval);
+  }
+  EXPECT_EQ(second.wait_for(std::chrono::milliseconds(0)), std::future_status::timeout);
+  EXPECT_EQ(queue.get_in_flight(), 1);
+
+  release.set_value();
+  second.get();
+  queue.wait();
+  EXPECT_EQ(queue.get_writes_completed(), 2);
+  EXPECT_EQ(queue.get_backpressure_waits(), 1);
+}
+
+TEST_P(AsyncWriteQueueTest, test_write_error) // NOLINT
+{
+  AsyncWriteQueue queue(2, GetParam());
+
+  int read_only_fd = open(file_name.c_str(), O_RDONLY); // NOLINT
+  ASSERT_GE(read_only_fd, 0);
+
+  bool called = false;
+  queue.write(read_only_fd, &data[0], chunk_size, 0, [&](const char *, uint64_t, uint64_t) { called = true; });
+  EXPECT_THROW(queue.wait(), std::runtime_error); // NOLINT
+  EXPECT_FALSE(called);
+  EXPECT_EQ(queue.get_writes_completed(), 0);
+
+  // the error is reported once
+  queue.wait();
+  close(read_only_fd);
+}
+
+TEST_P(AsyncWriteQueueTest, test_queue_failure) // NOLINT
+{
+  FailingAsyncWriteQueue queue(1, GetParam());
+
+  // the first request does not complete until its callback is released, and the second blocks on the full queue
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<bool> entered{false};
+  queue.write(fd, &data[0], chunk_size, 0, [&entered, released](const char *, uint64_t, uint64_t) { entered = true; released.wait(); });
+  auto second = std::async(std::launch::async, [&]() { queue.write(fd, &data[chunk_size], chunk_size, chunk_size); });
+
+  static constexpr auto poll_interval = std::chrono::milliseconds(1);
+  while (!entered || queue.get_backpressure_waits() == 0)
+  {
+    std::this_thread::sleep_for(poll_interval);
+  }
+
+  // every outstanding request fails, and the blocked and subsequent calls throw instead of hanging
+  queue.fail("injected failure");
+  EXPECT_EQ(queue.get_in_flight(), 0);
+  EXPECT_THROW(second.get(), std::runtime_error); // NOLINT
+  EXPECT_THROW(queue.wait(), std::runtime_error); // NOLINT
+  EXPECT_THROW(queue.write(fd, &data[0], chunk_size, 0), std::runtime_error); // NOLINT
+  EXPECT_THROW(queue.wait(), std::runtime_error); // NOLINT
+
+  // the request that was being written when the queue failed is not counted and does not underflow the slots
+  release.set_value();
+  static constexpr auto settle_interval = std::chrono::milliseconds(10);
+  std::this_thread::sleep_for(settle_interval);
+  EXPECT_EQ(queue.get_in_flight(), 0);
+  EXPECT_EQ(queue.get_writes_completed(), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, AsyncWriteQueueTest, testing::Values(true, false)); // NOLINT
+
+} // namespace ska::pst::common::test
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+#include <filesystem>
+#include <string>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/Crc32cTest.h"
+#include "ska/pst/common/utils/FileChecksums.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void Crc32cTest::SetUp()
+{
+  static constexpr uint64_t nbytes = 65536 + 129;
+  data.resize(nbytes);
+  uint32_t state = 1;
+  for (auto& value : data)
+  {
+    state = state * 1664525 + 1013904223; // NOLINT
+    value = static_cast<char>(state >> 24); // NOLINT
+  }
+}
+
+void Crc32cTest::TearDown()
+{
+}
+
+TEST_F(Crc32cTest, test_check_value) // NOLINT
+{
+  // the standard check value of CRC-32C is the checksum of the ASCII digits 1 to 9
+  const std::string digits = "123456789";
+  static constexpr uint32_t check_value = 0xE3069283;
+  EXPECT_EQ(crc32c(digits.data(), digits.size()), check_value);
+  EXPECT_EQ(crc32c_software(digits.data(), digits.size()), check_value);
+  EXPECT_EQ(crc32c(digits.data(), 0), 0);
+  SPDLOG_INFO("ska::pst::common::test::Crc32cTest::test_check_value crc32c_uses_hardware={}", crc32c_uses_hardware());
+}
+
+TEST_F(Crc32cTest, test_chaining) // NOLINT
+{
+  const uint32_t expected = crc32c_software(data.data(), data.size());
+  for (uint64_t split : {1UL, 7UL, 4096UL, 12289UL, data.size() - 1})
+  {
+    const uint32_t first = crc32c(data.data(), split);
+    EXPECT_EQ(crc32c(data.data() + split, data.size() - split, first), expected) << " split=" << split; // NOLINT
+  }
+}
+
+TEST_F(Crc32cTest, test_hardware_matches_software) // NOLINT
+{
+  // lengths either side of the interleaved stream size, at every misalignment of the start of the buffer
+  for (uint64_t nbytes : {1UL, 3UL, 8UL, 15UL, 4095UL, 12288UL, 12289UL, 24583UL, 65536UL})
+  {
+    for (uint64_t offset=0; offset<8; offset++)
+    {
+      ASSERT_EQ(crc32c(data.data() + offset, nbytes), crc32c_software(data.data() + offset, nbytes)) // NOLINT
+        << " nbytes=" << nbytes << " offset=" << offset;
+    }
+  }
+}
+
+TEST_F(Crc32cTest, test_file_checksums) // NOLINT
+{
+  static constexpr uint64_t chunk_bytes = 4096;
+  static constexpr uint64_t header_bytes = 512;
+  FileChecksums checksums;
+  EXPECT_THROW(checksums.configure(0), std::runtime_error); // NOLINT
+  checksums.configure(chunk_bytes);
+  checksums.set_header(data.data(), header_bytes);
+
+  // add the data in pieces that are not aligned to the chunks
+  const char * payload = data.data() + header_bytes; // NOLINT
+  const uint64_t payload_bytes = data.size() - header_bytes;
+  uint64_t added = 0;
+  for (uint64_t piece : {100UL, 5000UL, 4096UL, 3UL})
+  {
+    checksums.update(payload + added, piece); // NOLINT
+    added += piece;
+  }
+  checksums.update(payload + added, payload_bytes - added); // NOLINT
+  checksums.finalise();
+
+  const uint64_t nchunks = (payload_bytes + chunk_bytes - 1) / chunk_bytes;
+  EXPECT_EQ(checksums.get_data_bytes(), payload_bytes);
+  EXPECT_EQ(checksums.get_nchunks(), nchunks);
+  EXPECT_EQ(checksums.get_chunk_checksum(1), crc32c(payload + chunk_bytes, chunk_bytes)); // NOLINT
+
+  const std::filesystem::path sidecar = FileChecksums::get_filename("/tmp/Crc32cTest.dada");
+  EXPECT_EQ(sidecar.generic_string(), "/tmp/Crc32cTest.dada.crc32c");
+  checksums.save(sidecar);
+
+  FileChecksums loaded;
+  loaded.load(sidecar);
+  std::filesystem::remove(sidecar);
+  EXPECT_EQ(loaded.get_chunk_bytes(), chunk_bytes);
+  EXPECT_EQ(loaded.get_data_bytes(), payload_bytes);
+  EXPECT_EQ(loaded.get_header_bytes(), header_bytes);
+  EXPECT_EQ(loaded.get_header_checksum(), checksums.get_header_checksum());
+  EXPECT_NO_THROW(loaded.verify_header(data.data(), header_bytes)); // NOLINT
+  EXPECT_THROW(loaded.verify_header(data.data() + 1, header_bytes), std::runtime_error); // NOLINT
+
+  // all chunks are verified, including the final partial chunk
+  EXPECT_EQ(loaded.verify(payload, payload_bytes, 0), nchunks);
+
+  // only the chunks entirely contained in the range are verified
+  EXPECT_EQ(loaded.verify(payload + 100, 3 * chunk_bytes, 100), 2); // NOLINT
+
+  std::vector<char> corrupted(payload, payload + payload_bytes); // NOLINT
+  corrupted[chunk_bytes + 10] ^= 1; // NOLINT
+  EXPECT_THROW(loaded.verify(corrupted.data(), payload_bytes, 0), std::runtime_error); // NOLINT
+  EXPECT_EQ(loaded.verify(corrupted.data() + 2 * chunk_bytes, chunk_bytes, 2 * chunk_bytes), 1); // NOLINT
+
+  EXPECT_THROW(loaded.load("/tmp/Crc32cTest.does_not_exist"), std::runtime_error); // NOLINT
+}
+
+} // namespace ska::pst::common::test
@@ -32,6 +32,7 @@
 
 #include "ska/pst/common/testutils/GtestMain.h"
 #include "ska/pst/common/utils/tests/DataUnpackerTest.h"
+#include "ska/pst/common/utils/PackedSamples.h"
 #include "ska/pst/common/definitions.h"
 
 auto main(int argc, char* argv[]) -> int
@@ -133,6 +134,7 @@ TEST_F(DataUnpackerTest, test_configure) // NOLINT
   ska::pst::common::DataUnpacker unpacker;
   GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
   EXPECT_NO_THROW(unpacker.configure(data_header, weights_header)); // NOLINT
+  EXPECT_TRUE(unpacker.has_packet_kernels());
 
   static constexpr uint32_t bad_header_param = 3;
   data_header.set("NCHAN", bad_header_param);
@@ -145,6 +147,18 @@ TEST_F(DataUnpackerTest, test_configure) // NOLINT
   EXPECT_THROW(unpacker.configure(data_header, weights_header), std::runtime_error); // NOLINT
 }
 
+TEST_F(DataUnpackerTest, test_configure_partial_byte_blocks) // NOLINT
+{
+  ska::pst::common::DataUnpacker unpacker;
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+
+  // a block of one 2-bit complex sample per weight occupies half a byte, which the row and bandpass kernels cannot address
+  data_header.set("NBIT", 2);
+  data_header.set("WT_NSAMP", 1);
+  weights_header.set("WT_NSAMP", 1);
+  EXPECT_THROW(unpacker.configure(data_header, weights_header), std::runtime_error); // NOLINT
+}
+
 TEST_F(DataUnpackerTest, test_unpack) // NOLINT
 {
   ska::pst::common::DataUnpacker unpacker;
@@ -179,6 +193,88 @@ TEST_F(DataUnpackerTest, test_unpack) // NOLINT
   }
 }
 
+TEST_F(DataUnpackerTest, test_unpack_flat) // NOLINT
+{
+  ska::pst::common::DataUnpacker unpacker;
+
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+  unpacker.configure(data_header, weights_header);
+
+  ska::pst::common::UnpackedView<std::complex<float>> unpacked = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+
+  const uint64_t nsamp = unpacked.get_nsamp();
+  const uint32_t nchan = unpacked.get_nchan();
+  const uint32_t npol = unpacked.get_npol();
+  const uint32_t nchan_per_packet = weights_header.get_uint32("UDP_NCHAN");
+  const uint32_t nbit = data_header.get_uint32("NBIT");
+
+  EXPECT_EQ(nsamp, unpacker.get_unpacked_nsamp(data.size()));
+  EXPECT_EQ(unpacked.size(), unpacker.get_unpacked_nval(data.size()));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(unpacked.data()) % ska::pst::common::DataUnpacker::unpacked_buffer_alignment, 0);
+
+  // TFP ordering
+  EXPECT_EQ(unpacked.get_pol_stride(), 1);
+  EXPECT_EQ(unpacked.get_chan_stride(), npol);
+  EXPECT_EQ(unpacked.get_samp_stride(), nchan * npol);
+
+  for (unsigned isamp=0; isamp<nsamp; isamp++)
+  {
+    for (unsigned ichan=0; ichan<nchan; ichan++)
+    {
+      for (unsigned ipol=0; ipol<npol; ipol++)
+      {
+        float value = get_float_value_for_channel_sample(ichan, nsamp, isamp, nbit);
+        if (std::isnan(get_weight_for_channel(ichan, nchan_per_packet)))
+        {
+          value = 0;
+        }
+        ASSERT_EQ(unpacked(isamp, ichan, ipol).real(), value);
+        ASSERT_EQ(unpacked(isamp, ichan, ipol).imag(), value * -1);
+      }
+    }
+  }
+
+  // repeated calls re-use the same buffer
+  ska::pst::common::UnpackedView<std::complex<float>> repeated = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+  EXPECT_EQ(repeated.data(), unpacked.data());
+}
+
+TEST_F(DataUnpackerTest, test_unpack_flat_external_buffer) // NOLINT
+{
+  ska::pst::common::DataUnpacker unpacker;
+
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+  unpacker.configure(data_header, weights_header);
+
+  std::vector<std::complex<float>> output(unpacker.get_unpacked_nval(data.size()));
+
+  // buffer that is too small
+  EXPECT_THROW(unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), output.data(), output.size() - 1), std::runtime_error); // NOLINT
+  EXPECT_THROW(unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), static_cast<std::complex<float> *>(nullptr), output.size()), std::runtime_error); // NOLINT
+
+  // weights buffer that is too small for the number of heaps in data
+  const uint64_t nheaps = data.size() / data_header.get_uint32("RESOLUTION");
+  const uint64_t weights_bufsz = nheaps * weights_header.get_uint32("RESOLUTION");
+  EXPECT_THROW(unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights_bufsz - 1, output.data(), output.size()), std::runtime_error); // NOLINT
+  EXPECT_NO_THROW(unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights_bufsz, output.data(), output.size())); // NOLINT
+
+  ska::pst::common::UnpackedView<std::complex<float>> unpacked = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), output.data(), output.size());
+  EXPECT_EQ(unpacked.data(), output.data());
+
+  // the flat output must match the nested vector output
+  std::vector<std::vector<std::vector<std::complex<float>>>>& expected = unpacker.unpack(&data[0], data.size(), &weights[0], weights.size());
+  for (unsigned isamp=0; isamp<unpacked.get_nsamp(); isamp++)
+  {
+    for (unsigned ichan=0; ichan<unpacked.get_nchan(); ichan++)
+    {
+      for (unsigned ipol=0; ipol<unpacked.get_npol(); ipol++)
+      {
+        ASSERT_EQ(unpacked(isamp, ichan, ipol), expected[isamp][ichan][ipol]);
+      }
+    }
+  }
+}
+
 TEST_F(DataUnpackerTest, test_integrate_bandpass) // NOLINT
 {
   ska::pst::common::DataUnpacker unpacker;
@@ -199,22 +295,487 @@ TEST_F(DataUnpackerTest, test_integrate_bandpass) // NOLINT
   {
     for (unsigned ipol=0; ipol<npol; ipol++)
     {
-      float power = 0;
+      // accumulate the expected power in double precision, so that it is not limited by rounding errors
+      double power = 0;
       for (unsigned isamp=0; isamp<nsamp; isamp++)
       {
-        float value = get_float_value_for_channel_sample(ichan, nsamp, isamp, nbit);
+        double value = get_float_value_for_channel_sample(ichan, nsamp, isamp, nbit);
         power += (value * value) + (value * value);
       }
       if (std::isnan(get_weight_for_channel(ichan, nchan_per_packet)))
       {
         power = 0;
       }
-      float allowed_error = power / 100000; // NOLINT
+      double allowed_error = power / 100000; // NOLINT
       EXPECT_NEAR(power, bandpass[ichan][ipol], allowed_error);
     }
   }
 }
 
+TEST_F(DataUnpackerTest, test_unpack_flat_orders) // NOLINT
+{
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+
+  ska::pst::common::DataUnpacker reference;
+  reference.configure(data_header, weights_header);
+  auto expected = reference.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+
+  for (auto order : {ska::pst::common::TFP, ska::pst::common::FTP, ska::pst::common::PFT})
+  {
+    ska::pst::common::DataUnpacker unpacker;
+    unpacker.configure(data_header, weights_header);
+    unpacker.set_unpacked_order(order);
+    EXPECT_EQ(unpacker.get_unpacked_order(), order);
+
+    auto view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+    EXPECT_EQ(view.get_order(), order);
+    ASSERT_EQ(view.size(), expected.size());
+
+    const uint64_t nsamp = view.get_nsamp();
+    const uint32_t nchan = view.get_nchan();
+    const uint32_t npol = view.get_npol();
+    if (order == ska::pst::common::FTP)
+    {
+      EXPECT_EQ(view.get_chan_stride(), nsamp * npol);
+      EXPECT_EQ(view.get_samp_stride(), npol);
+    }
+    if (order == ska::pst::common::PFT)
+    {
+      EXPECT_EQ(view.get_pol_stride(), nsamp * nchan);
+      EXPECT_EQ(view.get_samp_stride(), 1);
+    }
+
+    for (uint64_t isamp=0; isamp<nsamp; isamp++)
+    {
+      for (uint32_t ichan=0; ichan<nchan; ichan++)
+      {
+        for (uint32_t ipol=0; ipol<npol; ipol++)
+        {
+          ASSERT_EQ(view(isamp, ichan, ipol), expected(isamp, ichan, ipol));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(DataUnpackerTest, test_set_nthreads) // NOLINT
+{
+  ska::pst::common::DataUnpacker unpacker;
+  EXPECT_EQ(unpacker.get_nthreads(), 1);
+  static constexpr unsigned nthreads = 4;
+  unpacker.set_nthreads(nthreads);
+  EXPECT_EQ(unpacker.get_nthreads(), nthreads);
+  EXPECT_THROW(unpacker.set_nthreads(0), std::runtime_error); // NOLINT
+}
+
+TEST_F(DataUnpackerTest, test_unpack_flat_multithreaded) // NOLINT
+{
+  ska::pst::common::DataUnpacker serial;
+  ska::pst::common::DataUnpacker parallel;
+
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+  serial.configure(data_header, weights_header);
+  parallel.configure(data_header, weights_header);
+
+  // use a number of threads that does not evenly divide the number of heaps
+  static constexpr unsigned nthreads = 3;
+  parallel.set_nthreads(nthreads);
+
+  auto expected = serial.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+  auto view = parallel.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+
+  ASSERT_EQ(view.size(), expected.size());
+  for (uint64_t ival=0; ival<view.size(); ival++)
+  {
+    ASSERT_EQ(view.data()[ival], expected.data()[ival]); // NOLINT
+  }
+
+  EXPECT_GT(serial.get_invalid_packets(), 0);
+  EXPECT_EQ(parallel.get_invalid_packets(), serial.get_invalid_packets());
+  EXPECT_EQ(parallel.get_invalid_samples(), serial.get_invalid_samples());
+}
+
+//! SegmentProducer that returns consecutive segments of a fixed number of heaps from the data and weights vectors
+class HeapSegmentProducer : public ska::pst::common::SegmentProducer
+{
+  public:
+    HeapSegmentProducer(DataUnpackerTest& _test, uint64_t _nheaps_per_segment) : test(_test), nheaps_per_segment(_nheaps_per_segment)
+    {
+      data_heap_stride = test.data_header.get_uint32("RESOLUTION");
+      weights_heap_stride = test.weights_header.get_uint32("RESOLUTION");
+      nheaps = test.data.size() / data_heap_stride;
+    }
+
+    auto get_data_header() const -> const ska::pst::common::AsciiHeader& override { return test.data_header; }
+
+    auto get_weights_header() const -> const ska::pst::common::AsciiHeader& override { return test.weights_header; }
+
+    auto next_segment() -> Segment override
+    {
+      Segment segment;
+      if (iheap < nheaps)
+      {
+        const uint64_t segment_nheaps = std::min(nheaps_per_segment, nheaps - iheap);
+        segment.data = BlockProducer::Block(&test.data[iheap * data_heap_stride], segment_nheaps * data_heap_stride, iheap * data_heap_stride);
+        segment.weights = BlockProducer::Block(&test.weights[iheap * weights_heap_stride], segment_nheaps * weights_heap_stride, iheap * weights_heap_stride);
+        iheap += segment_nheaps;
+      }
+      return segment;
+    }
+
+  private:
+    DataUnpackerTest& test;
+    uint64_t nheaps_per_segment;
+    uint64_t data_heap_stride{0};
+    uint64_t weights_heap_stride{0};
+    uint64_t nheaps{0};
+    uint64_t iheap{0};
+};
+
+TEST_F(DataUnpackerTest, test_unpack_stream) // NOLINT
+{
+  ska::pst::common::DataUnpacker serial;
+  ska::pst::common::DataUnpacker streamer;
+
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+  serial.configure(data_header, weights_header);
+  streamer.configure(data_header, weights_header);
+
+  auto expected = serial.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+
+  // windows that do not evenly divide the segments, and segments that do not evenly divide the stream
+  static constexpr uint32_t nheaps_per_window = 7;
+  static constexpr uint64_t nheaps_per_segment = 30;
+  HeapSegmentProducer producer(*this, nheaps_per_segment);
+
+  const uint64_t data_heap_stride = data_header.get_uint32("RESOLUTION");
+  const uint64_t nsamp_per_heap = data_header.get_uint32("UDP_NSAMP");
+  const std::complex<float> * window_data = nullptr;
+  uint64_t expected_obs_offset = 0;
+  uint64_t nwindows = 0;
+
+  uint64_t nheaps = streamer.unpack_stream(producer, nheaps_per_window, [&](const ska::pst::common::UnpackedView<std::complex<float>>& window, uint64_t obs_offset) {
+    // every window is unpacked into the same buffer
+    if (window_data == nullptr)
+    {
+      window_data = window.data();
+    }
+    ASSERT_EQ(window.data(), window_data);
+    ASSERT_EQ(obs_offset, expected_obs_offset);
+    ASSERT_LE(window.get_nsamp(), nheaps_per_window * nsamp_per_heap);
+
+    const uint64_t first_samp = (obs_offset / data_heap_stride) * nsamp_per_heap;
+    for (uint64_t isamp=0; isamp<window.get_nsamp(); isamp++)
+    {
+      for (uint32_t ichan=0; ichan<window.get_nchan(); ichan++)
+      {
+        for (uint32_t ipol=0; ipol<window.get_npol(); ipol++)
+        {
+          ASSERT_EQ(window(isamp, ichan, ipol), expected(first_samp + isamp, ichan, ipol));
+        }
+      }
+    }
+    expected_obs_offset += (window.get_nsamp() / nsamp_per_heap) * data_heap_stride;
+    nwindows++;
+  });
+
+  EXPECT_EQ(nheaps, data.size() / data_heap_stride);
+  EXPECT_EQ(expected_obs_offset, data.size());
+  EXPECT_GT(nwindows, nheaps / nheaps_per_window);
+  EXPECT_EQ(streamer.get_invalid_packets(), serial.get_invalid_packets());
+
+  HeapSegmentProducer empty(*this, nheaps_per_segment);
+  EXPECT_THROW(streamer.unpack_stream(empty, 0, [](const ska::pst::common::UnpackedView<std::complex<float>>&, uint64_t) {}), std::runtime_error); // NOLINT
+}
+
+TEST_F(DataUnpackerTest, test_integrate_bandpass_multithreaded) // NOLINT
+{
+  ska::pst::common::DataUnpacker serial;
+  ska::pst::common::DataUnpacker parallel;
+
+  GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+  serial.configure(data_header, weights_header);
+  parallel.configure(data_header, weights_header);
+
+  static constexpr unsigned nthreads = 3;
+  parallel.set_nthreads(nthreads);
+
+  serial.integrate_bandpass(&data[0], data.size(), &weights[0], weights.size());
+  parallel.integrate_bandpass(&data[0], data.size(), &weights[0], weights.size());
+
+  std::vector<std::vector<float>>& expected = serial.get_bandpass();
+  std::vector<std::vector<float>>& bandpass = parallel.get_bandpass();
+  ASSERT_EQ(bandpass.size(), expected.size());
+  for (unsigned ichan=0; ichan<bandpass.size(); ichan++)
+  {
+    for (unsigned ipol=0; ipol<bandpass[ichan].size(); ipol++)
+    {
+      float allowed_error = expected[ichan][ipol] / 100000; // NOLINT
+      EXPECT_NEAR(bandpass[ichan][ipol], expected[ichan][ipol], allowed_error);
+    }
+  }
+
+  EXPECT_GT(serial.get_invalid_packets(), 0);
+  EXPECT_EQ(parallel.get_invalid_packets(), serial.get_invalid_packets());
+  EXPECT_EQ(parallel.get_invalid_samples(), serial.get_invalid_samples());
+}
+
+TEST_F(DataUnpackerTest, test_unpack_packed) // NOLINT
+{
+  for (uint32_t nbit : {2, 4})
+  {
+    // generate the weights, then replace the 16-bit data with packed data at the lower bit depth
+    GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+    static constexpr uint32_t header_nbit = 16;
+    data_header.set("NBIT", nbit);
+    data_header.set("RESOLUTION", data_header.get_uint32("RESOLUTION") * nbit / header_nbit);
+    data_header.set("DB_BUFSZ", data_header.get_uint32("DB_BUFSZ") * nbit / header_nbit);
+    data.resize(data_header.get_uint32("DB_BUFSZ"));
+
+    const uint64_t nval = data.size() * ska::pst::common::bits_per_byte / nbit;
+    const int32_t nstates = 1 << nbit;
+    std::vector<int8_t> values(nval);
+    for (uint64_t ival=0; ival<nval; ival++)
+    {
+      values[ival] = static_cast<int8_t>(static_cast<int32_t>((ival * 7) % nstates) - (nstates / 2)); // NOLINT
+    }
+    ska::pst::common::pack_values(values.data(), nval, nbit, data.data());
+
+    // unpack with the generic implementation in a channel-major order
+    ska::pst::common::DataUnpacker unpacker;
+    unpacker.configure(data_header, weights_header);
+    EXPECT_FALSE(unpacker.has_packet_kernels());
+    unpacker.set_unpacked_order(ska::pst::common::PFT);
+    auto view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+    ASSERT_EQ(view.get_samp_stride(), 1);
+    unpacker.integrate_bandpass(&data[0], data.size(), &weights[0], weights.size());
+    std::vector<std::vector<float>>& bandpass = unpacker.get_bandpass();
+
+    // walk the heap, packet, pol, chan, samp, dim ordering of the packed values
+    const uint32_t nchan = data_header.get_uint32("NCHAN");
+    const uint32_t npol = data_header.get_uint32("NPOL");
+    const uint32_t nchan_pp = data_header.get_uint32("UDP_NCHAN");
+    const uint32_t nsamp_pp = data_header.get_uint32("UDP_NSAMP");
+    const uint32_t nheaps = data.size() / data_header.get_uint32("RESOLUTION");
+    ASSERT_EQ(view.get_nsamp(), nheaps * nsamp_pp);
+
+    std::vector<std::vector<double>> expected_bandpass(nchan, std::vector<double>(npol, 0));
+    uint64_t ival = 0;
+    for (uint32_t iheap=0; iheap<nheaps; iheap++)
+    {
+      for (uint32_t ipacket=0; ipacket<nchan/nchan_pp; ipacket++)
+      {
+        const bool valid = !std::isnan(get_weight_for_channel(ipacket * nchan_pp, nchan_pp));
+        for (uint32_t ipol=0; ipol<npol; ipol++)
+        {
+          for (uint32_t ichan=0; ichan<nchan_pp; ichan++)
+          {
+            const uint32_t ochan = (ipacket * nchan_pp) + ichan;
+            for (uint32_t isamp=0; isamp<nsamp_pp; isamp++)
+            {
+              const uint32_t osamp = (iheap * nsamp_pp) + isamp;
+              const float re = valid ? values[ival] : 0;
+              const float im = valid ? values[ival + 1] : 0;
+              ival += 2;
+              ASSERT_EQ(view(osamp, ochan, ipol), std::complex<float>(re, im));
+              expected_bandpass[ochan][ipol] += (re * re) + (im * im);
+            }
+          }
+        }
+      }
+    }
+
+    for (uint32_t ichan=0; ichan<nchan; ichan++)
+    {
+      for (uint32_t ipol=0; ipol<npol; ipol++)
+      {
+        ASSERT_EQ(bandpass[ichan][ipol], expected_bandpass[ichan][ipol]);
+      }
+    }
+  }
+}
+
+TEST_F(DataUnpackerTest, test_unpack_flat_reduced_precision) // NOLINT
+{
+  for (uint32_t nbit : {4, 16})
+  {
+    GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+    if (nbit == 4) // NOLINT
+    {
+      // replace the 16-bit data with 4-bit data
+      static constexpr uint32_t header_nbit = 16;
+      data_header.set("NBIT", nbit);
+      data_header.set("RESOLUTION", data_header.get_uint32("RESOLUTION") * nbit / header_nbit);
+      data_header.set("DB_BUFSZ", data_header.get_uint32("DB_BUFSZ") * nbit / header_nbit);
+      data.resize(data_header.get_uint32("DB_BUFSZ"));
+      const uint64_t nval = data.size() * ska::pst::common::bits_per_byte / nbit;
+      std::vector<int8_t> values(nval);
+      for (uint64_t ival=0; ival<nval; ival++)
+      {
+        values[ival] = static_cast<int8_t>(static_cast<int32_t>(ival % 16) - 8); // NOLINT
+      }
+      ska::pst::common::pack_values(values.data(), nval, nbit, data.data());
+    }
+
+    // use a scale factor with an exact reciprocal for the valid packets
+    static constexpr float scale_factor = 4.0;
+    const uint32_t weights_packet_stride = weights_header.get_uint32("PACKET_SCALES_SIZE") + weights_header.get_uint32("PACKET_WEIGHTS_SIZE");
+    const uint64_t npackets = weights.size() / weights_packet_stride;
+    for (uint64_t ipacket=0; ipacket<npackets; ipacket++)
+    {
+      auto * scale = reinterpret_cast<float *>(&weights[ipacket * weights_packet_stride]);
+      if (!std::isnan(*scale))
+      {
+        *scale = scale_factor;
+      }
+    }
+
+    ska::pst::common::DataUnpacker unpacker;
+    unpacker.configure(data_header, weights_header);
+    EXPECT_TRUE(unpacker.get_apply_scale_factors());
+
+    auto expected = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+    const uint64_t nval = expected.size();
+
+    std::vector<ska::pst::common::ComplexInt16> int16(nval);
+    std::vector<ska::pst::common::ComplexFP16> fp16(nval);
+    std::vector<ska::pst::common::ComplexBF16> bf16(nval);
+    auto int16_view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), int16.data(), nval);
+    auto fp16_view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), fp16.data(), nval);
+    auto bf16_view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), bf16.data(), nval);
+    EXPECT_THROW(unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), int16.data(), nval - 1), std::runtime_error); // NOLINT
+
+    for (uint64_t ival=0; ival<nval; ival++)
+    {
+      const std::complex<float> value = expected.data()[ival]; // NOLINT
+      ASSERT_EQ(int16_view.data()[ival].re, ska::pst::common::float_to_int16(value.real())); // NOLINT
+      ASSERT_EQ(int16_view.data()[ival].im, ska::pst::common::float_to_int16(value.imag())); // NOLINT
+      ASSERT_EQ(fp16_view.data()[ival].re, ska::pst::common::float_to_fp16(value.real())); // NOLINT
+      ASSERT_EQ(fp16_view.data()[ival].im, ska::pst::common::float_to_fp16(value.imag())); // NOLINT
+      ASSERT_EQ(bf16_view.data()[ival].re, ska::pst::common::float_to_bf16(value.real())); // NOLINT
+      ASSERT_EQ(bf16_view.data()[ival].im, ska::pst::common::float_to_bf16(value.imag())); // NOLINT
+    }
+
+    // keep the scale factors separate, so that the 16-bit integers store the quantised values exactly
+    unpacker.set_apply_scale_factors(false);
+    int16_view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size(), int16.data(), nval);
+    const std::vector<float>& packet_scales = unpacker.get_packet_scales();
+
+    const uint32_t nchan_pp = data_header.get_uint32("UDP_NCHAN");
+    const uint32_t packets_per_heap = data_header.get_uint32("NCHAN") / nchan_pp;
+    const uint32_t nsamp_pp = data_header.get_uint32("UDP_NSAMP");
+    const uint64_t nheaps = data.size() / data_header.get_uint32("RESOLUTION");
+    ASSERT_EQ(packet_scales.size(), nheaps * packets_per_heap);
+    for (uint64_t isamp=0; isamp<int16_view.get_nsamp(); isamp++)
+    {
+      for (uint32_t ichan=0; ichan<int16_view.get_nchan(); ichan++)
+      {
+        const uint64_t ipacket = ((isamp / nsamp_pp) * packets_per_heap) + (ichan / nchan_pp);
+        const bool valid = !std::isnan(get_weight_for_channel(ichan, nchan_pp));
+        ASSERT_EQ(packet_scales[ipacket], valid ? 1.0f / scale_factor : 0.0f);
+        for (uint32_t ipol=0; ipol<int16_view.get_npol(); ipol++)
+        {
+          const auto& quantised = int16_view(isamp, ichan, ipol);
+          ASSERT_EQ(static_cast<float>(quantised.re) * packet_scales[ipacket], expected(isamp, ichan, ipol).real());
+          ASSERT_EQ(static_cast<float>(quantised.im) * packet_scales[ipacket], expected(isamp, ichan, ipol).imag());
+        }
+      }
+    }
+  }
+}
+
+TEST_F(DataUnpackerTest, test_zero_weights) // NOLINT
+{
+  // 8-bit data use the generic implementation, 16-bit data use the kernels specialised for the Low geometry
+  for (uint32_t nbit : {8, 16})
+  {
+    GeneratePackedData("DataUnpacker_data_header.txt", "DataUnpacker_weights_header.txt");
+    static constexpr uint32_t header_nbit = 16;
+    if (nbit != header_nbit)
+    {
+      data_header.set("NBIT", nbit);
+      data_header.set("RESOLUTION", data_header.get_uint32("RESOLUTION") * nbit / header_nbit);
+      data_header.set("DB_BUFSZ", data_header.get_uint32("DB_BUFSZ") * nbit / header_nbit);
+      data.resize(data_header.get_uint32("DB_BUFSZ"));
+      GenerateQuantisedPackedData(reinterpret_cast<int8_t*>(&data[0]));
+    }
+
+    // four relative weights per channel of each packet
+    static constexpr uint32_t nsamp_per_weight = 8;
+    const uint32_t nchan_pp = data_header.get_uint32("UDP_NCHAN");
+    const uint32_t nsamp_pp = data_header.get_uint32("UDP_NSAMP");
+    const uint32_t nblocks_per_chan = nsamp_pp / nsamp_per_weight;
+    const uint32_t packets_per_heap = data_header.get_uint32("NCHAN") / nchan_pp;
+    const uint32_t packet_weights_size = nchan_pp * nblocks_per_chan * sizeof(uint16_t);
+    const uint32_t packet_scales_size = weights_header.get_uint32("PACKET_SCALES_SIZE");
+    const uint32_t weights_packet_stride = packet_scales_size + packet_weights_size;
+    data_header.set("WT_NSAMP", nsamp_per_weight);
+    weights_header.set("WT_NSAMP", nsamp_per_weight);
+    weights_header.set("PACKET_WEIGHTS_SIZE", packet_weights_size);
+    weights_header.set("RESOLUTION", weights_packet_stride * packets_per_heap);
+
+    auto is_masked = [](uint32_t ipacket, uint32_t ichan, uint32_t iblock) { return ((ipacket + ichan + iblock) % 3) == 0; };
+
+    const uint32_t nheaps = data.size() / data_header.get_uint32("RESOLUTION");
+    weights.assign(static_cast<uint64_t>(nheaps) * packets_per_heap * weights_packet_stride, 0);
+    for (uint32_t iheap=0; iheap<nheaps; iheap++)
+    {
+      for (uint32_t ipacket=0; ipacket<packets_per_heap; ipacket++)
+      {
+        char * packet = &weights[((iheap * packets_per_heap) + ipacket) * weights_packet_stride];
+        *reinterpret_cast<float *>(packet) = get_weight_for_channel(ipacket * nchan_pp, nchan_pp);
+        auto * relative_weights = reinterpret_cast<uint16_t *>(packet + packet_scales_size);
+        for (uint32_t ichan=0; ichan<nchan_pp; ichan++)
+        {
+          for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
+          {
+            relative_weights[(ichan * nblocks_per_chan) + iblock] = is_masked(ipacket, ichan, iblock) ? 0 : 65535; // NOLINT
+          }
+        }
+      }
+    }
+
+    ska::pst::common::DataUnpacker unpacker;
+    unpacker.configure(data_header, weights_header);
+    EXPECT_EQ(unpacker.has_packet_kernels(), nbit == header_nbit);
+
+    auto view = unpacker.unpack_flat(&data[0], data.size(), &weights[0], weights.size());
+    std::vector<std::vector<std::vector<std::complex<float>>>>& nested = unpacker.unpack(&data[0], data.size(), &weights[0], weights.size());
+    unpacker.integrate_bandpass(&data[0], data.size(), &weights[0], weights.size());
+    std::vector<std::vector<float>>& bandpass = unpacker.get_bandpass();
+
+    const uint64_t nsamp = view.get_nsamp();
+    std::vector<std::vector<double>> expected_bandpass(view.get_nchan(), std::vector<double>(view.get_npol(), 0));
+    for (uint64_t isamp=0; isamp<nsamp; isamp++)
+    {
+      for (uint32_t ichan=0; ichan<view.get_nchan(); ichan++)
+      {
+        const uint32_t ipacket = ichan / nchan_pp;
+        const bool valid = !std::isnan(get_weight_for_channel(ichan, nchan_pp));
+        const bool masked = is_masked(ipacket, ichan % nchan_pp, (isamp % nsamp_pp) / nsamp_per_weight);
+        const float value = (valid && !masked) ? get_float_value_for_channel_sample(ichan, nsamp, isamp, nbit) : 0;
+        // the generator negates the imaginary component in the packed type, which wraps -128 for 8-bit data
+        const float imag = (nbit == 8) ? static_cast<float>(static_cast<int8_t>(-static_cast<int>(value))) : -value; // NOLINT
+        for (uint32_t ipol=0; ipol<view.get_npol(); ipol++)
+        {
+          ASSERT_EQ(view(isamp, ichan, ipol).real(), value);
+          ASSERT_EQ(view(isamp, ichan, ipol).imag(), imag);
+          ASSERT_EQ(nested[isamp][ichan][ipol], view(isamp, ichan, ipol));
+          expected_bandpass[ichan][ipol] += static_cast<double>(value) * static_cast<double>(value) + static_cast<double>(imag) * static_cast<double>(imag);
+        }
+      }
+    }
+
+    for (uint32_t ichan=0; ichan<view.get_nchan(); ichan++)
+    {
+      for (uint32_t ipol=0; ipol<view.get_npol(); ipol++)
+      {
+        ASSERT_FLOAT_EQ(bandpass[ichan][ipol], static_cast<float>(expected_bandpass[ichan][ipol]));
+      }
+    }
+  }
+}
+
 TEST_P(DataUnpackerTest, test_unpack_performance) // NOLINT
 {
   GTEST_SKIP() << "Skipping DataUnpacker performance tests";
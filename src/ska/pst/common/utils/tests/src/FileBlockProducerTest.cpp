@@ -28,6 +28,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <spdlog/spdlog.h>
 #include <filesystem>
 #include <sys/types.h>
@@ -36,6 +37,8 @@
 
 #include "ska/pst/common/testutils/GtestMain.h"
 #include "ska/pst/common/utils/tests/FileBlockProducerTest.h"
+#include "ska/pst/common/utils/FileChecksums.h"
+#include "ska/pst/common/utils/FileWriter.h"
 
 auto main(int argc, char* argv[]) -> int
 {
@@ -155,4 +158,134 @@ TEST_F(FileBlockProducerTest, test_read_more_data_than_available) // NOLINT
   EXPECT_EQ(next.size, 0);
 }
 
+TEST_F(FileBlockProducerTest, test_chunked_blocks) // NOLINT
+{
+  const uint64_t resolution = header.get_uint64("RESOLUTION");
+  static constexpr uint64_t heaps_per_block = 3;
+  const uint64_t block_bytes = heaps_per_block * resolution;
+
+  for (bool populate : {false, true})
+  {
+    FileBlockProducer fr(file_name);
+    EXPECT_EQ(fr.get_block_bytes(), 0);
+    EXPECT_THROW(fr.set_block_bytes(resolution + 1), std::runtime_error); // NOLINT
+    fr.set_block_bytes(block_bytes);
+    fr.set_read_ahead(2 * block_bytes);
+    fr.set_populate(populate);
+    fr.set_huge_pages(true);
+    EXPECT_EQ(fr.get_block_bytes(), block_bytes);
+    EXPECT_EQ(fr.get_read_ahead(), 2 * block_bytes);
+
+    uint64_t offset = 0;
+    auto next = fr.next_block();
+    EXPECT_THROW(fr.set_block_bytes(resolution), std::runtime_error); // NOLINT
+    while (next.block != nullptr)
+    {
+      EXPECT_EQ(next.size, std::min(block_bytes, data_size - offset));
+      EXPECT_EQ(next.obs_offset, offset);
+      auto block_ptr = reinterpret_cast<uint8_t *>(next.block);
+      for (unsigned i=0; i<next.size; i++)
+      {
+        ASSERT_EQ(block_ptr[i], uint8_t((offset + i) % 256));  // NOLINT
+      }
+      offset += next.size;
+      next = fr.next_block();
+    }
+    EXPECT_EQ(offset, data_size);
+    EXPECT_EQ(next.size, 0);
+
+    // remains at the end of the data
+    next = fr.next_block();
+    EXPECT_EQ(next.block, nullptr); // NOLINT
+  }
+}
+
+TEST_F(FileBlockProducerTest, test_populate_single_block) // NOLINT
+{
+  FileBlockProducer fr(file_name);
+  fr.set_populate(true);
+  auto next = fr.next_block();
+  EXPECT_EQ(next.size, data_size);
+  auto file_data_ptr = reinterpret_cast<uint8_t *>(next.block);
+  for (unsigned i=0; i<data_size; i++)
+  {
+    ASSERT_EQ(file_data_ptr[i], uint8_t(i % 256));  // NOLINT
+  }
+}
+
+TEST_F(FileBlockProducerTest, test_verify_checksums) // NOLINT
+{
+  const uint64_t resolution = header.get_uint64("RESOLUTION");
+  const std::filesystem::path sidecar = FileChecksums::get_filename(file_name);
+
+  // no sidecar file
+  {
+    FileBlockProducer fr(file_name);
+    EXPECT_THROW(fr.set_verify_checksums(true), std::runtime_error); // NOLINT
+  }
+
+  // checksums of the data with one byte of the third heap changed
+  std::vector<char> expected_data(file_data);
+  expected_data[2 * resolution + 5] ^= 1; // NOLINT
+  FileChecksums checksums;
+  checksums.configure(resolution);
+  checksums.set_header(&file_header[0], header_size);
+  checksums.update(&expected_data[0], data_size);
+  checksums.finalise();
+  checksums.save(sidecar);
+
+  {
+    FileBlockProducer fr(file_name);
+    fr.set_verify_checksums(true);
+    EXPECT_THROW(fr.next_block(), std::runtime_error); // NOLINT
+  }
+
+  {
+    FileBlockProducer fr(file_name);
+    fr.set_block_bytes(resolution);
+    fr.set_verify_checksums(true);
+    EXPECT_EQ(fr.next_block().size, resolution);
+    EXPECT_EQ(fr.next_block().size, resolution);
+    EXPECT_THROW(fr.next_block(), std::runtime_error); // NOLINT
+  }
+  std::filesystem::remove(sidecar);
+}
+
+TEST_F(FileBlockProducerTest, test_compressed_file) // NOLINT
+{
+  const uint64_t resolution = header.get_uint64("RESOLUTION");
+  {
+    FileWriter writer;
+    writer.set_compression(true);
+    writer.open_file(file_name);
+    writer.write_header(header);
+    writer.write_data(&file_data[0], data_size / 2);
+    writer.write_data(&file_data[data_size / 2], data_size / 2);
+    writer.close_file();
+  }
+  for (uint64_t block_bytes : {0UL, 3 * resolution})
+  {
+    FileBlockProducer fr(file_name);
+    EXPECT_TRUE(fr.get_header().has("COMPRESSION"));
+    fr.set_block_bytes(block_bytes);
+    fr.prefetch(data_size);
+
+    uint64_t offset = 0;
+    auto next = fr.next_block();
+    EXPECT_THROW(fr.set_block_bytes(resolution), std::runtime_error); // NOLINT
+    while (next.block != nullptr)
+    {
+      EXPECT_EQ(next.size, (block_bytes == 0) ? data_size : std::min(block_bytes, data_size - offset));
+      EXPECT_EQ(next.obs_offset, offset);
+      for (unsigned i=0; i<next.size; i++)
+      {
+        ASSERT_EQ(next.block[i], file_data[offset + i]);  // NOLINT
+      }
+      offset += next.size;
+      next = fr.next_block();
+    }
+    EXPECT_EQ(offset, data_size);
+  }
+}
+
 } // namespace ska::pst::common::test
@@ -28,8 +28,11 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <array>
 #include <spdlog/spdlog.h>
 #include <filesystem>
+#include <thread>
 #include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -226,4 +229,124 @@ TEST_F(FileReaderTest, test_read_data_with_bad_fd) // NOLINT
   EXPECT_NO_THROW(fr.read_data(&_data[0], data_size)); // NOLINT
 }
 
+TEST_F(FileReaderTest, test_read_data_at) // NOLINT
+{
+  FileReader fr(file_name);
+  fr.read_header();
+
+  static constexpr uint64_t read_size = 10000;
+  static constexpr std::array<uint64_t, 4> offsets{0, 12345, 500000, 1048576 - 100};
+  std::vector<char> _data(read_size);
+  for (auto offset : offsets)
+  {
+    uint64_t expected = std::min(read_size, data_size - offset);
+    EXPECT_EQ(fr.read_data_at(&_data[0], read_size, offset), expected);
+    for (unsigned i=0; i<expected; i++)
+    {
+      ASSERT_EQ(_data[i], file_data[offset + i]); // NOLINT
+    }
+  }
+  EXPECT_EQ(fr.read_data_at(&_data[0], read_size, data_size), 0);
+
+  // positional reads do not change the position of sequential reads
+  EXPECT_EQ(fr.read_data(&_data[0], read_size), read_size);
+  for (unsigned i=0; i<read_size; i++)
+  {
+    ASSERT_EQ(_data[i], file_data[i]); // NOLINT
+  }
+}
+
+TEST_F(FileReaderTest, test_read_data_at_concurrent) // NOLINT
+{
+  static constexpr unsigned nthreads = 4;
+  for (bool use_o_direct : {false, true})
+  {
+    FileReader fr(file_name, use_o_direct);
+    fr.read_header();
+
+    // each thread reads an interleaved set of unaligned chunks
+    static constexpr uint64_t chunk_size = 3000;
+    std::vector<std::vector<char>> results(nthreads, std::vector<char>(data_size));
+    std::vector<std::thread> threads;
+    for (unsigned ithread=0; ithread<nthreads; ithread++)
+    {
+      threads.emplace_back([&, ithread]() {
+        for (uint64_t offset=ithread*chunk_size; offset<data_size; offset+=nthreads*chunk_size)
+        {
+          fr.read_data_at(&results[ithread][offset], std::min(chunk_size, data_size - offset), offset);
+        }
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    for (uint64_t offset=0; offset<data_size; offset++)
+    {
+      const unsigned ithread = (offset / chunk_size) % nthreads;
+      ASSERT_EQ(results[ithread][offset], file_data[offset]); // NOLINT
+    }
+  }
+}
+
+TEST_F(FileReaderTest, test_read_data_o_direct) // NOLINT
+{
+  FileReader fr(file_name, true);
+  EXPECT_TRUE(fr.uses_o_direct());
+  EXPECT_GT(fr.block_alignment(), 0);
+  EXPECT_EQ(fr.read_header(), header_size);
+  EXPECT_EQ(fr.get_header().raw(), header.raw());
+
+  // sizes and buffers that are not aligned are read through the staging buffer
+  static constexpr std::array<uint64_t, 5> read_sizes{1000, 3, 70000, 4096, 262144};
+  std::vector<char> _data(data_size);
+  uint64_t offset = 0;
+  for (auto read_size : read_sizes)
+  {
+    EXPECT_EQ(fr.read_data(&_data[offset], read_size), read_size);
+    offset += read_size;
+  }
+  EXPECT_EQ(fr.read_data(&_data[offset], data_size), data_size - offset);
+  for (unsigned i=0; i<data_size; i++)
+  {
+    ASSERT_EQ(_data[i], file_data[i]); // NOLINT
+  }
+
+  // aligned reads are transferred directly
+  char * aligned{nullptr};
+  const uint64_t alignment = fr.block_alignment();
+  ASSERT_EQ(posix_memalign(reinterpret_cast<void **>(&aligned), alignment, data_size), 0); // NOLINT
+  EXPECT_EQ(fr.read_data_at(aligned, data_size - alignment, alignment), data_size - alignment);
+  for (unsigned i=0; i<data_size - alignment; i++)
+  {
+    ASSERT_EQ(aligned[i], file_data[alignment + i]); // NOLINT
+  }
+  free(aligned); // NOLINT
+}
+
+TEST_F(FileReaderTest, test_read_ahead) // NOLINT
+{
+  static constexpr uint64_t read_ahead = 262144;
+  FileReader fr(file_name);
+  EXPECT_EQ(fr.get_read_ahead(), 0);
+  fr.set_read_ahead(read_ahead);
+  EXPECT_EQ(fr.get_read_ahead(), read_ahead);
+  fr.read_header();
+
+  static constexpr uint64_t read_size = 65536;
+  std::vector<char> _data(read_size);
+  for (uint64_t offset=0; offset<data_size; offset+=read_size)
+  {
+    EXPECT_EQ(fr.read_data(&_data[0], read_size), read_size);
+    for (unsigned i=0; i<read_size; i++)
+    {
+      ASSERT_EQ(_data[i], file_data[offset + i]); // NOLINT
+    }
+  }
+
+  fr.set_read_ahead(0);
+  EXPECT_EQ(fr.get_read_ahead(), 0);
+}
+
 } // namespace ska::pst::common::test
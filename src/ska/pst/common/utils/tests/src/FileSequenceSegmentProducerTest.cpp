@@ -0,0 +1,202 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/FileSequenceSegmentProducerTest.h"
+#include "ska/pst/common/utils/FileReader.h"
+#include "ska/pst/common/utils/FileWriter.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+static constexpr unsigned nfiles = 3;
+static constexpr uint64_t heaps_per_file = 4;
+static constexpr uint64_t weights_resolution = 1024;
+
+void FileSequenceSegmentProducerTest::SetUp()
+{
+  data_header.load_from_file(test_data_file("data_header.txt"));
+  weights_header.clone(data_header);
+  weights_header.set("RESOLUTION", weights_resolution);
+
+  const uint64_t data_resolution = data_header.get_uint64("RESOLUTION");
+  data.resize(nfiles * heaps_per_file * data_resolution);
+  for (uint64_t i=0; i<data.size(); i++)
+  {
+    data[i] = static_cast<char>(i % 251); // NOLINT
+  }
+  weights.resize(nfiles * heaps_per_file * weights_resolution);
+  for (uint64_t i=0; i<weights.size(); i++)
+  {
+    weights[i] = static_cast<char>(i % 241); // NOLINT
+  }
+
+  std::filesystem::remove_all(base_dir);
+  data_files = write_files(base_dir / "data", data_header, data, heaps_per_file * data_resolution);
+  weights_files = write_files(base_dir / "weights", weights_header, weights, heaps_per_file * weights_resolution);
+}
+
+void FileSequenceSegmentProducerTest::TearDown()
+{
+  std::filesystem::remove_all(base_dir);
+}
+
+auto FileSequenceSegmentProducerTest::write_files(const std::filesystem::path& directory, const ska::pst::common::AsciiHeader& header,
+  const std::vector<char>& stream, uint64_t file_bytes, bool compress) -> std::vector<std::string>
+{
+  std::filesystem::create_directories(directory);
+  std::vector<std::string> file_paths;
+  for (unsigned ifile=0; ifile<stream.size()/file_bytes; ifile++)
+  {
+    const uint64_t obs_offset = ifile * file_bytes;
+    ska::pst::common::AsciiHeader file_header(header);
+    file_header.set("OBS_OFFSET", obs_offset);
+    file_header.set("FILE_NUMBER", ifile);
+
+    std::filesystem::path file_path = directory / FileWriter::get_filename(header.get_val("UTC_START"), obs_offset, ifile);
+    FileWriter writer;
+    writer.set_compression(compress);
+    writer.open_file(file_path);
+    writer.write_header(file_header);
+    writer.write_data(const_cast<char *>(&stream[obs_offset]), file_bytes); // NOLINT
+    writer.close_file();
+    file_paths.push_back(file_path.string());
+  }
+  return file_paths;
+}
+
+TEST_F(FileSequenceSegmentProducerTest, test_whole_files) // NOLINT
+{
+  // files are ordered by OBS_OFFSET, not by the order in which they are listed
+  std::vector<std::string> reversed_data_files(data_files.rbegin(), data_files.rend());
+  FileSequenceSegmentProducer producer(reversed_data_files, weights_files);
+  EXPECT_EQ(producer.get_nfiles(), nfiles);
+  EXPECT_EQ(producer.get_data_file_paths(), data_files);
+  EXPECT_EQ(producer.get_weights_file_paths(), weights_files);
+  EXPECT_EQ(producer.get_data_header().get_uint64("OBS_OFFSET"), 0);
+  EXPECT_EQ(producer.get_weights_header().get_uint64("RESOLUTION"), weights_resolution);
+
+  const uint64_t data_file_bytes = data.size() / nfiles;
+  const uint64_t weights_file_bytes = weights.size() / nfiles;
+  for (unsigned ifile=0; ifile<nfiles; ifile++)
+  {
+    auto segment = producer.next_segment();
+    EXPECT_EQ(producer.get_file_index(), ifile);
+    ASSERT_NE(segment.data.block, nullptr);
+    EXPECT_EQ(segment.data.size, data_file_bytes);
+    EXPECT_EQ(segment.weights.size, weights_file_bytes);
+    EXPECT_EQ(segment.get_obs_offset(), ifile * data_file_bytes);
+    EXPECT_TRUE(std::equal(segment.data.block, segment.data.block + segment.data.size, data.begin() + ifile * data_file_bytes)); // NOLINT
+    EXPECT_TRUE(std::equal(segment.weights.block, segment.weights.block + segment.weights.size, weights.begin() + ifile * weights_file_bytes)); // NOLINT
+  }
+
+  auto segment = producer.next_segment();
+  EXPECT_EQ(segment.data.block, nullptr); // NOLINT
+  EXPECT_EQ(segment.data.size, 0);
+  EXPECT_EQ(segment.weights.block, nullptr); // NOLINT
+  EXPECT_EQ(segment.weights.size, 0);
+}
+
+TEST_F(FileSequenceSegmentProducerTest, test_segments_across_files) // NOLINT
+{
+  // segments do not divide the files evenly
+  static constexpr uint64_t heaps_per_segment = 3;
+  FileSequenceSegmentProducer producer(
+    FileSequenceSegmentProducer::list_files(base_dir / "data"),
+    FileSequenceSegmentProducer::list_files(base_dir / "weights"),
+    heaps_per_segment);
+
+  std::vector<char> data_read;
+  std::vector<char> weights_read;
+  unsigned nsegments = 0;
+  auto segment = producer.next_segment();
+  while (segment.data.block != nullptr)
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileSequenceSegmentProducerTest::test_segments_across_files obs_offset={} size={}", segment.get_obs_offset(), segment.data.size);
+    EXPECT_EQ(segment.get_obs_offset(), data_read.size());
+    EXPECT_EQ(segment.data.size / data_header.get_uint64("RESOLUTION"), segment.weights.size / weights_resolution);
+    data_read.insert(data_read.end(), segment.data.block, segment.data.block + segment.data.size); // NOLINT
+    weights_read.insert(weights_read.end(), segment.weights.block, segment.weights.block + segment.weights.size); // NOLINT
+    nsegments++;
+    segment = producer.next_segment();
+  }
+
+  EXPECT_EQ(nsegments, nfiles * ((heaps_per_file + heaps_per_segment - 1) / heaps_per_segment));
+  EXPECT_EQ(producer.get_file_index(), nfiles - 1);
+  EXPECT_EQ(data_read, data);
+  EXPECT_EQ(weights_read, weights);
+}
+
+TEST_F(FileSequenceSegmentProducerTest, test_compressed_weights) // NOLINT
+{
+  // the OBS_OFFSET of each compressed file follows the uncompressed size of the previous file
+  std::filesystem::remove_all(base_dir / "weights");
+  weights_files = write_files(base_dir / "weights", weights_header, weights, heaps_per_file * weights_resolution, true);
+
+  FileReader reader(weights_files.front());
+  reader.read_header();
+  ASSERT_TRUE(reader.is_compressed());
+  EXPECT_EQ(reader.get_data_size(), heaps_per_file * weights_resolution);
+
+  FileSequenceSegmentProducer producer(data_files, weights_files);
+  std::vector<char> weights_read;
+  for (auto segment = producer.next_segment(); segment.data.block != nullptr; segment = producer.next_segment())
+  {
+    weights_read.insert(weights_read.end(), segment.weights.block, segment.weights.block + segment.weights.size); // NOLINT
+  }
+  EXPECT_EQ(weights_read, weights);
+}
+
+TEST_F(FileSequenceSegmentProducerTest, test_list_files) // NOLINT
+{
+  EXPECT_EQ(FileSequenceSegmentProducer::list_files(base_dir / "data"), data_files);
+  EXPECT_EQ(FileSequenceSegmentProducer::list_files(base_dir / "weights"), weights_files);
+}
+
+TEST_F(FileSequenceSegmentProducerTest, test_invalid_files) // NOLINT
+{
+  std::vector<std::string> no_files;
+  EXPECT_THROW(FileSequenceSegmentProducer(no_files, no_files), std::runtime_error); // NOLINT
+
+  std::vector<std::string> fewer_files(weights_files.begin(), weights_files.end() - 1);
+  EXPECT_THROW(FileSequenceSegmentProducer(data_files, fewer_files), std::runtime_error); // NOLINT
+
+  std::vector<std::string> bad_files{"/tmp/file/that/does/not/exist"};
+  EXPECT_THROW(FileSequenceSegmentProducer(bad_files, bad_files), std::runtime_error); // NOLINT
+}
+
+} // namespace ska::pst::common::test
@@ -29,6 +29,8 @@
  */
 
 #include <spdlog/spdlog.h>
+#include <array>
+#include <atomic>
 #include <initializer_list>
 #include <filesystem>
 #include <vector>
@@ -38,6 +40,7 @@
 
 #include "ska/pst/common/testutils/GtestMain.h"
 #include "ska/pst/common/utils/tests/FileWriterTest.h"
+#include "ska/pst/common/utils/FileChecksums.h"
 #include "ska/pst/common/utils/FileReader.h"
 
 auto main(int argc, char* argv[]) -> int
@@ -308,8 +311,34 @@ TEST_F(FileWriterTest, test_write_unaligned_pointer) // NOLINT
   SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_write_unaligned_pointer write_header");
   writer.write_header(header);
 
-  SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_write_unaligned_pointer write_data unaligned base address");
-  EXPECT_THROW(writer.write_data(file_data+1, data_size/2), std::runtime_error); // NOLINT
+  // buffers that are not aligned in memory are written through the staging buffer
+  static constexpr std::array<uint64_t, 3> offsets{1, 8, 512};
+  const uint64_t write_size = data_size / 4;
+  uint64_t total = 0;
+  for (auto offset : offsets)
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_write_unaligned_pointer write_data base address offset={}", offset);
+    EXPECT_EQ(writer.write_data(file_data + offset, write_size), write_size); // NOLINT
+    total += write_size;
+  }
+
+  // asynchronous writes of unaligned buffers are also written through the staging buffer
+  writer.set_async_depth(2);
+  EXPECT_EQ(writer.write_data_async(file_data + 1, write_size), header_size + total); // NOLINT
+  total += write_size;
+  writer.close_file();
+
+  EXPECT_EQ(std::filesystem::file_size(file_name), header_size + total);
+
+  FileReader reader (file_name);
+  reader.read_header();
+  std::vector<char> read_data(total);
+  EXPECT_EQ(reader.read_data(&read_data[0], total), total);
+  for (unsigned i=0; i<offsets.size(); i++)
+  {
+    ASSERT_EQ(memcmp(&read_data[i * write_size], file_data + offsets[i], write_size), 0); // NOLINT
+  }
+  ASSERT_EQ(memcmp(&read_data[offsets.size() * write_size], file_data + 1, write_size), 0); // NOLINT
 }
 
 TEST_F(FileWriterTest, test_write_less_than_block) // NOLINT
@@ -330,4 +359,335 @@ TEST_F(FileWriterTest, test_write_less_than_block) // NOLINT
   EXPECT_EQ(writer.write_data(file_data, half_block), half_block);
 }
 
+TEST_F(FileWriterTest, test_write_data_async) // NOLINT
+{
+  static constexpr uint32_t depth = 4;
+  static constexpr uint32_t nwrites = 8;
+  const uint64_t write_size = data_size / nwrites;
+
+  for (bool use_o_direct : {false,true})
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_write_data_async use_o_direct={}", use_o_direct);
+    FileWriter writer(use_o_direct);
+    EXPECT_EQ(writer.get_async_depth(), 0);
+    writer.set_async_depth(depth);
+    EXPECT_EQ(writer.get_async_depth(), depth);
+
+    writer.open_file(file_name);
+    EXPECT_THROW(writer.write_data_async(file_data, write_size), std::runtime_error); // NOLINT
+    writer.write_header(header);
+
+    std::atomic<uint32_t> completed{0};
+    for (uint32_t iwrite=0; iwrite<nwrites; iwrite++)
+    {
+      auto offset = writer.write_data_async(file_data + iwrite * write_size, write_size, [&](const char *, uint64_t nbytes, uint64_t) { // NOLINT
+        EXPECT_EQ(nbytes, write_size);
+        completed++;
+      });
+      EXPECT_EQ(offset, header_size + iwrite * write_size);
+      EXPECT_LE(writer.get_writes_in_flight(), depth);
+    }
+    EXPECT_EQ(writer.get_data_bytes_written(), data_size);
+
+    writer.wait_for_writes();
+    EXPECT_EQ(completed, nwrites);
+    EXPECT_EQ(writer.get_writes_in_flight(), 0);
+    writer.close_file();
+
+    FileReader reader (file_name);
+    reader.read_header();
+    EXPECT_EQ(reader.get_header().raw(), header.raw());
+
+    std::vector<char> read_data(data_size);
+    EXPECT_EQ(reader.read_data(&read_data[0], data_size), data_size);
+    for (unsigned i=0; i<data_size; i++)
+    {
+      ASSERT_EQ(file_data[i], read_data[i]);  // NOLINT
+    }
+  }
+}
+
+TEST_F(FileWriterTest, test_write_data_async_not_enabled) // NOLINT
+{
+  FileWriter writer;
+  writer.open_file(file_name);
+  writer.write_header(header);
+  EXPECT_THROW(writer.write_data_async(file_data, data_size), std::runtime_error); // NOLINT
+}
+
+TEST_F(FileWriterTest, test_mixed_sync_async_writes) // NOLINT
+{
+  const uint64_t half = data_size / 2;
+  FileWriter writer;
+  writer.set_async_depth(2);
+  writer.open_file(file_name);
+  writer.write_header(header);
+
+  writer.write_data_async(file_data, half);
+  EXPECT_EQ(writer.write_data(file_data + half, half), half); // NOLINT
+  writer.close_file();
+
+  FileReader reader (file_name);
+  reader.read_header();
+  std::vector<char> read_data(data_size);
+  EXPECT_EQ(reader.read_data(&read_data[0], data_size), data_size);
+  for (unsigned i=0; i<data_size; i++)
+  {
+    ASSERT_EQ(file_data[i], read_data[i]);  // NOLINT
+  }
+}
+
+TEST_F(FileWriterTest, test_o_direct_unaligned_writes) // NOLINT
+{
+  // sizes that leave, merge, and complete partial blocks in the staging buffer
+  static constexpr std::array<uint64_t, 7> write_sizes{1000, 3, 70000, 1536, 1, 262144, 511};
+
+  for (bool use_async : {false,true})
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_o_direct_unaligned_writes use_async={}", use_async);
+    bool use_o_direct = true;
+    FileWriter writer(use_o_direct);
+    if (use_async)
+    {
+      writer.set_async_depth(2);
+    }
+    writer.open_file(file_name);
+    writer.write_header(header);
+    const uint64_t alignment = writer.block_alignment();
+    EXPECT_GT(alignment, 0);
+
+    uint64_t total = 0;
+    for (auto write_size : write_sizes)
+    {
+      if (use_async)
+      {
+        EXPECT_EQ(writer.write_data_async(file_data + total, write_size), header_size + total); // NOLINT
+      }
+      else
+      {
+        EXPECT_EQ(writer.write_data(file_data + total, write_size), write_size); // NOLINT
+      }
+      total += write_size;
+      EXPECT_EQ(writer.get_data_bytes_written(), total);
+      EXPECT_EQ(writer.get_staged_bytes(), (header_size + total) % alignment);
+    }
+    writer.close_file();
+    EXPECT_EQ(writer.get_staged_bytes(), 0);
+
+    EXPECT_EQ(std::filesystem::file_size(file_name), header_size + total);
+
+    FileReader reader (file_name);
+    reader.read_header();
+    EXPECT_EQ(reader.get_header().raw(), header.raw());
+
+    std::vector<char> read_data(total);
+    EXPECT_EQ(reader.read_data(&read_data[0], total), total);
+    for (unsigned i=0; i<total; i++)
+    {
+      ASSERT_EQ(file_data[i], read_data[i]);  // NOLINT
+    }
+  }
+}
+
+TEST_F(FileWriterTest, test_compute_file_bytes) // NOLINT
+{
+  EXPECT_EQ(FileWriter::compute_file_bytes(header, 0), header_size);
+
+  // 1024 bytes per 207.36 microsecond sample
+  static constexpr double duration = 2.0736;
+  static constexpr uint64_t expected_data_bytes = 10240000;
+  EXPECT_EQ(FileWriter::compute_file_bytes(header, duration), header_size + expected_data_bytes);
+
+  EXPECT_THROW(FileWriter::compute_file_bytes(header, -1), std::runtime_error); // NOLINT
+}
+
+TEST_F(FileWriterTest, test_preallocation) // NOLINT
+{
+  // preallocate more than is written, so that the file must be truncated on close
+  const uint64_t write_size = data_size / 2 + 3;
+  const uint64_t preallocation_bytes = header_size + data_size;
+
+  for (bool use_o_direct : {false,true})
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_preallocation use_o_direct={}", use_o_direct);
+    FileWriter writer(use_o_direct);
+    EXPECT_EQ(writer.get_preallocation_bytes(), 0);
+    writer.set_preallocation_bytes(preallocation_bytes);
+    EXPECT_EQ(writer.get_preallocation_bytes(), preallocation_bytes);
+
+    writer.open_file(file_name);
+    // file systems that do not support fallocate leave the file unallocated
+    if (writer.get_preallocated_bytes() > 0)
+    {
+      EXPECT_EQ(writer.get_preallocated_bytes(), preallocation_bytes);
+      EXPECT_EQ(std::filesystem::file_size(file_name), preallocation_bytes);
+    }
+
+    writer.write_header(header);
+    EXPECT_EQ(writer.write_data(file_data, write_size), write_size);
+    writer.close_file();
+    EXPECT_EQ(writer.get_preallocated_bytes(), 0);
+
+    EXPECT_EQ(std::filesystem::file_size(file_name), header_size + write_size);
+
+    FileReader reader (file_name);
+    reader.read_header();
+    EXPECT_EQ(reader.get_header().raw(), header.raw());
+
+    std::vector<char> read_data(write_size);
+    EXPECT_EQ(reader.read_data(&read_data[0], write_size), write_size);
+    for (unsigned i=0; i<write_size; i++)
+    {
+      ASSERT_EQ(file_data[i], read_data[i]);  // NOLINT
+    }
+  }
+}
+
+TEST_F(FileWriterTest, test_checksums) // NOLINT
+{
+  static constexpr uint64_t chunk_bytes = 65536;
+  const uint64_t write_size = data_size / 4;
+  const std::filesystem::path sidecar = FileChecksums::get_filename(file_name);
+
+  for (bool use_o_direct : {false,true})
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_checksums use_o_direct={}", use_o_direct);
+    FileWriter writer(use_o_direct);
+    EXPECT_EQ(writer.get_checksum_chunk_bytes(), 0);
+    writer.set_checksum_chunk_bytes(chunk_bytes);
+    EXPECT_EQ(writer.get_checksum_chunk_bytes(), chunk_bytes);
+    writer.set_async_depth(2);
+
+    // write the data synchronously, asynchronously and with a final partial chunk
+    writer.open_file(file_name);
+    writer.write_header(header);
+    writer.write_data(file_data, write_size);
+    writer.write_data_async(file_data + write_size, write_size); // NOLINT
+    writer.write_data(file_data + 2 * write_size, write_size + 3); // NOLINT
+    writer.close_file();
+    ASSERT_TRUE(std::filesystem::exists(sidecar));
+
+    const uint64_t data_bytes = 3 * write_size + 3;
+    const uint64_t nchunks = (data_bytes + chunk_bytes - 1) / chunk_bytes;
+    {
+      FileReader reader(file_name);
+      EXPECT_EQ(reader.verify_checksums(), nchunks);
+
+      reader.set_verify_checksums(true);
+      EXPECT_TRUE(reader.get_verify_checksums());
+      reader.read_header();
+      std::vector<char> read_data(data_bytes);
+      EXPECT_EQ(reader.read_data(&read_data[0], data_bytes), data_bytes);
+      EXPECT_EQ(reader.get_chunks_verified(), nchunks);
+      EXPECT_EQ(reader.read_data_at(&read_data[0], chunk_bytes, chunk_bytes), chunk_bytes);
+      EXPECT_EQ(reader.get_chunks_verified(), nchunks + 1);
+    }
+
+    // corrupt one byte of the second chunk
+    int fd = ::open(file_name.c_str(), O_WRONLY); // NOLINT
+    ASSERT_GE(fd, 0);
+    const char corrupt = 0x55;
+    ASSERT_EQ(::pwrite(fd, &corrupt, 1, header_size + chunk_bytes + 1), 1);
+    ::close(fd);
+
+    {
+      FileReader reader(file_name);
+      EXPECT_THROW(reader.verify_checksums(), std::runtime_error); // NOLINT
+
+      reader.set_verify_checksums(true);
+      reader.read_header();
+      std::vector<char> read_data(chunk_bytes);
+      EXPECT_EQ(reader.read_data(&read_data[0], chunk_bytes), chunk_bytes);
+      EXPECT_THROW(reader.read_data(&read_data[0], chunk_bytes), std::runtime_error); // NOLINT
+      EXPECT_THROW(reader.read_data_at(&read_data[0], chunk_bytes, chunk_bytes), std::runtime_error); // NOLINT
+    }
+    std::filesystem::remove(sidecar);
+  }
+
+  // the reader cannot verify a file without a sidecar
+  FileReader reader(file_name);
+  EXPECT_THROW(reader.set_verify_checksums(true), std::runtime_error); // NOLINT
+}
+
+TEST_F(FileWriterTest, test_compression) // NOLINT
+{
+  // weights-like data, in which every 52 byte packet is identical
+  static constexpr uint32_t packet_bytes = 52;
+  header.set("PACKET_WEIGHTS_SIZE", packet_bytes - sizeof(float));
+  header.set("PACKET_SCALES_SIZE", sizeof(float));
+  std::vector<char> weights(data_size);
+  for (unsigned i=0; i<data_size; i++)
+  {
+    weights[i] = static_cast<char>((i % packet_bytes) + 1); // NOLINT
+  }
+  const uint64_t write_size = data_size / 4;
+
+  for (bool use_o_direct : {false,true})
+  {
+    SPDLOG_TRACE("ska::pst::common::test::FileWriterTest::test_compression use_o_direct={}", use_o_direct);
+    FileWriter writer(use_o_direct);
+    EXPECT_FALSE(writer.get_compression());
+    writer.set_compression(true);
+    EXPECT_TRUE(writer.get_compression());
+    writer.set_async_depth(2);
+
+    writer.open_file(file_name);
+    writer.write_header(header);
+    for (unsigned i=0; i<4; i++)
+    {
+      if (i % 2)
+      {
+        writer.write_data_async(&weights[i * write_size], write_size);
+      }
+      else
+      {
+        EXPECT_EQ(writer.write_data(&weights[i * write_size], write_size), write_size);
+      }
+    }
+    EXPECT_EQ(writer.get_uncompressed_bytes_written(), data_size);
+    EXPECT_LT(writer.get_data_bytes_written() * 100, data_size);
+    writer.close_file();
+    EXPECT_EQ(std::filesystem::file_size(file_name), header_size + writer.get_data_bytes_written());
+
+    FileReader reader(file_name, use_o_direct);
+    reader.read_header();
+    EXPECT_TRUE(reader.is_compressed());
+    EXPECT_EQ(reader.get_header().get_val("COMPRESSION"), WeightsCodec::compression_name);
+    EXPECT_EQ(reader.get_header().get_uint32("COMPRESSION_STRIDE"), packet_bytes);
+    EXPECT_EQ(reader.get_data_size(), data_size);
+
+    // read in pieces that span the frames
+    std::vector<char> read_data(data_size);
+    static constexpr uint64_t piece_bytes = 100000;
+    uint64_t offset = 0;
+    while (offset < data_size)
+    {
+      auto bytes_read = reader.read_data(&read_data[offset], piece_bytes);
+      ASSERT_GT(bytes_read, 0);
+      offset += bytes_read;
+    }
+    EXPECT_EQ(offset, data_size);
+    EXPECT_EQ(reader.read_data(&read_data[0], piece_bytes), 0);
+    EXPECT_EQ(read_data, weights);
+
+    std::fill(read_data.begin(), read_data.end(), 0);
+    EXPECT_EQ(reader.read_data_at(&read_data[0], write_size * 2, write_size - 7), write_size * 2);
+    for (unsigned i=0; i<write_size * 2; i++)
+    {
+      ASSERT_EQ(read_data[i], weights[write_size - 7 + i]);
+    }
+  }
+
+  // uncompressed files report the size of the data that follow the header
+  FileWriter writer;
+  writer.open_file(file_name);
+  writer.write_header(header);
+  writer.write_data(file_data, data_size);
+  writer.close_file();
+  FileReader reader(file_name);
+  reader.read_header();
+  EXPECT_FALSE(reader.is_compressed());
+  EXPECT_EQ(reader.get_data_size(), data_size);
+}
+
 } // namespace ska::pst::common::test
@@ -32,6 +32,7 @@
 #include "ska/pst/common/testutils/GtestMain.h"
 
 #include <spdlog/spdlog.h>
+#include <vector>
 
 auto main(int argc, char* argv[]) -> int
 {
@@ -144,6 +145,23 @@ TEST_F(HeapLayoutTest, test_invalid_udp_nsamp) // NOLINT
   EXPECT_THROW(layout.configure(invalid_data_header, invalid_weights_header), std::runtime_error); // NOLINT
 }
 
+TEST_F(HeapLayoutTest, test_invalid_packed_wt_nsamp) // NOLINT
+{
+  ska::pst::common::AsciiHeader invalid_data_header(data_header);
+  ska::pst::common::AsciiHeader invalid_weights_header(weights_header);
+
+  // a single sample of 2-bit data does not fill a whole byte
+  invalid_data_header.set("NBIT", 2);
+  invalid_data_header.set("WT_NSAMP", 1);
+  invalid_weights_header.set("WT_NSAMP", 1);
+  EXPECT_THROW(layout.configure(invalid_data_header, invalid_weights_header), std::runtime_error); // NOLINT
+
+  // two samples of 2-bit complex data fill a whole byte
+  invalid_data_header.set("WT_NSAMP", 2);
+  invalid_weights_header.set("WT_NSAMP", 2);
+  EXPECT_NO_THROW(layout.configure(invalid_data_header, invalid_weights_header)); // NOLINT
+}
+
 TEST_F(HeapLayoutTest, test_invalid_data_nbit) // NOLINT
 {
   ska::pst::common::AsciiHeader invalid_data_header(data_header);
@@ -184,4 +202,47 @@ TEST_F(HeapLayoutTest, test_invalid_weights_npol) // NOLINT
   EXPECT_THROW(layout.configure(data_header, invalid_weights_header), std::runtime_error); // NOLINT
 }
 
+TEST_F(HeapLayoutTest, test_get_packets) // NOLINT
+{
+  layout.configure(data_header, weights_header);
+  const auto& packet_layout = layout.get_packet_layout();
+  const uint32_t packets_per_heap = layout.get_packets_per_heap();
+
+  static constexpr uint32_t nheaps = 4;
+  static constexpr uint32_t heap_begin = 1;
+  std::vector<char> data(nheaps * layout.get_data_heap_stride());
+  std::vector<char> weights(nheaps * layout.get_weights_heap_stride());
+
+  auto packets = layout.get_packets(data.data(), weights.data(), heap_begin, nheaps);
+  EXPECT_EQ(packets.size(), (nheaps - heap_begin) * packets_per_heap);
+
+  uint64_t packet_number = heap_begin * packets_per_heap;
+  for (const auto& packet : packets)
+  {
+    const uint64_t iheap = packet_number / packets_per_heap;
+    const uint32_t ipacket = packet_number % packets_per_heap;
+    ASSERT_EQ(packet.packet_number, packet_number);
+    ASSERT_EQ(packet.heap_packet, ipacket);
+    ASSERT_EQ(packet.data, data.data() + packet_number * layout.get_data_packet_stride());
+    ASSERT_EQ(packet.scales, weights.data() + packet_number * layout.get_weights_packet_stride() + packet_layout.get_packet_scales_offset());
+    ASSERT_EQ(packet.weights, weights.data() + packet_number * layout.get_weights_packet_stride() + packet_layout.get_packet_weights_offset());
+    ASSERT_EQ(packet.chan_begin, ipacket * udp_nchan);
+    ASSERT_EQ(packet.chan_end, (ipacket + 1) * udp_nchan);
+    ASSERT_EQ(packet.samp_begin, iheap * udp_nsamp);
+    ASSERT_EQ(packet.samp_end, (iheap + 1) * udp_nsamp);
+    packet_number++;
+  }
+  EXPECT_EQ(packet_number, nheaps * packets_per_heap);
+
+  // without a weights stream, the scales and weights pointers are null
+  const std::vector<char>& const_data = data;
+  for (const auto& packet : layout.get_packets(const_data.data(), nullptr, 0, 1))
+  {
+    ASSERT_EQ(packet.scales, nullptr);
+    ASSERT_EQ(packet.weights, nullptr);
+  }
+
+  EXPECT_EQ(layout.get_packets(data.data(), nullptr, 2, 2).size(), 0);
+}
+
 } // namespace ska::pst::common::test
@@ -34,6 +34,7 @@
 #include "ska/pst/common/definitions.h"
 #include "ska/pst/common/testutils/GtestMain.h"
 #include "ska/pst/common/utils/tests/NormalSequenceTest.h"
+#include "ska/pst/common/utils/PackedSamples.h"
 
 auto main(int argc, char* argv[]) -> int
 {
@@ -147,6 +148,39 @@ TEST_F(NormalSequenceTest, test_generate_16bit) // NOLINT
   assert_mean_stddev(unpacked, expected_mean, expected_stddev);
 }
 
+TEST_F(NormalSequenceTest, test_generate_4bit) // NOLINT
+{
+  data_header.load_from_file(test_data_file("8bit_data_header.txt"));
+
+  // a standard deviation that is small compared to the range of 4-bit integers
+  static constexpr uint32_t nbit = 4;
+  static constexpr float expected_mean = 0.0;
+  static constexpr float expected_stddev = 1.5;
+  data_header.set("NBIT", nbit);
+  data_header.set("NORMAL_DIST_MEAN", expected_mean);
+  data_header.set("NORMAL_DIST_STDDEV", expected_stddev);
+
+  NormalSequence ns;
+  ns.configure(data_header);
+  ns.generate(&buffer[0], buffer.size());
+
+  const unsigned buffer_nval = (buffer.size() * ska::pst::common::bits_per_byte) / nbit;
+  std::vector<int8_t> values(buffer_nval);
+  ska::pst::common::unpack_values(&buffer[0], buffer_nval, nbit, values.data());
+
+  std::vector<float> unpacked(buffer_nval);
+  for (unsigned i=0; i<buffer_nval; i++)
+  {
+    ASSERT_GE(values[i], -8); // NOLINT
+    ASSERT_LE(values[i], 7); // NOLINT
+    unpacked[i] = static_cast<float>(values[i]);
+  }
+  assert_mean_stddev(unpacked, expected_mean, expected_stddev);
+
+  ns.reset();
+  EXPECT_TRUE(ns.validate(&buffer[0], buffer.size()));
+}
+
 TEST_F(NormalSequenceTest, test_generate_red_noise) // NOLINT
 {
   data_header.load_from_file(test_data_file("16bit_data_header.txt"));
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/definitions.h"
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/PackedSamplesTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void PackedSamplesTest::SetUp()
+{
+  nbit = GetParam();
+  static constexpr uint64_t nval = 1024;
+  const int32_t nstates = 1 << nbit;
+  values.resize(nval);
+  for (uint64_t i=0; i<nval; i++)
+  {
+    values[i] = static_cast<int8_t>(static_cast<int32_t>((i * 5) % nstates) - (nstates / 2)); // NOLINT
+  }
+  packed.resize(nval * nbit / ska::pst::common::bits_per_byte);
+  pack_values(values.data(), values.size(), nbit, packed.data());
+}
+
+void PackedSamplesTest::TearDown()
+{
+}
+
+TEST_P(PackedSamplesTest, test_pack_unpack_values) // NOLINT
+{
+  EXPECT_TRUE(is_packed_nbit(nbit));
+  std::vector<int8_t> unpacked(values.size());
+  unpack_values(packed.data(), unpacked.size(), nbit, unpacked.data());
+  EXPECT_EQ(unpacked, values);
+}
+
+TEST_P(PackedSamplesTest, test_convert_packed_complex_samples) // NOLINT
+{
+  // also convert an odd number of samples, which only partially fill the last byte at 2 bits
+  const uint64_t nsamp = (values.size() / 2) - 1;
+  static constexpr float scale = 0.5;
+  std::vector<std::complex<float>> output(nsamp);
+  convert_packed_complex_samples(packed.data(), nsamp, nbit, scale, output.data());
+  for (uint64_t isamp=0; isamp<nsamp; isamp++)
+  {
+    ASSERT_EQ(output[isamp], std::complex<float>(values[2*isamp] * scale, values[(2*isamp)+1] * scale));
+  }
+}
+
+TEST_P(PackedSamplesTest, test_sum_packed_complex_power) // NOLINT
+{
+  const uint64_t nsamp = (values.size() / 2) - 1;
+  float expected = 0;
+  for (uint64_t ival=0; ival<nsamp*2; ival++)
+  {
+    expected += static_cast<float>(values[ival] * values[ival]);
+  }
+  EXPECT_EQ(sum_packed_complex_power(packed.data(), nsamp, nbit), expected);
+}
+
+TEST(PackedSamplesInvalidTest, test_invalid_nbit) // NOLINT
+{
+  static constexpr uint32_t nbit = 8;
+  EXPECT_FALSE(is_packed_nbit(nbit));
+  std::vector<int8_t> values(2, 0);
+  std::vector<char> packed(2, 0);
+  EXPECT_THROW(pack_values(values.data(), values.size(), nbit, packed.data()), std::runtime_error); // NOLINT
+  EXPECT_THROW(unpack_values(packed.data(), values.size(), nbit, values.data()), std::runtime_error); // NOLINT
+}
+
+INSTANTIATE_TEST_SUITE_P(BitDepths, PackedSamplesTest, testing::Values(2, 4)); // NOLINT
+
+} // namespace ska::pst::common::test
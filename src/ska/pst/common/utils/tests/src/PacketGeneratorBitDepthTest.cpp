@@ -34,6 +34,7 @@
 #include "ska/pst/common/utils/tests/PacketGeneratorBitDepthTest.h"
 #include "ska/pst/common/utils/GaussianNoiseGenerator.h"
 #include "ska/pst/common/utils/SineWaveGenerator.h"
+#include "ska/pst/common/utils/SquareWaveGenerator.h"
 
 auto main(int argc, char* argv[]) -> int
 {
@@ -121,8 +122,15 @@ TEST_P(PacketGeneratorBitDepthTest, test_generate_validate_blocks) // NOLINT
   swg.reset();
   EXPECT_TRUE(swg.test_data(buffer_ptr, buffer_size));
   EXPECT_FALSE(swg.test_data(buffer_ptr, buffer_size));
+
+  ska::pst::common::SquareWaveGenerator sqwg(layout);
+  sqwg.configure(header);
+  sqwg.fill_data(buffer_ptr, buffer_size);
+  sqwg.reset();
+  EXPECT_TRUE(sqwg.test_data(buffer_ptr, buffer_size));
+  EXPECT_FALSE(sqwg.test_data(buffer_ptr, buffer_size));
 }
 
-INSTANTIATE_TEST_SUITE_P(SignalGenerators, PacketGeneratorBitDepthTest, testing::Values(8, 16)); // NOLINT
+INSTANTIATE_TEST_SUITE_P(SignalGenerators, PacketGeneratorBitDepthTest, testing::Values(2, 4, 8, 16)); // NOLINT
 
 } // namespace ska::pst::common::test
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <array>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/PacketKernelsTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void PacketKernelsTest::SetUp()
+{
+  std::tie(nbit, nsamp, nchan, npol) = GetParam();
+  const uint64_t nval = static_cast<uint64_t>(nsamp) * nchan * npol * 2;
+  if (nbit == 8) // NOLINT
+  {
+    fill_packet<int8_t>(nval);
+  }
+  else
+  {
+    fill_packet<int16_t>(nval);
+  }
+}
+
+void PacketKernelsTest::TearDown()
+{
+}
+
+auto PacketKernelsTest::get_packet_value(uint64_t i) const -> float
+{
+  if (nbit == 8) // NOLINT
+  {
+    return reinterpret_cast<const int8_t *>(packet.data())[i]; // NOLINT
+  }
+  return reinterpret_cast<const int16_t *>(packet.data())[i]; // NOLINT
+}
+
+TEST_P(PacketKernelsTest, test_unpack) // NOLINT
+{
+  PacketKernels kernels = get_packet_kernels(nbit, nsamp, nchan, npol);
+  ASSERT_NE(kernels.unpack, nullptr);
+
+  // unpack into a TFP array with additional channels on either side of the packet
+  static constexpr uint32_t chan_offset = 3;
+  const uint64_t samp_stride = static_cast<uint64_t>(nchan + (2 * chan_offset)) * npol;
+  std::vector<std::complex<float>> output(nsamp * samp_stride, std::complex<float>(-1, -1));
+  static constexpr float scale = 0.5;
+  kernels.unpack(packet.data(), scale, &output[chan_offset * npol], samp_stride, npol, 1);
+
+  uint64_t ival = 0;
+  for (uint32_t ipol=0; ipol<npol; ipol++)
+  {
+    for (uint32_t ichan=0; ichan<nchan; ichan++)
+    {
+      for (uint32_t isamp=0; isamp<nsamp; isamp++)
+      {
+        const std::complex<float>& value = output[(isamp * samp_stride) + ((chan_offset + ichan) * npol) + ipol];
+        ASSERT_EQ(value.real(), get_packet_value(ival) * scale);
+        ASSERT_EQ(value.imag(), get_packet_value(ival + 1) * scale);
+        ival += 2;
+      }
+    }
+  }
+
+  // the channels outside of the packet are not modified
+  for (uint32_t isamp=0; isamp<nsamp; isamp++)
+  {
+    ASSERT_EQ(output[isamp * samp_stride], std::complex<float>(-1, -1));
+  }
+}
+
+TEST_P(PacketKernelsTest, test_unpack_channel_major) // NOLINT
+{
+  PacketKernels kernels = get_packet_kernels(nbit, nsamp, nchan, npol);
+  ASSERT_NE(kernels.unpack, nullptr);
+  static constexpr float scale = 0.25;
+
+  // unpack into FTP and PFT arrays, whose rows of time samples are strided and contiguous respectively
+  const uint64_t nval = static_cast<uint64_t>(nsamp) * nchan * npol;
+  const std::vector<std::array<uint64_t, 3>> strides = {
+    { npol, static_cast<uint64_t>(nsamp) * npol, 1 },
+    { 1, nsamp, static_cast<uint64_t>(nsamp) * nchan }
+  };
+  for (const auto& stride : strides)
+  {
+    std::vector<std::complex<float>> output(nval, std::complex<float>(-1, -1));
+    kernels.unpack(packet.data(), scale, output.data(), stride[0], stride[1], stride[2]);
+
+    uint64_t ival = 0;
+    for (uint32_t ipol=0; ipol<npol; ipol++)
+    {
+      for (uint32_t ichan=0; ichan<nchan; ichan++)
+      {
+        for (uint32_t isamp=0; isamp<nsamp; isamp++)
+        {
+          const std::complex<float>& value = output[(isamp * stride[0]) + (ichan * stride[1]) + (ipol * stride[2])];
+          ASSERT_EQ(value.real(), get_packet_value(ival) * scale) << " samp_stride=" << stride[0];
+          ASSERT_EQ(value.imag(), get_packet_value(ival + 1) * scale) << " samp_stride=" << stride[0];
+          ival += 2;
+        }
+      }
+    }
+  }
+}
+
+TEST_P(PacketKernelsTest, test_integrate) // NOLINT
+{
+  PacketKernels kernels = get_packet_kernels(nbit, nsamp, nchan, npol);
+  ASSERT_NE(kernels.integrate, nullptr);
+
+  static constexpr float initial = 1.0;
+  static constexpr float scale = 0.25;
+  std::vector<float> bandpass(nchan * npol, initial);
+  kernels.integrate(packet.data(), scale, bandpass.data());
+
+  uint64_t ival = 0;
+  for (uint32_t ipol=0; ipol<npol; ipol++)
+  {
+    for (uint32_t ichan=0; ichan<nchan; ichan++)
+    {
+      double power = 0;
+      for (uint32_t isamp=0; isamp<nsamp*2; isamp++)
+      {
+        const double value = get_packet_value(ival++);
+        power += value * value;
+      }
+      const double expected = initial + (power * scale);
+      EXPECT_NEAR(bandpass[(ichan * npol) + ipol], expected, expected * 1e-6); // NOLINT
+    }
+  }
+}
+
+TEST(PacketKernelsGenericTest, test_unspecialised_geometry) // NOLINT
+{
+  static constexpr uint32_t nbit = 16;
+  static constexpr uint32_t nsamp = 7;
+  static constexpr uint32_t nchan = 3;
+  static constexpr uint32_t npol = 1;
+  PacketKernels kernels = get_packet_kernels(nbit, nsamp, nchan, npol);
+  EXPECT_EQ(kernels.unpack, nullptr);
+  EXPECT_EQ(kernels.integrate, nullptr);
+}
+
+INSTANTIATE_TEST_SUITE_P(Geometries, PacketKernelsTest, testing::Values( // NOLINT
+  PacketGeometry(16, 32, 24, 2), // NOLINT Low
+  PacketGeometry(16, 4, 185, 2), // NOLINT Mid 16-bit
+  PacketGeometry(8, 4, 185, 2))); // NOLINT Mid 8-bit
+
+} // namespace ska::pst::common::test
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/RateControllerTest.h"
+#include "ska/pst/common/utils/PacedSegmentProducer.h"
+#include "ska/pst/common/utils/RateController.h"
+#include "ska/pst/common/utils/SegmentGenerator.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+static auto get_thread_cpu_seconds() -> double
+{
+  struct timespec now{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9; // NOLINT
+}
+
+void RateControllerTest::SetUp()
+{
+  data_header.load_from_file(test_data_file("SegmentGenerator_data_header.txt"));
+  weights_header.load_from_file(test_data_file("SegmentGenerator_weights_header.txt"));
+  data_header.set_val("DATA_GENERATOR", "Random");
+}
+
+void RateControllerTest::TearDown()
+{
+}
+
+TEST_F(RateControllerTest, test_construct) // NOLINT
+{
+  EXPECT_THROW(RateController controller(0.0), std::runtime_error); // NOLINT
+  EXPECT_THROW(RateController controller(-1.0), std::runtime_error); // NOLINT
+
+  RateController controller(data_header);
+  EXPECT_DOUBLE_EQ(controller.get_bytes_per_second(), data_header.compute_bytes_per_second());
+  EXPECT_EQ(controller.get_deadlines(), 0);
+  EXPECT_EQ(controller.get_lateness_histogram().size(), RateController::lateness_bins);
+  EXPECT_EQ(controller.get_mean_lateness_nanoseconds(), 0);
+}
+
+TEST_F(RateControllerTest, test_lateness_bin) // NOLINT
+{
+  EXPECT_EQ(RateController::get_lateness_bin(0), 0);
+  EXPECT_EQ(RateController::get_lateness_bin(999), 0); // NOLINT
+  EXPECT_EQ(RateController::get_lateness_bin(1000), 1); // NOLINT
+  EXPECT_EQ(RateController::get_lateness_bin(1999), 1); // NOLINT
+  EXPECT_EQ(RateController::get_lateness_bin(2000), 2); // NOLINT
+  EXPECT_EQ(RateController::get_lateness_bin(4000), 3); // NOLINT
+  EXPECT_EQ(RateController::get_lateness_bin(UINT64_MAX), RateController::lateness_bins - 1);
+}
+
+TEST_F(RateControllerTest, test_pacing) // NOLINT
+{
+  // 50 deadlines 2 ms apart
+  static constexpr double bytes_per_second = 1e6;
+  static constexpr uint64_t bytes_per_wait = 2000;
+  static constexpr uint64_t nwaits = 50;
+  static constexpr double expected_seconds = 0.1;
+  RateController controller(bytes_per_second);
+
+  const double cpu_start = get_thread_cpu_seconds();
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t iwait = 0; iwait < nwaits; iwait++)
+  {
+    controller.wait(bytes_per_wait);
+  }
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double cpu_seconds = get_thread_cpu_seconds() - cpu_start;
+  controller.print_statistics();
+
+  EXPECT_GE(elapsed, expected_seconds);
+  EXPECT_LT(elapsed, 2 * expected_seconds);
+  EXPECT_EQ(controller.get_bytes_emitted(), nwaits * bytes_per_wait);
+  EXPECT_EQ(controller.get_deadlines(), nwaits);
+
+  // the caller sleeps for most of the time between deadlines
+  EXPECT_LT(cpu_seconds, elapsed / 2);
+
+  const auto& histogram = controller.get_lateness_histogram();
+  EXPECT_EQ(std::accumulate(histogram.begin(), histogram.end(), uint64_t(0)), nwaits);
+}
+
+TEST_F(RateControllerTest, test_missed_deadlines) // NOLINT
+{
+  static constexpr double bytes_per_second = 1e6;
+  static constexpr uint64_t bytes_per_wait = 1000;
+  static constexpr auto delay = std::chrono::milliseconds(5);
+  RateController controller(bytes_per_second);
+
+  controller.wait(bytes_per_wait);
+  EXPECT_EQ(controller.get_missed_deadlines(), 0);
+
+  // the producer falls behind by more than one deadline
+  std::this_thread::sleep_for(delay);
+  controller.wait(bytes_per_wait);
+  EXPECT_EQ(controller.get_missed_deadlines(), 1);
+  EXPECT_GE(controller.get_max_lateness_nanoseconds(), 3000000); // NOLINT
+  EXPECT_GT(controller.get_lateness_histogram()[RateController::get_lateness_bin(controller.get_max_lateness_nanoseconds())], 0);
+
+  // restarting the stream resets the statistics
+  controller.start();
+  EXPECT_EQ(controller.get_deadlines(), 0);
+  EXPECT_EQ(controller.get_missed_deadlines(), 0);
+  EXPECT_EQ(controller.get_max_lateness_nanoseconds(), 0);
+  controller.wait(bytes_per_wait);
+  EXPECT_EQ(controller.get_missed_deadlines(), 0);
+}
+
+TEST_F(RateControllerTest, test_paced_segment_producer) // NOLINT
+{
+  static constexpr uint64_t nsegments = 4;
+  auto generator = std::make_shared<SegmentGenerator>();
+  generator->configure(data_header, weights_header);
+  generator->resize(1);
+
+  PacedSegmentProducer producer(generator);
+  EXPECT_DOUBLE_EQ(producer.get_rate_controller().get_bytes_per_second(), data_header.compute_bytes_per_second());
+  EXPECT_EQ(producer.get_data_header().get_val("UTC_START"), generator->get_data_header().get_val("UTC_START"));
+
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t bytes = 0;
+  for (uint64_t isegment = 0; isegment < nsegments; isegment++)
+  {
+    bytes += producer.next_segment().data.size;
+  }
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  EXPECT_GE(elapsed, static_cast<double>(bytes) / data_header.compute_bytes_per_second());
+  EXPECT_EQ(producer.get_rate_controller().get_deadlines(), nsegments);
+  EXPECT_EQ(producer.get_rate_controller().get_bytes_emitted(), bytes);
+}
+
+} // namespace ska::pst::common::test
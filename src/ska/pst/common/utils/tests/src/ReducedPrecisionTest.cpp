@@ -0,0 +1,116 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <limits>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/ReducedPrecisionTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void ReducedPrecisionTest::SetUp()
+{
+}
+
+void ReducedPrecisionTest::TearDown()
+{
+}
+
+TEST_F(ReducedPrecisionTest, test_float_to_int16) // NOLINT
+{
+  EXPECT_EQ(float_to_int16(0.0), 0);
+  EXPECT_EQ(float_to_int16(1.4), 1);
+  EXPECT_EQ(float_to_int16(-1.6), -2);
+
+  // round half to even
+  EXPECT_EQ(float_to_int16(2.5), 2);
+  EXPECT_EQ(float_to_int16(3.5), 4);
+
+  // saturate at the limits of int16_t
+  EXPECT_EQ(float_to_int16(1e6), std::numeric_limits<int16_t>::max());
+  EXPECT_EQ(float_to_int16(-1e6), std::numeric_limits<int16_t>::min());
+}
+
+TEST_F(ReducedPrecisionTest, test_fp16) // NOLINT
+{
+  // bit patterns of known values
+  EXPECT_EQ(float_to_fp16(0.0), 0x0000);
+  EXPECT_EQ(float_to_fp16(-0.0), 0x8000);
+  EXPECT_EQ(float_to_fp16(1.0), 0x3c00);
+  EXPECT_EQ(float_to_fp16(-2.0), 0xc000);
+  EXPECT_EQ(float_to_fp16(65504.0), 0x7bff);
+  EXPECT_EQ(float_to_fp16(1e6), 0x7c00);
+  EXPECT_EQ(float_to_fp16(std::numeric_limits<float>::infinity()), 0x7c00);
+  EXPECT_EQ(float_to_fp16(std::ldexp(1.0f, -24)), 0x0001);
+  EXPECT_TRUE(std::isnan(fp16_to_float(float_to_fp16(std::nanf("")))));
+
+  // 1 + 2^-11 is half way between 1 and the next half-precision value, and rounds to even
+  EXPECT_EQ(float_to_fp16(1.0f + std::ldexp(1.0f, -11)), 0x3c00);
+  EXPECT_EQ(float_to_fp16(1.0f + std::ldexp(3.0f, -11)), 0x3c02);
+
+  // every finite half-precision value survives the round trip through single precision
+  static constexpr uint32_t nvalues = 1U << 16U;
+  for (uint32_t bits=0; bits<nvalues; bits++)
+  {
+    const auto half = static_cast<uint16_t>(bits);
+    const float value = fp16_to_float(half);
+    if (std::isfinite(value))
+    {
+      ASSERT_EQ(float_to_fp16(value), half) << "bits=" << bits;
+    }
+  }
+}
+
+TEST_F(ReducedPrecisionTest, test_bf16) // NOLINT
+{
+  EXPECT_EQ(float_to_bf16(0.0), 0x0000);
+  EXPECT_EQ(float_to_bf16(1.0), 0x3f80);
+  EXPECT_EQ(float_to_bf16(-2.0), 0xc000);
+  EXPECT_EQ(bf16_to_float(0x3f80), 1.0);
+
+  // 1 + 2^-8 is half way between 1 and the next bfloat16 value, and rounds to even
+  EXPECT_EQ(float_to_bf16(1.0f + std::ldexp(1.0f, -8)), 0x3f80);
+  EXPECT_EQ(float_to_bf16(1.0f + std::ldexp(3.0f, -8)), 0x3f82);
+  EXPECT_TRUE(std::isnan(bf16_to_float(float_to_bf16(std::nanf("")))));
+
+  // integers up to 256 are exactly representable
+  for (int i=-256; i<=256; i++) // NOLINT
+  {
+    ASSERT_EQ(bf16_to_float(float_to_bf16(static_cast<float>(i))), static_cast<float>(i));
+  }
+}
+
+} // namespace ska::pst::common::test
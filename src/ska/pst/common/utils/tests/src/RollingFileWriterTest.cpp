@@ -0,0 +1,250 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/RollingFileWriterTest.h"
+#include "ska/pst/common/utils/FileReader.h"
+#include "ska/pst/common/utils/FileWriter.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void RollingFileWriterTest::SetUp()
+{
+  header.load_from_file(test_data_file("data_scan_config.txt"));
+  header.set_val("UTC_START", "2023-07-31-13:41:23");
+  resolution = header.get_uint64("RESOLUTION");
+
+  FileWriter tmp;
+  posix_memalign(reinterpret_cast<void **>(&data), tmp.block_alignment(), data_size); // NOLINT
+  for (uint64_t i=0; i<data_size; i++)
+  {
+    data[i] = static_cast<char>(i % 251); // NOLINT
+  }
+
+  std::filesystem::remove_all(output_dir);
+  std::filesystem::create_directory(output_dir);
+}
+
+void RollingFileWriterTest::TearDown()
+{
+  std::filesystem::remove_all(output_dir);
+  free(data); // NOLINT
+}
+
+void RollingFileWriterTest::write_chunks(RollingFileWriter& writer, uint64_t nbytes)
+{
+  static constexpr uint64_t chunk_size = 50000;
+  uint64_t offset = 0;
+  while (offset < nbytes)
+  {
+    uint64_t bytes_to_write = std::min(chunk_size, nbytes - offset);
+    ASSERT_EQ(writer.write_data(data + offset, bytes_to_write), bytes_to_write); // NOLINT
+    offset += bytes_to_write;
+  }
+  EXPECT_EQ(writer.get_data_bytes_written(), nbytes);
+}
+
+void RollingFileWriterTest::check_files(const RollingFileWriter& writer, uint64_t nbytes)
+{
+  const auto& filenames = writer.get_filenames();
+
+  // only the files written remain in the output directory
+  uint64_t nfiles = std::distance(std::filesystem::directory_iterator(output_dir), std::filesystem::directory_iterator());
+  EXPECT_EQ(nfiles, filenames.size());
+
+  uint64_t file_bytes = writer.get_file_data_bytes();
+  uint64_t expected_files = (file_bytes > 0) ? (nbytes + file_bytes - 1) / file_bytes : 1;
+  EXPECT_EQ(filenames.size(), expected_files);
+
+  uint64_t offset = 0;
+  for (uint64_t ifile=0; ifile<filenames.size(); ifile++)
+  {
+    SPDLOG_TRACE("ska::pst::common::test::RollingFileWriterTest::check_files {}", filenames[ifile].generic_string());
+    EXPECT_EQ(filenames[ifile], output_dir / FileWriter::get_filename(header.get_val("UTC_START"), offset, ifile));
+
+    FileReader reader(filenames[ifile]);
+    reader.read_header();
+    EXPECT_EQ(reader.get_header().get_uint64("FILE_NUMBER"), ifile);
+    EXPECT_EQ(reader.get_header().get_uint64("OBS_OFFSET"), offset);
+
+    uint64_t expected_bytes = (file_bytes > 0) ? std::min(file_bytes, nbytes - offset) : nbytes;
+    EXPECT_EQ(std::filesystem::file_size(filenames[ifile]), header.get_uint64("HDR_SIZE") + expected_bytes);
+
+    std::vector<char> read_data(expected_bytes);
+    EXPECT_EQ(reader.read_data(&read_data[0], expected_bytes), expected_bytes);
+    for (uint64_t i=0; i<expected_bytes; i++)
+    {
+      ASSERT_EQ(read_data[i], data[offset + i]); // NOLINT
+    }
+    offset += expected_bytes;
+  }
+  EXPECT_EQ(offset, nbytes);
+}
+
+TEST_P(RollingFileWriterTest, test_no_rollover) // NOLINT
+{
+  RollingFileWriter writer(GetParam());
+  writer.open(output_dir, header);
+  EXPECT_TRUE(writer.is_open());
+  EXPECT_EQ(writer.get_file_data_bytes(), 0);
+
+  write_chunks(writer, data_size);
+  EXPECT_EQ(writer.get_file_number(), 0);
+  writer.close();
+  EXPECT_FALSE(writer.is_open());
+
+  check_files(writer, data_size);
+}
+
+TEST_P(RollingFileWriterTest, test_rollover_bytes) // NOLINT
+{
+  static constexpr uint64_t heaps_per_file = 3;
+  static constexpr uint64_t extra_bytes = 100;
+  RollingFileWriter writer(GetParam());
+  writer.set_max_file_bytes(heaps_per_file * resolution + extra_bytes);
+  writer.open(output_dir, header);
+
+  // the threshold is rounded down to complete heaps
+  EXPECT_EQ(writer.get_file_data_bytes(), heaps_per_file * resolution);
+
+  write_chunks(writer, data_size);
+  EXPECT_EQ(writer.get_file_number(), writer.get_filenames().size() - 1);
+  writer.close();
+
+  check_files(writer, data_size);
+}
+
+TEST_P(RollingFileWriterTest, test_rollover_seconds) // NOLINT
+{
+  static constexpr uint64_t heaps_per_file = 2;
+  const double seconds_per_heap = static_cast<double>(resolution) / header.compute_bytes_per_second();
+  RollingFileWriter writer(GetParam());
+  writer.set_max_file_seconds((heaps_per_file + 0.5) * seconds_per_heap); // NOLINT
+  writer.set_preallocate(true);
+  writer.open(output_dir, header);
+  EXPECT_EQ(writer.get_file_data_bytes(), heaps_per_file * resolution);
+
+  write_chunks(writer, data_size - resolution / 2);
+  writer.close();
+
+  check_files(writer, data_size - resolution / 2);
+}
+
+TEST_P(RollingFileWriterTest, test_smaller_threshold) // NOLINT
+{
+  static constexpr uint64_t heaps_per_file = 2;
+  const double seconds_per_heap = static_cast<double>(resolution) / header.compute_bytes_per_second();
+  RollingFileWriter writer(GetParam());
+  writer.set_max_file_seconds((heaps_per_file + 0.5) * seconds_per_heap); // NOLINT
+  writer.set_max_file_bytes(resolution);
+  writer.open(output_dir, header);
+  EXPECT_EQ(writer.get_file_data_bytes(), resolution);
+
+  write_chunks(writer, data_size);
+  writer.close();
+
+  check_files(writer, data_size);
+}
+
+TEST_P(RollingFileWriterTest, test_exact_file_boundary) // NOLINT
+{
+  static constexpr uint64_t nfiles = 4;
+  RollingFileWriter writer(GetParam());
+  writer.set_max_file_bytes(data_size / nfiles);
+  writer.set_preallocate(true);
+  writer.open(output_dir, header);
+
+  // no empty file follows the last full file
+  write_chunks(writer, data_size);
+  writer.close();
+
+  check_files(writer, data_size);
+  EXPECT_EQ(writer.get_filenames().size(), nfiles);
+}
+
+TEST_P(RollingFileWriterTest, test_multiple_directories) // NOLINT
+{
+  static constexpr unsigned ndirs = 3;
+  std::vector<std::filesystem::path> output_dirs;
+  for (unsigned idir=0; idir<ndirs; idir++)
+  {
+    output_dirs.push_back(output_dir / ("dir_" + std::to_string(idir)));
+    std::filesystem::create_directory(output_dirs.back());
+  }
+
+  RollingFileWriter writer(GetParam());
+  writer.set_max_file_bytes(2 * resolution);
+  writer.open(output_dirs, header);
+  write_chunks(writer, data_size);
+  writer.close();
+
+  // files are distributed round-robin across the directories
+  const auto& filenames = writer.get_filenames();
+  EXPECT_EQ(filenames.size(), data_size / (2 * resolution));
+  for (unsigned ifile=0; ifile<filenames.size(); ifile++)
+  {
+    EXPECT_EQ(filenames[ifile].parent_path(), output_dirs[ifile % ndirs]);
+    EXPECT_EQ(std::filesystem::file_size(filenames[ifile]), header.get_uint64("HDR_SIZE") + 2 * resolution);
+  }
+}
+
+TEST_P(RollingFileWriterTest, test_threshold_less_than_heap) // NOLINT
+{
+  RollingFileWriter writer(GetParam());
+  writer.set_max_file_bytes(resolution - 1);
+  EXPECT_THROW(writer.open(output_dir, header), std::runtime_error); // NOLINT
+  EXPECT_FALSE(writer.is_open());
+}
+
+TEST_P(RollingFileWriterTest, test_invalid_usage) // NOLINT
+{
+  RollingFileWriter writer(GetParam());
+  EXPECT_THROW(writer.write_data(data, resolution), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.close(), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.set_max_file_seconds(-1), std::runtime_error); // NOLINT
+
+  writer.open(output_dir, header);
+  EXPECT_THROW(writer.open(output_dir, header), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.set_max_file_bytes(resolution), std::runtime_error); // NOLINT
+  writer.close();
+}
+
+INSTANTIATE_TEST_SUITE_P(ODirect, RollingFileWriterTest, testing::Values(false, true)); // NOLINT
+
+} // namespace ska::pst::common::test
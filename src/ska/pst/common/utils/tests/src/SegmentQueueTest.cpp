@@ -0,0 +1,256 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/SegmentQueueTest.h"
+#include "ska/pst/common/utils/SegmentGenerator.h"
+#include "ska/pst/common/utils/SegmentQueue.h"
+#include "ska/pst/common/utils/ThreadedSegmentProducer.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+/**
+ * @brief Produces a finite number of segments, in which every byte is set to the index of the segment,
+ * optionally throwing an exception instead of the end of data.
+ */
+class CountingSegmentProducer : public SegmentProducer
+{
+  public:
+    CountingSegmentProducer(uint64_t _nsegments, bool _fail) : nsegments(_nsegments), fail(_fail), data(data_bytes), weights(weights_bytes) {}
+
+    const AsciiHeader& get_data_header() const override { return header; }
+
+    const AsciiHeader& get_weights_header() const override { return header; }
+
+    Segment next_segment() override
+    {
+      if (isegment == nsegments)
+      {
+        if (fail)
+        {
+          throw std::runtime_error("CountingSegmentProducer failed");
+        }
+        return {};
+      }
+      std::fill(data.begin(), data.end(), static_cast<char>(isegment));
+      std::fill(weights.begin(), weights.end(), static_cast<char>(isegment));
+      Segment segment;
+      segment.data = BlockProducer::Block(data.data(), data.size(), isegment * data_bytes);
+      segment.weights = BlockProducer::Block(weights.data(), weights.size(), isegment * weights_bytes);
+      isegment++;
+      return segment;
+    }
+
+    static constexpr uint64_t data_bytes = 1024;
+    static constexpr uint64_t weights_bytes = 64;
+
+  private:
+    AsciiHeader header;
+    uint64_t nsegments;
+    bool fail;
+    uint64_t isegment{0};
+    std::vector<char> data;
+    std::vector<char> weights;
+};
+
+static void expect_segment(const SegmentProducer::Segment& segment, uint64_t isegment)
+{
+  ASSERT_EQ(segment.data.size, CountingSegmentProducer::data_bytes);
+  ASSERT_EQ(segment.weights.size, CountingSegmentProducer::weights_bytes);
+  EXPECT_EQ(segment.get_obs_offset(), isegment * CountingSegmentProducer::data_bytes);
+  EXPECT_EQ(segment.weights.obs_offset, isegment * CountingSegmentProducer::weights_bytes);
+  EXPECT_EQ(segment.data.block[0], static_cast<char>(isegment));
+  EXPECT_EQ(segment.data.block[segment.data.size - 1], static_cast<char>(isegment)); // NOLINT
+  EXPECT_EQ(segment.weights.block[segment.weights.size - 1], static_cast<char>(isegment)); // NOLINT
+}
+
+void SegmentQueueTest::SetUp()
+{
+  data_header.load_from_file(test_data_file("SegmentGenerator_data_header.txt"));
+  weights_header.load_from_file(test_data_file("SegmentGenerator_weights_header.txt"));
+  data_header.set_val("DATA_GENERATOR", "Random");
+}
+
+void SegmentQueueTest::TearDown()
+{
+}
+
+TEST_F(SegmentQueueTest, test_construct) // NOLINT
+{
+  EXPECT_THROW(SegmentQueue queue(0), std::runtime_error); // NOLINT
+
+  static constexpr uint64_t data_bytes = 128;
+  SegmentQueue queue(3, data_bytes); // NOLINT
+  EXPECT_EQ(queue.get_nslots(), 3);
+  EXPECT_EQ(queue.get_size(), 0);
+
+  auto slot = queue.open_write_slot();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot->data.size(), data_bytes);
+  EXPECT_EQ(slot->weights.size(), 0);
+  EXPECT_EQ(queue.get_data_bytes(), data_bytes);
+  EXPECT_EQ(queue.get_weights_bytes(), 0);
+}
+
+TEST_F(SegmentQueueTest, test_producer_consumer) // NOLINT
+{
+  static constexpr uint64_t nsegments = 1000;
+  static constexpr size_t nslots = 2;
+  SegmentQueue queue(nslots);
+
+  std::thread producer_thread([&]() {
+    CountingSegmentProducer producer(nsegments, false);
+    for (auto segment = producer.next_segment(); segment.data.block != nullptr; segment = producer.next_segment())
+    {
+      auto slot = queue.open_write_slot();
+      ASSERT_NE(slot, nullptr);
+      slot->assign(segment);
+      queue.close_write_slot();
+      EXPECT_LE(queue.get_size(), nslots);
+    }
+    queue.signal_end();
+  });
+
+  uint64_t isegment = 0;
+  for (auto slot = queue.open_read_slot(); slot != nullptr; slot = queue.open_read_slot())
+  {
+    expect_segment(slot->segment, isegment);
+    queue.close_read_slot();
+    isegment++;
+  }
+  producer_thread.join();
+
+  EXPECT_EQ(isegment, nsegments);
+  EXPECT_EQ(queue.get_size(), 0);
+  SPDLOG_INFO("ska::pst::common::test::SegmentQueueTest::test_producer_consumer write_waits={} read_waits={}", queue.get_write_waits(), queue.get_read_waits());
+}
+
+TEST_F(SegmentQueueTest, test_stop) // NOLINT
+{
+  SegmentQueue queue(1);
+  ASSERT_NE(queue.open_write_slot(), nullptr);
+  queue.close_write_slot();
+
+  // the producer blocks on the full queue until it is stopped
+  std::thread producer_thread([&]() { EXPECT_EQ(queue.open_write_slot(), nullptr); });
+  while (queue.get_write_waits() == 0)
+  {
+    std::this_thread::yield();
+  }
+  queue.stop();
+  producer_thread.join();
+
+  EXPECT_EQ(queue.open_read_slot(), nullptr);
+}
+
+TEST_F(SegmentQueueTest, test_threaded_producer) // NOLINT
+{
+  static constexpr uint64_t nsegments = 100;
+  auto producer = std::make_shared<CountingSegmentProducer>(nsegments, false);
+  ThreadedSegmentProducer threaded(producer, 3); // NOLINT
+  EXPECT_EQ(threaded.get_queue().get_nslots(), 3);
+
+  uint64_t isegment = 0;
+  for (auto segment = threaded.next_segment(); segment.data.block != nullptr; segment = threaded.next_segment())
+  {
+    expect_segment(segment, isegment);
+    isegment++;
+  }
+  EXPECT_EQ(isegment, nsegments);
+  EXPECT_EQ(threaded.next_segment().data.block, nullptr);
+}
+
+TEST_F(SegmentQueueTest, test_threaded_producer_failure) // NOLINT
+{
+  static constexpr uint64_t nsegments = 5;
+  auto producer = std::make_shared<CountingSegmentProducer>(nsegments, true);
+  ThreadedSegmentProducer threaded(producer);
+
+  // the segments produced before the exception are consumed before it is re-thrown
+  for (uint64_t isegment = 0; isegment < nsegments; isegment++)
+  {
+    expect_segment(threaded.next_segment(), isegment);
+  }
+  EXPECT_THROW(threaded.next_segment(), std::runtime_error); // NOLINT
+}
+
+TEST_F(SegmentQueueTest, test_threaded_generator) // NOLINT
+{
+  static constexpr uint64_t nheap = 4;
+  static constexpr uint64_t max_segments = 6;
+
+  auto generator = std::make_shared<SegmentGenerator>();
+  generator->configure(data_header, weights_header);
+  generator->resize(nheap);
+
+  SegmentGenerator validator;
+  validator.configure(data_header, weights_header);
+  validator.resize(nheap);
+
+  ThreadedSegmentProducer threaded(generator, SegmentQueue::default_nslots, max_segments, nheap);
+  EXPECT_EQ(threaded.get_data_header().get_val("UTC_START"), generator->get_data_header().get_val("UTC_START"));
+
+  // the slots are preallocated to hold the segments of the generator
+  EXPECT_EQ(threaded.get_queue().get_data_bytes(), nheap * data_header.get_uint64("RESOLUTION"));
+  EXPECT_EQ(threaded.get_queue().get_weights_bytes(), nheap * weights_header.get_uint64("RESOLUTION"));
+
+  uint64_t isegment = 0;
+  for (auto segment = threaded.next_segment(); segment.data.block != nullptr; segment = threaded.next_segment())
+  {
+    EXPECT_EQ(segment.data.size, threaded.get_queue().get_data_bytes());
+    EXPECT_EQ(segment.weights.size, threaded.get_queue().get_weights_bytes());
+    EXPECT_TRUE(validator.test_segment(segment)) << " isegment=" << isegment;
+    isegment++;
+  }
+  EXPECT_EQ(isegment, max_segments);
+}
+
+TEST_F(SegmentQueueTest, test_threaded_generator_stop) // NOLINT
+{
+  // the generator never ends, so the producer thread must be stopped by the destructor while it waits on the full queue
+  auto generator = std::make_shared<SegmentGenerator>();
+  generator->configure(data_header, weights_header);
+  generator->resize(1);
+
+  ThreadedSegmentProducer threaded(generator, 2);
+  EXPECT_NE(threaded.next_segment().data.block, nullptr);
+}
+
+} // namespace ska::pst::common::test
@@ -0,0 +1,366 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/SharedMemoryRingBufferTest.h"
+#include "ska/pst/common/utils/SharedMemoryBlockProducer.h"
+#include "ska/pst/common/utils/SharedMemoryRingBuffer.h"
+#include "ska/pst/common/utils/SharedMemorySegmentProducer.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+static constexpr uint64_t test_nbufs = 4;
+static constexpr uint64_t test_bufsz = 8192;
+
+static void fill_block(char * block, uint64_t nbytes, uint64_t iblock)
+{
+  for (uint64_t i = 0; i < nbytes; i++)
+  {
+    block[i] = static_cast<char>((i + iblock * 7) % 251); // NOLINT
+  }
+}
+
+void SharedMemoryRingBufferTest::SetUp()
+{
+  header.set_val("UTC_START", "2023-01-01-00:00:00");
+  header.set("OBS_OFFSET", 1024); // NOLINT
+}
+
+void SharedMemoryRingBufferTest::TearDown()
+{
+}
+
+auto SharedMemoryRingBufferTest::get_name(const std::string& suffix) const -> std::string
+{
+  return "ska_pst_common_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_create_and_attach) // NOLINT
+{
+  const std::string name = get_name("create");
+  EXPECT_THROW(SharedMemoryRingBuffer attached(name), std::runtime_error); // NOLINT
+  {
+    SharedMemoryRingBuffer ring(name, test_nbufs, test_bufsz);
+    EXPECT_EQ(ring.get_name(), "/" + name);
+    EXPECT_THROW(SharedMemoryRingBuffer duplicate(name, test_nbufs, test_bufsz), std::runtime_error); // NOLINT
+
+    SharedMemoryRingBuffer attached(name);
+    EXPECT_EQ(attached.get_nbufs(), test_nbufs);
+    EXPECT_EQ(attached.get_bufsz(), test_bufsz);
+    EXPECT_EQ(attached.get_hdr_bufsz(), AsciiHeader::default_header_size);
+
+    attached.write_header(header);
+    AsciiHeader received = ring.read_header();
+    EXPECT_EQ(received.get_val("UTC_START"), header.get_val("UTC_START"));
+    EXPECT_EQ(received.get_uint64("OBS_OFFSET"), header.get_uint64("OBS_OFFSET"));
+  }
+
+  // the segment is removed when the ring buffer that created it is destroyed
+  EXPECT_THROW(SharedMemoryRingBuffer attached(name), std::runtime_error); // NOLINT
+  EXPECT_THROW(SharedMemoryRingBuffer invalid(name, 0, test_bufsz), std::runtime_error); // NOLINT
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_attach_during_creation) // NOLINT
+{
+  const std::string name = get_name("process");
+  static constexpr uint64_t nblocks = 20;
+  static constexpr double timeout = 10;
+  static constexpr std::chrono::microseconds poll_sleep{10};
+
+  // the writer creates the ring buffer in another process, while this process attaches as soon as the segment exists
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0)
+  {
+    int status = 0;
+    try
+    {
+      SharedMemoryRingBuffer ring(name, test_nbufs, test_bufsz);
+      ring.set_timeout(timeout);
+      ring.write_header(header);
+      std::vector<char> buffer(test_bufsz);
+      for (uint64_t iblock = 0; iblock < nblocks; iblock++)
+      {
+        fill_block(buffer.data(), test_bufsz, iblock);
+        ring.write_block(buffer.data(), test_bufsz);
+      }
+      ring.signal_eod();
+
+      // the segment is unlinked when the ring is destroyed, so wait for the reader to release every block
+      const auto start = std::chrono::steady_clock::now();
+      while (ring.get_read_count() < nblocks && std::chrono::steady_clock::now() - start < std::chrono::duration<double>(timeout))
+      {
+        std::this_thread::sleep_for(poll_sleep);
+      }
+    }
+    catch (std::exception& exc)
+    {
+      SPDLOG_ERROR("ska::pst::common::test::SharedMemoryRingBufferTest writer process failed: {}", exc.what());
+      status = 1;
+    }
+    _exit(status);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  int fd = shm_open(SharedMemoryRingBuffer::get_shm_name(name).c_str(), O_RDONLY, 0); // NOLINT
+  while (fd < 0 && std::chrono::steady_clock::now() - start < std::chrono::duration<double>(timeout))
+  {
+    fd = shm_open(SharedMemoryRingBuffer::get_shm_name(name).c_str(), O_RDONLY, 0); // NOLINT
+  }
+  ASSERT_GE(fd, 0);
+  ::close(fd);
+
+  SharedMemoryRingBuffer reader(name, timeout);
+  reader.set_timeout(timeout);
+  EXPECT_EQ(reader.get_nbufs(), test_nbufs);
+  EXPECT_EQ(reader.get_bufsz(), test_bufsz);
+  EXPECT_EQ(reader.read_header().get_val("UTC_START"), header.get_val("UTC_START"));
+
+  std::vector<char> expected(test_bufsz);
+  uint64_t iblock = 0;
+  for (auto block = reader.open_read_block(); block.block != nullptr; block = reader.open_read_block())
+  {
+    fill_block(expected.data(), test_bufsz, iblock);
+    EXPECT_EQ(block.size, test_bufsz);
+    EXPECT_EQ(memcmp(block.block, expected.data(), test_bufsz), 0) << " iblock=" << iblock;
+    reader.close_read_block();
+    iblock++;
+  }
+  EXPECT_EQ(iblock, nblocks);
+
+  int status = -1;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_attach_unpublished) // NOLINT
+{
+  // a segment that is never sized or initialised by a ring buffer is rejected once the attach timeout expires
+  const std::string name = SharedMemoryRingBuffer::get_shm_name(get_name("unpublished"));
+  const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR); // NOLINT
+  ASSERT_GE(fd, 0);
+  static constexpr double attach_timeout = 0.01;
+  EXPECT_THROW(SharedMemoryRingBuffer attached(name, attach_timeout), std::runtime_error); // NOLINT
+
+  // a segment that is sized but whose control block is never published is also rejected
+  ASSERT_EQ(ftruncate(fd, static_cast<off_t>(test_bufsz)), 0);
+  EXPECT_THROW(SharedMemoryRingBuffer attached(name, attach_timeout), std::runtime_error); // NOLINT
+
+  ::close(fd);
+  shm_unlink(name.c_str());
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_write_and_read) // NOLINT
+{
+  const std::string name = get_name("stream");
+  SharedMemoryRingBuffer ring(name, test_nbufs, test_bufsz);
+  static constexpr uint64_t nblocks = 50;
+  static constexpr uint64_t last_block_bytes = 100;
+
+  // the writer publishes many more blocks than there are slots, so that the reader must release them
+  std::thread writer([&]() {
+    SharedMemoryRingBuffer output(name);
+    output.write_header(header);
+    std::vector<char> buffer(test_bufsz);
+    for (uint64_t iblock = 0; iblock < nblocks; iblock++)
+    {
+      const uint64_t nbytes = (iblock == nblocks - 1) ? last_block_bytes : test_bufsz;
+      if (iblock % 2 == 0)
+      {
+        char * block = output.open_write_block();
+        fill_block(block, nbytes, iblock);
+        output.close_write_block(nbytes);
+      }
+      else
+      {
+        fill_block(buffer.data(), nbytes, iblock);
+        output.write_block(buffer.data(), nbytes);
+      }
+    }
+    output.signal_eod();
+  });
+
+  SharedMemoryBlockProducer producer(name);
+  EXPECT_EQ(producer.get_header().get_val("UTC_START"), header.get_val("UTC_START"));
+
+  std::vector<char> expected(test_bufsz);
+  uint64_t iblock = 0;
+  uint64_t obs_offset = header.get_uint64("OBS_OFFSET");
+  for (auto block = producer.next_block(); block.block != nullptr; block = producer.next_block())
+  {
+    const uint64_t nbytes = (iblock == nblocks - 1) ? last_block_bytes : test_bufsz;
+    ASSERT_EQ(block.size, nbytes);
+    EXPECT_EQ(block.obs_offset, obs_offset);
+    fill_block(expected.data(), nbytes, iblock);
+    EXPECT_EQ(memcmp(block.block, expected.data(), nbytes), 0) << " iblock=" << iblock;
+    obs_offset += nbytes;
+    iblock++;
+  }
+  writer.join();
+
+  EXPECT_EQ(iblock, nblocks);
+  EXPECT_EQ(ring.get_write_count(), nblocks);
+  EXPECT_EQ(ring.get_read_count(), nblocks);
+
+  // the end of data is sticky
+  EXPECT_EQ(producer.next_block().block, nullptr);
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_statistics) // NOLINT
+{
+  SharedMemoryRingBuffer ring(get_name("stats"), test_nbufs, test_bufsz);
+  SharedMemoryRingBuffer reader(ring.get_name());
+  std::vector<char> buffer(test_bufsz);
+
+  ring.write_block(buffer.data(), buffer.size());
+  ring.write_block(buffer.data(), buffer.size());
+  ring.open_write_block();
+
+  ska::pst::lmc::SmrbStatitics stats;
+  reader.fill(stats);
+  EXPECT_EQ(stats.nbufs(), test_nbufs);
+  EXPECT_EQ(stats.bufsz(), test_bufsz);
+  EXPECT_EQ(stats.written(), 2);
+  EXPECT_EQ(stats.read(), 0);
+  EXPECT_EQ(stats.full(), 2);
+  EXPECT_EQ(stats.clear(), 2);
+  EXPECT_EQ(stats.available(), 1);
+
+  auto block = reader.open_read_block();
+  EXPECT_EQ(block.size, test_bufsz);
+  EXPECT_EQ(block.obs_offset, 0);
+  reader.close_read_block();
+  ring.close_write_block(test_bufsz);
+
+  ring.fill(stats);
+  EXPECT_EQ(stats.written(), 3);
+  EXPECT_EQ(stats.read(), 1);
+  EXPECT_EQ(stats.full(), 2);
+  EXPECT_EQ(stats.clear(), 2);
+  EXPECT_EQ(stats.available(), 2);
+
+  block = reader.open_read_block();
+  EXPECT_EQ(block.obs_offset, test_bufsz);
+  EXPECT_THROW(reader.open_read_block(), std::runtime_error); // NOLINT
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_timeout) // NOLINT
+{
+  SharedMemoryRingBuffer ring(get_name("timeout"), test_nbufs, test_bufsz);
+  static constexpr double timeout = 0.01;
+  ring.set_timeout(timeout);
+  std::vector<char> buffer(test_bufsz);
+
+  // nothing has been written
+  EXPECT_THROW(ring.open_read_block(), std::runtime_error); // NOLINT
+  EXPECT_THROW(SharedMemoryBlockProducer producer(ring.get_name(), timeout), std::runtime_error); // NOLINT
+
+  // every slot is full
+  for (uint64_t iblock = 0; iblock < test_nbufs; iblock++)
+  {
+    ring.write_block(buffer.data(), buffer.size());
+  }
+  EXPECT_THROW(ring.open_write_block(), std::runtime_error); // NOLINT
+  EXPECT_THROW(ring.write_block(buffer.data(), test_bufsz + 1), std::runtime_error); // NOLINT
+  EXPECT_THROW(ring.close_write_block(test_bufsz), std::runtime_error); // NOLINT
+
+  // the slots written before the end of data can still be read
+  ring.signal_eod();
+  for (uint64_t iblock = 0; iblock < test_nbufs; iblock++)
+  {
+    EXPECT_EQ(ring.open_read_block().size, test_bufsz);
+    ring.close_read_block();
+  }
+  EXPECT_EQ(ring.open_read_block().block, nullptr);
+  EXPECT_THROW(ring.read_header(), std::runtime_error); // NOLINT
+}
+
+TEST_F(SharedMemoryRingBufferTest, test_segment_producer) // NOLINT
+{
+  static constexpr uint64_t weights_bufsz = 512;
+  static constexpr uint64_t nblocks = 3;
+  SharedMemoryRingBuffer data_ring(get_name("data"), test_nbufs, test_bufsz);
+  SharedMemoryRingBuffer weights_ring(get_name("weights"), test_nbufs, weights_bufsz);
+
+  data_ring.write_header(header);
+  weights_ring.write_header(header);
+  std::vector<char> buffer(test_bufsz);
+  for (uint64_t iblock = 0; iblock < nblocks; iblock++)
+  {
+    data_ring.write_block(buffer.data(), test_bufsz);
+    weights_ring.write_block(buffer.data(), weights_bufsz);
+  }
+  data_ring.signal_eod();
+  weights_ring.signal_eod();
+
+  SharedMemorySegmentProducer producer(data_ring.get_name(), weights_ring.get_name());
+  EXPECT_EQ(producer.get_data_header().get_uint64("OBS_OFFSET"), header.get_uint64("OBS_OFFSET"));
+  EXPECT_EQ(producer.get_weights_header().get_uint64("OBS_OFFSET"), header.get_uint64("OBS_OFFSET"));
+
+  auto segment = producer.next_segment();
+  EXPECT_EQ(segment.data.size, test_bufsz);
+  EXPECT_EQ(segment.weights.size, weights_bufsz);
+  EXPECT_EQ(segment.get_obs_offset(), header.get_uint64("OBS_OFFSET"));
+
+  ska::pst::lmc::SmrbMonitorData monitor_data;
+  producer.fill(monitor_data);
+  EXPECT_EQ(monitor_data.data().bufsz(), test_bufsz);
+  EXPECT_EQ(monitor_data.data().written(), nblocks);
+  EXPECT_EQ(monitor_data.data().read(), 0);
+  EXPECT_EQ(monitor_data.weights().bufsz(), weights_bufsz);
+  EXPECT_EQ(monitor_data.weights().full(), nblocks);
+
+  uint64_t nsegments = 1;
+  for (segment = producer.next_segment(); segment.data.block != nullptr; segment = producer.next_segment())
+  {
+    EXPECT_EQ(segment.get_obs_offset(), header.get_uint64("OBS_OFFSET") + nsegments * test_bufsz);
+    nsegments++;
+  }
+  EXPECT_EQ(nsegments, nblocks);
+  EXPECT_EQ(segment.weights.block, nullptr);
+}
+
+} // namespace ska::pst::common::test
@@ -0,0 +1,291 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/StatisticsEngineTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void StatisticsEngineTest::SetUp()
+{
+  data_header.load_from_file(test_data_file("DataUnpacker_data_header.txt"));
+  weights_header.load_from_file(test_data_file("DataUnpacker_weights_header.txt"));
+  layout.configure(data_header, weights_header);
+}
+
+void StatisticsEngineTest::TearDown()
+{
+}
+
+auto StatisticsEngineTest::get_value(uint32_t ipol, uint32_t ichan, uint32_t isamp, uint32_t idim) const -> int16_t
+{
+  if (isamp == clipped_sample && idim == 0)
+  {
+    return std::numeric_limits<int16_t>::max();
+  }
+  return static_cast<int16_t>(((ichan * 7) + (isamp * 3) + (ipol * 5) + (idim * 11)) % 200) - 100; // NOLINT
+}
+
+auto StatisticsEngineTest::is_invalid_channel(uint32_t ichan) const -> bool
+{
+  // the second packet of every heap is dropped
+  return (ichan / layout.get_packet_layout().get_nchan_per_packet()) == 1;
+}
+
+void StatisticsEngineTest::generate_packed_data(uint32_t nheaps)
+{
+  const uint32_t npol = data_header.get_uint32("NPOL");
+  const uint32_t packets_per_heap = layout.get_packets_per_heap();
+  const uint32_t nchan_per_packet = layout.get_packet_layout().get_nchan_per_packet();
+  const uint32_t nsamp_per_packet = layout.get_packet_layout().get_samples_per_packet();
+
+  nsamp = nheaps * nsamp_per_packet;
+  data.resize(static_cast<uint64_t>(nheaps) * layout.get_data_heap_stride());
+  // unity relative weights, as written by the ScaleWeightGenerator
+  weights.assign(static_cast<uint64_t>(nheaps) * layout.get_weights_heap_stride(), '\xff');
+
+  auto * out = reinterpret_cast<int16_t *>(data.data());
+  uint32_t packet_number = 0;
+  for (uint32_t iheap=0; iheap<nheaps; iheap++)
+  {
+    for (uint32_t ipacket=0; ipacket<packets_per_heap; ipacket++)
+    {
+      auto * scale = reinterpret_cast<float *>(weights.data() + (packet_number * layout.get_weights_packet_stride())); // NOLINT
+      *scale = is_invalid_channel(ipacket * nchan_per_packet) ? std::nanf("dropped") : scale_factor;
+      packet_number++;
+
+      for (uint32_t ipol=0; ipol<npol; ipol++)
+      {
+        for (uint32_t ichan=0; ichan<nchan_per_packet; ichan++)
+        {
+          const uint32_t ochan = (ipacket * nchan_per_packet) + ichan;
+          for (uint32_t isamp=0; isamp<nsamp_per_packet; isamp++)
+          {
+            const uint32_t osamp = (iheap * nsamp_per_packet) + isamp;
+            *out++ = get_value(ipol, ochan, osamp, 0); // NOLINT
+            *out++ = get_value(ipol, ochan, osamp, 1); // NOLINT
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_F(StatisticsEngineTest, test_configure) // NOLINT
+{
+  StatisticsEngine engine;
+  EXPECT_NO_THROW(engine.configure(data_header, weights_header)); // NOLINT
+  EXPECT_EQ(engine.get_nrebin(), StatisticsEngine::default_nrebin);
+  EXPECT_EQ(engine.get_nfreq_bins(), data_header.get_uint32("NCHAN"));
+
+  static constexpr uint32_t bad_nrebin = 100;
+  data_header.set("STAT_NREBIN", bad_nrebin);
+  EXPECT_THROW(engine.configure(data_header, weights_header), std::runtime_error); // NOLINT
+  data_header.del("STAT_NREBIN");
+
+  static constexpr uint32_t bad_nbit = 4;
+  data_header.set("NBIT", bad_nbit);
+  EXPECT_THROW(engine.configure(data_header, weights_header), std::runtime_error); // NOLINT
+}
+
+TEST_F(StatisticsEngineTest, test_compute) // NOLINT
+{
+  static constexpr uint32_t nheaps = 4;
+  static constexpr uint32_t req_freq_bins = 16;
+  static constexpr uint32_t req_time_bins = 8;
+  data_header.set("STAT_REQ_FREQ_BINS", req_freq_bins);
+  data_header.set("STAT_REQ_TIME_BINS", req_time_bins);
+  generate_packed_data(nheaps);
+
+  StatisticsEngine engine;
+  engine.configure(data_header, weights_header);
+
+  // flag a contiguous range of channels for RFI
+  const uint32_t nchan = data_header.get_uint32("NCHAN");
+  const uint32_t npol = data_header.get_uint32("NPOL");
+  const uint32_t ndim = data_header.get_uint32("NDIM");
+  static constexpr uint32_t flagged_start = 100;
+  static constexpr uint32_t flagged_end = 200;
+  std::vector<bool> mask(nchan, false);
+  for (uint32_t ichan=flagged_start; ichan<flagged_end; ichan++)
+  {
+    mask[ichan] = true;
+  }
+  engine.set_channel_mask(mask);
+
+  ska::pst::lmc::StatMonitorData stats;
+  engine.compute(data.data(), data.size(), weights.data(), weights.size(), stats);
+
+  const uint32_t nstates = 1U << data_header.get_uint32("NBIT");
+  const uint32_t nrebin = engine.get_nrebin();
+  EXPECT_EQ(engine.get_ntime_bins(), req_time_bins);
+  EXPECT_EQ(engine.get_nfreq_bins(), req_freq_bins);
+  EXPECT_EQ(engine.get_invalid_packets(), nheaps);
+
+  EXPECT_EQ(stats.mean_frequency_avg_size(), npol * ndim);
+  EXPECT_EQ(stats.variance_frequency_avg_masked_size(), npol * ndim);
+  EXPECT_EQ(stats.mean_spectrum_size(), npol * ndim * nchan);
+  EXPECT_EQ(stats.max_spectral_power_size(), npol * nchan);
+  EXPECT_EQ(stats.histogram_1d_freq_avg_size(), npol * ndim * nstates);
+  EXPECT_EQ(stats.histogram_rebinned_1d_freq_avg_masked_size(), npol * ndim * nrebin);
+  EXPECT_EQ(stats.histogram_rebinned_2d_freq_avg_size(), npol * nrebin * nrebin);
+  EXPECT_EQ(stats.num_clipped_samples_spectrum_size(), npol * ndim * nchan);
+  EXPECT_EQ(stats.spectrogram_size(), npol * req_freq_bins * req_time_bins);
+  EXPECT_EQ(stats.timeseries_masked_size(), npol * req_time_bins * 3);
+
+  const double inverse_scale = 1.0 / scale_factor;
+  double total_power = 0;
+  for (uint32_t ipol=0; ipol<npol; ipol++)
+  {
+    for (uint32_t idim=0; idim<ndim; idim++)
+    {
+      double sum = 0;
+      double sum_masked = 0;
+      uint64_t count = 0;
+      uint64_t count_masked = 0;
+      for (uint32_t ichan=0; ichan<nchan; ichan++)
+      {
+        const uint32_t idx = (((ipol * ndim) + idim) * nchan) + ichan;
+        if (is_invalid_channel(ichan))
+        {
+          EXPECT_EQ(stats.mean_spectrum(idx), 0);
+          EXPECT_EQ(stats.num_clipped_samples_spectrum(idx), 0);
+          continue;
+        }
+
+        double chan_sum = 0;
+        double chan_sumsq = 0;
+        for (uint32_t isamp=0; isamp<nsamp; isamp++)
+        {
+          const double value = get_value(ipol, ichan, isamp, idim) * inverse_scale;
+          chan_sum += value;
+          chan_sumsq += value * value;
+        }
+        const double mean = chan_sum / nsamp;
+        const double variance = (chan_sumsq - (chan_sum * mean)) / (nsamp - 1);
+        EXPECT_NEAR(stats.mean_spectrum(idx), mean, std::abs(mean) * 1e-5); // NOLINT
+        EXPECT_NEAR(stats.variance_spectrum(idx), variance, variance * 1e-5); // NOLINT
+        EXPECT_EQ(stats.num_clipped_samples_spectrum(idx), (idim == 0) ? 1 : 0);
+
+        sum += chan_sum;
+        count += nsamp;
+        if (!mask[ichan])
+        {
+          sum_masked += chan_sum;
+          count_masked += nsamp;
+        }
+      }
+
+      const uint32_t ipd = (ipol * ndim) + idim;
+      EXPECT_NEAR(stats.mean_frequency_avg(ipd), sum / count, std::abs(sum / count) * 1e-5); // NOLINT
+      EXPECT_NEAR(stats.mean_frequency_avg_masked(ipd), sum_masked / count_masked, std::abs(sum_masked / count_masked) * 1e-5); // NOLINT
+      EXPECT_EQ(stats.num_clipped_samples(ipd), (idim == 0) ? count / nsamp : 0);
+      EXPECT_EQ(stats.num_clipped_samples_masked(ipd), (idim == 0) ? count_masked / nsamp : 0);
+
+      // every valid sample is counted exactly once in each of the histograms
+      uint64_t hist_total = 0;
+      uint64_t hist_masked_total = 0;
+      for (uint32_t istate=0; istate<nstates; istate++)
+      {
+        hist_total += stats.histogram_1d_freq_avg((ipd * nstates) + istate);
+        hist_masked_total += stats.histogram_1d_freq_avg_masked((ipd * nstates) + istate);
+      }
+      EXPECT_EQ(hist_total, count);
+      EXPECT_EQ(hist_masked_total, count_masked);
+
+      uint64_t rebinned_total = 0;
+      for (uint32_t ibin=0; ibin<nrebin; ibin++)
+      {
+        rebinned_total += stats.histogram_rebinned_1d_freq_avg((ipd * nrebin) + ibin);
+      }
+      EXPECT_EQ(rebinned_total, count);
+    }
+
+    double pol_power = 0;
+    for (uint32_t ichan=0; ichan<nchan; ichan++)
+    {
+      if (is_invalid_channel(ichan))
+      {
+        continue;
+      }
+      double chan_power = 0;
+      for (uint32_t isamp=0; isamp<nsamp; isamp++)
+      {
+        const double re = get_value(ipol, ichan, isamp, 0) * inverse_scale;
+        const double im = get_value(ipol, ichan, isamp, 1) * inverse_scale;
+        chan_power += (re * re) + (im * im);
+      }
+      EXPECT_NEAR(stats.mean_spectral_power((ipol * nchan) + ichan), chan_power / nsamp, chan_power / nsamp * 1e-5); // NOLINT
+      pol_power += chan_power;
+    }
+    total_power += pol_power;
+
+    double spectrogram_power = 0;
+    for (uint32_t ibin=0; ibin<req_freq_bins * req_time_bins; ibin++)
+    {
+      spectrogram_power += stats.spectrogram((ipol * req_freq_bins * req_time_bins) + ibin);
+    }
+    EXPECT_NEAR(spectrogram_power, pol_power, pol_power * 1e-5); // NOLINT
+
+    // the maximum power in each bin of the timeseries is due to the clipped sample
+    const uint32_t clipped_bin = (clipped_sample * req_time_bins) / nsamp;
+    const uint32_t ts_idx = ((ipol * req_time_bins) + clipped_bin) * 3;
+    EXPECT_GE(stats.timeseries(ts_idx), std::pow(std::numeric_limits<int16_t>::max() * inverse_scale, 2));
+    EXPECT_LE(stats.timeseries(ts_idx + 1), stats.timeseries(ts_idx + 2));
+  }
+  EXPECT_GT(total_power, 0);
+}
+
+TEST_F(StatisticsEngineTest, test_compute_invalid_buffers) // NOLINT
+{
+  static constexpr uint32_t nheaps = 2;
+  generate_packed_data(nheaps);
+
+  StatisticsEngine engine;
+  engine.configure(data_header, weights_header);
+
+  ska::pst::lmc::StatMonitorData stats;
+  // data buffer that is smaller than a heap
+  EXPECT_THROW(engine.compute(data.data(), layout.get_data_heap_stride() - 1, weights.data(), weights.size(), stats), std::runtime_error); // NOLINT
+  // weights buffer that is too small for the number of heaps in data
+  EXPECT_THROW(engine.compute(data.data(), data.size(), weights.data(), weights.size() - 1, stats), std::runtime_error); // NOLINT
+  EXPECT_NO_THROW(engine.compute(data.data(), data.size(), weights.data(), weights.size(), stats)); // NOLINT
+}
+
+} // namespace ska::pst::common::test
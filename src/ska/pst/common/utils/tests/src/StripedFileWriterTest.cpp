@@ -0,0 +1,174 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <filesystem>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/StripedFileWriterTest.h"
+#include "ska/pst/common/utils/FileReader.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+static constexpr uint64_t data_size = 1048576;
+static constexpr uint64_t chunk_size = 50000;
+static constexpr unsigned ndirs = 3;
+
+void StripedFileWriterTest::SetUp()
+{
+  header.load_from_file(test_data_file("data_scan_config.txt"));
+  header.set_val("UTC_START", "2023-07-31-13:41:23");
+  resolution = header.get_uint64("RESOLUTION");
+
+  data.resize(data_size);
+  for (uint64_t i=0; i<data_size; i++)
+  {
+    data[i] = static_cast<char>(i % 251); // NOLINT
+  }
+
+  std::filesystem::remove_all(base_dir);
+  for (unsigned idir=0; idir<ndirs; idir++)
+  {
+    output_dirs.push_back(base_dir / ("stripe_" + std::to_string(idir)));
+    std::filesystem::create_directories(output_dirs.back());
+  }
+}
+
+void StripedFileWriterTest::TearDown()
+{
+  std::filesystem::remove_all(base_dir);
+}
+
+auto StripedFileWriterTest::reassemble(const std::filesystem::path& manifest_filename) const -> std::vector<char>
+{
+  ska::pst::common::AsciiHeader manifest;
+  manifest.load_from_file(manifest_filename);
+  const uint32_t nstripe = manifest.get_uint32("NSTRIPE");
+  const uint64_t stripe_bytes = manifest.get_uint64("STRIPE_BYTES");
+  const uint64_t total_bytes = manifest.get_uint64("DATA_BYTES");
+
+  std::vector<std::vector<char>> stripe_data(nstripe);
+  for (uint32_t istripe=0; istripe<nstripe; istripe++)
+  {
+    FileReader reader(manifest.get_val("STRIPE_FILE_" + std::to_string(istripe)));
+    reader.read_header();
+    EXPECT_EQ(reader.get_header().get_uint32("STRIPE_INDEX"), istripe);
+    EXPECT_EQ(reader.get_header().get_uint32("NSTRIPE"), nstripe);
+    EXPECT_EQ(reader.get_header().get_uint64("STRIPE_BYTES"), stripe_bytes);
+
+    stripe_data[istripe].resize(reader.get_file_size() - reader.get_header().get_uint64("HDR_SIZE"));
+    EXPECT_EQ(reader.read_data(&stripe_data[istripe][0], stripe_data[istripe].size()), stripe_data[istripe].size());
+  }
+
+  std::vector<char> result;
+  std::vector<uint64_t> offsets(nstripe, 0);
+  for (uint64_t stripe=0; result.size() < total_bytes; stripe++)
+  {
+    const uint32_t istripe = stripe % nstripe;
+    const uint64_t nbytes = std::min(stripe_bytes, total_bytes - result.size());
+    EXPECT_LE(offsets[istripe] + nbytes, stripe_data[istripe].size());
+    auto begin = stripe_data[istripe].begin() + static_cast<std::ptrdiff_t>(offsets[istripe]);
+    result.insert(result.end(), begin, begin + static_cast<std::ptrdiff_t>(nbytes));
+    offsets[istripe] += nbytes;
+  }
+  return result;
+}
+
+TEST_P(StripedFileWriterTest, test_write_data) // NOLINT
+{
+  StripedFileWriter writer;
+  writer.set_async_depth(GetParam());
+  writer.set_stripe_bytes(2 * resolution);
+  writer.open(output_dirs, header);
+  EXPECT_TRUE(writer.is_open());
+  EXPECT_EQ(writer.get_stripe_bytes(), 2 * resolution);
+  EXPECT_EQ(writer.get_filenames().size(), ndirs);
+
+  for (uint64_t offset=0; offset<data_size; offset+=chunk_size)
+  {
+    uint64_t nbytes = std::min(chunk_size, data_size - offset);
+    EXPECT_EQ(writer.write_data(&data[offset], nbytes), nbytes);
+  }
+  EXPECT_EQ(writer.get_data_bytes_written(), data_size);
+  writer.close();
+  EXPECT_FALSE(writer.is_open());
+
+  EXPECT_EQ(writer.get_manifest_filename().parent_path(), output_dirs[0]);
+  EXPECT_EQ(reassemble(writer.get_manifest_filename()), data);
+}
+
+TEST_P(StripedFileWriterTest, test_write_data_async) // NOLINT
+{
+  StripedFileWriter writer;
+  writer.set_async_depth(GetParam());
+  writer.open(output_dirs, header);
+
+  // one heap per stripe by default
+  EXPECT_EQ(writer.get_stripe_bytes(), resolution);
+
+  for (uint64_t offset=0; offset<data_size; offset+=chunk_size)
+  {
+    uint64_t nbytes = std::min(chunk_size, data_size - offset);
+    EXPECT_EQ(writer.write_data_async(&data[offset], nbytes), offset);
+  }
+  writer.wait_for_writes();
+  writer.close();
+
+  EXPECT_EQ(reassemble(writer.get_manifest_filename()), data);
+}
+
+TEST_P(StripedFileWriterTest, test_invalid_configuration) // NOLINT
+{
+  StripedFileWriter writer;
+  writer.set_async_depth(GetParam());
+  EXPECT_THROW(writer.write_data(&data[0], resolution), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.close(), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.open({}, header), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.open({output_dirs[0], output_dirs[1], output_dirs[0]}, header), std::runtime_error); // NOLINT
+
+  writer.set_stripe_bytes(resolution + 1);
+  EXPECT_THROW(writer.open(output_dirs, header), std::runtime_error); // NOLINT
+  EXPECT_FALSE(writer.is_open());
+
+  writer.set_stripe_bytes(resolution);
+  writer.open(output_dirs, header);
+  EXPECT_THROW(writer.set_stripe_bytes(2 * resolution), std::runtime_error); // NOLINT
+  EXPECT_THROW(writer.set_async_depth(1), std::runtime_error); // NOLINT
+  writer.close();
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncDepths, StripedFileWriterTest, testing::Values(0, 4)); // NOLINT
+
+} // namespace ska::pst::common::test
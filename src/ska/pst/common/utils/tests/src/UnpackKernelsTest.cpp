@@ -0,0 +1,216 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/UnpackKernelsTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void UnpackKernelsTest::SetUp()
+{
+  initial_level = get_simd_level();
+}
+
+void UnpackKernelsTest::TearDown()
+{
+  set_simd_level(initial_level);
+}
+
+void UnpackKernelsTest::skip_if_unsupported()
+{
+  if (GetParam() > get_supported_simd_level())
+  {
+    GTEST_SKIP() << get_simd_level_name(GetParam()) << " not supported by this CPU";
+  }
+}
+
+TEST_P(UnpackKernelsTest, test_convert_int8) // NOLINT
+{
+  // an odd number of samples exercises the scalar remainder of the vectorised kernels
+  static constexpr uint64_t nsamp = 77;
+  static constexpr float scale = 0.25;
+  std::vector<int8_t> input;
+  fill_input(input, nsamp);
+
+  std::vector<std::complex<float>> output(nsamp);
+  skip_if_unsupported();
+  set_simd_level(GetParam());
+  convert_complex_samples(input.data(), nsamp, scale, output.data());
+
+  for (uint64_t isamp=0; isamp<nsamp; isamp++)
+  {
+    ASSERT_EQ(output[isamp].real(), static_cast<float>(input[2*isamp]) * scale);
+    ASSERT_EQ(output[isamp].imag(), static_cast<float>(input[2*isamp+1]) * scale);
+  }
+}
+
+TEST_P(UnpackKernelsTest, test_convert_int16) // NOLINT
+{
+  static constexpr uint64_t nsamp = 77;
+  static constexpr float scale = 0.5;
+  std::vector<int16_t> input;
+  fill_input(input, nsamp);
+
+  std::vector<std::complex<float>> output(nsamp);
+  skip_if_unsupported();
+  set_simd_level(GetParam());
+  convert_complex_samples(input.data(), nsamp, scale, output.data());
+
+  for (uint64_t isamp=0; isamp<nsamp; isamp++)
+  {
+    ASSERT_EQ(output[isamp].real(), static_cast<float>(input[2*isamp]) * scale);
+    ASSERT_EQ(output[isamp].imag(), static_cast<float>(input[2*isamp+1]) * scale);
+  }
+}
+
+TEST_P(UnpackKernelsTest, test_sum_power_int8) // NOLINT
+{
+  static constexpr uint64_t nsamp = 77;
+  std::vector<int8_t> input;
+  fill_input(input, nsamp);
+
+  double expected = 0;
+  for (auto value : input)
+  {
+    expected += static_cast<double>(value) * static_cast<double>(value);
+  }
+
+  skip_if_unsupported();
+  set_simd_level(GetParam());
+  EXPECT_FLOAT_EQ(sum_complex_power(input.data(), nsamp), static_cast<float>(expected));
+}
+
+TEST_P(UnpackKernelsTest, test_sum_power_int16) // NOLINT
+{
+  static constexpr uint64_t nsamp = 77;
+  std::vector<int16_t> input;
+  fill_input(input, nsamp);
+
+  double expected = 0;
+  for (auto value : input)
+  {
+    expected += static_cast<double>(value) * static_cast<double>(value);
+  }
+
+  skip_if_unsupported();
+  set_simd_level(GetParam());
+  EXPECT_FLOAT_EQ(sum_complex_power(input.data(), nsamp), static_cast<float>(expected));
+}
+
+TEST_P(UnpackKernelsTest, test_convert_reduced_precision) // NOLINT
+{
+  static constexpr uint64_t nsamp = 77;
+  static constexpr float scale = 0.75;
+  std::vector<int8_t> input8;
+  std::vector<int16_t> input16;
+  fill_input(input8, nsamp);
+  fill_input(input16, nsamp);
+
+  std::vector<ComplexInt16> int16_8(nsamp);
+  std::vector<ComplexInt16> int16_16(nsamp);
+  std::vector<ComplexFP16> fp16_8(nsamp);
+  std::vector<ComplexFP16> fp16_16(nsamp);
+  std::vector<ComplexBF16> bf16_8(nsamp);
+  std::vector<ComplexBF16> bf16_16(nsamp);
+
+  skip_if_unsupported();
+  set_simd_level(GetParam());
+  convert_complex_samples(input8.data(), nsamp, scale, int16_8.data());
+  convert_complex_samples(input16.data(), nsamp, scale, int16_16.data());
+  convert_complex_samples(input8.data(), nsamp, scale, fp16_8.data());
+  convert_complex_samples(input16.data(), nsamp, scale, fp16_16.data());
+  convert_complex_samples(input8.data(), nsamp, scale, bf16_8.data());
+  convert_complex_samples(input16.data(), nsamp, scale, bf16_16.data());
+
+  // the vectorised kernels must match the scalar conversions exactly
+  for (uint64_t isamp=0; isamp<nsamp; isamp++)
+  {
+    const float re8 = static_cast<float>(input8[2*isamp]) * scale;
+    const float im8 = static_cast<float>(input8[2*isamp+1]) * scale;
+    const float re16 = static_cast<float>(input16[2*isamp]) * scale;
+    const float im16 = static_cast<float>(input16[2*isamp+1]) * scale;
+
+    ASSERT_EQ(int16_8[isamp].re, float_to_int16(re8));
+    ASSERT_EQ(int16_8[isamp].im, float_to_int16(im8));
+    ASSERT_EQ(int16_16[isamp].re, float_to_int16(re16));
+    ASSERT_EQ(int16_16[isamp].im, float_to_int16(im16));
+    ASSERT_EQ(fp16_8[isamp].re, float_to_fp16(re8));
+    ASSERT_EQ(fp16_8[isamp].im, float_to_fp16(im8));
+    ASSERT_EQ(fp16_16[isamp].re, float_to_fp16(re16));
+    ASSERT_EQ(fp16_16[isamp].im, float_to_fp16(im16));
+    ASSERT_EQ(bf16_8[isamp].re, float_to_bf16(re8));
+    ASSERT_EQ(bf16_8[isamp].im, float_to_bf16(im8));
+    ASSERT_EQ(bf16_16[isamp].re, float_to_bf16(re16));
+    ASSERT_EQ(bf16_16[isamp].im, float_to_bf16(im16));
+  }
+}
+
+TEST_P(UnpackKernelsTest, test_convert_int16_saturation) // NOLINT
+{
+  static constexpr uint64_t nsamp = 16;
+  static constexpr float scale = 1000.0;
+  std::vector<int16_t> input;
+  fill_input(input, nsamp);
+
+  std::vector<ComplexInt16> output(nsamp);
+  skip_if_unsupported();
+  set_simd_level(GetParam());
+  convert_complex_samples(input.data(), nsamp, scale, output.data());
+
+  for (uint64_t isamp=0; isamp<nsamp; isamp++)
+  {
+    ASSERT_EQ(output[isamp].re, float_to_int16(static_cast<float>(input[2*isamp]) * scale));
+    ASSERT_EQ(output[isamp].im, float_to_int16(static_cast<float>(input[2*isamp+1]) * scale));
+  }
+}
+
+TEST_P(UnpackKernelsTest, test_set_simd_level) // NOLINT
+{
+  if (GetParam() > get_supported_simd_level())
+  {
+    EXPECT_THROW(set_simd_level(GetParam()), std::runtime_error); // NOLINT
+  }
+  else
+  {
+    set_simd_level(GetParam());
+    EXPECT_EQ(get_simd_level(), GetParam());
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(SimdLevels, UnpackKernelsTest, testing::Values(Scalar, AVX2, AVX512)); // NOLINT
+
+} // namespace ska::pst::common::test
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <spdlog/spdlog.h>
+#include <cstring>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/WeightsCodecTest.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void WeightsCodecTest::SetUp()
+{
+  ska::pst::common::AsciiHeader header;
+  header.load_from_file(test_data_file("Low_AA0.5_weights_header.txt"));
+  stride = WeightsCodec::get_stride(header);
+}
+
+void WeightsCodecTest::TearDown()
+{
+}
+
+void WeightsCodecTest::fill_weights(uint64_t nrecord, uint64_t change_interval)
+{
+  static constexpr float unity_scale = 1.0;
+  static constexpr uint16_t unity_weight = 0xffff;
+  static constexpr uint16_t changed_weight = 0x7fff;
+  weights.resize(nrecord * stride);
+  uint16_t last_weight = unity_weight;
+  for (uint64_t irecord=0; irecord<nrecord; irecord++)
+  {
+    char * record = &weights[irecord * stride];
+    memcpy(record, &unity_scale, sizeof(float));
+    auto * record_weights = reinterpret_cast<uint16_t *>(record + sizeof(float)); // NOLINT
+    const uint64_t nweight = (stride - sizeof(float)) / sizeof(uint16_t);
+    for (uint64_t iweight=0; iweight<nweight; iweight++)
+    {
+      record_weights[iweight] = unity_weight; // NOLINT
+    }
+    if (change_interval > 0 && irecord % change_interval == 0)
+    {
+      last_weight = (last_weight == unity_weight) ? changed_weight : unity_weight;
+    }
+    record_weights[irecord % nweight] = last_weight; // NOLINT
+  }
+}
+
+auto WeightsCodecTest::round_trip(const WeightsCodec& codec, uint64_t nbytes) -> uint64_t
+{
+  std::vector<char> encoded(WeightsCodec::get_max_encoded_bytes(nbytes));
+  const uint64_t encoded_bytes = codec.encode(weights.data(), nbytes, encoded.data());
+  EXPECT_LE(encoded_bytes, encoded.size());
+
+  std::vector<char> decoded(nbytes);
+  codec.decode(encoded.data(), encoded_bytes, decoded.data(), nbytes);
+  for (uint64_t i=0; i<nbytes; i++)
+  {
+    EXPECT_EQ(decoded[i], weights[i]) << " i=" << i;
+    if (decoded[i] != weights[i])
+    {
+      break;
+    }
+  }
+  return encoded_bytes;
+}
+
+TEST_F(WeightsCodecTest, test_get_stride) // NOLINT
+{
+  EXPECT_EQ(stride, 52);
+  ska::pst::common::AsciiHeader header;
+  EXPECT_EQ(WeightsCodec::get_stride(header), WeightsCodec::default_stride);
+  EXPECT_THROW(WeightsCodec codec(2), std::runtime_error); // NOLINT
+}
+
+TEST_F(WeightsCodecTest, test_constant_weights) // NOLINT
+{
+  // identical packets reduce to the encoded first packet followed by a single run
+  static constexpr uint64_t nrecord = 10000;
+  fill_weights(nrecord, 0);
+  WeightsCodec codec(stride);
+  const uint64_t encoded_bytes = round_trip(codec, weights.size());
+  SPDLOG_INFO("ska::pst::common::test::WeightsCodecTest::test_constant_weights {} bytes encoded as {} bytes", weights.size(), encoded_bytes);
+  EXPECT_LE(encoded_bytes, 2 * stride);
+}
+
+TEST_F(WeightsCodecTest, test_slowly_changing_weights) // NOLINT
+{
+  static constexpr uint64_t nrecord = 4096;
+  static constexpr uint64_t change_interval = 100;
+  fill_weights(nrecord, change_interval);
+  WeightsCodec codec(stride);
+  EXPECT_LT(round_trip(codec, weights.size()) * 4, weights.size());
+}
+
+TEST_F(WeightsCodecTest, test_random_bytes) // NOLINT
+{
+  // incompressible data, of sizes that are not a multiple of the word or the stride
+  weights.resize(100003);
+  uint32_t state = 1;
+  for (auto& value : weights)
+  {
+    state = state * 1664525 + 1013904223; // NOLINT
+    value = static_cast<char>(state >> 24); // NOLINT
+  }
+
+  WeightsCodec codec(stride);
+  for (uint64_t nbytes : {0UL, 1UL, 3UL, 5UL, 53UL, weights.size()})
+  {
+    EXPECT_LE(round_trip(codec, nbytes), WeightsCodec::get_max_encoded_bytes(nbytes));
+  }
+}
+
+TEST_F(WeightsCodecTest, test_malformed_stream) // NOLINT
+{
+  static constexpr uint64_t nrecord = 100;
+  fill_weights(nrecord, 0);
+  WeightsCodec codec(stride);
+  std::vector<char> encoded(WeightsCodec::get_max_encoded_bytes(weights.size()));
+  const uint64_t encoded_bytes = codec.encode(weights.data(), weights.size(), encoded.data());
+
+  std::vector<char> decoded(weights.size());
+  EXPECT_THROW(codec.decode(encoded.data(), encoded_bytes - 1, decoded.data(), weights.size()), std::runtime_error); // NOLINT
+  EXPECT_THROW(codec.decode(encoded.data(), encoded_bytes, decoded.data(), weights.size() - 4), std::runtime_error); // NOLINT
+  EXPECT_THROW(codec.decode(encoded.data(), encoded_bytes, decoded.data(), weights.size() + 4), std::runtime_error); // NOLINT
+
+  // a token with a count of zero
+  memset(encoded.data(), 0, sizeof(uint32_t));
+  EXPECT_THROW(codec.decode(encoded.data(), encoded_bytes, decoded.data(), weights.size()), std::runtime_error); // NOLINT
+}
+
+} // namespace ska::pst::common::test
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ska/pst/common/utils/tests/WeightsDecoderTest.h"
+#include "ska/pst/common/testutils/GtestMain.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+unsigned constexpr nchan = 128;
+unsigned constexpr udp_nsamp = 32;
+unsigned constexpr udp_nchan = 16;   // nchan must be a multiple of udp_nchan
+unsigned constexpr wt_nsamp = 8;     // udp_nsamp must be a multiple of wt_nsamp
+
+unsigned constexpr packets_per_heap = nchan / udp_nchan;
+unsigned constexpr nblocks_per_chan = udp_nsamp / wt_nsamp;
+unsigned constexpr nblocks_per_packet = udp_nchan * nblocks_per_chan;
+
+void WeightsDecoderTest::SetUp()
+{
+  data_header.set("NCHAN",nchan);
+  data_header.set("NBIT",16);
+  data_header.set("NPOL",2);
+  data_header.set("NDIM",2);
+  data_header.set("UDP_NSAMP",udp_nsamp);
+  data_header.set("UDP_NCHAN",udp_nchan);
+  data_header.set("WT_NSAMP",wt_nsamp);
+
+  weights_header = data_header;
+  weights_header.set("NBIT",GetParam());
+  weights_header.set("NPOL",1);
+  weights_header.set("NDIM",1);
+
+  layout.configure(data_header, weights_header);
+}
+
+void WeightsDecoderTest::TearDown()
+{
+}
+
+auto WeightsDecoderTest::is_masked(uint32_t ipacket, uint32_t ichan, uint32_t iblock) -> bool
+{
+  return ((ipacket + ichan + iblock) % 5) == 0;
+}
+
+void WeightsDecoderTest::generate_weights(uint32_t nheaps)
+{
+  const auto& packet_layout = layout.get_packet_layout();
+  const uint32_t weights_nbit = GetParam();
+  weights.assign(static_cast<size_t>(nheaps) * layout.get_weights_heap_stride(), 0);
+
+  for (uint32_t iheap=0; iheap<nheaps; iheap++)
+  {
+    for (uint32_t ipacket=0; ipacket<packets_per_heap; ipacket++)
+    {
+      char * packet = &weights[(iheap * packets_per_heap + ipacket) * layout.get_weights_packet_stride()];
+      float scale = static_cast<float>(ipacket);
+      if (ipacket == 0)
+      {
+        scale = std::numeric_limits<float>::quiet_NaN();
+      }
+      memcpy(packet + packet_layout.get_packet_scales_offset(), &scale, sizeof(float)); // NOLINT
+
+      char * relative_weights = packet + packet_layout.get_packet_weights_offset(); // NOLINT
+      for (uint32_t ichan=0; ichan<udp_nchan; ichan++)
+      {
+        for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
+        {
+          const uint32_t idx = ichan * nblocks_per_chan + iblock;
+          // use a non-zero weight that is not all ones to verify that any non-zero value is unmasked
+          const uint16_t weight = is_masked(ipacket, ichan, iblock) ? 0 : static_cast<uint16_t>(1 + (idx % 7));
+          if (weights_nbit == 8) // NOLINT
+          {
+            relative_weights[idx] = static_cast<char>(weight); // NOLINT
+          }
+          else
+          {
+            memcpy(relative_weights + idx * sizeof(uint16_t), &weight, sizeof(uint16_t)); // NOLINT
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_P(WeightsDecoderTest, test_configure) // NOLINT
+{
+  ska::pst::common::WeightsDecoder decoder;
+  decoder.configure(layout);
+  EXPECT_EQ(decoder.get_nsamp_per_block(), wt_nsamp);
+  EXPECT_EQ(decoder.get_nblocks_per_chan(), nblocks_per_chan);
+  EXPECT_EQ(decoder.get_nblocks_per_packet(), nblocks_per_packet);
+  EXPECT_EQ(decoder.get_npackets(), 0);
+}
+
+TEST_P(WeightsDecoderTest, test_decode) // NOLINT
+{
+  static constexpr uint32_t nheaps = 3;
+  generate_weights(nheaps);
+
+  ska::pst::common::WeightsDecoder decoder;
+  decoder.configure(layout);
+  decoder.decode(&weights[0], nheaps);
+
+  ASSERT_EQ(decoder.get_npackets(), nheaps * packets_per_heap);
+  ASSERT_EQ(decoder.get_reciprocal_scales().size(), nheaps * packets_per_heap);
+
+  uint64_t expected_masked_blocks = 0;
+  for (uint32_t iheap=0; iheap<nheaps; iheap++)
+  {
+    for (uint32_t ipacket=0; ipacket<packets_per_heap; ipacket++)
+    {
+      const uint64_t packet_number = iheap * packets_per_heap + ipacket;
+      const float * mask = decoder.get_packet_mask(packet_number);
+
+      if (ipacket == 0)
+      {
+        EXPECT_FALSE(decoder.is_valid(packet_number));
+        EXPECT_FALSE(decoder.is_fully_weighted(packet_number));
+        EXPECT_EQ(decoder.get_reciprocal_scale(packet_number), 0.0);
+        for (uint32_t iblock=0; iblock<nblocks_per_packet; iblock++)
+        {
+          EXPECT_EQ(mask[iblock], 0.0); // NOLINT
+        }
+        continue;
+      }
+
+      const float expected_scale = (ipacket == 1) ? 1.0F : 1.0F / static_cast<float>(ipacket);
+      EXPECT_TRUE(decoder.is_valid(packet_number));
+      EXPECT_FLOAT_EQ(decoder.get_reciprocal_scale(packet_number), expected_scale);
+      EXPECT_EQ(decoder.get_reciprocal_scales()[packet_number], decoder.get_reciprocal_scale(packet_number));
+
+      bool fully_weighted = true;
+      for (uint32_t ichan=0; ichan<udp_nchan; ichan++)
+      {
+        for (uint32_t iblock=0; iblock<nblocks_per_chan; iblock++)
+        {
+          const bool masked = is_masked(ipacket, ichan, iblock);
+          EXPECT_EQ(mask[ichan * nblocks_per_chan + iblock], masked ? 0.0 : 1.0); // NOLINT
+          if (masked)
+          {
+            fully_weighted = false;
+            expected_masked_blocks++;
+          }
+        }
+      }
+      EXPECT_EQ(decoder.is_fully_weighted(packet_number), fully_weighted);
+    }
+  }
+
+  EXPECT_EQ(decoder.get_invalid_packets(), nheaps);
+  EXPECT_EQ(decoder.get_masked_blocks(), expected_masked_blocks);
+
+  // decoding fewer heaps replaces the previous state
+  decoder.decode(&weights[0], 1);
+  EXPECT_EQ(decoder.get_npackets(), packets_per_heap);
+  EXPECT_EQ(decoder.get_invalid_packets(), 1);
+  EXPECT_EQ(decoder.get_masked_blocks(), expected_masked_blocks / nheaps);
+}
+
+TEST_P(WeightsDecoderTest, test_fully_weighted) // NOLINT
+{
+  static constexpr uint32_t nheaps = 2;
+  static constexpr float scale = 4.0;
+  const auto& packet_layout = layout.get_packet_layout();
+
+  weights.assign(static_cast<size_t>(nheaps) * layout.get_weights_heap_stride(), '\xff');
+  for (uint32_t ipacket=0; ipacket<nheaps * packets_per_heap; ipacket++)
+  {
+    memcpy(&weights[ipacket * layout.get_weights_packet_stride() + packet_layout.get_packet_scales_offset()], &scale, sizeof(float));
+  }
+
+  ska::pst::common::WeightsDecoder decoder;
+  decoder.configure(layout);
+  decoder.decode(&weights[0], nheaps);
+
+  EXPECT_EQ(decoder.get_invalid_packets(), 0);
+  EXPECT_EQ(decoder.get_masked_blocks(), 0);
+  for (uint64_t ipacket=0; ipacket<decoder.get_npackets(); ipacket++)
+  {
+    EXPECT_TRUE(decoder.is_fully_weighted(ipacket));
+    EXPECT_EQ(decoder.get_reciprocal_scale(ipacket), 1.0F / scale);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(WeightsNbit, WeightsDecoderTest, testing::Values(8, 16)); // NOLINT
+
+} // namespace ska::pst::common::test
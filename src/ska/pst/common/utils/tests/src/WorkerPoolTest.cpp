@@ -0,0 +1,118 @@
+/*
+ * Copyright 2023 Square Kilometre Array Observatory
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ska/pst/common/testutils/GtestMain.h"
+#include "ska/pst/common/utils/tests/WorkerPoolTest.h"
+#include "ska/pst/common/utils/WorkerPool.h"
+
+auto main(int argc, char* argv[]) -> int
+{
+  return ska::pst::common::test::gtest_main(argc, argv);
+}
+
+namespace ska::pst::common::test {
+
+void WorkerPoolTest::SetUp()
+{
+}
+
+void WorkerPoolTest::TearDown()
+{
+}
+
+TEST_F(WorkerPoolTest, test_construct) // NOLINT
+{
+  EXPECT_THROW(WorkerPool pool(0), std::runtime_error); // NOLINT
+
+  static constexpr unsigned nthreads = 3;
+  WorkerPool pool(nthreads);
+  EXPECT_EQ(pool.get_nthreads(), nthreads);
+  EXPECT_THROW(pool.run(nthreads + 1, [](unsigned) {}), std::runtime_error); // NOLINT
+}
+
+TEST_F(WorkerPoolTest, test_run) // NOLINT
+{
+  static constexpr unsigned nthreads = 4;
+  static constexpr unsigned nsections = 1000;
+  WorkerPool pool(nthreads);
+
+  // every task of every section runs exactly once, on the same threads in each section
+  std::vector<unsigned> counts(nthreads, 0);
+  std::vector<std::set<std::thread::id>> thread_ids(nthreads);
+  std::mutex mutex;
+  for (unsigned isection=0; isection<nsections; isection++)
+  {
+    const unsigned ntasks = (isection % nthreads) + 1;
+    pool.run(ntasks, [&](unsigned itask) {
+      std::lock_guard<std::mutex> lock(mutex);
+      counts[itask]++;
+      thread_ids[itask].insert(std::this_thread::get_id());
+    });
+  }
+
+  for (unsigned itask=0; itask<nthreads; itask++)
+  {
+    EXPECT_EQ(counts[itask], nsections / nthreads * (nthreads - itask)) << " itask=" << itask;
+    EXPECT_EQ(thread_ids[itask].size(), 1) << " itask=" << itask;
+  }
+
+  // the first task runs on the calling thread
+  EXPECT_EQ(*thread_ids[0].begin(), std::this_thread::get_id());
+}
+
+TEST_F(WorkerPoolTest, test_exception) // NOLINT
+{
+  static constexpr unsigned nthreads = 3;
+  WorkerPool pool(nthreads);
+
+  // the exception is rethrown only after every task has completed
+  std::atomic<unsigned> completed{0};
+  EXPECT_THROW(pool.run(nthreads, [&](unsigned itask) { // NOLINT
+    if (itask == nthreads - 1)
+    {
+      throw std::runtime_error("task failed");
+    }
+    completed++;
+  }), std::runtime_error);
+  EXPECT_EQ(completed.load(), nthreads - 1);
+
+  // the pool remains usable after an exception
+  pool.run(nthreads, [&](unsigned) { completed++; });
+  EXPECT_EQ(completed.load(), (2 * nthreads) - 1);
+}
+
+} // namespace ska::pst::common::test